@@ -19,6 +19,8 @@
 #include <array>
 #include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "dfstypes.h"
 
@@ -33,8 +35,44 @@ namespace DFS
     virtual ~FileAccess();
     // On error, raise OsError.  On read beyond EOF, returns empty.
     virtual std::vector<byte> read(unsigned long offset, unsigned long len) = 0;
+    // As read(), but copies the data into out (which must have space
+    // for len bytes) and returns the number of bytes read.  The
+    // default implementation calls read(), but implementations which
+    // can read directly into out should override it.
+    virtual unsigned long read_into(unsigned long offset, unsigned long len, byte* out);
+    // If the data is exactly the content of a host file, return a
+    // descriptor for that file (which remains owned by this object),
+    // and the file's size.
+    virtual std::optional<std::pair<int, unsigned long>> host_file() const;
   };
 
+  // A span of sectors which are stored contiguously in a host file.
+  struct HostExtent
+  {
+    int fd;			// the host file.
+    unsigned long offset;	// byte position of the first sector.
+    unsigned long sectors;	// number of sectors in the span.
+  };
+
+  // Where a device is stored in a FileAccess at regular positions,
+  // SectorLayout describes where: sector lba (for lba < limit) is
+  // sector y = origin + lba of a device whose sectors are stored in
+  // groups of take sectors, each followed by leave unused sectors;
+  // that is, at sector skip + (y / take) * (take + leave) + y % take
+  // of the file.  If leave is 0, the mapping is simply skip + y.
+  struct SectorLayout
+  {
+    FileAccess* file;
+    unsigned long origin;
+    unsigned long limit;
+    unsigned long skip;
+    unsigned long take;
+    unsigned long leave;
+  };
+
+  // Implementations of FileAccess and DataAccess must allow several
+  // threads to read at once, so reads must not depend on (or change)
+  // a shared file position.
   class DataAccess
   {
   public:
@@ -45,6 +83,30 @@ namespace DFS
     // DFS file systems, while the lba address here could be a sector
     // position within (e.g.) an MMB file, which is much larger.
     virtual std::optional<SectorBuffer> read_block(unsigned long lba) = 0;
+
+    // Read up to count consecutive sectors starting at lba into out,
+    // which must have space for count * SECTOR_BYTES bytes.  Returns
+    // the number of sectors read; this is less than count if a sector
+    // could not be read (for example because it is beyond EOF).  On
+    // error, raise OsError.  The default implementation simply calls
+    // read_block() for each sector, but implementations which can
+    // fetch a run of sectors in a single operation should override it.
+    virtual unsigned long read_blocks(unsigned long lba, unsigned long count, byte* out);
+
+    // If sector lba (and possibly some of the following count-1
+    // sectors) are stored contiguously in a host file, return their
+    // location, so that callers can copy them without reading them
+    // through this interface.  Otherwise (for example for compressed
+    // or track-based images) return an empty optional.  The default
+    // implementation returns an empty optional.
+    virtual std::optional<HostExtent> host_extent(unsigned long lba, unsigned long count);
+
+    // If the sectors are stored at regular positions in a FileAccess,
+    // describe where, so that callers can compute their positions
+    // directly (see SectorResolver) instead of reading through this
+    // interface.  The default implementation returns an empty
+    // optional.
+    virtual std::optional<SectorLayout> sector_layout();
   };
 }
 #endif
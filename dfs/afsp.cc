@@ -16,37 +16,25 @@
 #include "afsp.h"
 
 #include <assert.h>             // for assert
-#include <ctype.h>              // for isdigit, tolower, toupper
+#include <ctype.h>              // for isdigit, tolower
 #include <stddef.h>             // for size_t
-#include <iostream>             // for operator<<, basic_ostream, ostringstream
+#include <algorithm>            // for all_of
 #include <optional>             // for optional
-#include <sstream>		// for ostringstream
-#include <string>               // for string, operator+, operator<<, char_t...
-#include <utility>              // for move
-#include <vector>               // for vector<>::const_iterator, vector
+#include <string>               // for string, operator+
+#include <string_view>          // for string_view
+#include <utility>              // for pair
+#include <vector>               // for vector
 
 #include "dfscontext.h"         // for DFSContext
 #include "driveselector.h"      // for VolumeSelector
-#include "regularexpression.h"  // for RegularExpression
-#include "stringutil.h"         // for rtrim
-
-namespace DFS { class StorageConfiguration; }
 
 using std::string;
 using std::vector;
 
 namespace
 {
-  using DFS::stringutil::rtrim;
   using DFS::AFSPMatcher;
   using DFS::DFSContext;
-  using DFS::RegularExpression;
-  using DFS::StorageConfiguration;
-
-  inline char up(char ch)
-  {
-    return static_cast<char>(toupper(static_cast<unsigned char>(ch)));
-  }
 
   inline char down(char ch)
   {
@@ -63,81 +51,89 @@ namespace
     return result;
   }
 
-  string directory_prefix(char directory)
+  // Return the length of the drive prefix (for example ":0." or
+  // ":12B.") at the start of s, or 0 if s doesn't start with one.  A
+  // drive prefix has one or more decimal digits, optionally followed
+  // by an Opus DDOS volume letter A-H.
+  size_t drive_prefix_length(const string& s)
   {
-    string result(2, '.');
-    result[0] = directory;
-    return result;
+    if (s.empty() || s[0] != ':')
+      return 0;
+    size_t i = 1;
+    while (i < s.size() && isdigit(static_cast<unsigned char>(s[i])))
+      ++i;
+    if (i == 1)
+      return 0;			// no digits.
+    if (i < s.size() && s[i] >= 'A' && s[i] <= 'H')
+      ++i;
+    if (i < s.size() && s[i] == '.')
+      return i + 1;
+    return 0;
   }
 
-  bool transform_string_with_regex(const DFS::VolumeSelector vol,
-				   const char dir,
-				   const string& input,
-				   const string& regex_pattern,
-				   const char * invalid,
-				   string* out, string* error_message)
+  // Split input into drive, directory and name parts, any of which
+  // except the name may be omitted; omitted parts are filled in from
+  // vol and dir.  Directory and name may not contain any of the
+  // characters in forbidden, nor a dot.
+  bool split_file_name(const DFS::VolumeSelector vol,
+		       const char dir,
+		       const string& input,
+		       const char *forbidden,
+		       const char *invalid,
+		       string* out, string* error_message)
   {
-    RegularExpression rx(regex_pattern);
-    if (!rx.compile())
+    auto allowed = [forbidden](char ch) -> bool
+		   {
+		     return ch != '.' && std::string_view(forbidden).find(ch) == std::string_view::npos;
+		   };
+    auto split_at = [&](size_t drive_len) -> bool
       {
-	std::ostringstream ss;
-	ss << "failed to compile regular expression " << regex_pattern
-	   << ": " << rx.error_message();
-	error_message->assign(ss.str());
-	return false;
-      }
-    assert(rx.valid());
-    auto groups = rx.match(input.c_str());
-    if (!rx.valid())
-      {
-	error_message->assign(rx.error_message());
-	return false;
-      }
-    if (groups.empty())
-      {
-	error_message->assign(invalid);
-	return false;
-      }
-
-#if defined(VERBOSE_FOR_TESTS)
-    RegularExpression::display_matches(regex_pattern.c_str(), input, groups);
-#endif
-
-    string drive, directory, name;
-    if (groups.size() > 1 && !groups[1].empty())
-      drive = groups[1];
-    else
-      drive = drive_prefix(vol);
-    if (groups.size() > 2 && !groups[2].empty())
-      directory = groups[2];
-    else
-      directory = directory_prefix(dir);
-    if (groups.size() > 3 && !groups[3].empty())
-      {
-	name = groups[3];
-      }
-    else
-      {
-	error_message->assign(invalid);
-	return false;
-      }
-    out->clear();
-    out->reserve(drive.size() + directory.size() + name.size());
-    out->append(drive);
-    out->append(directory);
-    out->append(name);
-    return true;
+	const string rest(input.substr(drive_len));
+	size_t name_pos = 0;
+	if (rest.size() > 1 && rest[1] == '.' && allowed(rest[0]))
+	  name_pos = 2;
+	if (name_pos == rest.size())
+	  return false;		// no name.
+	for (size_t i = name_pos; i < rest.size(); ++i)
+	  {
+	    if (!allowed(rest[i]))
+	      return false;
+	  }
+	out->clear();
+	if (drive_len)
+	  out->append(input.substr(0, drive_len));
+	else
+	  out->append(drive_prefix(vol));
+	if (name_pos)
+	  {
+	    out->append(rest.substr(0, 2));
+	  }
+	else
+	  {
+	    out->push_back(dir);
+	    out->push_back('.');
+	  }
+	out->append(rest.substr(name_pos));
+	return true;
+      };
+    const size_t drive_len = drive_prefix_length(input);
+    // If the drive prefix is invalid, what looks like a drive might
+    // instead be part of the name (when colons are allowed there).
+    if ((drive_len && split_at(drive_len)) || split_at(0))
+      return true;
+    error_message->assign(invalid);
+    return false;
   }
 
-  /* Convert a DFS ambiguous file specification into a POSIX regular
-     expression.   The mapping is:
-     DFS       Extended Regex
-     :         :     (matches only itself)
-     #         [^.]  (matches any single character except .)
-     *         [^.]* (matches any sequence of characters other than .)
-     .         [.]   (matches only itself)
-     x         [xX]  (alphabetic characters match their upper or lower case selves)
-     4         [4]   (other characters match only themselves)
+  /* Compile a DFS ambiguous file specification.   The elements are:
+     DFS       Meaning
+     #         any single character
+     *         any sequence of characters (including none)
+     x         x (alphabetic characters match their upper or lower case selves)
+     4         4 (other characters match only themselves)
+
+     Since qualified file names never contain a dot, there is no
+     need to exclude it from what # and * match.
 
      Some documentation claims that the Acorn DFS does not allow * in
      a position other than at the end of the wildcard, but my testing
@@ -150,83 +146,22 @@ namespace
      Opus DDOS 3.45 does not (giving the error "Bad drive")
      Solidisk DOS 2.1 does not (giving the error "Bad filename")
   */
-  bool convert_wildcard_into_extended_regex(DFS::VolumeSelector* vol, char dir, const string& wild,
-					    string* ere, string* error_message)
+  AFSPMatcher::Instruction compile_one(char w)
   {
-    string full_wildcard;
-    if (!DFS::internal::extend_wildcard(*vol, dir, wild, &full_wildcard, error_message))
-      return false;
-    assert(full_wildcard.size() > 0 && full_wildcard[0] == ':');
-    // We expect the wildcard to be of the form :NN.D.blah where DD is
-    // the drive number.
-    if (!isdigit(full_wildcard[1]))
-      {
-	error_message->assign("No drive number in " + full_wildcard);
-	return false;
-      }
-    size_t end;
-    // The base matters because we support drive numbers greater
-    // than 3.
-    std::string err;
-    std::optional<DFS::VolumeSelector> got = DFS::VolumeSelector::parse(full_wildcard.substr(1), &end, err);
-    if (!got)
+    switch (w)
       {
-	error_message->assign(err);
-	return false;
+      case '#':
+	return AFSPMatcher::Instruction{AFSPMatcher::Instruction::Op::AnyChar, '\0'};
+      case '*':
+	return AFSPMatcher::Instruction{AFSPMatcher::Instruction::Op::AnySequence, '\0'};
+      default:
+	return AFSPMatcher::Instruction{AFSPMatcher::Instruction::Op::Literal, down(w)};
       }
-    *vol = *got;
-    ++end;
-    if (full_wildcard[end] != '.')
-      {
-	error_message->assign("Non-digit after drive number in " + full_wildcard
-			      + ", specifically " + full_wildcard.substr(end));
-	return false;
-      }
-    vector<char> parts = {'^'};
-    for (auto w : full_wildcard)
-      {
-	switch (w)
-	  {
-	  case ':':
-	    parts.push_back(':');
-	    break;
-
-	  case '#':
-	    parts.push_back('[');
-	    parts.push_back('^');
-	    parts.push_back('.');
-	    parts.push_back(']');
-	    break;
-
-	  case '*':
-	    parts.push_back('[');
-	    parts.push_back('^');
-	    parts.push_back('.');
-	    parts.push_back(']');
-	    parts.push_back('*');
-	    break;
+  }
 
-	  case '.':
-	  default:
-	    if (up(w) != down(w))
-	      {
-		parts.push_back('[');
-		parts.push_back(up(w));
-		parts.push_back(down(w));
-		parts.push_back(']');
-	      }
-	    else
-	      {
-		parts.push_back('[');
-		parts.push_back(w);
-		parts.push_back(']');
-	      }
-	    break;
-	  }
-      }
-    parts.push_back('$');
-    ere->assign(parts.cbegin(), parts.cend());
-    return true;
+  bool is_literal(const AFSPMatcher::Instruction& insn)
+  {
+    return insn.op == AFSPMatcher::Instruction::Op::Literal;
   }
 }  // namespace
 
@@ -238,26 +173,16 @@ namespace DFS
 		 string* out, string* error_message)
     {
       static const char invalid[] = "not a valid file name";
-      static const char *ddn_pat = "^"
-	"(:[0-9]+[A-H]?[.])?"	// drive (more than one digit is OK) with optional Opus DDOS sub volume
-	"([^.:#*][.])?"		// directory (HDFS is not supported yet)
-	"([^.:#*]+)$";		// file name (with trailing blanks trimmed)
-      bool result = transform_string_with_regex(vol, dir, rtrim(filename), ddn_pat, invalid,
-						out, error_message);
-#if VERBOSE_FOR_TESTS
-      std::cerr << "qualify: '" << filename << "' -> '" << *out << "'\n";
-#endif
-      return result;
+      // Trailing blanks in the file name are trimmed.
+      const string::size_type end = filename.find_last_not_of(' ');
+      const string trimmed(end == string::npos ? string() : filename.substr(0, end + 1));
+      return split_file_name(vol, dir, trimmed, ":#*", invalid, out, error_message);
     }
 
     bool extend_wildcard(DFS::VolumeSelector vol, char dir, const string& wild,
 			 string* out, string* error_message)
     {
-      static const char *ddn_pat = "^"
-	"(:[0-9]+[A-H]?[.])?"   // drive (more than one digit is OK) and optional (Opus DDOS) volume
-	"([^.][.])?"		// directory (no support for HDFS yet)
-	"([^.]+)$";		// file name
-      return transform_string_with_regex(vol, dir, wild, ddn_pat, "bad name", out, error_message);
+      return split_file_name(vol, dir, wild, "", "bad name", out, error_message);
     }
 
   }  // namespace internal
@@ -265,28 +190,58 @@ namespace DFS
 AFSPMatcher::AFSPMatcher(const AFSPMatcher::FactoryKey&,
 			 const DFSContext& ctx, const string& wildcard,
 			 string *error_message)
-  : valid_(false), vol_(ctx.current_volume), implementation_(0)
+  : valid_(false), vol_(ctx.current_volume),
+    dir_{Instruction::Op::AnyChar, '\0'}
 {
-  string ere;
-  valid_ = convert_wildcard_into_extended_regex(&vol_,
-						ctx.current_directory,
-						wildcard, &ere, error_message);
-  if (valid_)
+  string full_wildcard;
+  if (!DFS::internal::extend_wildcard(vol_, ctx.current_directory, wildcard,
+				      &full_wildcard, error_message))
+    return;
+  // We expect the wildcard to be of the form :NN.D.blah where NN is
+  // the drive number.
+  assert(full_wildcard.size() > 0 && full_wildcard[0] == ':');
+  if (!isdigit(static_cast<unsigned char>(full_wildcard[1])))
     {
-#if defined(VERBOSE_FOR_TESTS)
-      std::cerr << "AFSPMatcher: wildcard " << wildcard
-		<< " translates to ERE pattern " << ere << "\n";
-#endif
-      RegularExpression* re = new RegularExpression(ere);
-      if (!re->compile() || !re->valid())
-	{
-	  valid_ = false;
-	  error_message->assign(re->error_message());
-	  delete re;
-	  return;
-	}
-      implementation_ = re;
+      error_message->assign("No drive number in " + full_wildcard);
+      return;
+    }
+  size_t end;
+  std::string err;
+  std::optional<DFS::VolumeSelector> got = DFS::VolumeSelector::parse(full_wildcard.substr(1), &end, err);
+  if (!got)
+    {
+      error_message->assign(err);
+      return;
+    }
+  vol_ = *got;
+  ++end;
+  if (full_wildcard[end] != '.')
+    {
+      error_message->assign("Non-digit after drive number in " + full_wildcard
+			    + ", specifically " + full_wildcard.substr(end));
+      return;
     }
+  // What follows the drive is D.NAME.
+  const string::size_type dir_pos = end + 1;
+  assert(full_wildcard.size() > dir_pos + 2 && full_wildcard[dir_pos + 1] == '.');
+  dir_ = compile_one(full_wildcard[dir_pos]);
+  name_.reserve(full_wildcard.size() - (dir_pos + 2));
+  for (auto it = full_wildcard.cbegin() + (dir_pos + 2); it != full_wildcard.cend(); ++it)
+    {
+      Instruction insn = compile_one(*it);
+      // Consecutive stars are equivalent to just one.
+      if (insn.op == Instruction::Op::AnySequence && !name_.empty()
+	  && name_.back().op == Instruction::Op::AnySequence)
+	continue;
+      name_.push_back(insn);
+    }
+  if (is_literal(dir_) && std::all_of(name_.cbegin(), name_.cend(), is_literal))
+    {
+      // There are no wildcard characters, so the caller can look the
+      // file up directly.
+      literal_name_.emplace(full_wildcard[dir_pos], full_wildcard.substr(dir_pos + 2));
+    }
+  valid_ = true;
 }
 
 DFS::VolumeSelector AFSPMatcher::get_volume() const
@@ -294,42 +249,74 @@ DFS::VolumeSelector AFSPMatcher::get_volume() const
   return vol_;
 }
 
-bool AFSPMatcher::matches(DFS::VolumeSelector vol, char directory, const std::string& name)
+bool AFSPMatcher::matches(DFS::VolumeSelector vol, char directory, const std::string& name) const
 {
   if (!valid())
     return false;
-  assert(implementation_);
-  string full_name;
-  string error_message;
-  if (!DFS::internal::qualify(vol, directory, name, &full_name, &error_message))
+  if (!(vol == vol_))
+    return false;
+  if (is_literal(dir_) && dir_.ch != down(directory))
+    return false;
+
+  // Trailing blanks in the name are ignored.  The name must be
+  // something that qualify() would accept; that is, it must be
+  // non-empty and contain no dot, colon or wildcard character.
+  size_t len = name.size();
+  while (len > 0 && name[len - 1] == ' ')
+    --len;
+  if (len == 0)
+    return false;
+  for (size_t i = 0; i < len; ++i)
     {
-#if VERBOSE_FOR_TESTS
-      std::cerr << "not matched (because " << error_message << "): " << full_name
-		<< " (canonicalised from " << name << ")\n";
-#endif
-      return false;
+      switch (name[i])
+	{
+	case '.':
+	case ':':
+	case '#':
+	case '*':
+	  return false;
+	default:
+	  break;
+	}
     }
-  RegularExpression* re = static_cast<RegularExpression*>(implementation_);
-  vector<string> matches = re->match(full_name.c_str());
-  if (matches.empty())
+
+  // Match the name against the compiled pattern.  When we run into a
+  // mismatch, we retry from the most recent star, making it consume one
+  // more character.  Earlier stars never need to be revisited.
+  const size_t plen = name_.size();
+  size_t p = 0, n = 0;
+  size_t star_p = plen, star_n = 0;
+  while (n < len)
     {
-#if VERBOSE_FOR_TESTS
-      std::cerr << "not matched: " << full_name
-		<< " (canonicalised from " << name << ")\n";
-#endif
-      return false;
+      if (p < plen)
+	{
+	  const Instruction& insn = name_[p];
+	  if (insn.op == Instruction::Op::AnySequence)
+	    {
+	      star_p = p++;
+	      star_n = n;
+	      continue;
+	    }
+	  if (insn.op == Instruction::Op::AnyChar || insn.ch == down(name[n]))
+	    {
+	      ++p;
+	      ++n;
+	      continue;
+	    }
+	}
+      if (star_p == plen)
+	return false;
+      p = star_p + 1;
+      n = ++star_n;
     }
-  return true;
+  while (p < plen && name_[p].op == Instruction::Op::AnySequence)
+    ++p;
+  return p == plen;
 }
 
 
 AFSPMatcher::~AFSPMatcher()
 {
-  if (implementation_)
-    {
-      RegularExpression* re = static_cast<RegularExpression*>(implementation_);
-      delete re;
-    }
 }
 
 
@@ -15,7 +15,10 @@
 //
 // Acorn DFS ambiguous file specification matcher
 #include <memory>           // for unique_ptr
+#include <optional>         // for optional
 #include <string>           // for string
+#include <utility>          // for pair
+#include <vector>           // for vector
 
 #include "driveselector.h"  // for VolumeSelector
 
@@ -31,7 +34,9 @@ class AFSPMatcher
   static std::unique_ptr<AFSPMatcher>
   make_unique(const DFSContext& ctx, const std::string& pattern, std::string* error);
 
-  bool matches(DFS::VolumeSelector vol, char directory, const std::string& name);
+  // Return true if the file with the specified name matches the
+  // wildcard.  No memory is allocated.
+  bool matches(DFS::VolumeSelector vol, char directory, const std::string& name) const;
 
   // Acorn DFS wildcards can include a drive number, but the drive
   // number field itself cannot be a wildcard.  That is, :*.$.!BOOT is
@@ -39,6 +44,16 @@ class AFSPMatcher
   // associated drive numbers.  We extend the idea to cover Opus DDOS
   // volumes.
   DFS::VolumeSelector get_volume() const;
+
+  // When the pattern contains no wildcard characters (for example
+  // :0.$.!BOOT) it can only match files having one particular
+  // directory and name (ignoring case).  In that case, return them,
+  // so that the caller can look the file up directly instead of
+  // testing every catalog entry.
+  const std::optional<std::pair<char, std::string>>& literal_name() const
+  {
+    return literal_name_;
+  }
   static bool self_test();
 
   // The point of FactoryKey is to ensure that only MakeUnique() can
@@ -49,6 +64,15 @@ class AFSPMatcher
 		       std::string* error_message);
   ~AFSPMatcher();
 
+  // A wildcard is compiled into a sequence of instructions, one for
+  // each character of the directory and name parts of the wildcard.
+  struct Instruction
+  {
+    enum class Op { Literal, AnyChar, AnySequence };
+    Op op;
+    char ch;			// Literal only; folded to lower case.
+  };
+
  private:
   bool valid() const
   {
@@ -56,12 +80,10 @@ class AFSPMatcher
   }
 
   bool valid_;
-  // TODO: move the volume selector out of the AFSPMatcher's regex.
-  // It knows which volume it is going to match on (because we can ask
-  // for the value of vol_), and so there is no point offering it file
-  // names from other drives.
   DFS::VolumeSelector vol_;
-  void *implementation_;
+  Instruction dir_;
+  std::vector<Instruction> name_;
+  std::optional<std::pair<char, std::string>> literal_name_;
 };
 
   namespace internal
@@ -0,0 +1,362 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "archive.h"
+
+#include <assert.h>       // for assert
+#include <errno.h>        // for errno
+#include <stdlib.h>       // for abort
+#include <string.h>       // for strerror
+#include <time.h>         // for localtime_r, tm
+#include <algorithm>      // for copy, fill
+#include <array>          // for array
+#include <vector>         // for vector
+
+#include "crc.h"          // for CRC32
+#include "exceptions.h"   // for BaseException, FileIOError
+
+namespace
+{
+  using DFS::byte;
+
+  class ArchiveLimitExceeded : public DFS::BaseException
+  {
+  public:
+    explicit ArchiveLimitExceeded(const std::string& msg)
+      : BaseException(msg)
+    {
+    }
+  };
+
+  // A ustar archive (POSIX.1-1988 as extended by POSIX.1-2001).
+  class TarWriter : public DFS::ArchiveWriter
+  {
+  public:
+    static constexpr unsigned long block_size = 512;
+    // tar reads and writes in records of 20 blocks.
+    static constexpr unsigned long record_size = 20 * block_size;
+
+    TarWriter(std::ostream& out, time_t mtime)
+      : out_(out), mtime_(mtime), written_(0), remaining_(0)
+    {
+    }
+
+    void begin_member(const std::string& name, unsigned long size) override
+    {
+      assert(remaining_ == 0);
+      std::array<char, block_size> header;
+      header.fill(0);
+      if (name.size() > 100)
+	throw ArchiveLimitExceeded("file name " + name + " is too long for a tar archive");
+      if (size > 077777777777uL)
+	throw ArchiveLimitExceeded("file " + name + " is too large for a tar archive");
+      std::copy(name.begin(), name.end(), header.begin());
+      octal(&header[100], 8, 0644);	      // mode
+      octal(&header[108], 8, 0);	      // uid
+      octal(&header[116], 8, 0);	      // gid
+      octal(&header[124], 12, size);
+      octal(&header[136], 12, static_cast<unsigned long>(mtime_));
+      header[156] = '0';		      // regular file
+      const std::string magic("ustar");
+      std::copy(magic.begin(), magic.end(), &header[257]); // and a NUL
+      header[263] = '0';		      // version "00"
+      header[264] = '0';
+      // The checksum is computed as if its own field contained spaces.
+      std::fill(&header[148], &header[156], ' ');
+      unsigned long sum = 0;
+      for (char c : header)
+	sum += static_cast<unsigned char>(c);
+      octal(&header[148], 7, sum);
+      emit(header.data(), block_size);
+      remaining_ = size;
+    }
+
+    void write(const byte* begin, const byte* end) override
+    {
+      const unsigned long len = static_cast<unsigned long>(end - begin);
+      assert(len <= remaining_);
+      emit(reinterpret_cast<const char*>(begin), len);
+      remaining_ -= len;
+    }
+
+    void end_member() override
+    {
+      assert(remaining_ == 0);
+      pad_to(block_size);
+    }
+
+    void finish() override
+    {
+      // The end of the archive is marked by two zero blocks.
+      const std::array<char, 2 * block_size> zeroes = {};
+      emit(zeroes.data(), zeroes.size());
+      pad_to(record_size);
+      out_.flush();
+    }
+
+  private:
+    // Write value into a field of width bytes as octal digits followed
+    // by a NUL.
+    static void octal(char* field, int width, unsigned long value)
+    {
+      field[width - 1] = '\0';
+      for (int i = width - 2; i >= 0; --i)
+	{
+	  field[i] = static_cast<char>('0' + (value & 7));
+	  value >>= 3;
+	}
+    }
+
+    void emit(const char* p, unsigned long len)
+    {
+      out_.write(p, static_cast<std::streamsize>(len));
+      written_ += len;
+    }
+
+    void pad_to(unsigned long multiple)
+    {
+      const std::array<char, block_size> zeroes = {};
+      while (written_ % multiple)
+	{
+	  const unsigned long partial = written_ % block_size;
+	  emit(zeroes.data(), block_size - partial);
+	}
+    }
+
+    std::ostream& out_;
+    time_t mtime_;
+    unsigned long written_;
+    unsigned long remaining_;
+  };
+
+  // A zip archive whose members are stored (not compressed).  The
+  // local header of a member has to give its CRC, so the data of
+  // each member is held until end_member().  DFS files and discs are
+  // small enough for this not to matter.
+  class ZipWriter : public DFS::ArchiveWriter
+  {
+  public:
+    ZipWriter(std::ostream& out, time_t mtime)
+      : out_(out), written_(0), dos_time_(0), dos_date_(0)
+    {
+      struct tm t;
+      if (localtime_r(&mtime, &t) && t.tm_year >= 80)
+	{
+	  dos_time_ = static_cast<unsigned>((t.tm_hour << 11) | (t.tm_min << 5) | (t.tm_sec / 2));
+	  dos_date_ = static_cast<unsigned>(((t.tm_year - 80) << 9) | ((t.tm_mon + 1) << 5) | t.tm_mday);
+	}
+      else
+	{
+	  dos_date_ = (1 << 5) | 1;	// 1980-01-01
+	}
+    }
+
+    void begin_member(const std::string& name, unsigned long size) override
+    {
+      if (name.size() > 0xFFFF)
+	throw ArchiveLimitExceeded("file name " + name + " is too long for a zip archive");
+      if (members_.size() >= 0xFFFF)
+	throw ArchiveLimitExceeded("too many files for a zip archive");
+      current_ = Member{name, 0, size, 0};
+      data_.clear();
+      data_.reserve(size);
+    }
+
+    void write(const byte* begin, const byte* end) override
+    {
+      data_.insert(data_.end(), begin, end);
+    }
+
+    void end_member() override
+    {
+      assert(data_.size() == current_.size);
+      DFS::CRC32 crc;
+      crc.update(data_.data(), data_.data() + data_.size());
+      current_.crc = crc.get();
+      current_.offset = written_;
+      if (current_.offset + 30 + current_.name.size() + data_.size() > 0xFFFFFFFFuL)
+	throw ArchiveLimitExceeded("the output is too large for a zip archive");
+      std::vector<byte> header;
+      put32(header, 0x04034b50uL);	// local file header signature
+      put_common(header, current_);
+      put16(header, 0);			// extra field length
+      header.insert(header.end(), current_.name.begin(), current_.name.end());
+      emit(header.data(), header.size());
+      emit(data_.data(), data_.size());
+      members_.push_back(current_);
+      data_.clear();
+    }
+
+    void finish() override
+    {
+      const unsigned long directory_offset = written_;
+      std::vector<byte> dir;
+      for (const Member& m : members_)
+	{
+	  put32(dir, 0x02014b50uL);	// central file header signature
+	  put16(dir, (3 << 8) | 20);	// made by: Unix, version 2.0
+	  put_common(dir, m);
+	  put16(dir, 0);		// extra field length
+	  put16(dir, 0);		// file comment length
+	  put16(dir, 0);		// disk number start
+	  put16(dir, 0);		// internal file attributes
+	  put32(dir, 0100644uL << 16);	// external attributes: Unix mode
+	  put32(dir, m.offset);
+	  dir.insert(dir.end(), m.name.begin(), m.name.end());
+	}
+      emit(dir.data(), dir.size());
+      std::vector<byte> end;
+      put32(end, 0x06054b50uL);		// end of central dir signature
+      put16(end, 0);			// number of this disk
+      put16(end, 0);			// disk where central directory starts
+      put16(end, members_.size());
+      put16(end, members_.size());
+      put32(end, dir.size());
+      put32(end, directory_offset);
+      put16(end, 0);			// comment length
+      emit(end.data(), end.size());
+      out_.flush();
+    }
+
+  private:
+    struct Member
+    {
+      std::string name;
+      unsigned long crc;
+      unsigned long size;
+      unsigned long offset;
+    };
+
+    static void put16(std::vector<byte>& v, unsigned long n)
+    {
+      v.push_back(static_cast<byte>(n & 0xFF));
+      v.push_back(static_cast<byte>((n >> 8) & 0xFF));
+    }
+
+    static void put32(std::vector<byte>& v, unsigned long n)
+    {
+      put16(v, n & 0xFFFF);
+      put16(v, (n >> 16) & 0xFFFF);
+    }
+
+    // The fields from "version needed to extract" to "file name
+    // length", which the local and central headers have in common.
+    void put_common(std::vector<byte>& v, const Member& m) const
+    {
+      put16(v, 10);			// version needed to extract: 1.0
+      put16(v, 0);			// general purpose flags
+      put16(v, 0);			// compression method: stored
+      put16(v, dos_time_);
+      put16(v, dos_date_);
+      put32(v, m.crc);
+      put32(v, m.size);			// compressed size
+      put32(v, m.size);			// uncompressed size
+      put16(v, m.name.size());
+    }
+
+    void emit(const byte* p, unsigned long len)
+    {
+      out_.write(reinterpret_cast<const char*>(p), static_cast<std::streamsize>(len));
+      written_ += len;
+    }
+
+    std::ostream& out_;
+    unsigned long written_;
+    unsigned dos_time_;
+    unsigned dos_date_;
+    Member current_;
+    std::vector<byte> data_;
+    std::vector<Member> members_;
+  };
+}  // namespace
+
+namespace DFS
+{
+  std::optional<ArchiveFormat> archive_format_from_name(const std::string& name)
+  {
+    if (name == "tar")
+      return ArchiveFormat::Tar;
+    if (name == "zip")
+      return ArchiveFormat::Zip;
+    return std::nullopt;
+  }
+
+  ArchiveWriter::~ArchiveWriter()
+  {
+  }
+
+  void ArchiveWriter::add_member(const std::string& name, const byte* begin, const byte* end)
+  {
+    begin_member(name, static_cast<unsigned long>(end - begin));
+    write(begin, end);
+    end_member();
+  }
+
+  std::unique_ptr<ArchiveWriter> make_archive_writer(ArchiveFormat format,
+						     std::ostream& out,
+						     time_t mtime)
+  {
+    switch (format)
+      {
+      case ArchiveFormat::Tar:
+	return std::make_unique<TarWriter>(out, mtime);
+      case ArchiveFormat::Zip:
+	return std::make_unique<ZipWriter>(out, mtime);
+      }
+    abort();
+  }
+
+  ArchiveOutput::ArchiveOutput(const std::string& name, std::ostream& standard_output)
+    : name_(name), standard_output_(standard_output)
+  {
+    if (!is_stdout())
+      {
+	file_.open(name_, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+	if (!file_.good())
+	  throw FileIOError(name_, errno);
+      }
+  }
+
+  bool ArchiveOutput::is_stdout() const
+  {
+    return name_ == "-";
+  }
+
+  std::ostream& ArchiveOutput::stream()
+  {
+    if (is_stdout())
+      return standard_output_;
+    return file_;
+  }
+
+  std::string ArchiveOutput::description() const
+  {
+    return is_stdout() ? std::string("the standard output") : name_;
+  }
+
+  bool ArchiveOutput::close(std::string* error)
+  {
+    if (is_stdout())
+      standard_output_.flush();
+    else
+      file_.close();
+    if (!stream().good())
+      {
+	*error = description() + ": " + strerror(errno);
+	return false;
+      }
+    return true;
+  }
+}  // namespace DFS
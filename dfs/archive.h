@@ -0,0 +1,82 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Writing extracted data as a single archive (tar or zip) instead of
+// as separate files.
+#ifndef INC_ARCHIVE_H
+#define INC_ARCHIVE_H 1
+
+#include <time.h>        // for time_t
+#include <fstream>       // for ofstream
+#include <iostream>      // for ostream
+#include <memory>        // for unique_ptr
+#include <optional>      // for optional
+#include <string>        // for string
+
+#include "dfstypes.h"    // for byte
+
+namespace DFS
+{
+  enum class ArchiveFormat { Tar, Zip };
+
+  // Convert the value of an --archive option ("tar" or "zip").
+  std::optional<ArchiveFormat> archive_format_from_name(const std::string&);
+
+  // Writes members, one after the other, to an archive.  Each member
+  // is begun with its name and exact size, then its data is supplied
+  // in any number of pieces.  Nothing is written to the stream after
+  // finish().  Stream errors are not diagnosed here; callers should
+  // check the state of the stream once they are done.
+  class ArchiveWriter
+  {
+  public:
+    virtual ~ArchiveWriter();
+    virtual void begin_member(const std::string& name, unsigned long size) = 0;
+    virtual void write(const byte* begin, const byte* end) = 0;
+    virtual void end_member() = 0;
+    virtual void finish() = 0;
+
+    // Add a member whose data is all available at once.
+    void add_member(const std::string& name, const byte* begin, const byte* end);
+  };
+
+  // Members are given the modification time mtime.  The names of
+  // tar members are limited to 100 characters.
+  std::unique_ptr<ArchiveWriter> make_archive_writer(ArchiveFormat format,
+						     std::ostream& out,
+						     time_t mtime);
+
+  // The destination of an archive: a named file or, if the name is
+  // "-", standard_output.
+  class ArchiveOutput
+  {
+  public:
+    // Throws FileIOError if the file cannot be created.
+    ArchiveOutput(const std::string& name, std::ostream& standard_output);
+    std::ostream& stream();
+    bool is_stdout() const;
+    // How to describe the destination in messages.
+    std::string description() const;
+    // Flush the output.  On failure, returns false and sets *error.
+    bool close(std::string* error);
+
+  private:
+    std::string name_;
+    std::ostream& standard_output_;
+    std::ofstream file_;
+  };
+}  // namespace DFS
+
+#endif
@@ -0,0 +1,222 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "beebtools.h"
+
+#include <string.h>         // for memcpy
+#include <algorithm>        // for min
+#include <exception>        // for exception
+#include <optional>         // for optional
+#include <sstream>          // for ostringstream
+#include <utility>          // for move
+
+#include "dfs.h"            // for verbose, set_diagnostic_stream
+#include "dfs_catalog.h"    // for Catalog, CatalogEntry
+#include "dfs_filesystem.h" // for FileSystem
+#include "dfs_volume.h"     // for Volume
+#include "dfscontext.h"     // for DFSContext
+#include "driveselector.h"  // for VolumeSelector, SurfaceSelector
+#include "fsp.h"            // for ParsedFileName, parse_filename
+#include "media.h"          // for AbstractImageFile, make_image_file
+#include "storage.h"        // for StorageConfiguration, VolumeMountResult
+
+namespace
+{
+  // Run f, converting any exception it throws into beebtools::Error.
+  template <class F> auto translate_exceptions(F f) -> decltype(f())
+  {
+    try
+      {
+	return f();
+      }
+    catch (beebtools::Error&)
+      {
+	throw;
+      }
+    catch (std::exception& e)
+      {
+	throw beebtools::Error(e.what());
+      }
+  }
+
+  DFS::VolumeSelector parse_volume(const std::string& volume)
+  {
+    DFS::VolumeSelector result(0);
+    std::string error;
+    if (!DFS::StorageConfiguration::decode_drive_number(volume, &result, error))
+      throw beebtools::Error(volume + " is not a valid volume: " + error);
+    return result;
+  }
+}  // namespace
+
+namespace beebtools
+{
+  Error::Error(const std::string& msg)
+    : std::runtime_error(msg)
+  {
+  }
+
+  struct Images::Impl
+  {
+    void add_image(const std::string& file_name, DriveAllocation how)
+    {
+      std::string error;
+      std::unique_ptr<DFS::AbstractImageFile> file = DFS::make_image_file(file_name, error);
+      if (!file)
+	throw Error(error);
+      const DFS::DriveAllocation allocation = how == DriveAllocation::First
+	? DFS::DriveAllocation::FIRST : DFS::DriveAllocation::PHYSICAL;
+      if (!file->connect_drives(&storage, allocation, error))
+	throw Error(error);
+      files.push_back(std::move(file));
+    }
+
+    std::vector<std::string> volumes() const
+    {
+      std::vector<std::string> result;
+      for (const DFS::SurfaceSelector& surface : storage.get_all_occupied_drive_numbers())
+	{
+	  std::string error;
+	  if (!storage.drive_format(surface, error))
+	    continue;		// unformatted
+	  std::unique_ptr<DFS::FileSystem> fs = storage.mount_fs(surface, error);
+	  if (!fs)
+	    throw Error(error);
+	  for (std::optional<char> sv : fs->subvolumes())
+	    {
+	      std::ostringstream ss;
+	      if (sv)
+		ss << DFS::VolumeSelector(surface, *sv);
+	      else
+		ss << DFS::VolumeSelector(surface);
+	      result.push_back(ss.str());
+	    }
+	}
+      return result;
+    }
+
+    std::vector<FileInfo> files_of(const std::string& volume) const
+    {
+      DFS::VolumeMountResult mounted = mount(parse_volume(volume));
+      std::vector<FileInfo> result;
+      for (const DFS::CatalogEntry& entry : mounted.volume()->root().entries())
+	{
+	  result.push_back(FileInfo{entry.directory(), entry.name(),
+				    entry.load_address(), entry.exec_address(),
+				    entry.file_length(), entry.start_sector(),
+				    entry.is_locked()});
+	}
+      return result;
+    }
+
+    unsigned long read_file(const std::string& file_name,
+			    unsigned char* buf, unsigned long size) const
+    {
+      const DFS::DFSContext ctx('$', DFS::VolumeSelector(0));
+      DFS::ParsedFileName name;
+      std::string error;
+      if (!DFS::parse_filename(ctx, file_name, &name, error))
+	throw Error(file_name + " is not a valid file name: " + error);
+      DFS::VolumeMountResult mounted = mount(name.vol);
+      const std::optional<DFS::CatalogEntry> entry =
+	mounted.volume()->root().find_catalog_entry_for_name(name);
+      if (!entry)
+	throw Error(file_name + ": not found");
+      unsigned long done = 0;
+      auto copy = [buf, size, &done](const DFS::byte* begin, const DFS::byte* end)
+		  {
+		    const unsigned long n = std::min(static_cast<unsigned long>(end - begin),
+						     size - done);
+		    memcpy(buf + done, begin, n);
+		    done += n;
+		    return done < size;
+		  };
+      if (size)
+	entry->visit_file_body_spans(mounted.volume()->data_region(), copy);
+      return entry->file_length();
+    }
+
+    DFS::VolumeMountResult mount(const DFS::VolumeSelector& vol) const
+    {
+      std::string error;
+      std::optional<DFS::VolumeMountResult> mounted = storage.mount(vol, error);
+      if (!mounted)
+	{
+	  std::ostringstream ss;
+	  DFS::failed_to_mount_volume(ss, vol, error);
+	  std::string msg(ss.str());
+	  if (!msg.empty() && msg.back() == '\n')
+	    msg.pop_back();
+	  throw Error(msg);
+	}
+      return std::move(*mounted);
+    }
+
+    // files must outlive storage.
+    std::vector<std::unique_ptr<DFS::AbstractImageFile>> files;
+    DFS::StorageConfiguration storage;
+  };
+
+  Images::Images()
+    : impl_(std::make_unique<Impl>())
+  {
+  }
+
+  Images::~Images()
+  {
+  }
+
+  Images::Images(Images&&) noexcept = default;
+  Images& Images::operator=(Images&&) noexcept = default;
+
+  void Images::add_image(const std::string& file_name, DriveAllocation how)
+  {
+    translate_exceptions([&]() { impl_->add_image(file_name, how); });
+  }
+
+  std::vector<std::string> Images::volumes() const
+  {
+    return translate_exceptions([&]() { return impl_->volumes(); });
+  }
+
+  std::string Images::title(const std::string& volume) const
+  {
+    return translate_exceptions([&]()
+				{
+				  return impl_->mount(parse_volume(volume)).volume()->root().title();
+				});
+  }
+
+  std::vector<FileInfo> Images::files(const std::string& volume) const
+  {
+    return translate_exceptions([&]() { return impl_->files_of(volume); });
+  }
+
+  unsigned long Images::read_file(const std::string& file_name,
+				  unsigned char* buf, unsigned long size) const
+  {
+    return translate_exceptions([&]() { return impl_->read_file(file_name, buf, size); });
+  }
+
+  void set_diagnostic_stream(std::ostream* os)
+  {
+    DFS::set_diagnostic_stream(os);
+  }
+
+  void set_verbose(bool verbose)
+  {
+    DFS::verbose = verbose;
+  }
+}  // namespace beebtools
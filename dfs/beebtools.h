@@ -0,0 +1,106 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// The public interface of the beebtools library, for programs which
+// want to read DFS disc images without running the dfs program.
+// Nothing here depends on the other headers of this package, and the
+// library writes nothing to the standard output or standard error.
+#ifndef INC_BEEBTOOLS_H
+#define INC_BEEBTOOLS_H 1
+
+#include <iosfwd>     // for ostream
+#include <memory>     // for unique_ptr
+#include <stdexcept>  // for runtime_error
+#include <string>     // for string
+#include <vector>     // for vector
+
+namespace beebtools
+{
+  // All failures are reported by throwing Error.  what() gives the
+  // same explanation the dfs program would print.
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit Error(const std::string& msg);
+  };
+
+  // A file in the catalog of a volume.
+  struct FileInfo
+  {
+    char directory;
+    std::string name;		// without the directory, e.g. "FOO"
+    unsigned long load_address;
+    unsigned long exec_address;
+    unsigned long length;
+    unsigned long start_sector;
+    bool locked;
+  };
+
+  // How disc images are assigned to drives, as for the --drive-first
+  // and --drive-physical options of the dfs program.
+  enum class DriveAllocation
+    {
+     Physical,			// as if the images were physical discs
+     First			// each image gets the next free drive
+    };
+
+  // A collection of disc images, each connected to one or more
+  // drives just as the --file option of the dfs program does.
+  // Volumes are named as for the --drive option (for example "0",
+  // "2" or "0B").  An Images object must not be used by more than
+  // one thread at a time.
+  class Images
+  {
+  public:
+    Images();
+    ~Images();
+    Images(Images&&) noexcept;
+    Images& operator=(Images&&) noexcept;
+    Images(const Images&) = delete;
+    Images& operator=(const Images&) = delete;
+
+    // Open the image file file_name and connect it to the next free
+    // drive (or drives, for a double-sided image).
+    void add_image(const std::string& file_name,
+		   DriveAllocation how = DriveAllocation::Physical);
+
+    // The names of the volumes of all the formatted drives.
+    std::vector<std::string> volumes() const;
+
+    std::string title(const std::string& volume) const;
+    std::vector<FileInfo> files(const std::string& volume) const;
+
+    // Copy the body of the file named file_name (for example
+    // "$.FOO" or ":2.B.BAR"; the default drive is 0 and the default
+    // directory is $) into [buf, buf + size).  Returns the length of
+    // the file; if this is more than size, only the first size bytes
+    // were copied.
+    unsigned long read_file(const std::string& file_name,
+			    unsigned char* buf, unsigned long size) const;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+  };
+
+  // Diagnostics about damaged or unusual images (and, after
+  // set_verbose(true), notes about how images are being decoded) are
+  // discarded unless a stream is given here.  These settings affect
+  // the whole process.
+  void set_diagnostic_stream(std::ostream* os);
+  void set_verbose(bool verbose);
+}  // namespace beebtools
+
+#endif
@@ -240,6 +240,11 @@ namespace
       return "display the disc catalogue";
     }
 
+    bool supports_multiple_images() const override
+    {
+      return true;
+    }
+
     static std::optional<int> get_screen_cols()
     {
       // $COLUMNS (if it is set) is the width of the user's terminal.
@@ -332,23 +337,23 @@ namespace
       const std::optional<int> screen_width = get_screen_cols();
       if (DFS::verbose)
 	{
-	  std::cerr << "Screen width is ";
+	  ctx.err() << "Screen width is ";
 	  if (screen_width)
-	    std::cerr << *screen_width;
+	    ctx.err() << *screen_width;
 	  else
-	    std::cerr << "unknown or inapplicable";
-	  std::cerr << "\n";
+	    ctx.err() << "unknown or inapplicable";
+	  ctx.err() << "\n";
 	}
       std::string error;
-      auto fail = [&error]()
+      auto fail = [&ctx, &error]()
 		  {
-		    std::cerr << error << "\n";
+		    ctx.err() << error << "\n";
 		    return false;
 		  };
       DFS::VolumeSelector d(0);
       if (args.size() > 2)
 	{
-	  std::cerr << "Please specify at most one argument, the drive number\n";
+	  ctx.err() << "Please specify at most one argument, the drive number\n";
 	  return false;
 	}
       else if (args.size() == 2)
@@ -360,12 +365,12 @@ namespace
 	    return fail();
 	  if (end != args[1].size())
 	    {
-	      std::cerr << "unexpected suffix on drive specifier " << args[1] << "\n";
+	      ctx.err() << "unexpected suffix on drive specifier " << args[1] << "\n";
 	      return false;
 	    }
 	  d = *got;
 	  if (!error.empty())
-	    std::cerr << "warning: " << error << "\n";
+	    ctx.err() << "warning: " << error << "\n";
 	}
       else
 	{
@@ -374,7 +379,7 @@ namespace
       auto mounted = storage.mount(d, error);
       if (!mounted)
 	{
-	  failed_to_mount_volume(std::cerr, d, error);
+	  failed_to_mount_volume(ctx.err(), d, error);
 	  return false;
 	}
       DFS::FileSystem* file_system = mounted->file_system();
@@ -382,8 +387,8 @@ namespace
       DFS::Geometry geom = file_system->geometry();
       const auto ui = file_system->ui_style(ctx);
 
-      std::cout << std::setfill(' ');
-      colstream out(std::cout, ui == DFS::UiStyle::Opus ? " " : "");
+      ctx.out() << std::setfill(' ');
+      colstream out(ctx.out(), ui == DFS::UiStyle::Opus ? " " : "");
 
       // Produce output which is suitable for the actual width of the device
       // and the selected ui.
@@ -0,0 +1,434 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include <string.h>         // for memcmp, memset
+#include <algorithm>        // for max, min, find
+#include <iomanip>          // for operator<<, setw, setfill
+#include <iostream>         // for operator<<, basic_ostream, ostream
+#include <map>              // for map
+#include <memory>           // for unique_ptr
+#include <optional>         // for optional
+#include <sstream>          // for ostringstream
+#include <string>           // for string, operator+
+#include <vector>           // for vector
+
+#include "abstractio.h"     // for SECTOR_BYTES
+#include "cleanup.h"        // for ostream_flag_saver
+#include "commands.h"       // for CommandInterface, REGISTER_COMMAND
+#include "dfs.h"            // for sign_extend
+#include "dfs_catalog.h"    // for CatalogEntry, Catalog, operator<<
+#include "dfs_filesystem.h" // for FileSystem
+#include "dfs_unused.h"     // for SectorMap
+#include "dfs_volume.h"     // for Volume
+#include "dfscontext.h"     // for DFSContext
+#include "dfstypes.h"       // for byte, sector_count_type
+#include "driveselector.h"  // for VolumeSelector, SurfaceSelector, operator<<
+#include "exceptions.h"     // for BaseException
+#include "storage.h"        // for StorageConfiguration, AbstractDrive
+
+namespace
+{
+  // The number of sectors read from each drive at once.  Whole
+  // chunks are compared first, and only chunks which differ are
+  // compared sector by sector.
+  constexpr unsigned long compare_chunk_sectors = 256;
+
+  // One of the two drives being compared.
+  struct Side
+  {
+    DFS::SurfaceSelector surface;
+    DFS::AbstractDrive* drive;
+    std::unique_ptr<DFS::FileSystem> fs;
+    std::unique_ptr<DFS::SectorMap> sector_map;
+  };
+
+  struct DiffCounts
+  {
+    unsigned long added = 0;
+    unsigned long removed = 0;
+    unsigned long changed = 0;
+    unsigned long sectors = 0;
+    unsigned long unreadable = 0;
+  };
+
+  // What we found out about one drive while reading its sectors.
+  struct ReadState
+  {
+    explicit ReadState(unsigned long total)
+      : unreadable(total, false), readable_end(0)
+    {
+    }
+
+    std::vector<bool> unreadable;
+    // One more than the number of the last sector which could be read.
+    unsigned long readable_end;
+  };
+
+  std::string file_location(const DFS::VolumeSelector& vol, const DFS::CatalogEntry& entry)
+  {
+    std::ostringstream ss;
+    ss << ':' << vol << '.' << entry.full_name();
+    return ss.str();
+  }
+
+  // Append "what before -> after" to changes if before and after
+  // differ.
+  template <class T>
+  void note_change(std::vector<std::string>* changes, const std::string& what,
+		   const T& before, const T& after)
+  {
+    if (before == after)
+      return;
+    std::ostringstream ss;
+    ss << what << ' ' << before << " -> " << after;
+    changes->push_back(ss.str());
+  }
+
+  std::string hex6(unsigned long n)
+  {
+    std::ostringstream ss;
+    ss << std::hex << std::uppercase << std::setfill('0') << std::setw(6) << n;
+    return ss.str();
+  }
+
+  std::string join(const std::vector<std::string>& items)
+  {
+    std::string result;
+    for (const std::string& item : items)
+      {
+	if (!result.empty())
+	  result.append("; ");
+	result.append(item);
+      }
+    return result;
+  }
+
+class CommandDiff : public DFS::CommandInterface
+{
+public:
+  const std::string name() const override
+  {
+    return "diff";
+  }
+
+  const std::string usage() const override
+  {
+    return "usage: " + name() + " DRIVE-A DRIVE-B\n"
+      "Compares two drives (for example two image files given with two\n"
+      "--file options), first catalog by catalog and then sector by sector.\n"
+      "Differences are printed one per line:\n"
+      "  removed FILE          the file is only on DRIVE-A\n"
+      "  added FILE            the file is only on DRIVE-B\n"
+      "  changed FILE: ...     the file's catalog entry differs\n"
+      "  changed volume V: ... the volume's title or boot setting differs\n"
+      "  sectors N-M differ: A-OWNER / B-OWNER\n"
+      "  sector N cannot be read on drive D\n"
+      "where an OWNER is the file or catalog which occupies the sectors on\n"
+      "that drive (or - if they are unused).  Sectors missing from the end\n"
+      "of an image file are treated as if they contained zeroes.  A\n"
+      "summary follows.  The exit status is non-zero if the drives differ\n"
+      "or a sector cannot be read.\n";
+  }
+
+  const std::string description() const override
+  {
+    return "compare the catalogs and sectors of two drives";
+  }
+
+  bool invoke(const DFS::StorageConfiguration& storage,
+	      const DFS::DFSContext& ctx,
+	      const std::vector<std::string>& args) override
+  {
+    if (args.size() != 3)
+      {
+	ctx.err() << usage();
+	return false;
+      }
+    std::vector<Side> sides;
+    for (size_t i = 1; i < args.size(); ++i)
+      {
+	std::string error;
+	size_t end;
+	auto surface = DFS::SurfaceSelector::parse(args[i], &end, error);
+	if (!surface)
+	  {
+	    ctx.err() << error << "\n";
+	    return false;
+	  }
+	if (end != args[i].size())
+	  {
+	    ctx.err() << "trailing junk after drive number " << args[i] << "\n";
+	    return false;
+	  }
+	Side side{*surface, nullptr, nullptr, nullptr};
+	if (!storage.select_drive(side.surface, &side.drive, error))
+	  {
+	    ctx.err() << error << "\n";
+	    return false;
+	  }
+	side.fs = storage.mount_fs(side.surface, error);
+	if (!side.fs)
+	  {
+	    DFS::failed_to_mount_surface(ctx.err(), side.surface, error);
+	    return false;
+	  }
+	side.sector_map = side.fs->get_sector_map(side.surface);
+	sides.push_back(std::move(side));
+      }
+
+    DiffCounts counts;
+    ostream_flag_saver restore_cout_flags(ctx.out());
+    if (!compare_catalogs(ctx, sides[0], sides[1], &counts))
+      return false;
+    if (!compare_sectors(ctx, sides[0], sides[1], &counts))
+      return false;
+
+    ctx.out() << std::dec << "drives " << sides[0].surface << " and " << sides[1].surface;
+    const bool same = !counts.added && !counts.removed && !counts.changed && !counts.sectors
+      && !counts.unreadable;
+    if (same)
+      {
+	ctx.out() << " are the same\n";
+      }
+    else
+      {
+	ctx.out() << " differ: " << counts.added << " added, " << counts.removed
+		  << " removed, " << counts.changed << " changed; "
+		  << counts.sectors << " sectors differ";
+	if (counts.unreadable)
+	  ctx.out() << "; " << counts.unreadable << " sectors cannot be read";
+	ctx.out() << "\n";
+      }
+    return same && ctx.out().good();
+  }
+
+private:
+  static bool compare_catalogs(const DFS::DFSContext& ctx, const Side& a, const Side& b,
+			       DiffCounts* counts)
+  {
+    const std::vector<std::optional<char>> a_vols = a.fs->subvolumes();
+    const std::vector<std::optional<char>> b_vols = b.fs->subvolumes();
+    for (std::optional<char> sv : a_vols)
+      {
+	const DFS::VolumeSelector a_sel = sv ? DFS::VolumeSelector(a.surface, *sv)
+	  : DFS::VolumeSelector(a.surface);
+	if (std::find(b_vols.begin(), b_vols.end(), sv) == b_vols.end())
+	  {
+	    ctx.out() << "removed volume " << a_sel << "\n";
+	    ++counts->removed;
+	    continue;
+	  }
+	const DFS::VolumeSelector b_sel = sv ? DFS::VolumeSelector(b.surface, *sv)
+	  : DFS::VolumeSelector(b.surface);
+	std::string error;
+	DFS::Volume* a_vol = a.fs->mount(sv, error);
+	DFS::Volume* b_vol = a_vol ? b.fs->mount(sv, error) : nullptr;
+	if (!a_vol || !b_vol)
+	  {
+	    ctx.err() << error << "\n";
+	    return false;
+	  }
+	compare_volumes(ctx, a_sel, a_vol->root(), b_sel, b_vol->root(), counts);
+      }
+    for (std::optional<char> sv : b_vols)
+      {
+	if (std::find(a_vols.begin(), a_vols.end(), sv) == a_vols.end())
+	  {
+	    const DFS::VolumeSelector b_sel = sv ? DFS::VolumeSelector(b.surface, *sv)
+	      : DFS::VolumeSelector(b.surface);
+	    ctx.out() << "added volume " << b_sel << "\n";
+	    ++counts->added;
+	  }
+      }
+    return true;
+  }
+
+  static void compare_volumes(const DFS::DFSContext& ctx,
+			      const DFS::VolumeSelector& a_sel, const DFS::Catalog& a,
+			      const DFS::VolumeSelector& b_sel, const DFS::Catalog& b,
+			      DiffCounts* counts)
+  {
+    std::vector<std::string> changes;
+    note_change(&changes, "title", '"' + a.title() + '"', '"' + b.title() + '"');
+    note_change(&changes, "boot setting", a.boot_setting(), b.boot_setting());
+    if (!changes.empty())
+      {
+	ctx.out() << "changed volume " << a_sel << ": " << join(changes) << "\n";
+	++counts->changed;
+      }
+
+    std::map<std::string, const DFS::CatalogEntry*> b_entries;
+    for (const DFS::CatalogEntry& entry : b.entries())
+      b_entries[entry.full_name()] = &entry;
+    for (const DFS::CatalogEntry& entry : a.entries())
+      {
+	auto it = b_entries.find(entry.full_name());
+	if (it == b_entries.end())
+	  {
+	    ctx.out() << "removed " << file_location(a_sel, entry) << "\n";
+	    ++counts->removed;
+	    continue;
+	  }
+	const DFS::CatalogEntry& other(*it->second);
+	b_entries.erase(it);
+	changes.clear();
+	note_change(&changes, "load", hex6(DFS::sign_extend(entry.load_address())),
+		    hex6(DFS::sign_extend(other.load_address())));
+	note_change(&changes, "exec", hex6(DFS::sign_extend(entry.exec_address())),
+		    hex6(DFS::sign_extend(other.exec_address())));
+	note_change(&changes, "length", hex6(entry.file_length()), hex6(other.file_length()));
+	note_change(&changes, "start sector", entry.start_sector(), other.start_sector());
+	note_change(&changes, "lock",
+		    std::string(entry.is_locked() ? "L" : "-"),
+		    std::string(other.is_locked() ? "L" : "-"));
+	if (!changes.empty())
+	  {
+	    ctx.out() << "changed " << file_location(a_sel, entry) << ": "
+		      << join(changes) << "\n";
+	    ++counts->changed;
+	  }
+      }
+    // Report the new files in the order of the catalog.
+    for (const DFS::CatalogEntry& entry : b.entries())
+      {
+	if (b_entries.count(entry.full_name()))
+	  {
+	    ctx.out() << "added " << file_location(b_sel, entry) << "\n";
+	    ++counts->added;
+	  }
+      }
+  }
+
+  // Read count sectors starting at sec, putting zeroes in place of
+  // those which cannot be read and noting them in *state.  Image
+  // files often omit the unused sectors at the end of the disc, and
+  // those are compared as if they contained zeroes.  But a sector
+  // which cannot be read inside the image (for example because of a
+  // CRC error in an HFE file) must not hide the ones after it.
+  static bool read_zero_filled(const DFS::DFSContext& ctx, const Side& side,
+			       unsigned long sec, unsigned long count,
+			       DFS::byte* out, ReadState* state)
+  {
+    unsigned long done = 0;
+    while (done < count)
+      {
+	unsigned long got;
+	try
+	  {
+	    got = side.drive->read_blocks(sec + done, count - done, out + done * DFS::SECTOR_BYTES);
+	  }
+	catch (DFS::BaseException& e)
+	  {
+	    ctx.err() << "drive " << side.surface << ": " << e.what() << "\n";
+	    return false;
+	  }
+	done += got;
+	if (got)
+	  state->readable_end = sec + done;
+	if (done < count)
+	  {
+	    memset(out + done * DFS::SECTOR_BYTES, 0, DFS::SECTOR_BYTES);
+	    state->unreadable[sec + done] = true;
+	    ++done;
+	  }
+      }
+    return true;
+  }
+
+  // Report the sectors which could not be read and which are not
+  // simply missing from the end of the image, and return true for
+  // each of them in *skip.
+  static void report_unreadable(const DFS::DFSContext& ctx, const Side& side,
+				const ReadState& state, std::vector<bool>* skip,
+				DiffCounts* counts)
+  {
+    for (unsigned long sec = 0; sec < state.readable_end; ++sec)
+      {
+	if (!state.unreadable[sec])
+	  continue;
+	ctx.out() << std::dec << "sector " << sec << " cannot be read on drive "
+		  << side.surface << "\n";
+	if (!(*skip)[sec])
+	  ++counts->unreadable;
+	(*skip)[sec] = true;
+      }
+  }
+
+  static bool compare_sectors(const DFS::DFSContext& ctx, const Side& a, const Side& b,
+			      DiffCounts* counts)
+  {
+    const unsigned long total = std::max(a.fs->disc_sector_count(), b.fs->disc_sector_count());
+    std::vector<DFS::byte> a_buf(compare_chunk_sectors * DFS::SECTOR_BYTES);
+    std::vector<DFS::byte> b_buf(compare_chunk_sectors * DFS::SECTOR_BYTES);
+    std::vector<bool> differs(total, false);
+    ReadState a_state(total), b_state(total);
+    for (unsigned long sec = 0; sec < total; sec += compare_chunk_sectors)
+      {
+	const unsigned long want = std::min(total - sec, compare_chunk_sectors);
+	if (!read_zero_filled(ctx, a, sec, want, a_buf.data(), &a_state)
+	    || !read_zero_filled(ctx, b, sec, want, b_buf.data(), &b_state))
+	  return false;
+	if (memcmp(a_buf.data(), b_buf.data(), want * DFS::SECTOR_BYTES) == 0)
+	  continue;
+	for (unsigned long i = 0; i < want; ++i)
+	  {
+	    const unsigned long offset = i * DFS::SECTOR_BYTES;
+	    if (memcmp(a_buf.data() + offset, b_buf.data() + offset, DFS::SECTOR_BYTES))
+	      differs[sec + i] = true;
+	  }
+      }
+    // Whether an unreadable sector differs is unknown, so it is
+    // reported as unreadable instead.
+    std::vector<bool> unreadable(total, false);
+    report_unreadable(ctx, a, a_state, &unreadable, counts);
+    report_unreadable(ctx, b, b_state, &unreadable, counts);
+    for (unsigned long sec = 0; sec < total; ++sec)
+      {
+	if (unreadable[sec])
+	  differs[sec] = false;
+      }
+
+    // Report each run of differing sectors having the same owners.
+    auto owner = [](const Side& side, unsigned long sec) -> std::string
+		 {
+		   return side.sector_map->at(static_cast<DFS::sector_count_type>(sec)).value_or("-");
+		 };
+    for (unsigned long sec = 0; sec < total; /* empty */)
+      {
+	if (!differs[sec])
+	  {
+	    ++sec;
+	    continue;
+	  }
+	const std::string a_owner(owner(a, sec)), b_owner(owner(b, sec));
+	unsigned long end = sec + 1;
+	while (end < total && differs[end]
+	       && owner(a, end) == a_owner && owner(b, end) == b_owner)
+	  ++end;
+	ctx.out() << std::dec;
+	if (end - sec == 1)
+	  ctx.out() << "sector " << sec << " differs: ";
+	else
+	  ctx.out() << "sectors " << sec << "-" << (end - 1) << " differ: ";
+	ctx.out() << a_owner << " / " << b_owner << "\n";
+	counts->sectors += end - sec;
+	sec = end;
+      }
+    return true;
+  }
+};
+REGISTER_COMMAND(CommandDiff);
+
+} // namespace
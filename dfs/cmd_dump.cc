@@ -13,15 +13,17 @@
 //   See the License for the specific language governing permissions and
 //   limitations under the License.
 //
-#include <assert.h>    // for assert
 #include <stddef.h>    // for size_t
+#include <array>       // for array
 #include <iostream>    // for cout, hex, uppercase, basic_ostream<>::__ostre...
 #include <optional>    // for std::optional
 #include <string>      // for string, allocator
 #include <vector>      // for vector
 
+#include "abstractio.h" // for SECTOR_BYTES
 #include "cleanup.h"   // for ostream_flag_saver
-#include "commands.h"  // for body_command, CommandInterface, REGISTER_COMMAND
+#include "commands.h"  // for body_command, FileBodyConsumer, CommandInterface
+#include "dfscontext.h" // for DFSContext
 #include "dfstypes.h"  // for byte
 #include "hexdump.h"   // for hexdump_bytes
 #include "storage.h"   // for AbstractDrive
@@ -30,6 +32,64 @@ namespace
 {
   constexpr long int Stride = 8;
 
+  // Produces the same output as a single call to hexdump_bytes() for
+  // the whole body.  Bytes which don't make up a whole line are held
+  // back until the next chunk (or the end of the file).
+  class DumpOutput : public DFS::FileBodyConsumer
+  {
+  public:
+    explicit DumpOutput(std::ostream& out)
+      : out_(out)
+    {
+    }
+
+    bool chunk(const DFS::byte* begin, const DFS::byte* end) override
+    {
+      if (pending_len_)
+	{
+	  while (pending_len_ < Stride && begin != end)
+	    pending_[pending_len_++] = *begin++;
+	  if (pending_len_ < Stride)
+	    return true;
+	  if (!flush_pending())
+	    return false;
+	}
+      const size_t whole_lines = static_cast<size_t>(end - begin) / Stride * Stride;
+      if (whole_lines)
+	{
+	  if (!DFS::hexdump_bytes(out_, pos_, Stride, begin, begin + whole_lines))
+	    return false;
+	  pos_ += whole_lines;
+	  begin += whole_lines;
+	}
+      while (begin != end)
+	pending_[pending_len_++] = *begin++;
+      return true;
+    }
+
+    bool end() override
+    {
+      return flush_pending() && out_.good();
+    }
+
+  private:
+    bool flush_pending()
+    {
+      if (!pending_len_)
+	return true;
+      const bool ok = DFS::hexdump_bytes(out_, pos_, Stride,
+					 pending_.data(), pending_.data() + pending_len_);
+      pos_ += pending_len_;
+      pending_len_ = 0;
+      return ok;
+    }
+
+    std::ostream& out_;
+    size_t pos_ = 0;
+    std::array<DFS::byte, Stride> pending_;
+    size_t pending_len_ = 0;
+  };
+
 }  // namespace
 
 namespace DFS
@@ -60,22 +120,15 @@ public:
 		const DFS::DFSContext& ctx,
 		const std::vector<std::string>& args) override
     {
-      return body_command(storage, ctx, args,
-			  [](const DFS::byte* body_start,
-			     const DFS::byte *body_end,
-			     const std::vector<std::string>&)
-			  {
-			    ostream_flag_saver restore_cout_flags(std::cout);
-			    std::cout << std::hex << std::uppercase;
-			    assert(body_end >= body_start);
-			    return hexdump_bytes(std::cout, 0, Stride, body_start, body_end);
-			  });
+      DumpOutput output(ctx.out());
+      return body_command(storage, ctx, args, output);
     }
 };
 REGISTER_COMMAND(CommandDump);
 
 
-std::optional<long int> get_arg(const std::string& which_arg,
+std::optional<long int> get_arg(std::ostream& err,
+				const std::string& which_arg,
 				const std::string& the_arg,
 				const long int upper_limit)
 {
@@ -86,14 +139,14 @@ std::optional<long int> get_arg(const std::string& which_arg,
       n = std::stol(the_arg, &end, 10);
       if (end < the_arg.size())
 	{
-	  std::cerr << which_arg << " " << the_arg
+	  err << which_arg << " " << the_arg
 		    << " should not have a non-numeric "
 		    << "suffix\n";
 	  return std::nullopt;
 	}
       else if (0 == end)
 	{
-	  std::cerr << which_arg << " " << the_arg
+	  err << which_arg << " " << the_arg
 		    << " should not be empty.\n";
 	  return std::nullopt;
 	}
@@ -106,7 +159,7 @@ std::optional<long int> get_arg(const std::string& which_arg,
     {
       // Report failure as for n > upper_limit.
     };
-  std::cerr << which_arg << " " << the_arg
+  err << which_arg << " " << the_arg
 	    << " should be between 0 and (for this disc) "
 	    << upper_limit << " inclusive\n";
   return std::nullopt;
@@ -123,7 +176,11 @@ public:
 
     const std::string usage() const override
     {
-      return "usage: dump-sector SIDE-NUM TRACK-NUM SECTOR-NUM\n";
+      return "usage: dump-sector SIDE-NUM TRACK-NUM SECTOR-NUM\n"
+	"   or: dump-sector --tracks SIDE-NUM FIRST-TRACK LAST-TRACK\n"
+	"The second form displays every sector of the tracks FIRST-TRACK\n"
+	"to LAST-TRACK inclusive; the position shown at the start of each\n"
+	"line is then the byte offset within the surface.\n";
     }
 
     const std::string description() const override
@@ -132,22 +189,24 @@ public:
     }
 
     bool invoke(const DFS::StorageConfiguration& storage,
-		const DFS::DFSContext&,
+		const DFS::DFSContext& ctx,
 		const std::vector<std::string>& args) override
     {
-      ostream_flag_saver restore_cout_flags(std::cout);
+      ostream_flag_saver restore_cout_flags(ctx.out());
       std::string error;
-      auto fail = [&error]()
+      auto fail = [&ctx, &error]()
 		  {
-		    std::cerr << error << "\n";
+		    ctx.err() << error << "\n";
 		    return false;
 		  };
 
-      if (args.size() != 4)
+      const bool whole_tracks = args.size() == 5 && args[1] == "--tracks";
+      if (args.size() != 4 && !whole_tracks)
 	{
-	  std::cerr << usage();
+	  ctx.err() << usage();
 	  return false;
 	}
+      const size_t first_arg = whole_tracks ? 2 : 1;
 
       // Decode the drive number and obtain the device geometry.
       size_t end = 0;
@@ -155,7 +214,7 @@ public:
       // doesn't make sense to request track 20 sector 3 of a
       // volume. IOW, physical sector addresses are only useful at the
       // physical media layer.
-      auto surface = DFS::SurfaceSelector::parse(args[1], &end, error);
+      auto surface = DFS::SurfaceSelector::parse(args[first_arg], &end, error);
       if (!surface)
 	{
 	  return fail();
@@ -164,12 +223,14 @@ public:
       if (!storage.select_drive(*surface, &drive, error))
 	return fail();
       const Geometry& geom = drive->geometry();
+      if (whole_tracks)
+	return dump_tracks(ctx, drive, args);
 
       // Decode the track and sector number
-      auto track = get_arg("track", args[2], geom.cylinders-1);
+      auto track = get_arg(ctx.err(), "track", args[2], geom.cylinders-1);
       if (!track)
 	return false;
-      auto sector = get_arg("sector", args[3], geom.sectors-1);
+      auto sector = get_arg(ctx.err(), "sector", args[3], geom.sectors-1);
       if (!sector)
 	return false;
 
@@ -178,12 +239,49 @@ public:
       auto got = drive->read_block(sec_addr);
       if (!got)
 	{
-	  std::cerr << "error: failed to read sector at track "
+	  ctx.err() << "error: failed to read sector at track "
 		    << *track << ", sector " << *sector << "\n";
 	  return false;
 	}
-      return hexdump_bytes(std::cout, 0, Stride, got->data(), got->data()+got->size());
+      return hexdump_bytes(ctx.out(), 0, Stride, got->data(), got->data()+got->size());
     }
+
+private:
+  bool dump_tracks(const DFS::DFSContext& ctx, DFS::AbstractDrive* drive,
+		   const std::vector<std::string>& args)
+  {
+    const Geometry& geom = drive->geometry();
+    auto first = get_arg(ctx.err(), "first track", args[3], geom.cylinders-1);
+    if (!first)
+      return false;
+    auto last = get_arg(ctx.err(), "last track", args[4], geom.cylinders-1);
+    if (!last)
+      return false;
+    if (*last < *first)
+      {
+	ctx.err() << "last track " << *last << " should not be before first track "
+		  << *first << "\n";
+	return false;
+      }
+    // Each track is read in one operation, and formatted in one call
+    // to hexdump_bytes().
+    const unsigned long track_sectors = geom.sectors;
+    std::vector<byte> buf(track_sectors * SECTOR_BYTES);
+    for (long int track = *first; track <= *last; ++track)
+      {
+	const unsigned long lba = track * track_sectors;
+	const unsigned long got = drive->read_blocks(lba, track_sectors, buf.data());
+	hexdump_bytes(ctx.out(), lba * SECTOR_BYTES, Stride,
+		      buf.data(), buf.data() + got * SECTOR_BYTES);
+	if (got < track_sectors)
+	  {
+	    ctx.err() << "error: failed to read sector at track "
+		      << track << ", sector " << got << "\n";
+	    return false;
+	  }
+      }
+    return ctx.out().good();
+  }
 };
 REGISTER_COMMAND(CommandDumpSector);
 
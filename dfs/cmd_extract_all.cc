@@ -0,0 +1,228 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include <errno.h>          // for errno, EEXIST
+#include <stddef.h>         // for size_t
+#include <string.h>         // for strerror
+#include <sys/stat.h>       // for mkdir
+#include <algorithm>        // for stable_sort
+#include <chrono>           // for steady_clock, duration
+#include <iomanip>          // for operator<<, setprecision, fixed
+#include <iostream>         // for operator<<, basic_ostream, ostream
+#include <memory>           // for unique_ptr
+#include <optional>         // for optional
+#include <sstream>          // for ostringstream
+#include <string>           // for string, operator+
+#include <tuple>            // for tie
+#include <vector>           // for vector
+
+#include "cleanup.h"        // for ostream_flag_saver
+#include "commands.h"       // for CommandInterface, REGISTER_COMMAND, split_...
+#include "dfs_catalog.h"    // for CatalogEntry, Catalog
+#include "dfs_filesystem.h" // for FileSystem
+#include "dfs_volume.h"     // for Volume
+#include "dfscontext.h"     // for DFSContext
+#include "driveselector.h"  // for VolumeSelector, SurfaceSelector, operator<<
+#include "exceptions.h"     // for BaseException
+#include "extraction.h"     // for Extraction, read_extraction, write_extraction
+#include "storage.h"        // for StorageConfiguration
+#include "workqueue.h"      // for run_work_stealing
+
+using std::string;
+
+namespace
+{
+  // The extraction of all the files in one volume.
+  struct VolumeJob
+  {
+    DFS::VolumeSelector selector;
+    DFS::Volume* volume;
+    string dest_dir;
+    unsigned long catalog_bytes;  // total size of the files
+    // Results, filled in by the worker.
+    unsigned long files_written;
+    unsigned long bytes_written;
+    std::vector<string> errors;
+  };
+
+class CommandExtractAll : public DFS::CommandInterface
+{
+public:
+  const std::string name() const override
+  {
+    return "extract-all";
+  }
+
+  const std::string usage() const override
+  {
+    return "usage: " + name() + " [--jobs N] destination-directory\n"
+      "The files in every volume of every occupied drive are extracted\n"
+      "(as for extract-files) into a subdirectory of the destination\n"
+      "directory named after the drive and volume, for example 0, 2 or 4B.\n"
+      "The --drive global option is ignored.\n"
+      "\n"
+      "The destination directory must exist already.  The volumes are\n"
+      "extracted by N threads at once; the default is the number of\n"
+      "processors.  All files are attempted even if some fail.\n";
+  }
+
+  const std::string description() const override
+  {
+    return "extract the files from all drives and volumes";
+  }
+
+  bool invoke(const DFS::StorageConfiguration& storage,
+	      const DFS::DFSContext& ctx,
+	      const std::vector<std::string>& args) override
+  {
+    unsigned int jobs = DFS::default_job_count();
+    std::vector<std::string> options, non_options;
+    std::tie(options, non_options) = DFS::split_command_options(args, {"--jobs"});
+    for (const auto& opt : options)
+      {
+	if (std::optional<unsigned int> n = DFS::jobs_option(name(), opt, ctx.err()))
+	  {
+	    if (!*n)
+	      return false;
+	    jobs = *n;
+	  }
+	else
+	  {
+	    ctx.err() << name() << ": unknown option " << opt << "\n";
+	    return false;
+	  }
+      }
+    if (non_options.size() < 2)
+      {
+	ctx.err() << name() << ": please specify the destination directory.\n";
+	return false;
+      }
+    if (non_options.size() > 2)
+      {
+	ctx.err() << name() << ": just one argument (the destination directory) is needed.\n";
+	return false;
+      }
+    string dest_dir(non_options[1]);
+    if (dest_dir.back() != '/')
+      dest_dir.push_back('/');
+
+    // Mount everything first.  The catalogs are read as the volumes
+    // are mounted, and every volume of a drive shares that drive's
+    // (cached) access to the image file.
+    std::vector<std::unique_ptr<DFS::FileSystem>> file_systems;
+    std::vector<VolumeJob> volumes;
+    bool ok = DFS::visit_all_volumes(storage, ctx, &file_systems,
+				     [&volumes, &dest_dir](const DFS::VolumeSelector& selector,
+							   DFS::Volume* vol)
+				     {
+				       unsigned long bytes = 0;
+				       for (const DFS::CatalogEntry& entry : vol->root().entries())
+					 bytes += entry.file_length();
+				       std::ostringstream ss;
+				       ss << dest_dir << selector << '/';
+				       volumes.push_back(VolumeJob{selector, vol, ss.str(),
+								   bytes, 0, 0, {}});
+				     });
+
+    // The volumes differ a lot in size (an MMB file has many nearly
+    // empty discs, for example) so start the biggest first and let
+    // idle workers steal the rest.
+    std::vector<VolumeJob*> order;
+    for (VolumeJob& job : volumes)
+      order.push_back(&job);
+    std::stable_sort(order.begin(), order.end(),
+		     [](const VolumeJob* a, const VolumeJob* b)
+		     {
+		       return a->catalog_bytes > b->catalog_bytes;
+		     });
+
+    const char current_directory = ctx.current_directory;
+    const auto start_time = std::chrono::steady_clock::now();
+    DFS::run_work_stealing<VolumeJob*>(order, jobs,
+				       [current_directory](VolumeJob*& job)
+				       {
+					 extract_volume(job, current_directory);
+				       });
+
+    unsigned long files_written = 0, total_bytes = 0;
+    for (const VolumeJob& job : volumes)
+      {
+	for (const string& e : job.errors)
+	  {
+	    ctx.err() << job.selector << ": " << e << "\n";
+	    ok = false;
+	  }
+	files_written += job.files_written;
+	total_bytes += job.bytes_written;
+      }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    ostream_flag_saver restore_cout_flags(ctx.out());
+    ctx.out() << std::dec << files_written << " files (" << total_bytes
+	      << " bytes) from " << volumes.size() << " volumes were written to "
+	      << dest_dir << " in "
+	      << std::fixed << std::setprecision(3) << elapsed.count() << " seconds";
+    if (elapsed.count() > 0)
+      ctx.out() << " (" << std::setprecision(1)
+		<< (total_bytes / 1024.0 / elapsed.count()) << " KiB/s)";
+    ctx.out() << "\n";
+    return ok;
+  }
+
+private:
+  static void extract_volume(VolumeJob* job, char current_directory)
+  {
+    if (mkdir(job->dest_dir.c_str(), 0777) != 0 && errno != EEXIST)
+      {
+	job->errors.push_back("unable to create directory " + job->dest_dir + ": " + strerror(errno));
+	return;
+      }
+    const std::vector<DFS::CatalogEntry>& entries(job->volume->root().entries());
+    for (size_t i = 0; i < entries.size(); ++i)
+      {
+	const string body_file(job->dest_dir +
+			       DFS::extracted_file_name(entries[i], current_directory));
+	// Unreadable sectors are reported through error; only a failure
+	// to read the image file itself throws.
+	std::optional<DFS::Extraction> extraction;
+	std::string error;
+	try
+	  {
+	    extraction = DFS::read_extraction(job->volume->data_region(), i, entries[i], body_file,
+					      error);
+	  }
+	catch (DFS::BaseException& e)
+	  {
+	    error = e.what();
+	  }
+	if (!extraction)
+	  {
+	    job->errors.push_back(body_file + ": " + error);
+	    continue;
+	  }
+	DFS::ExtractionResult result;
+	DFS::write_extraction(*extraction, &result);
+	if (!result.error.empty())
+	  {
+	    job->errors.push_back(result.error);
+	    continue;
+	  }
+	++job->files_written;
+	job->bytes_written += entries[i].file_length();
+      }
+  }
+};
+REGISTER_COMMAND(CommandExtractAll);
+
+} // namespace
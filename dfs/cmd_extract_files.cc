@@ -13,56 +13,73 @@
 //   See the License for the specific language governing permissions and
 //   limitations under the License.
 //
-#include <errno.h>          // for errno
-#include <string.h>         // for strerror
-#include <iomanip>          // for operator<<, setw, setfill, hex, uppercase
-#include <iostream>         // for operator<<, basic_ostream, ofstream, ostream
+#include <stddef.h>         // for size_t
+#include <time.h>           // for time
+#include <chrono>           // for steady_clock, duration
+#include <iomanip>          // for operator<<, setprecision, fixed
+#include <iostream>         // for operator<<, basic_ostream, ostream
+#include <map>              // for map
+#include <memory>           // for unique_ptr
 #include <optional>         // for optional
 #include <string>           // for allocator, string, operator+, char_traits
+#include <tuple>            // for tie
 #include <vector>           // for vector
 
-#include "commands.h"       // for CommandInterface, REGISTER_COMMAND
+#include "abstractio.h"     // for DataAccess
+#include "archive.h"        // for ArchiveWriter, ArchiveOutput, ArchiveFormat
+#include "cleanup.h"        // for ostream_flag_saver
+#include "commands.h"       // for CommandInterface, REGISTER_COMMAND, split_...
 #include "crc.h"            // for TapeCRC
-#include "dfs.h"            // for sign_extend
 #include "dfs_catalog.h"    // for CatalogEntry, Catalog
 #include "dfs_volume.h"     // for Volume
 #include "dfscontext.h"     // for DFSContext
 #include "dfstypes.h"       // for byte
 #include "driveselector.h"  // for operator<<
+#include "exceptions.h"     // for BaseException
+#include "extraction.h"     // for Extraction, read_extraction, write_extraction
 #include "storage.h"        // for VolumeMountResult, StorageConfiguration
-#include "stringutil.h"     // for rtrim
+#include "workqueue.h"      // for WorkerPool
 
-using std::cerr;
 using std::string;
-using DFS::stringutil::rtrim;
 
 namespace
 {
-  bool create_inf_file(const string& name,
-		       unsigned long crc,
-		       const DFS::CatalogEntry& entry)
+  // Write the body of each file and its .inf file into an archive.
+  // As when extracting into a directory, where several files would
+  // have the same name, the last one wins.
+  void write_archive(DFS::DataAccess& media,
+		     const std::vector<DFS::CatalogEntry>& entries,
+		     const std::vector<string>& names,
+		     DFS::ArchiveWriter* archive,
+		     unsigned long* files_written,
+		     unsigned long* total_bytes)
   {
-    unsigned long load_addr = DFS::sign_extend(entry.load_address());
-    unsigned long exec_addr = DFS::sign_extend(entry.exec_address());
-    std::ofstream inf_file(name, std::ofstream::out);
-    if (!inf_file.good())
+    std::map<string, size_t> last_use;
+    for (size_t i = 0; i < entries.size(); ++i)
+      last_use[names[i]] = i;
+    for (size_t i = 0; i < entries.size(); ++i)
       {
-	std::cerr << "unable to create file " << name << ": " << strerror(errno) << "\n";
-	return false;
+	if (last_use[names[i]] != i)
+	  continue;
+	const DFS::CatalogEntry& entry(entries[i]);
+	DFS::TapeCRC crc;
+	archive->begin_member(names[i], entry.file_length());
+	entry.visit_file_body_spans(media,
+				    [archive, &crc](const DFS::byte* begin, const DFS::byte* end)
+				    {
+				      crc.update(begin, end);
+				      archive->write(begin, end);
+				      return true;
+				    });
+	archive->end_member();
+	const string inf(DFS::inf_line(crc.get(), entry));
+	archive->add_member(names[i] + ".inf",
+			    reinterpret_cast<const DFS::byte*>(inf.data()),
+			    reinterpret_cast<const DFS::byte*>(inf.data() + inf.size()));
+	++*files_written;
+	*total_bytes += entry.file_length();
       }
-    inf_file << std::hex << std::uppercase;
-    // The NEXT field is missing because our source is not tape.
-    using std::setw;
-    using std::setfill;
-    inf_file << entry.directory() << '.' << entry.name() << ' '
-	     << setw(6) << setfill('0') << load_addr << " "
-	     << setw(6) << setfill('0') << exec_addr << " "
-	     << setw(6) << setfill('0') << entry.file_length() << " " // no sign-extend
-	     << (entry.is_locked() ? "Locked " : "")
-	     << "CRC=" << setw(4) << crc
-	     << "\n";
-    inf_file.close();
-    return inf_file.good();
+    archive->finish();
   }
 
 class CommandExtractFiles : public DFS::CommandInterface
@@ -77,7 +94,8 @@ public:
 
   const std::string usage() const override
   {
-    return "usage: " + name() + " destination-directory\n"
+    return "usage: " + name() + " [--jobs N] destination-directory\n"
+      "       " + name() + " --archive=tar|zip destination-file\n"
       "All files from the selected drive (see the --drive global option) are\n"
       "extracted into the destination directory.\n"
       "\n"
@@ -90,7 +108,15 @@ public:
       "have that as their directory.\n"
       "\n"
       "The destination directory must exist already.  An archive .inf file is\n"
-      "generated for each file.\n";
+      "generated for each file.\n"
+      "\n"
+      "With --jobs N, the output files are written by N threads at once.\n"
+      "Either way, all files are attempted even if some fail, and any\n"
+      "errors are reported in catalog order.\n"
+      "\n"
+      "With --archive, the files and their .inf files are instead written\n"
+      "into a single tar or zip archive.  If the destination is -, the\n"
+      "archive is written to the standard output.\n";
   }
 
   const std::string description() const override
@@ -102,83 +128,192 @@ public:
 	      const DFS::DFSContext& ctx,
 	      const std::vector<std::string>& args) override
   {
+    unsigned int jobs = 1;
+    bool jobs_given = false;
+    std::optional<DFS::ArchiveFormat> archive_format;
+    std::vector<std::string> options, non_options;
+    std::tie(options, non_options) =
+      DFS::split_command_options(args, {"--jobs", "--archive"});
+    for (const auto& opt : options)
+      {
+	const std::string archive_prefix("--archive=");
+	if (std::optional<unsigned int> n = DFS::jobs_option(name(), opt, ctx.err()))
+	  {
+	    if (!*n)
+	      return false;
+	    jobs = *n;
+	    jobs_given = true;
+	  }
+	else if (opt.compare(0, archive_prefix.size(), archive_prefix) == 0)
+	  {
+	    archive_format = DFS::archive_format_from_name(opt.substr(archive_prefix.size()));
+	    if (!archive_format)
+	      {
+		ctx.err() << name() << ": --archive needs a format, tar or zip\n";
+		return false;
+	      }
+	  }
+	else
+	  {
+	    ctx.err() << name() << ": unknown option " << opt << "\n";
+	    return false;
+	  }
+      }
+
+    if (archive_format && jobs_given)
+      {
+	ctx.err() << name() << ": --jobs cannot be used with --archive\n";
+	return false;
+      }
+
     // Use the --drive option to select which drive to extract files from.
-    if (args.size() < 2)
+    const char *dest_kind = archive_format ? "file" : "directory";
+    if (non_options.size() < 2)
       {
-	cerr << "extract-all: please specify the destination directory.\n";
+	ctx.err() << name() << ": please specify the destination " << dest_kind << ".\n";
 	return false;
       }
-    if (args.size() > 2)
+    if (non_options.size() > 2)
       {
-	cerr << "extract-all: just one argument (the destination directory) is needed.\n";
+	ctx.err() << name() << ": just one argument (the destination "
+		  << dest_kind << ") is needed.\n";
 	return false;
       }
-    string dest_dir(args[1]);
-    if (dest_dir.back() != '/')
+    string dest_dir(non_options[1]);
+    if (!archive_format && dest_dir.back() != '/')
       dest_dir.push_back('/');
 
     std::string error;
     auto mounted = storage.mount(ctx.current_volume, error);
     if (!mounted)
       {
-	failed_to_mount_volume(std::cerr, ctx.current_volume, error);
+	failed_to_mount_volume(ctx.err(), ctx.current_volume, error);
 	return false;
       }
     const DFS::Catalog& catalog(mounted->volume()->root());
+    const std::vector<DFS::CatalogEntry>& entries(catalog.entries());
 
-    std::vector<DFS::byte> file_body;
-    for (const auto& entry : catalog.entries())
+    std::vector<string> output_names;
+    output_names.reserve(entries.size());
+    std::map<string, int> name_uses;
+    for (const auto& entry : entries)
       {
-	file_body.clear();
-	DFS::TapeCRC crc;
-	const string output_origname(string(1, entry.directory()) + "." + rtrim(entry.name()));
-	string output_basename;
-	if (entry.directory() == ctx.current_directory)
+	const string output_basename(DFS::extracted_file_name(entry, ctx.current_directory));
+	output_names.push_back(archive_format ? output_basename : dest_dir + output_basename);
+	++name_uses[output_names.back()];
+      }
+
+    const auto start_time = std::chrono::steady_clock::now();
+    if (archive_format)
+      {
+	DFS::ArchiveOutput output(dest_dir, ctx.out());
+	std::unique_ptr<DFS::ArchiveWriter> archive =
+	  DFS::make_archive_writer(*archive_format, output.stream(), time(NULL));
+	unsigned long files_written = 0, total_bytes = 0;
+	write_archive(mounted->volume()->data_region(), entries, output_names,
+		      archive.get(), &files_written, &total_bytes);
+	if (!output.close(&error))
 	  {
-	    output_basename = rtrim(entry.name());
+	    ctx.err() << error << "\n";
+	    return false;
 	  }
-	else
+	// Keep the standard output for the archive itself.
+	report(output.is_stdout() ? ctx.err() : ctx.out(), files_written, total_bytes,
+	       output.description(), start_time);
+	return true;
+      }
+
+    // Each file is read from the disc image and then written, by a
+    // worker if there is more than one job.  A file which cannot be
+    // read or written is reported with the others, rather than
+    // stopping the extraction, so the outcome does not depend on the
+    // number of jobs.
+    std::vector<DFS::ExtractionResult> results(entries.size());
+    DFS::DataAccess& media(mounted->volume()->data_region());
+    auto extract = [&media, &entries, &output_names, &results](size_t i)
+      {
+	std::string read_error;
+	std::optional<DFS::Extraction> job;
+	try
 	  {
-	    output_basename = string(1, entry.directory()) + "." + rtrim(entry.name());
+	    job = DFS::read_extraction(media, i, entries[i], output_names[i], read_error);
 	  }
-	const string output_body_file = dest_dir + output_basename;
+	catch (DFS::BaseException& e)
+	  {
+	    read_error = e.what();
+	  }
+	if (!job)
+	  {
+	    results[i].done = true;
+	    results[i].error = output_names[i] + ": " + read_error;
+	    return;
+	  }
+	DFS::write_extraction(*job, &results[i]);
+      };
+
+    if (jobs == 1)
+      {
+	for (size_t i = 0; i < entries.size(); ++i)
+	  extract(i);
+      }
+    else
+      {
+	// Files which would be written to the same place are handled
+	// afterwards, in catalog order, so that the last one wins as it
+	// would without --jobs.
+	std::vector<size_t> deferred;
+	{
+	  DFS::WorkerPool<size_t> pool(jobs, 2 * jobs, [&extract](size_t& i) { extract(i); });
+	  for (size_t i = 0; i < entries.size(); ++i)
+	    {
+	      if (name_uses[output_names[i]] > 1)
+		deferred.push_back(i);
+	      else
+		pool.submit(i);
+	    }
+	  pool.finish();
+	}
+	for (size_t i : deferred)
+	  extract(i);
+      }
 
-	std::ofstream outfile(output_body_file, std::ofstream::out);
-	if (!outfile.good())
+    bool ok = true;
+    unsigned long files_written = 0;
+    unsigned long total_bytes = 0;
+    for (size_t i = 0; i < results.size(); ++i)
+      {
+	const DFS::ExtractionResult& result(results[i]);
+	if (!result.done)
+	  continue;
+	if (result.error.empty())
 	  {
-	    std::cerr << "unable to create file " << output_body_file
-		      << ": " << strerror(errno) << "\n";
-	    return false;
+	    ++files_written;
+	    total_bytes += entries[i].file_length();
 	  }
-	auto ok = entry.visit_file_body_piecewise
-	  (mounted->volume()->data_region(),
-	   [&crc, &outfile, &output_body_file]
-	   (const DFS::byte* begin,
-	    const DFS::byte* end)
-	   {
-	     crc.update(begin, end);
-	     outfile.write(reinterpret_cast<const char*>(begin),
-			   end - begin);
-	     if (!outfile)
-	       {
-		 std::cerr << output_body_file
-			   << ": "
-			   << strerror(errno) << "\n";
-		 return false;
-	       }
-	     return true;
-	   });
-	outfile.close();
-	if (!ok)
-	  return false;
-	const string inf_file_name = output_body_file + ".inf";
-	if (!create_inf_file(inf_file_name, crc.get(), entry))
+	else
 	  {
-	    std::cerr << inf_file_name << ": " << strerror(errno) << "\n";
-	    return false;
+	    ctx.err() << result.error << "\n";
+	    ok = false;
 	  }
       }
-    return true;
+    report(ctx.out(), files_written, total_bytes, dest_dir, start_time);
+    return ok;
+  }
+
+private:
+  static void report(std::ostream& os, unsigned long files_written,
+		     unsigned long total_bytes, const string& dest,
+		     std::chrono::steady_clock::time_point start_time)
+  {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    ostream_flag_saver restore_flags(os);
+    os << std::dec << files_written << " files (" << total_bytes
+       << " bytes) were written to " << dest << " in "
+       << std::fixed << std::setprecision(3) << elapsed.count() << " seconds";
+    if (elapsed.count() > 0)
+      os << " (" << std::setprecision(1)
+	 << (total_bytes / 1024.0 / elapsed.count()) << " KiB/s)";
+    os << "\n";
   }
 };
 REGISTER_COMMAND(CommandExtractFiles);
@@ -15,23 +15,29 @@
 //
 #include <assert.h>          // for assert
 #include <errno.h>           // for errno
+#include <fcntl.h>           // for open, O_WRONLY, O_CREAT, O_TRUNC, O_CLOEXEC
 #include <string.h>          // for strerror
-#include <array>             // for array
+#include <time.h>            // for time
+#include <unistd.h>          // for close
 #include <iomanip>           // for operator<<, operator|, setfill, setw, dec
-#include <iostream>          // for operator<<, basic_ostream, ofstream, ...
+#include <iostream>          // for operator<<, basic_ostream, ...
 #include <memory>            // for allocator, unique_ptr
 #include <optional>          // for optional
 #include <string>            // for operator<<, string, char_traits, operator+
+#include <tuple>             // for tie
 #include <vector>            // for vector
 
+#include "abstractio.h"      // for SECTOR_BYTES
+#include "archive.h"         // for ArchiveWriter, ArchiveOutput, ArchiveFormat
 #include "cleanup.h"         // for ostream_flag_saver
-#include "commands.h"        // for CommandInterface, REGISTER_COMMAND
+#include "commands.h"        // for CommandInterface, REGISTER_COMMAND, split_...
 #include "dfs_filesystem.h"  // for FileSystem
 #include "dfs_unused.h"      // for SectorMap
 #include "dfscontext.h"      // for DFSContext
-#include "dfstypes.h"        // for sector_count_type, sector_count
+#include "dfstypes.h"        // for byte, sector_count_type, sector_count
 #include "driveselector.h"   // for operator<<, VolumeSelector, SurfaceSelector
 #include "geometry.h"        // for Geometry
+#include "hostcopy.h"        // for copy_sectors
 #include "storage.h"         // for AbstractDrive, StorageConfiguration
 
 namespace
@@ -41,7 +47,7 @@ using DFS::sector_count;
 
 std::string make_name(const std::string& dest_dir, sector_count_type first_sector)
 {
-  assert(dest_dir.back() == '/');
+  assert(dest_dir.empty() || dest_dir.back() == '/');
   std::ostringstream ss;
   ss << dest_dir << "unused_" << std::hex << std::noshowbase
      << std::uppercase << std::setfill('0') << std::setw(3)
@@ -62,11 +68,15 @@ public:
   const std::string usage() const override
   {
     return "usage: " + name() + " destination-directory\n"
+      "       " + name() + " --archive=tar|zip destination-file\n"
       "For each span of unused space in the selected drive\n"
       "(see the --drive global option), write a file into\n"
       "destination-directory.\n"
       "The output files are given names corresponding to the\n"
-      "first sector they occupy (such as unused_1E4.bin).\n";
+      "first sector they occupy (such as unused_1E4.bin).\n"
+      "With --archive, the files are instead written into a\n"
+      "single tar or zip archive (to the standard output, if\n"
+      "the destination is -).\n";
   }
 
   const std::string description() const override
@@ -80,31 +90,54 @@ public:
   {
     if (ctx.current_volume.subvolume())
       {
-	std::cerr << name() << ": please specify only a drive number, not also a volume letter.\n";
+	ctx.err() << name() << ": please specify only a drive number, not also a volume letter.\n";
 	return false;
       }
 
+    std::optional<DFS::ArchiveFormat> archive_format;
+    std::vector<std::string> options, non_options;
+    std::tie(options, non_options) = DFS::split_command_options(args, {"--archive"});
+    for (const auto& opt : options)
+      {
+	const std::string archive_prefix("--archive=");
+	if (opt.compare(0, archive_prefix.size(), archive_prefix) == 0)
+	  {
+	    archive_format = DFS::archive_format_from_name(opt.substr(archive_prefix.size()));
+	    if (!archive_format)
+	      {
+		ctx.err() << name() << ": --archive needs a format, tar or zip\n";
+		return false;
+	      }
+	  }
+	else
+	  {
+	    ctx.err() << name() << ": unknown option " << opt << "\n";
+	    return false;
+	  }
+      }
+
     // Use the --drive option to select which drive to extract data from.
-    if (args.size() < 2)
+    const char *dest_kind = archive_format ? "file" : "directory";
+    if (non_options.size() < 2)
       {
-	std::cerr << name() << ": please specify the destination directory.\n";
+	ctx.err() << name() << ": please specify the destination " << dest_kind << ".\n";
 	return false;
       }
-    if (args.size() > 2)
+    if (non_options.size() > 2)
       {
-	std::cerr << name() << ": just one argument (the destination "
-		  << "directory) is needed.\n";
+	ctx.err() << name() << ": just one argument (the destination "
+		  << dest_kind << ") is needed.\n";
 	return false;
       }
-    std::string dest_dir(args[1]);
-    if (dest_dir.back() != '/')
+    std::string dest_dir(non_options[1]);
+    if (!archive_format && dest_dir.back() != '/')
       dest_dir.push_back('/');
 
     const DFS::SurfaceSelector surface(ctx.current_volume.surface());
     std::string error;
-    auto fail = [&surface, &error]()
+    auto fail = [&ctx, &surface, &error]()
 		{
-		  failed_to_mount_surface(std::cerr, surface, error);
+		  failed_to_mount_surface(ctx.err(), surface, error);
 		  return false;
 		};
     DFS::AbstractDrive *drive = 0;
@@ -115,42 +148,70 @@ public:
       return fail();
 
     // We're going to loop over the unoccupied areas of the disc,
-    // extracting each.  We add a sentinel value to ensure that we
-    // also extract the final free span, if any (this avoids
-    // duplication of code).
+    // extracting each.
     std::unique_ptr<DFS::SectorMap> occupied_by = mounted_fs->get_sector_map(surface);
-
     const sector_count_type last_sec = mounted_fs->disc_sector_count();
-    occupied_by->add_other(last_sec, ":::end");
-    int begin = -1;
     unsigned short count = 0;
-    for (DFS::sector_count_type sec = 0; sec <= last_sec; ++sec)
+    if (archive_format)
       {
-	std::optional<std::string> name = occupied_by->at(sec);
-	if (name)
+	DFS::ArchiveOutput output(dest_dir, ctx.out());
+	std::unique_ptr<DFS::ArchiveWriter> archive =
+	  DFS::make_archive_writer(*archive_format, output.stream(), time(NULL));
+	for (const DFS::SectorMap::Run& span : occupied_by->free_runs(last_sec))
 	  {
-	    if (begin >= 0)
-	      {
-		if (!write_span(drive, dest_dir, sector_count(begin), sec))
-		  return false;
-		++count;
-	      }
-	    begin = -1;
-	    continue;
+	    add_span(ctx, drive, archive.get(), span.begin, span.end);
+	    ++count;
 	  }
-	else if (begin < 0)
+	archive->finish();
+	if (!output.close(&error))
 	  {
-	    begin = sec;
+	    ctx.err() << error << "\n";
+	    return false;
 	  }
+	// Keep the standard output for the archive itself.
+	std::ostream& os(output.is_stdout() ? ctx.err() : ctx.out());
+	ostream_flag_saver restore_flags(os);
+	os << std::dec << count << " files were written to "
+	   << output.description() << "\n";
+	return true;
       }
-    ostream_flag_saver restore_cout_flags(std::cout);
-    std::cout << std::dec << count << " files were written to "
+    for (const DFS::SectorMap::Run& span : occupied_by->free_runs(last_sec))
+      {
+	if (!write_span(ctx, drive, dest_dir, span.begin, span.end))
+	  return false;
+	++count;
+      }
+    ostream_flag_saver restore_cout_flags(ctx.out());
+    ctx.out() << std::dec << count << " files were written to "
 	      << dest_dir << "\n";
     return true;
   }
 
 private:
-  bool write_span(DFS::AbstractDrive *drive,
+  void add_span(const DFS::DFSContext& ctx,
+		DFS::AbstractDrive *drive,
+		DFS::ArchiveWriter *archive,
+		sector_count_type start_sector,
+		// end_sector is the first sector not included.
+		sector_count_type end_sector)
+  {
+    assert(start_sector < end_sector);
+    // The size of an archive member has to be known before its data
+    // is written, so read the whole span first.
+    std::vector<DFS::byte> data((end_sector - start_sector) * DFS::SECTOR_BYTES);
+    const unsigned long got = drive->read_blocks(start_sector, end_sector - start_sector,
+						 data.data());
+    if (got < end_sector - start_sector)
+      {
+	ctx.err() << "warning: failed to read sector number "
+		  << (start_sector + got) << "\n";
+      }
+    archive->add_member(make_name("", start_sector),
+			data.data(), data.data() + got * DFS::SECTOR_BYTES);
+  }
+
+  bool write_span(const DFS::DFSContext& ctx,
+		  DFS::AbstractDrive *drive,
 		  const std::string& dest_dir,
 		  sector_count_type start_sector,
 		  // end_sector is the first sector not included.
@@ -158,31 +219,31 @@ private:
   {
     assert(start_sector < end_sector);
     const std::string file_name(make_name(dest_dir, start_sector));
-    std::ofstream output(file_name, std::ofstream::binary|std::ofstream::trunc);
-    if (!output)
+    const int out = open(file_name.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0666);
+    if (out < 0)
       {
-	std::cerr << "unable to create output file " << file_name << "\n";
+	ctx.err() << "unable to create output file " << file_name << "\n";
 	return false;
       }
-
-    for (sector_count_type sec = start_sector; sec < end_sector; ++sec)
+    // Where the drive is a plain image file, the sectors are copied
+    // directly from it.
+    unsigned long copied;
+    std::string error;
+    bool ok = DFS::copy_sectors(*drive, start_sector, end_sector, out, &copied, &error);
+    if (ok && copied < end_sector - start_sector)
       {
-	auto got = drive->read_block(sec);
-	if (!got)
-	  {
-	    std::cerr << "warning: failed to read sector number " << sec << "\n";
-	    break;
-	  }
-	errno = 0;
-	output.write(reinterpret_cast<char*>(got->data()), got->size());
-	if (!output)
-	  break;
+	ctx.err() << "warning: failed to read sector number "
+		  << (start_sector + copied) << "\n";
+      }
+    if (close(out) != 0 && ok)
+      {
+	error = strerror(errno);
+	ok = false;
       }
-    output.close();
-    if (!output)
+    if (!ok)
       {
-	std::cerr << "error: failed to write to " << file_name << ": "
-		  << strerror(errno) << "\n";
+	ctx.err() << "error: failed to write to " << file_name << ": "
+		  << error << "\n";
 	return false;
       }
     return true;
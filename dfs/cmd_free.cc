@@ -67,21 +67,26 @@ public:
     return "display information about a disc's free space";
   }
 
+  bool supports_multiple_images() const override
+  {
+    return true;
+  }
+
   bool invoke(const DFS::StorageConfiguration& storage,
 	      const DFS::DFSContext& ctx,
 	      const std::vector<std::string>& args) override
   {
     std::string error;
-    auto fail = [&error]()
+    auto fail = [&ctx, &error]()
 		 {
-		   std::cerr << error << "\n";
+		   ctx.err() << error << "\n";
 		   return false;
 		 };
 
     DFS::VolumeSelector vol(0);
     if (args.size() > 2)
       {
-	std::cerr << "at most one command-line argument is needed.\n";
+	ctx.err() << "at most one command-line argument is needed.\n";
 	return false;
       }
     if (args.size() < 2)
@@ -94,18 +99,18 @@ public:
 	if (!DFS::StorageConfiguration::decode_drive_number(args[1], &vol, error))
 	  return fail();
 	if (!error.empty())
-	  std::cerr << "warning: " << error << "\n";
+	  ctx.err() << "warning: " << error << "\n";
       }
     auto mounted = storage.mount(vol, error);
     if (!mounted)
       {
-	failed_to_mount_volume(std::cerr, vol, error);
+	failed_to_mount_volume(ctx.err(), vol, error);
 	return false;
       }
-    auto catalog(mounted->volume()->root());
+    const auto& catalog(mounted->volume()->root());
 
     int sectors_used = 2;
-    const std::vector<DFS::CatalogEntry> entries = catalog.entries();
+    const std::vector<DFS::CatalogEntry>& entries = catalog.entries();
     for (const auto& entry : entries)
       {
 	assert(entry.file_length() < std::numeric_limits<int>::max());
@@ -117,10 +122,10 @@ public:
 	    sectors_used = last_sector_of_file;
 	  }
       }
-    ostream_flag_saver restore_cout_flags(std::cout);
-    auto show = [](int files, int sectors, const std::string& desc)
+    ostream_flag_saver restore_cout_flags(ctx.out());
+    auto show = [&ctx](int files, int sectors, const std::string& desc)
 		{
-		  std::cout << std::setw(2) << std::setfill('0') << std::dec
+		  ctx.out() << std::setw(2) << std::setfill('0') << std::dec
 			    << files << " Files "
 			    << std::setw(3) << std::setfill('0') << std::hex
 			    << sectors << " Sectors "
@@ -129,16 +134,16 @@ public:
 			    << " Bytes " << desc << "\n";
 		};
 
-    auto prevlocale = std::cout.imbue(std::locale(std::cout.getloc(),
-					     new comma_thousands)); // takes ownership
+    auto prevlocale = ctx.out().imbue(std::locale(ctx.out().getloc(),
+						  new comma_thousands)); // takes ownership
     assert(entries.size() < std::numeric_limits<int>::max());
     int files_used = static_cast<int>(entries.size());
     int files_free = catalog.max_file_count() - files_used;
     int sectors_free = catalog.total_sectors() - sectors_used;
-    std::cout << std::uppercase;
+    ctx.out() << std::uppercase;
     show(files_free, sectors_free, "Free");
     show(files_used, sectors_used, "Used");
-    std::cout.imbue(prevlocale);
+    ctx.out().imbue(prevlocale);
     return true;
   }
 };
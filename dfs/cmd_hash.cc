@@ -0,0 +1,186 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include <iomanip>          // for operator<<, setw, setfill
+#include <iostream>         // for operator<<, basic_ostream, ostream
+#include <memory>           // for unique_ptr
+#include <optional>         // for optional
+#include <sstream>          // for ostringstream
+#include <string>           // for string, operator+
+#include <tuple>            // for tie
+#include <vector>           // for vector
+
+#include "abstractio.h"     // for DataAccess, SECTOR_BYTES
+#include "cleanup.h"        // for ostream_flag_saver
+#include "commands.h"       // for CommandInterface, REGISTER_COMMAND, split_...
+#include "dfs.h"            // for sign_extend
+#include "dfs_catalog.h"    // for CatalogEntry, Catalog
+#include "dfs_filesystem.h" // for FileSystem
+#include "dfs_volume.h"     // for Volume
+#include "dfscontext.h"     // for DFSContext
+#include "dfstypes.h"       // for byte
+#include "driveselector.h"  // for VolumeSelector, SurfaceSelector, operator<<
+#include "exceptions.h"     // for BaseException
+#include "sha256.h"         // for SHA256
+#include "storage.h"        // for StorageConfiguration
+#include "workqueue.h"      // for run_largest_first
+
+namespace
+{
+  struct FileHash
+  {
+    DFS::VolumeSelector selector;
+    DFS::Volume* volume;
+    DFS::CatalogEntry entry;
+    // Results, filled in by the worker.
+    std::string digest;
+    std::string error;
+  };
+
+class CommandHash : public DFS::CommandInterface
+{
+public:
+  const std::string name() const override
+  {
+    return "hash";
+  }
+
+  const std::string usage() const override
+  {
+    return "usage: " + name() + " [--jobs N]\n"
+      "Prints the SHA-256 hash of the body of every file on every volume\n"
+      "of every occupied drive, one file per line:\n"
+      "  HASH LENGTH LOAD EXEC :VOLUME.DIR.NAME\n"
+      "Files with the same contents have the same hash wherever they are\n"
+      "stored, so sorting the output groups duplicate files together.\n"
+      "The length and addresses (in hex) come from the catalog and are\n"
+      "not part of the hash.  Files are hashed by N threads at once; the\n"
+      "default is the number of processors.\n";
+  }
+
+  const std::string description() const override
+  {
+    return "print a hash of the contents of every file";
+  }
+
+  bool supports_multiple_images() const override
+  {
+    return true;
+  }
+
+  bool invoke(const DFS::StorageConfiguration& storage,
+	      const DFS::DFSContext& ctx,
+	      const std::vector<std::string>& args) override
+  {
+    unsigned int jobs = DFS::default_job_count();
+    std::vector<std::string> options, non_options;
+    std::tie(options, non_options) = DFS::split_command_options(args, {"--jobs"});
+    for (const auto& opt : options)
+      {
+	if (std::optional<unsigned int> n = DFS::jobs_option(name(), opt, ctx.err()))
+	  {
+	    if (!*n)
+	      return false;
+	    jobs = *n;
+	  }
+	else
+	  {
+	    ctx.err() << name() << ": unknown option " << opt << "\n";
+	    return false;
+	  }
+      }
+    if (non_options.size() > 1)
+      {
+	ctx.err() << name() << ": no arguments are needed.\n";
+	return false;
+      }
+
+    std::vector<std::unique_ptr<DFS::FileSystem>> file_systems;
+    std::vector<FileHash> files;
+    bool ok = DFS::visit_all_volumes(storage, ctx, &file_systems,
+				     [&files](const DFS::VolumeSelector& selector, DFS::Volume* vol)
+				     {
+				       for (const DFS::CatalogEntry& entry : vol->root().entries())
+					 files.push_back(FileHash{selector, vol, entry,
+								  std::string(), std::string()});
+				     });
+
+    std::vector<unsigned long> costs;
+    for (const FileHash& f : files)
+      costs.push_back(f.entry.file_length() + 1);
+    DFS::run_largest_first(costs, jobs,
+			   [&files](size_t i)
+			   {
+			     hash_file(&files[i]);
+			   });
+
+    ostream_flag_saver restore_cout_flags(ctx.out());
+    for (const FileHash& f : files)
+      {
+	if (!f.error.empty())
+	  {
+	    ctx.err() << location(f) << ": " << f.error << "\n";
+	    ok = false;
+	    continue;
+	  }
+	ctx.out() << f.digest << ' '
+		  << std::hex << std::uppercase << std::setfill('0')
+		  << std::setw(6) << f.entry.file_length() << ' '
+		  << std::setw(6) << DFS::sign_extend(f.entry.load_address()) << ' '
+		  << std::setw(6) << DFS::sign_extend(f.entry.exec_address()) << ' '
+		  << location(f) << "\n";
+      }
+    return ok && ctx.out().good();
+  }
+
+private:
+  static std::string location(const FileHash& f)
+  {
+    std::ostringstream ss;
+    ss << ':' << f.selector << '.' << f.entry.directory() << '.' << f.entry.name();
+    return ss.str();
+  }
+
+  static void hash_file(FileHash* f)
+  {
+    const unsigned long len = f->entry.file_length();
+    const unsigned long sectors = (len + DFS::SECTOR_BYTES - 1) / DFS::SECTOR_BYTES;
+    std::vector<DFS::byte> body(sectors * DFS::SECTOR_BYTES);
+    unsigned long got;
+    try
+      {
+	got = f->volume->data_region().read_blocks(f->entry.start_sector(), sectors,
+						   body.data());
+      }
+    catch (DFS::BaseException& e)
+      {
+	f->error = e.what();
+	return;
+      }
+    if (got < sectors)
+      {
+	std::ostringstream ss;
+	ss << "sector " << (f->entry.start_sector() + got) << " cannot be read";
+	f->error = ss.str();
+	return;
+      }
+    DFS::SHA256 h;
+    h.update(body.data(), body.data() + len);
+    f->digest = DFS::SHA256::hex(h.finish());
+  }
+};
+REGISTER_COMMAND(CommandHash);
+
+} // namespace
@@ -25,12 +25,11 @@
 
 #include "commands.h"  // for CommandHelp, CommandInterface, CIReg, REGISTER...
 #include "dfs.h"       // for get_option_help
+#include "dfscontext.h" // for DFSContext
 
 // CommandHelp is in the DFS namespace rather than in the unnamed
 // namespace, because we need to directly instantiate it.
 
-using std::cout;
-
 namespace DFS
 {
   class StorageConfiguration;
@@ -52,25 +51,25 @@ namespace DFS
   }
 
   bool CommandHelp::invoke(const DFS::StorageConfiguration&,
-			   const DFS::DFSContext&,
+			   const DFS::DFSContext& ctx,
 			   const std::vector<std::string>& args)
   {
     const auto& option_help = get_option_help();
     const int max_command_name_len = 14;
     if (args.size() < 2)
       {
-	cout << "usage: dfs [global-options] command [command-options] [command-arguments]\n"
-	     << "\n"
-	     << "This is a program for extracting information from Acorn DFS disc images.\n"
-	     << "\n"
-	     << "The global options affect almost all commands.  See below for details.\n"
-	     << "The command is a single word (for example dump, info) specifying what\n"
-	     << "action should be performed on one or more of the files within the DFS\n"
-	     << "disc image.  The command options modify the way the command works.\n"
-	     << "Most commands take no options.  The command-arguments typically specify\n"
-	     << "which files within the disc image will be selected.\n"
-	     << "\n"
-	     << "Global options:\n";
+	ctx.out() << "usage: dfs [global-options] command [command-options] [command-arguments]\n"
+		  << "\n"
+		  << "This is a program for extracting information from Acorn DFS disc images.\n"
+		  << "\n"
+		  << "The global options affect almost all commands.  See below for details.\n"
+		  << "The command is a single word (for example dump, info) specifying what\n"
+		  << "action should be performed on one or more of the files within the DFS\n"
+		  << "disc image.  The command options modify the way the command works.\n"
+		  << "Most commands take no options.  The command-arguments typically specify\n"
+		  << "which files within the disc image will be selected.\n"
+		  << "\n"
+		  << "Global options:\n";
 	int max_option_len = 0;
 	for (const auto& h : option_help)
 	  {
@@ -80,23 +79,23 @@ namespace DFS
 	  }
 	for (const auto& h : option_help)
 	  {
-	    cout << "--" << std::left << std::setw(max_option_len)
-		 << h.first << ": " << h.second << "\n";
+	    ctx.out() << "--" << std::left << std::setw(max_option_len)
+		      << h.first << ": " << h.second << "\n";
 	  }
-	cout << "\n";
+	ctx.out() << "\n";
 
 	const std::string prefix = "      ";
-	cout << "Commands:\n";
-	auto show = [prefix](CommandInterface* c) -> bool
+	ctx.out() << "Commands:\n";
+	auto show = [&ctx, prefix](CommandInterface* c) -> bool
 		    {
-		      cout << prefix << std::setw(max_command_name_len)
-			   << std::left << c->name() << ": "
-			   << c->description() << "\n";
-		      return cout.good();
+		      ctx.out() << prefix << std::setw(max_command_name_len)
+				<< std::left << c->name() << ": "
+				<< c->description() << "\n";
+		      return ctx.out().good();
 		    };
 	auto ok = CIReg::visit_all_commands(show);
-	cout << "For help on any individual command, use \"help command-name\"\n";
-	return ok && cout.good();
+	ctx.out() << "For help on any individual command, use \"help command-name\"\n";
+	return ok && ctx.out().good();
       }
     else
       {
@@ -105,16 +104,16 @@ namespace DFS
 	    auto instance = CIReg::get_command(args[i]);
 	    if (instance)
 	      {
-		cout << std::setw(args.size() > 2 ? max_command_name_len : 0)
-		     << std::left << args[i]
-		     << ": " << instance->description()
-		     << "\n" << instance->usage() << "\n";
-		if (!cout.good())
+		ctx.out() << std::setw(args.size() > 2 ? max_command_name_len : 0)
+			  << std::left << args[i]
+			  << ": " << instance->description()
+			  << "\n" << instance->usage() << "\n";
+		if (!ctx.out().good())
 		  return false;
 	      }
 	    else
 	      {
-		std::cerr << args[i] << " is not a known command.\n";
+		ctx.err() << args[i] << " is not a known command.\n";
 		return false;
 	      }
 	  }
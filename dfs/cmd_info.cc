@@ -28,9 +28,6 @@
 
 namespace DFS { struct DFSContext; }
 
-using std::cerr;
-using std::cout;
-
 // TODO: wrap in anonymous namespace?
 
 class CommandInfo : public DFS::CommandInterface // *INFO
@@ -73,20 +70,25 @@ public:
     return "display information about a file (for example load address)";
   }
 
+  bool supports_multiple_images() const override
+  {
+    return true;
+  }
+
   bool invoke(const DFS::StorageConfiguration& storage,
 	      const DFS::DFSContext& ctx,
 	      const std::vector<std::string>& args) override
   {
     if (args.size() < 2)
       {
-	cerr << "info: please give a file name or wildcard specifying which files "
-	     << "you want to see information about.\n";
+	ctx.err() << "info: please give a file name or wildcard specifying which files "
+		  << "you want to see information about.\n";
 	return false;
       }
     if (args.size() > 2)
       {
-	cerr << "info: please specify no more than one argument (you specified "
-	     << (args.size() - 1) << ")\n";
+	ctx.err() << "info: please specify no more than one argument (you specified "
+		  << (args.size() - 1) << ")\n";
 	return false;
       }
     std::string error_message;
@@ -94,7 +96,7 @@ public:
       DFS::AFSPMatcher::make_unique(ctx, args[1], &error_message);
     if (!matcher)
       {
-	cerr << "Not a valid pattern (" << error_message << "): " << args[1] << "\n";
+	ctx.err() << "Not a valid pattern (" << error_message << "): " << args[1] << "\n";
 	return false;
       }
 
@@ -103,21 +105,30 @@ public:
     auto mounted = storage.mount(vol, error);
     if (!mounted)
       {
-	failed_to_mount_volume(std::cerr, vol, error);
+	failed_to_mount_volume(ctx.err(), vol, error);
 	return false;
       }
     const auto& catalog(mounted->volume()->root());
 
-    const std::vector<DFS::CatalogEntry> entries(catalog.entries());
-    for (const auto& entry : entries)
+    const std::vector<DFS::CatalogEntry>& entries(catalog.entries());
+    auto show = [&ctx, &matcher, &vol](const DFS::CatalogEntry& entry)
       {
 #if VERBOSE_FOR_TESTS
-	std::cerr << "info: directory is '" << entry.directory() << "'\n";
-	std::cerr << "info: item is '" << entry.name() << "'\n";
+	ctx.err() << "info: directory is '" << entry.directory() << "'\n";
+	ctx.err() << "info: item is '" << entry.name() << "'\n";
 #endif
-	if (!matcher->matches(vol, entry.directory(), entry.name()))
-	  continue;
-	cout << entry << "\n";
+	if (matcher->matches(vol, entry.directory(), entry.name()))
+	  ctx.out() << entry << "\n";
+      };
+    if (const auto& literal = matcher->literal_name())
+      {
+	for (auto pos : catalog.positions_of(literal->first, literal->second))
+	  show(entries[pos]);
+      }
+    else
+      {
+	for (const auto& entry : entries)
+	  show(entry);
       }
     return true;
   }
@@ -13,16 +13,69 @@
 //   See the License for the specific language governing permissions and
 //   limitations under the License.
 //
-#include <iomanip>     // for operator<<, setbase, setfill, setw
-#include <iostream>    // for operator<<, cout, ostream, ...
-#include <string>      // for string, allocator
+#include <iostream>    // for ostream
+#include <string>      // for string, to_string
 #include <vector>      // for vector
 
-#include "commands.h"  // for body_command, file_body_logic, CommandInterface
+#include "commands.h"  // for body_command, FileBodyConsumer, CommandInterface
+#include "dfscontext.h" // for DFSContext
 #include "dfstypes.h"  // for byte
+#include "textconv.h"  // for find_cr
 
 namespace DFS { class StorageConfiguration; }
-namespace DFS { struct DFSContext; }
+
+namespace
+{
+  class NumberedLines : public DFS::FileBodyConsumer
+  {
+  public:
+    explicit NumberedLines(std::ostream& out)
+      : out_(out)
+    {
+    }
+
+    bool chunk(const DFS::byte* body_start, const DFS::byte* body_end) override
+    {
+      // Each line is copied as a whole into buf_, which is written
+      // out once for the whole chunk.
+      buf_.clear();
+      const DFS::byte* p = body_start;
+      while (p != body_end)
+	{
+	  if (start_of_line_)
+	    {
+	      append_line_number();
+	      start_of_line_ = false;
+	    }
+	  const DFS::byte* cr = DFS::find_cr(p, body_end);
+	  buf_.append(reinterpret_cast<const char*>(p), cr - p);
+	  if (cr == body_end)
+	    break;
+	  buf_.push_back('\n');
+	  start_of_line_ = true;
+	  p = cr + 1;
+	}
+      return out_.write(buf_.data(), buf_.size()).good();
+    }
+
+  private:
+    // Append the line number, right-aligned in a field of 4
+    // characters, and a space.
+    void append_line_number()
+    {
+      const std::string n(std::to_string(line_number_++));
+      if (n.size() < 4)
+	buf_.append(4 - n.size(), ' ');
+      buf_.append(n);
+      buf_.push_back(' ');
+    }
+
+    std::ostream& out_;
+    std::string buf_;
+    int line_number_ = 1;
+    bool start_of_line_ = true;
+  };
+}  // namespace
 
 namespace DFS
 {
@@ -49,33 +102,7 @@ namespace DFS
 		const DFS::DFSContext& ctx,
 		const std::vector<std::string>& args) override
     {
-      file_body_logic display_numbered_lines =
-	[](const byte* body_start,
-	   const byte *body_end,
-	   const std::vector<std::string>&) -> bool
-	{
-	  int line_number = 1;
-	  bool start_of_line = true;
-	  std::cout << std::setfill(' ') << std::setbase(10);
-	  for (const byte *p = body_start; p < body_end; ++p)
-	    {
-	      if (start_of_line)
-		{
-		  std::cout << std::setw(4) << line_number++ << ' ';
-		  start_of_line = false;
-		}
-	      if (*p == 0x0D)
-		{
-		  std::cout << '\n';
-		  start_of_line = true;
-		}
-	      else
-		{
-		  std::cout << static_cast<char>(*p);
-		}
-	    }
-	  return true;
-	};
+      NumberedLines display_numbered_lines(ctx.out());
       return body_command(storage, ctx, args, display_numbered_lines);
     }
   };
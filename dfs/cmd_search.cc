@@ -0,0 +1,352 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include <ctype.h>          // for isxdigit, isspace
+#include <algorithm>        // for min, sort
+#include <iomanip>          // for operator<<, setw, setfill
+#include <iostream>         // for operator<<, basic_ostream, ostream
+#include <memory>           // for unique_ptr
+#include <optional>         // for optional
+#include <sstream>          // for ostringstream
+#include <string>           // for string, operator+
+#include <tuple>            // for tie
+#include <utility>          // for pair
+#include <vector>           // for vector
+
+#include "abstractio.h"     // for DataAccess, SECTOR_BYTES
+#include "cleanup.h"        // for ostream_flag_saver
+#include "commands.h"       // for CommandInterface, REGISTER_COMMAND, split_...
+#include "dfs_catalog.h"    // for CatalogEntry, Catalog
+#include "dfs_filesystem.h" // for FileSystem
+#include "dfs_unused.h"     // for SectorMap
+#include "dfs_volume.h"     // for Volume
+#include "dfscontext.h"     // for DFSContext
+#include "dfstypes.h"       // for byte
+#include "driveselector.h"  // for VolumeSelector, SurfaceSelector, operator<<
+#include "exceptions.h"     // for BaseException
+#include "multisearch.h"    // for MultiPatternMatcher
+#include "storage.h"        // for StorageConfiguration, AbstractDrive
+#include "workqueue.h"      // for run_largest_first
+
+namespace
+{
+  // The number of sectors read (and searched) at once.
+  constexpr unsigned long read_chunk_sectors = 64;
+
+  // Either the files of one volume, or the unused sectors of one
+  // drive.
+  struct SearchTask
+  {
+    DFS::VolumeSelector selector;
+    DFS::Volume* volume;	// null for unused sectors
+    DFS::AbstractDrive* drive;	// null for files
+    std::vector<DFS::SectorMap::Run> free_runs;
+    unsigned long sectors;
+    // Results, filled in by the worker.
+    std::vector<std::string> matches;
+    std::vector<std::string> errors;
+    // Unused sectors at the end of a drive are often missing from
+    // the image file, so failing to read them is not an error.
+    std::vector<std::string> warnings;
+  };
+
+  std::optional<DFS::MultiPatternMatcher::Pattern> parse_hex(const std::string& s)
+  {
+    DFS::MultiPatternMatcher::Pattern result;
+    int pending = -1;
+    for (char ch : s)
+      {
+	const unsigned char uch = static_cast<unsigned char>(ch);
+	if (isspace(uch))
+	  continue;
+	if (!isxdigit(uch))
+	  return std::nullopt;
+	const int digit = isdigit(uch) ? uch - '0' : (toupper(uch) - 'A' + 10);
+	if (pending < 0)
+	  {
+	    pending = digit;
+	  }
+	else
+	  {
+	    result.push_back(static_cast<DFS::byte>(pending * 16 + digit));
+	    pending = -1;
+	  }
+      }
+    if (pending >= 0 || result.empty())
+      return std::nullopt;
+    return result;
+  }
+
+class CommandSearch : public DFS::CommandInterface
+{
+public:
+  const std::string name() const override
+  {
+    return "search";
+  }
+
+  const std::string usage() const override
+  {
+    return "usage: " + name() + " [--jobs N] [--unused] [--hex HEX]... [PATTERN]...\n"
+      "Searches the body of every file on every volume of every occupied\n"
+      "drive for each PATTERN (which is matched exactly, as a string of\n"
+      "bytes) and for each --hex pattern (a sequence of bytes in hex, such\n"
+      "as \"A9 00\" or A900).  With --unused, the sectors which are not\n"
+      "used by any file or catalog are searched too.\n"
+      "\n"
+      "Each match is printed on one line of the form\n"
+      "  LOCATION OFFSET PATTERN\n"
+      "where LOCATION is a file name such as :0.$.FOO, or for unused\n"
+      "sectors a drive followed by :unused (for example 0:unused).  OFFSET\n"
+      "is the position (in hex) of the start of the match within the\n"
+      "file, or within the drive for unused sectors.  The volumes are\n"
+      "searched by N threads at once; the default is the number of\n"
+      "processors.\n";
+  }
+
+  const std::string description() const override
+  {
+    return "search the contents of files for strings or bytes";
+  }
+
+  bool supports_multiple_images() const override
+  {
+    return true;
+  }
+
+  bool invoke(const DFS::StorageConfiguration& storage,
+	      const DFS::DFSContext& ctx,
+	      const std::vector<std::string>& args) override
+  {
+    unsigned int jobs = DFS::default_job_count();
+    bool search_unused = false;
+    std::vector<DFS::MultiPatternMatcher::Pattern> patterns;
+    std::vector<std::string> pattern_names;
+    std::vector<std::string> options, non_options;
+    std::tie(options, non_options) = DFS::split_command_options(args, {"--jobs", "--hex"});
+    for (const auto& opt : options)
+      {
+	const std::string hex_prefix("--hex=");
+	if (std::optional<unsigned int> n = DFS::jobs_option(name(), opt, ctx.err()))
+	  {
+	    if (!*n)
+	      return false;
+	    jobs = *n;
+	  }
+	else if (opt.compare(0, hex_prefix.size(), hex_prefix) == 0)
+	  {
+	    const std::string hex(opt.substr(hex_prefix.size()));
+	    std::optional<DFS::MultiPatternMatcher::Pattern> bytes = parse_hex(hex);
+	    if (!bytes)
+	      {
+		ctx.err() << name() << ": --hex needs a whole number of bytes in hex, not '"
+			  << hex << "'\n";
+		return false;
+	      }
+	    patterns.push_back(*bytes);
+	    pattern_names.push_back(hex);
+	  }
+	else if (opt == "--unused")
+	  {
+	    search_unused = true;
+	  }
+	else
+	  {
+	    ctx.err() << name() << ": unknown option " << opt << "\n";
+	    return false;
+	  }
+      }
+    for (size_t i = 1; i < non_options.size(); ++i)
+      {
+	const std::string& literal(non_options[i]);
+	if (literal.empty())
+	  {
+	    ctx.err() << name() << ": search patterns must not be empty\n";
+	    return false;
+	  }
+	patterns.emplace_back(literal.begin(), literal.end());
+	pattern_names.push_back(literal);
+      }
+    if (patterns.empty())
+      {
+	ctx.err() << name() << ": please specify at least one pattern\n";
+	return false;
+      }
+    const DFS::MultiPatternMatcher matcher(patterns);
+
+    bool ok = true;
+    std::vector<std::unique_ptr<DFS::FileSystem>> file_systems;
+    std::vector<SearchTask> tasks;
+    auto add_volume = [&tasks](const DFS::VolumeSelector& selector, DFS::Volume* vol)
+      {
+	unsigned long sectors = 0;
+	for (const DFS::CatalogEntry& entry : vol->root().entries())
+	  sectors += (entry.file_length() + DFS::SECTOR_BYTES - 1) / DFS::SECTOR_BYTES;
+	tasks.push_back(SearchTask{selector, vol, nullptr, {}, sectors, {}, {}, {}});
+      };
+    auto add_unused = [&](const DFS::SurfaceSelector& surface, DFS::FileSystem* fs)
+      {
+	std::string error;
+	DFS::AbstractDrive* drive;
+	if (!storage.select_drive(surface, &drive, error))
+	  {
+	    DFS::failed_to_mount_surface(ctx.err(), surface, error);
+	    ok = false;
+	    return;
+	  }
+	const std::unique_ptr<DFS::SectorMap> sector_map = fs->get_sector_map(surface);
+	std::vector<DFS::SectorMap::Run> runs = sector_map->free_runs(fs->disc_sector_count());
+	unsigned long sectors = 0;
+	for (const DFS::SectorMap::Run& run : runs)
+	  sectors += run.end - run.begin;
+	tasks.push_back(SearchTask{DFS::VolumeSelector(surface), nullptr, drive,
+				   std::move(runs), sectors, {}, {}, {}});
+      };
+    if (!DFS::visit_all_volumes(storage, ctx, &file_systems, add_volume,
+				search_unused ? add_unused
+				: std::function<void(const DFS::SurfaceSelector&,
+						     DFS::FileSystem*)>()))
+      ok = false;
+
+    std::vector<unsigned long> costs;
+    for (const SearchTask& t : tasks)
+      costs.push_back(t.sectors + 1);
+    DFS::run_largest_first(costs, jobs,
+			   [&](size_t i)
+			   {
+			     SearchTask* task = &tasks[i];
+			     if (task->volume)
+			       search_files(matcher, pattern_names, task);
+			     else
+			       search_unused_sectors(matcher, pattern_names, task);
+			   });
+
+    for (const SearchTask& t : tasks)
+      {
+	for (const std::string& line : t.matches)
+	  ctx.out() << line << "\n";
+	for (const std::string& e : t.errors)
+	  ctx.err() << e << "\n";
+	for (const std::string& w : t.warnings)
+	  ctx.err() << "warning: " << w << "\n";
+	if (!t.errors.empty())
+	  ok = false;
+      }
+    return ok && ctx.out().good();
+  }
+
+private:
+  using Match = std::pair<unsigned long, size_t>; // offset, pattern
+
+  static void format_matches(const std::string& location, std::vector<Match>* found,
+			     const std::vector<std::string>& pattern_names,
+			     std::vector<std::string>* lines)
+  {
+    std::sort(found->begin(), found->end());
+    for (const Match& m : *found)
+      {
+	std::ostringstream ss;
+	ss << location << ' ' << std::hex << std::uppercase << std::setfill('0')
+	   << std::setw(6) << m.first << ' ' << pattern_names[m.second];
+	lines->push_back(ss.str());
+      }
+  }
+
+  static void search_files(const DFS::MultiPatternMatcher& matcher,
+			   const std::vector<std::string>& pattern_names,
+			   SearchTask* task)
+  {
+    DFS::DataAccess& media(task->volume->data_region());
+    for (const DFS::CatalogEntry& entry : task->volume->root().entries())
+      {
+	std::ostringstream where;
+	where << ':' << task->selector << '.' << entry.directory() << '.' << entry.name();
+	std::vector<Match> found;
+	DFS::MultiPatternMatcher::State state;
+	auto scan = [&matcher, &state, &found](const DFS::byte* begin, const DFS::byte* end)
+		    {
+		      matcher.scan(&state, begin, end,
+				   [&found](size_t pattern, unsigned long offset)
+				   {
+				     found.push_back(Match(offset, pattern));
+				   });
+		      return true;
+		    };
+	// Unreadable sectors are reported through error; only a failure
+	// to read the image file itself throws.
+	std::string error;
+	try
+	  {
+	    entry.visit_file_body_spans(media, scan, error, read_chunk_sectors);
+	  }
+	catch (DFS::BaseException& e)
+	  {
+	    error = e.what();
+	  }
+	if (!error.empty())
+	  task->errors.push_back(where.str() + ": " + error);
+	format_matches(where.str(), &found, pattern_names, &task->matches);
+      }
+  }
+
+  static void search_unused_sectors(const DFS::MultiPatternMatcher& matcher,
+				    const std::vector<std::string>& pattern_names,
+				    SearchTask* task)
+  {
+    std::ostringstream where;
+    where << task->selector << ":unused";
+    DFS::DataAccess& media(*task->drive);
+    std::vector<DFS::byte> buf(read_chunk_sectors * DFS::SECTOR_BYTES);
+    std::vector<Match> found;
+    for (const DFS::SectorMap::Run& run : task->free_runs)
+      {
+	// Each run is searched separately, so a match cannot span the
+	// space between runs.
+	DFS::MultiPatternMatcher::State state;
+	const unsigned long origin = static_cast<unsigned long>(run.begin) * DFS::SECTOR_BYTES;
+	for (unsigned long sec = run.begin; sec < run.end; /* empty */)
+	  {
+	    const unsigned long want = std::min(run.end - sec, read_chunk_sectors);
+	    unsigned long got;
+	    try
+	      {
+		got = media.read_blocks(sec, want, buf.data());
+	      }
+	    catch (DFS::BaseException& e)
+	      {
+		task->errors.push_back(where.str() + ": " + e.what());
+		break;
+	      }
+	    matcher.scan(&state, buf.data(), buf.data() + got * DFS::SECTOR_BYTES,
+			 [&found, origin](size_t pattern, unsigned long offset)
+			 {
+			   found.push_back(Match(origin + offset, pattern));
+			 });
+	    sec += got;
+	    if (got < want)
+	      {
+		std::ostringstream ss;
+		ss << where.str() << ": sector " << sec << " cannot be read";
+		task->warnings.push_back(ss.str());
+		break;
+	      }
+	  }
+      }
+    format_matches(where.str(), &found, pattern_names, &task->matches);
+  }
+};
+REGISTER_COMMAND(CommandSearch);
+
+} // namespace
@@ -34,9 +34,6 @@
 #include "geometry.h"        // for Geometry
 #include "storage.h"         // for StorageConfiguration
 
-using std::cerr;
-using std::cout;
-
 class CommandSectorMap : public DFS::CommandInterface
 {
 public:
@@ -64,22 +61,22 @@ public:
 	      const std::vector<std::string>& args) override
   {
     std::string error;
-    auto fail = [&error]()
+    auto fail = [&ctx, &error]()
 		 {
-		   std::cerr << error << "\n";
+		   ctx.err() << error << "\n";
 		   return false;
 		 };
     DFS::SurfaceSelector drive_num(0);
     if (args.size() > 2)
       {
-	std::cerr << "at most one command-line argument is needed.\n";
+	ctx.err() << "at most one command-line argument is needed.\n";
 	return false;
       }
     if (args.size() < 2)
       {
 	if (ctx.current_volume.subvolume())
 	  {
-	    std::cerr << "Please specify only a drive number with --drive(to get a sector map of the whole drive).\n";
+	    ctx.err() << "Please specify only a drive number with --drive(to get a sector map of the whole drive).\n";
 	    return false;
 	  }
 	drive_num = ctx.current_volume.surface();
@@ -93,17 +90,17 @@ public:
 	  return fail();
 	drive_num = *got;
 	if (!error.empty())
-	  std::cerr << "warning: " << error << "\n";
+	  ctx.err() << "warning: " << error << "\n";
 	if (end != args[1].size())
 	  {
-	    std::cerr << "trailing junk after drive number " << args[1] << "\n";
+	    ctx.err() << "trailing junk after drive number " << args[1] << "\n";
 	    return false;
 	  }
       }
     std::unique_ptr<DFS::FileSystem> fs = (storage.mount_fs(drive_num, error));
     if (!fs)
       {
-	failed_to_mount_surface(std::cerr, drive_num, error);
+	failed_to_mount_surface(ctx.err(), drive_num, error);
 	return false;
       }
     std::unique_ptr<DFS::SectorMap> sector_map = fs->get_sector_map(drive_num);
@@ -118,30 +115,34 @@ public:
     assert(strlen(sector_col_header) < std::numeric_limits<int>::max());
     const int sector_col_width =
       std::max(6, static_cast<int>(strlen(sector_col_header)));
-    std::cout << std::setw(sector_col_width) << sector_col_header << ":\n"
+    ctx.out() << std::setw(sector_col_width) << sector_col_header << ":\n"
 	      << std::setw(sector_col_width) << "(dec)" << ": "
 	      << "Name of file occupying each sector\n";
     const auto sectors = fs->disc_sector_count();
-    ostream_flag_saver restore_cout_flags(std::cout);
-    for (DFS::sector_count_type sec = 0; sec < sectors; ++sec)
+    ostream_flag_saver restore_cout_flags(ctx.out());
+    DFS::sector_count_type sec = 0;
+    for (const DFS::SectorMap::Run& run : sector_map->runs(sectors))
       {
-	if (0 == column)
+	const std::string name = run.label ? *run.label : "-";
+	for (; sec < run.end; ++sec)
 	  {
-	    if (sec > 0)
-	      std::cout << "\n";
-	    std::cout << std::dec
-		      << std::right << std::setfill('0')
-		      << std::setw(sector_col_width)
-		      << sec << ": ";
-	  }
+	    if (0 == column)
+	      {
+		if (sec > 0)
+		  ctx.out() << "\n";
+		ctx.out() << std::dec
+			  << std::right << std::setfill('0')
+			  << std::setw(sector_col_width)
+			  << sec << ": ";
+	      }
 
-	const std::string name = sector_map->at(sec).value_or("-");
-	std::cout << std::setw(name_col_width) << std::setfill(' ') << std::left << name << ' ';
-	if (++column == max_col)
-	  column = 0;
+	    ctx.out() << std::setw(name_col_width) << std::setfill(' ') << std::left << name << ' ';
+	    if (++column == max_col)
+	      column = 0;
+	  }
       }
-    std::cout << "\n";
-    return std::cout.good();
+    ctx.out() << "\n";
+    return ctx.out().good();
   }
 };
 REGISTER_COMMAND(CommandSectorMap);
@@ -0,0 +1,455 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include <errno.h>              // for errno, EINTR, ECONNABORTED, EMFILE, ...
+#include <fcntl.h>              // for O_CLOEXEC, O_NONBLOCK
+#include <poll.h>               // for poll, pollfd, POLLIN
+#include <signal.h>             // for sigaction, SIGINT, SIGTERM
+#include <stddef.h>             // for size_t
+#include <string.h>             // for strerror, memset
+#include <sys/socket.h>         // for socket, bind, listen, accept4, recv, send
+#include <sys/un.h>             // for sockaddr_un
+#include <unistd.h>             // for close, unlink, pipe2, write
+#include <condition_variable>   // for condition_variable
+#include <future>               // for promise, future
+#include <iostream>             // for operator<<, basic_ostream, ostream
+#include <mutex>                // for mutex, lock_guard, unique_lock
+#include <optional>             // for optional
+#include <set>                  // for set
+#include <sstream>              // for ostringstream
+#include <string>               // for string, to_string
+#include <thread>               // for thread
+#include <tuple>                // for tie
+#include <utility>              // for move
+#include <vector>               // for vector
+
+#include "cleanup.h"            // for cleanup
+#include "commands.h"           // for CommandInterface, run_command, REGISTER...
+#include "dfs.h"                // for set_thread_diagnostic_stream
+#include "dfscontext.h"         // for DFSContext
+#include "stringutil.h"         // for split_words
+#include "workqueue.h"          // for WorkerPool
+
+namespace DFS { class StorageConfiguration; }
+
+namespace
+{
+  // A request line longer than this is rejected, and the connection
+  // closed.
+  constexpr size_t max_request_bytes = 64 * 1024;
+
+  // Each connection has a thread and a descriptor, so we serve at
+  // most this many at once.  Further clients wait in the listen
+  // queue until one of the others disconnects.
+  constexpr size_t max_connections = 256;
+
+  // While we are not accepting connections (because there are
+  // already max_connections, or because accept() ran out of
+  // resources) we check again this often.
+  constexpr int accept_retry_ms = 100;
+
+  // Returns true if accept() failed because we (or the system) ran
+  // out of something, rather than because of a problem with one
+  // client.
+  bool out_of_resources(int err)
+  {
+    return err == EMFILE || err == ENFILE || err == ENOBUFS || err == ENOMEM;
+  }
+
+  // The write end of the pipe by which the signal handler tells the
+  // accept loop to stop.
+  int shutdown_pipe_fd = -1;
+
+  void on_shutdown_signal(int)
+  {
+    const int saved_errno = errno;
+    const char c = 0;
+    if (write(shutdown_pipe_fd, &c, 1) < 0)
+      {
+	// Nothing useful can be done; a byte is already waiting.
+      }
+    errno = saved_errno;
+  }
+
+  struct Response
+  {
+    bool ok;
+    std::string out;
+    std::string err;
+  };
+
+  struct Request
+  {
+    std::vector<std::string> args;
+    std::promise<Response> response;
+  };
+
+  bool send_all(int fd, const std::string& data)
+  {
+    const char *p = data.data();
+    size_t len = data.size();
+    while (len)
+      {
+	const ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+	if (n < 0)
+	  {
+	    if (errno == EINTR)
+	      continue;
+	    return false;
+	  }
+	p += n;
+	len -= static_cast<size_t>(n);
+      }
+    return true;
+  }
+
+  // Answers requests arriving on the connections accepted by
+  // CommandServe.  Each connection has a thread which reads its
+  // requests and writes the responses, but the commands themselves
+  // are run by a fixed pool of workers.
+  class Server
+  {
+  public:
+    Server(const DFS::StorageConfiguration& storage, const DFS::DFSContext& ctx,
+	   unsigned int workers)
+      : storage_(storage), ctx_(ctx),
+	pool_(workers, workers * 4, [this](Request& r) { run(r); })
+    {
+    }
+
+    ~Server()
+    {
+      stop();
+    }
+
+    void start_connection(int fd)
+    {
+      std::lock_guard<std::mutex> lock(connections_mu_);
+      connections_.insert(fd);
+      std::thread([this, fd]() { serve_connection(fd); }).detach();
+    }
+
+    bool full()
+    {
+      std::lock_guard<std::mutex> lock(connections_mu_);
+      return connections_.size() >= max_connections;
+    }
+
+    // The number of connections which have been closed so far.
+    unsigned long connections_closed()
+    {
+      std::lock_guard<std::mutex> lock(connections_mu_);
+      return connections_closed_;
+    }
+
+    // Disconnect all clients, wait for their threads to finish, then
+    // stop the workers.
+    void stop()
+    {
+      std::unique_lock<std::mutex> lock(connections_mu_);
+      for (int fd : connections_)
+	shutdown(fd, SHUT_RDWR);
+      connections_done_.wait(lock, [this]() { return connections_.empty(); });
+      lock.unlock();
+      pool_.finish();
+    }
+
+  private:
+    void serve_connection(int fd)
+    {
+      std::string buffer, line;
+      bool more = true;
+      while (more)
+	{
+	  more = read_request(fd, &buffer, &line);
+	  if (!more && line.empty())
+	    break;
+	  if (line.size() > max_request_bytes)
+	    {
+	      send_all(fd, format(Response{false, "", "request too long\n"}));
+	      break;
+	    }
+	  if (!send_all(fd, format(answer(line))))
+	    break;
+	}
+      // The descriptor is closed while the lock is held.  So by the
+      // time accept() can hand out the same number again, it is no
+      // longer in connections_, and stop() cannot shut down a
+      // descriptor which has been reused.
+      std::lock_guard<std::mutex> lock(connections_mu_);
+      connections_.erase(fd);
+      close(fd);
+      ++connections_closed_;
+      connections_done_.notify_all();
+    }
+
+    // Read the next newline-terminated line from fd into *line,
+    // keeping any data which follows it in *buffer.  Returns false at
+    // end of file (in which case *line holds any unterminated final
+    // line) or if the line is too long.
+    bool read_request(int fd, std::string* buffer, std::string* line)
+    {
+      for (;;)
+	{
+	  const size_t newline = buffer->find('\n');
+	  if (newline != std::string::npos)
+	    {
+	      line->assign(*buffer, 0, newline);
+	      buffer->erase(0, newline + 1);
+	      return true;
+	    }
+	  if (buffer->size() > max_request_bytes)
+	    {
+	      line->swap(*buffer);
+	      return false;
+	    }
+	  char chunk[4096];
+	  const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+	  if (n < 0 && errno == EINTR)
+	    continue;
+	  if (n <= 0)
+	    {
+	      line->swap(*buffer);
+	      buffer->clear();
+	      return false;
+	    }
+	  buffer->append(chunk, static_cast<size_t>(n));
+	}
+    }
+
+    Response answer(const std::string& line)
+    {
+      Request req;
+      std::string error;
+      if (!DFS::stringutil::split_words(line, &req.args, &error))
+	return Response{false, "", error + "\n"};
+      if (req.args.empty())
+	return Response{true, "", ""};
+      if (req.args[0] == "serve")
+	return Response{false, "", "serve cannot be used in a request\n"};
+      std::future<Response> result = req.response.get_future();
+      if (!pool_.submit(std::move(req)))
+	return Response{false, "", "the server is shutting down\n"};
+      return result.get();
+    }
+
+    void run(Request& req)
+    {
+      DFS::DFSContext ctx(ctx_);
+      std::ostringstream out, err;
+      ctx.redirect_output(&out, &err);
+      // Requests run at once, so diagnostics go back to the client
+      // whose request caused them.
+      std::ostream* saved = DFS::set_thread_diagnostic_stream(&err);
+      cleanup restore([saved]() { DFS::set_thread_diagnostic_stream(saved); });
+      const bool ok = DFS::run_command(storage_, ctx, req.args);
+      req.response.set_value(Response{ok, out.str(), err.str()});
+    }
+
+    static std::string format(const Response& r)
+    {
+      return std::to_string(r.ok ? 0 : 1) + " " + std::to_string(r.out.size())
+	+ " " + std::to_string(r.err.size()) + "\n" + r.out + r.err;
+    }
+
+    const DFS::StorageConfiguration& storage_;
+    const DFS::DFSContext& ctx_;
+    std::mutex connections_mu_;
+    std::condition_variable connections_done_;
+    std::set<int> connections_;
+    unsigned long connections_closed_ = 0;
+    DFS::WorkerPool<Request> pool_;
+  };
+
+class CommandServe : public DFS::CommandInterface
+{
+public:
+  const std::string name() const override
+  {
+    return "serve";
+  }
+
+  const std::string usage() const override
+  {
+    return "usage: " + name() + " [--jobs N] --socket PATH\n"
+      "Listen on the Unix-domain socket PATH and run the commands\n"
+      "sent by clients against the disc images given on the command\n"
+      "line, which stay loaded between requests.  Each request is a line\n"
+      "holding a command and its arguments, quoted as for --batch.  The\n"
+      "response is a line \"STATUS OUT-LEN ERR-LEN\" (STATUS is 0 if the\n"
+      "command succeeded) followed by OUT-LEN bytes of output and ERR-LEN\n"
+      "bytes of error messages.  Up to N commands (by default, the number\n"
+      "of processors) are run at once, and up to 256 clients are served\n"
+      "at once.  The server stops on SIGINT or SIGTERM, and then removes\n"
+      "PATH.\n";
+  }
+
+  const std::string description() const override
+  {
+    return "answer commands sent over a Unix-domain socket";
+  }
+
+  bool invoke(const DFS::StorageConfiguration& storage,
+	      const DFS::DFSContext& ctx,
+	      const std::vector<std::string>& args) override
+  {
+    unsigned int jobs = DFS::default_job_count();
+    std::optional<std::string> socket_path;
+    std::vector<std::string> options, non_options;
+    std::tie(options, non_options) = DFS::split_command_options(args, {"--jobs", "--socket"});
+    for (const auto& opt : options)
+      {
+	const std::string socket_prefix("--socket=");
+	if (std::optional<unsigned int> n = DFS::jobs_option(name(), opt, ctx.err()))
+	  {
+	    if (!*n)
+	      return false;
+	    jobs = *n;
+	  }
+	else if (opt.compare(0, socket_prefix.size(), socket_prefix) == 0)
+	  {
+	    socket_path = opt.substr(socket_prefix.size());
+	  }
+	else
+	  {
+	    ctx.err() << name() << ": unknown option " << opt << "\n";
+	    return false;
+	  }
+      }
+    if (non_options.size() > 1)
+      {
+	ctx.err() << name() << ": unexpected argument " << non_options[1] << "\n";
+	return false;
+      }
+    if (!socket_path || socket_path->empty())
+      {
+	ctx.err() << name() << ": please specify the socket with --socket\n";
+	return false;
+      }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path->size() >= sizeof(addr.sun_path))
+      {
+	ctx.err() << name() << ": socket name " << *socket_path << " is too long\n";
+	return false;
+      }
+    socket_path->copy(addr.sun_path, socket_path->size());
+
+    auto fail = [this, &ctx, &socket_path](const char* what) -> bool
+		{
+		  ctx.err() << name() << ": " << *socket_path << ": "
+			    << what << ": " << strerror(errno) << "\n";
+		  return false;
+		};
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+      return fail("socket");
+    cleanup close_listener([listen_fd]() { close(listen_fd); });
+    // We don't remove an existing socket, since another server may
+    // be using it.
+    if (bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+      return fail("bind");
+    cleanup remove_socket([&socket_path]() { unlink(socket_path->c_str()); });
+    if (listen(listen_fd, SOMAXCONN) != 0)
+      return fail("listen");
+
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC | O_NONBLOCK) != 0)
+      return fail("pipe");
+    cleanup close_pipe([&pipe_fds]()
+		       {
+			 close(pipe_fds[0]);
+			 close(pipe_fds[1]);
+		       });
+    shutdown_pipe_fd = pipe_fds[1];
+    struct sigaction action, old_int, old_term;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_shutdown_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &old_int);
+    sigaction(SIGTERM, &action, &old_term);
+    cleanup restore_signals([&old_int, &old_term]()
+			    {
+			      sigaction(SIGINT, &old_int, NULL);
+			      sigaction(SIGTERM, &old_term, NULL);
+			      shutdown_pipe_fd = -1;
+			    });
+
+    bool ok = true;
+    Server server(storage, ctx, jobs);
+    struct pollfd fds[2];
+    fds[0] = pollfd{listen_fd, POLLIN, 0};
+    fds[1] = pollfd{pipe_fds[0], POLLIN, 0};
+    // When the server is full, or accept() has run out of
+    // resources, the listening socket would stay readable.  So we
+    // leave it out of the poll until a connection closes (or, after
+    // a resource failure, until accept_retry_ms has passed) instead
+    // of spinning on it.
+    bool starved = false, starvation_reported = false;
+    unsigned long closed_when_starved = 0;
+    for (;;)
+      {
+	if (starved && server.connections_closed() != closed_when_starved)
+	  starved = false;
+	const bool listening = !starved && !server.full();
+	fds[0].fd = listening ? listen_fd : -1;
+	const int ready = poll(fds, 2, listening ? -1 : accept_retry_ms);
+	if (ready < 0)
+	  {
+	    if (errno == EINTR)
+	      continue;
+	    ok = fail("poll");
+	    break;
+	  }
+	if (fds[1].revents)
+	  break;		// we were asked to stop.
+	if (ready == 0)
+	  {
+	    starved = false;	// try accept() again.
+	    continue;
+	  }
+	if (fds[0].revents & POLLIN)
+	  {
+	    const int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+	    if (fd < 0)
+	      {
+		if (out_of_resources(errno))
+		  {
+		    // Report this once, not every time we retry.
+		    if (!starvation_reported)
+		      ctx.err() << name() << ": accept: " << strerror(errno) << "\n";
+		    starvation_reported = true;
+		    starved = true;
+		    closed_when_starved = server.connections_closed();
+		  }
+		else if (errno != EINTR && errno != ECONNABORTED && errno != EAGAIN)
+		  {
+		    ctx.err() << name() << ": accept: " << strerror(errno) << "\n";
+		  }
+		continue;
+	      }
+	    starvation_reported = false;
+	    server.start_connection(fd);
+	  }
+      }
+    server.stop();
+    return ok;
+  }
+};
+REGISTER_COMMAND(CommandServe);
+
+} // namespace
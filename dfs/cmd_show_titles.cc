@@ -53,7 +53,13 @@ class CommandShowTitles : public DFS::CommandInterface
     return "display disc titles";
   }
 
+  bool supports_multiple_images() const override
+  {
+    return true;
+  }
+
   bool show_title(const DFS::StorageConfiguration& storage,
+		  const DFS::DFSContext& ctx,
 		  const DFS::SurfaceSelector& d, std::string& error)
   {
     std::unique_ptr<DFS::FileSystem> fs(storage.mount_fs(d, error));
@@ -66,19 +72,19 @@ class CommandShowTitles : public DFS::CommandInterface
 	if (!p)
 	  return false;
 	auto vol = sv ? std::make_unique<DFS::VolumeSelector>(d, *sv) : std::make_unique<DFS::VolumeSelector>(d);
-	std::cout << (*vol) << ": " << p->root().title() << "\n";
+	ctx.out() << (*vol) << ": " << p->root().title() << "\n";
       }
-    return std::cout.good();
+    return ctx.out().good();
   }
 
   bool invoke(const DFS::StorageConfiguration& storage,
-	      const DFS::DFSContext&,
+	      const DFS::DFSContext& ctx,
 	      const std::vector<std::string>& args) override
   {
     std::string error;
-    auto fail = [&error]()
+    auto fail = [&ctx, &error]()
 		 {
-		   std::cerr << error << "\n";
+		   ctx.err() << error << "\n";
 		   return false;
 		 };
     std::vector<DFS::SurfaceSelector> todo;
@@ -98,7 +104,7 @@ class CommandShowTitles : public DFS::CommandInterface
 	    if (!surf)
 	      return fail();
 	    if (!error.empty())
-	      std::cerr << "warning: " << error << "\n";
+	      ctx.err() << "warning: " << error << "\n";
 	    todo.push_back(*surf);
 	  }
       }
@@ -110,7 +116,7 @@ class CommandShowTitles : public DFS::CommandInterface
     bool ok = true;
     for (DFS::SurfaceSelector surface : todo)
       {
-	if (!show_title(storage, surface, error))
+	if (!show_title(storage, ctx, surface, error))
 	  {
 	    ok = false;
 	  }
@@ -0,0 +1,296 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include <stdlib.h>         // for strtod
+#include <string.h>         // for memcmp
+#include <algorithm>        // for min
+#include <fstream>          // for ifstream
+#include <iomanip>          // for operator<<, setprecision, fixed
+#include <iostream>         // for operator<<, basic_ostream, ostream
+#include <memory>           // for unique_ptr
+#include <optional>         // for optional
+#include <sstream>          // for ostringstream
+#include <string>           // for string, operator+
+#include <tuple>            // for tie
+#include <vector>           // for vector
+
+#include "abstractio.h"     // for DataAccess, SECTOR_BYTES
+#include "cleanup.h"        // for ostream_flag_saver
+#include "commands.h"       // for CommandInterface, REGISTER_COMMAND, split_...
+#include "dfs_catalog.h"    // for CatalogEntry, Catalog
+#include "dfs_filesystem.h" // for FileSystem
+#include "dfs_volume.h"     // for Volume
+#include "dfscontext.h"     // for DFSContext
+#include "dfstypes.h"       // for byte
+#include "driveselector.h"  // for VolumeSelector, SurfaceSelector, operator<<
+#include "exceptions.h"     // for BaseException
+#include "minhash.h"        // for MinHashSketch, block_hash, find_similar_groups
+#include "storage.h"        // for StorageConfiguration
+
+namespace
+{
+  // The number of sectors read at once.
+  constexpr unsigned long read_chunk_sectors = 64;
+
+  struct NamedSketch
+  {
+    std::string name;
+    DFS::MinHashSketch sketch;
+  };
+
+  // Blocks in which every byte is the same (most often, blank
+  // sectors) say nothing about which disc they came from.
+  bool uniform(const DFS::byte* begin, const DFS::byte* end)
+  {
+    return end - begin < 2 || memcmp(begin, begin + 1, end - begin - 1) == 0;
+  }
+
+  void add_block(DFS::MinHashSketch* sketch, const DFS::byte* begin, const DFS::byte* end)
+  {
+    if (!uniform(begin, end))
+      sketch->add(DFS::block_hash(begin, end));
+  }
+
+  // The features of a volume are the hashes of its sectors, plus the
+  // hash of the last part of each file whose length is not a whole
+  // number of sectors.  Files always begin on a sector boundary, so
+  // the hashes of a file's body do not depend on where on the disc
+  // it is stored, or on what follows the end of the file.
+  DFS::MinHashSketch sketch_volume(DFS::Volume* vol)
+  {
+    const DFS::Catalog& catalog(vol->root());
+    const unsigned long total = catalog.total_sectors();
+    std::vector<DFS::byte> image(total * DFS::SECTOR_BYTES);
+    std::vector<bool> readable(total, false);
+    DFS::MinHashSketch result;
+    for (unsigned long sec = 0; sec < total; /* empty */)
+      {
+	const unsigned long want = std::min(total - sec, read_chunk_sectors);
+	DFS::byte* buf = image.data() + sec * DFS::SECTOR_BYTES;
+	const unsigned long got = vol->data_region().read_blocks(sec, want, buf);
+	for (unsigned long i = 0; i < got; ++i)
+	  {
+	    readable[sec + i] = true;
+	    add_block(&result, buf + i * DFS::SECTOR_BYTES, buf + (i + 1) * DFS::SECTOR_BYTES);
+	  }
+	// Skip any sector which cannot be read.
+	sec += (got < want) ? got + 1 : got;
+      }
+    for (const DFS::CatalogEntry& entry : catalog.entries())
+      {
+	const unsigned long tail = entry.file_length() % DFS::SECTOR_BYTES;
+	const unsigned long last = entry.start_sector() + entry.file_length() / DFS::SECTOR_BYTES;
+	if (tail && last < total && readable[last])
+	  {
+	    const DFS::byte* p = image.data() + last * DFS::SECTOR_BYTES;
+	    add_block(&result, p, p + tail);
+	  }
+      }
+    return result;
+  }
+
+class CommandSimilar : public DFS::CommandInterface
+{
+public:
+  const std::string name() const override
+  {
+    return "similar";
+  }
+
+  const std::string usage() const override
+  {
+    return "usage: " + name() + " [--threshold T] [--sketch] [--sketches FILE]...\n"
+      "Finds groups of volumes which are nearly the same: for example, the\n"
+      "same disc with a file changed, a different title or its files\n"
+      "stored in different places.  Each volume is summarised by a MinHash\n"
+      "sketch of the hashes of its sectors and of the ends of its files,\n"
+      "from which the similarity of two volumes (between 0 and 1) can be\n"
+      "estimated.\n"
+      "\n"
+      "With --sketch, the sketch of every volume of every occupied drive\n"
+      "is printed on one line of the form\n"
+      "  minhash FEATURES SKETCH :VOLUME\n"
+      "and nothing else is done.  Otherwise, the sketches of the volumes\n"
+      "are compared with each other and with the sketches read from each\n"
+      "--sketches FILE (which is the output of an earlier use of --sketch,\n"
+      "perhaps with --images).  Each group of volumes whose similarity\n"
+      "is at least T (by default, 0.5) is printed, with the estimated\n"
+      "similarity of each member to the first.  The names of volumes read\n"
+      "from a FILE written with --images begin with the name of the image.\n"
+      "To compare a large collection, use\n"
+      "  dfs --images DIR similar --sketch > INDEX\n"
+      "  dfs similar --sketches INDEX\n";
+  }
+
+  const std::string description() const override
+  {
+    return "find volumes which are nearly the same";
+  }
+
+  bool supports_multiple_images() const override
+  {
+    return true;
+  }
+
+  bool invoke(const DFS::StorageConfiguration& storage,
+	      const DFS::DFSContext& ctx,
+	      const std::vector<std::string>& args) override
+  {
+    double threshold = 0.5;
+    bool sketch_only = false;
+    std::vector<std::string> sketch_files;
+    std::vector<std::string> options, non_options;
+    std::tie(options, non_options) = DFS::split_command_options(args, {"--threshold", "--sketches"});
+    for (const auto& opt : options)
+      {
+	const std::string threshold_prefix("--threshold=");
+	const std::string sketches_prefix("--sketches=");
+	if (opt.compare(0, threshold_prefix.size(), threshold_prefix) == 0)
+	  {
+	    const std::string value(opt.substr(threshold_prefix.size()));
+	    char *end;
+	    threshold = strtod(value.c_str(), &end);
+	    if (value.empty() || *end || !(threshold > 0.0 && threshold <= 1.0))
+	      {
+		ctx.err() << name() << ": --threshold needs a number greater than 0 and at most 1\n";
+		return false;
+	      }
+	  }
+	else if (opt.compare(0, sketches_prefix.size(), sketches_prefix) == 0)
+	  {
+	    sketch_files.push_back(opt.substr(sketches_prefix.size()));
+	  }
+	else if (opt == "--sketch")
+	  {
+	    sketch_only = true;
+	  }
+	else
+	  {
+	    ctx.err() << name() << ": unknown option " << opt << "\n";
+	    return false;
+	  }
+      }
+    if (non_options.size() > 1)
+      {
+	ctx.err() << name() << ": no arguments are needed.\n";
+	return false;
+      }
+
+    bool ok = true;
+    std::vector<NamedSketch> sketches;
+    std::vector<std::unique_ptr<DFS::FileSystem>> file_systems;
+    auto add_sketch = [&](const DFS::VolumeSelector& selector, DFS::Volume* vol)
+      {
+	std::ostringstream where;
+	where << ':' << selector;
+	try
+	  {
+	    sketches.push_back(NamedSketch{where.str(), sketch_volume(vol)});
+	  }
+	catch (DFS::BaseException& e)
+	  {
+	    ctx.err() << "volume " << selector << ": " << e.what() << "\n";
+	    ok = false;
+	  }
+      };
+    if (!DFS::visit_all_volumes(storage, ctx, &file_systems, add_sketch))
+      ok = false;
+
+    if (sketch_only)
+      {
+	for (const NamedSketch& s : sketches)
+	  ctx.out() << "minhash " << s.sketch.encode() << ' ' << s.name << "\n";
+	return ok && ctx.out().good();
+      }
+
+    for (const std::string& file : sketch_files)
+      {
+	if (!read_sketches(file, ctx, &sketches))
+	  return false;
+      }
+    std::vector<DFS::MinHashSketch> values;
+    values.reserve(sketches.size());
+    for (const NamedSketch& s : sketches)
+      values.push_back(s.sketch);
+
+    const std::vector<std::vector<size_t>> groups = DFS::find_similar_groups(values, threshold);
+
+    ostream_flag_saver restore_cout_flags(ctx.out());
+    ctx.out() << std::fixed << std::setprecision(3);
+    unsigned long found = 0;
+    for (const std::vector<size_t>& members : groups)
+      {
+	if (found++)
+	  ctx.out() << "\n";
+	ctx.out() << "group " << found << ": " << members.size() << " volumes\n";
+	for (size_t i : members)
+	  {
+	    ctx.out() << "  " << sketches[members.front()].sketch.similarity(sketches[i].sketch)
+		      << ' ' << sketches[i].name << "\n";
+	  }
+      }
+    return ok && ctx.out().good();
+  }
+
+private:
+  // Read the output of --sketch.  The headers which --images writes
+  // before the output for each image give the names of the images.
+  bool read_sketches(const std::string& file, const DFS::DFSContext& ctx,
+		     std::vector<NamedSketch>* sketches)
+  {
+    std::ifstream f(file);
+    if (!f)
+      {
+	ctx.err() << name() << ": cannot open " << file << "\n";
+	return false;
+      }
+    const std::string header_start("==> "), header_end(" <==");
+    const std::string prefix("minhash ");
+    std::string image, line;
+    for (unsigned long lineno = 1; std::getline(f, line); ++lineno)
+      {
+	if (line.empty())
+	  continue;
+	if (line.size() > header_start.size() + header_end.size()
+	    && line.compare(0, header_start.size(), header_start) == 0
+	    && line.compare(line.size() - header_end.size(), header_end.size(), header_end) == 0)
+	  {
+	    image = line.substr(header_start.size(),
+				line.size() - header_start.size() - header_end.size());
+	    continue;
+	  }
+	// The sketch itself contains exactly one space.
+	const size_t name_pos = line.find(' ', line.find(' ', prefix.size()) + 1);
+	std::optional<DFS::MinHashSketch> sketch;
+	if (line.compare(0, prefix.size(), prefix) == 0 && name_pos != std::string::npos)
+	  sketch = DFS::MinHashSketch::decode(line.substr(prefix.size(), name_pos - prefix.size()));
+	if (!sketch)
+	  {
+	    ctx.err() << file << ":" << lineno << ": this is not a sketch\n";
+	    return false;
+	  }
+	sketches->push_back(NamedSketch{image + line.substr(name_pos + 1), *sketch});
+      }
+    if (f.bad())
+      {
+	ctx.err() << name() << ": failed to read " << file << "\n";
+	return false;
+      }
+    return true;
+  }
+};
+REGISTER_COMMAND(CommandSimilar);
+
+} // namespace
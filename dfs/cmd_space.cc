@@ -36,9 +36,6 @@
 #include "exceptions.h"	       // for BadFileSystem
 #include "storage.h"           // for StorageConfiguration, VolumeMountResult
 
-using std::cerr;
-using std::cout;
-
 namespace
 {
   std::optional<std::vector<DFS::VolumeSelector>>
@@ -71,7 +68,7 @@ namespace
 	  return std::nullopt;
 	result.push_back(vol);
 	if (!error.empty())
-	  std::cerr << "warning: " << error << "\n";
+	  ctx.err() << "warning: " << error << "\n";
       }
     return result;
   }
@@ -97,19 +94,24 @@ public:
     return "show spaces between files";
   }
 
+  bool supports_multiple_images() const override
+  {
+    return true;
+  }
+
   bool invoke(const DFS::StorageConfiguration& storage,
 	      const DFS::DFSContext& ctx,
 	      const std::vector<std::string>& args) override
   {
-    ostream_flag_saver restore_cerr_flags(std::cerr);
-    ostream_flag_saver restore_cout_flags(std::cout);
+    ostream_flag_saver restore_cerr_flags(ctx.err());
+    ostream_flag_saver restore_cout_flags(ctx.out());
     std::string error;
     std::map<DFS::VolumeSelector, DFS::sector_count_type> free_space;
     std::optional<std::vector<DFS::VolumeSelector>> selected =
       select_volumes(ctx, args, error);
     if (!selected)
       {
-	std::cerr << error << "\n";
+	ctx.err() << error << "\n";
 	return false;
       }
     for (const DFS::VolumeSelector& selector : *selected)
@@ -117,10 +119,10 @@ public:
 	auto mounted = storage.mount(selector, error);
 	if (!mounted)
 	  {
-	    failed_to_mount_volume(std::cerr, selector, error);
+	    failed_to_mount_volume(ctx.err(), selector, error);
 	    return false;
 	  }
-	auto root(mounted->volume()->root());
+	const auto& root(mounted->volume()->root());
 
 	// Files occur on the disk in a kind of reverse order.  The last
 	// file on the disk is the first one mentioned in the catalog in
@@ -242,39 +244,39 @@ public:
 	    add_initial_gap(first_file_entry_pos);
 	  }
 
-	std::cout << "Gap sizes on disc " << selector << ":\n";
+	ctx.out() << "Gap sizes on disc " << selector << ":\n";
 	bool first = true;
-	ostream_flag_saver restore_cout_flags(std::cout);
-	std::cout << std::hex << std::uppercase << std::setfill('0');
+	ostream_flag_saver restore_cout_flags(ctx.out());
+	ctx.out() << std::hex << std::uppercase << std::setfill('0');
 	for (const auto& gap : gaps)
 	  {
 	    if (!first)
-	      std::cout << ' ';
+	      ctx.out() << ' ';
 	    first = false;
-	    std::cout << std::setw(3) << gap;
+	    ctx.out() << std::setw(3) << gap;
 	  }
 	auto free_sectors = std::accumulate(gaps.cbegin(), gaps.cend(), 0);
-	std::cout << "\n\nTotal space free = " << free_sectors << " sectors\n";
+	ctx.out() << "\n\nTotal space free = " << free_sectors << " sectors\n";
 	free_space[selector] = free_sectors;
       }
     if (selected->size() > 1)
       {
-	std::cout << std::hex << std::uppercase;
+	ctx.out() << std::hex << std::uppercase;
 	DFS::sector_count_type tot_free = 0;
-	std::cout << std::setfill(' ');
+	ctx.out() << std::setfill(' ');
 	for (const auto& f : free_space)
 	  {
-	    std::cout << "Total space free in volume "
+	    ctx.out() << "Total space free in volume "
 		      << std::setfill(' ') << std::setw(4) << f.first
 		      << " = " << std::setw(4) << std::setfill('0')
 		      << f.second << " sectors\n";
 	    tot_free += f.second;
 	  }
-	std::cout << "Total space free in all volumes = "
+	ctx.out() << "Total space free in all volumes = "
 		  << std::setfill('0') << std::setw(4) << tot_free
 		  << " sectors\n";
       }
-    return std::cout.good();
+    return ctx.out().good();
   }
 };
 REGISTER_COMMAND(CommandSpace);
@@ -16,55 +16,48 @@
 #include <iostream>    // for operator<<, basic_ostream, ostream, basic_ostr...
 #include <string>      // for string, operator==, allocator, operator<<, cha...
 #include <tuple>       // for tie, tuple
-#include <utility>     // for make_pair, pair
 #include <vector>      // for vector
 
-#include "commands.h"  // for body_command, file_body_logic, CommandInterface
+#include "commands.h"  // for body_command, FileBodyConsumer, split_command...
+#include "dfscontext.h" // for DFSContext
 #include "dfstypes.h"  // for byte
+#include "textconv.h"  // for cr_to_lf
 
 namespace DFS { class StorageConfiguration; }
-namespace DFS { struct DFSContext; }
 
 namespace
 {
   using std::vector;
   using std::string;
 
-  std::pair<std::vector<string>, vector<string>> parse_args(const vector<string> in)
+  class TypeOutput : public DFS::FileBodyConsumer
   {
-    std::vector<string> options, non_options;
-    bool could_be_option = true;
-    bool first = true;
-    for (const std::string& arg : in)
-      {
-	if (first)
-	  {
-	    non_options.push_back(arg); // argv[0] is never an option
-	    first = false;
-	  }
-	else if (!could_be_option || arg.empty())
-	  {
-	    could_be_option = false;
-	    non_options.push_back(arg);
-	  }
-	else if (arg == "--")
-	  {
-	    could_be_option = false;
-	  }
-	else if (arg[0] == '-')
-	  {
-	    // Does not cope well with --foo=bar.  But we don't have
-	    // an option like that.
-	    options.push_back(arg);
-	  }
-	else
-	  {
-	    could_be_option = false;
-	    non_options.push_back(arg);
-	  }
-      }
-    return std::make_pair(options, non_options);
-  }
+  public:
+    TypeOutput(std::ostream& out, bool binary)
+      : out_(out), binary_(binary)
+    {
+    }
+
+    bool chunk(const DFS::byte* begin, const DFS::byte* end) override
+    {
+      if (binary_)
+	return write(begin, end);
+      // Translate the whole chunk, and write it at once.
+      buf_.resize(end - begin);
+      DFS::cr_to_lf(begin, end, buf_.data());
+      return out_.write(buf_.data(), buf_.size()).good();
+    }
+
+  private:
+    bool write(const DFS::byte* begin, const DFS::byte* end)
+    {
+      return out_.write(reinterpret_cast<const char*>(begin), end - begin).good();
+    }
+
+    std::ostream& out_;
+    bool binary_;
+    std::vector<char> buf_;
+  };
 }
 
 namespace DFS
@@ -93,7 +86,7 @@ namespace DFS
     {
       bool binary = false;
       std::vector<string> options, non_options;
-      std::tie(options, non_options) = parse_args(args);
+      std::tie(options, non_options) = split_command_options(args);
       for (const auto& opt : options)
 	{
 	  if (opt == "--binary")
@@ -102,33 +95,12 @@ namespace DFS
 	    }
 	  else
 	    {
-	      std::cerr << "unknown option " << opt << "\n";
+	      ctx.err() << "unknown option " << opt << "\n";
 	      return false;
 	    }
 	}
 
-      file_body_logic display_contents =
-	[binary](const byte* body_start,
-		 const byte *body_end,
-		 const std::vector<std::string>&)
-	{
-	  if (binary)
-	    {
-	      return std::cout.write(reinterpret_cast<const char*>(body_start),
-				     body_end - body_start).good();
-	    }
-	  else
-	    {
-	      std::vector<byte> data(body_start, body_end);
-	      for (byte& ch : data)
-		{
-		  if (ch == '\r')
-		    ch = '\n';
-		}
-	      return std::cout.write(reinterpret_cast<const char*>(data.data()), data.size())
-		.good();
-	    }
-	};
+      TypeOutput display_contents(ctx.out(), binary);
       return body_command(storage, ctx, non_options, display_contents);
     }
   };
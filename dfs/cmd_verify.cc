@@ -0,0 +1,300 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include <stddef.h>         // for size_t
+#include <algorithm>        // for min, max
+#include <chrono>           // for steady_clock, duration
+#include <iomanip>          // for operator<<, setprecision, fixed
+#include <iostream>         // for operator<<, basic_ostream, ostream
+#include <memory>           // for unique_ptr
+#include <optional>         // for optional
+#include <sstream>          // for ostringstream
+#include <string>           // for string, operator+
+#include <tuple>            // for tie
+#include <vector>           // for vector
+
+#include "abstractio.h"     // for DataAccess, SECTOR_BYTES
+#include "cleanup.h"        // for ostream_flag_saver
+#include "commands.h"       // for CommandInterface, REGISTER_COMMAND, split_...
+#include "dfs_catalog.h"    // for CatalogEntry, Catalog
+#include "dfs_filesystem.h" // for FileSystem
+#include "dfs_unused.h"     // for SectorMap
+#include "dfs_volume.h"     // for Volume
+#include "dfscontext.h"     // for DFSContext
+#include "dfstypes.h"       // for byte
+#include "driveselector.h"  // for VolumeSelector, SurfaceSelector, operator<<
+#include "exceptions.h"     // for BaseException
+#include "storage.h"        // for StorageConfiguration, AbstractDrive, TrackC...
+#include "workqueue.h"      // for run_largest_first
+
+namespace
+{
+  // The checks of one volume which can be made in parallel with the
+  // others.
+  struct VolumeCheck
+  {
+    DFS::VolumeSelector selector;
+    DFS::Volume* volume;
+    unsigned long sectors;	// total size of the files
+    // Results, filled in by the worker.
+    unsigned long files;
+    unsigned long sectors_read;
+    std::vector<std::string> problems;
+  };
+
+  // The number of sectors read at once when checking that a file can
+  // be read.
+  constexpr unsigned long read_chunk_sectors = 64;
+
+  std::string file_location(const DFS::VolumeSelector& vol, const DFS::CatalogEntry& entry)
+  {
+    std::ostringstream ss;
+    ss << ':' << vol << '.' << entry.directory() << '.' << entry.name();
+    return ss.str();
+  }
+
+  unsigned long sectors_of(const DFS::CatalogEntry& entry)
+  {
+    return (entry.file_length() + DFS::SECTOR_BYTES - 1) / DFS::SECTOR_BYTES;
+  }
+
+class CommandVerify : public DFS::CommandInterface
+{
+public:
+  const std::string name() const override
+  {
+    return "verify";
+  }
+
+  const std::string usage() const override
+  {
+    return "usage: " + name() + " [--jobs N]\n"
+      "Checks that every volume of every occupied drive is internally\n"
+      "consistent: that the catalog is valid, that each file lies within\n"
+      "the volume, that no two files share a sector, and that every\n"
+      "sector of every file can be read.  For HFE and MFM images, tracks\n"
+      "on which records had a bad CRC are also reported.\n"
+      "\n"
+      "Each problem is printed on one line of the form\n"
+      "  KIND LOCATION: DETAILS\n"
+      "where KIND is one of mount, catalog, extent, overlap, unreadable\n"
+      "or crc, and LOCATION is a drive, a volume or a file name such as\n"
+      ":0.$.FOO.  A summary follows.  The volumes are checked by N threads\n"
+      "at once; the default is the number of processors.\n";
+  }
+
+  const std::string description() const override
+  {
+    return "check the integrity of all drives and volumes";
+  }
+
+  bool supports_multiple_images() const override
+  {
+    return true;
+  }
+
+  bool invoke(const DFS::StorageConfiguration& storage,
+	      const DFS::DFSContext& ctx,
+	      const std::vector<std::string>& args) override
+  {
+    unsigned int jobs = DFS::default_job_count();
+    std::vector<std::string> options, non_options;
+    std::tie(options, non_options) = DFS::split_command_options(args, {"--jobs"});
+    for (const auto& opt : options)
+      {
+	if (std::optional<unsigned int> n = DFS::jobs_option(name(), opt, ctx.err()))
+	  {
+	    if (!*n)
+	      return false;
+	    jobs = *n;
+	  }
+	else
+	  {
+	    ctx.err() << name() << ": unknown option " << opt << "\n";
+	    return false;
+	  }
+      }
+    if (non_options.size() > 1)
+      {
+	ctx.err() << name() << ": no arguments are needed.\n";
+	return false;
+      }
+
+    // Mount everything first, checking the things which concern a
+    // whole drive as we go.
+    const auto start_time = std::chrono::steady_clock::now();
+    std::vector<std::string> problems;
+    std::vector<std::unique_ptr<DFS::FileSystem>> file_systems;
+    std::vector<VolumeCheck> volumes;
+    unsigned long drives = 0;
+    for (const DFS::SurfaceSelector& surface : storage.get_all_occupied_drive_numbers())
+      {
+	std::string error;
+	if (!storage.drive_format(surface, error))
+	  {
+	    if (!error.empty())
+	      problems.push_back(problem("mount", surface, error));
+	    continue;		// unformatted, so there is nothing to check.
+	  }
+	std::unique_ptr<DFS::FileSystem> fs = storage.mount_fs(surface, error);
+	if (!fs)
+	  {
+	    problems.push_back(problem("mount", surface, error));
+	    continue;
+	  }
+	++drives;
+	check_crc(storage, surface, &problems);
+	const std::unique_ptr<DFS::SectorMap> sector_map = fs->get_sector_map(surface);
+	for (const DFS::SectorMap::Overlap& o : sector_map->overlaps())
+	  {
+	    std::ostringstream ss;
+	    ss << "sectors " << o.begin << "-" << (o.end - 1) << " of " << o.owner
+	       << " are also used by " << o.claimant;
+	    problems.push_back(problem("overlap", surface, ss.str()));
+	  }
+	for (std::optional<char> sv : fs->subvolumes())
+	  {
+	    const DFS::VolumeSelector selector = sv ? DFS::VolumeSelector(surface, *sv)
+	      : DFS::VolumeSelector(surface);
+	    DFS::Volume *vol = fs->mount(sv, error);
+	    if (!vol)
+	      {
+		problems.push_back(problem("mount", selector, error));
+		continue;
+	      }
+	    unsigned long sectors = 0;
+	    for (const DFS::CatalogEntry& entry : vol->root().entries())
+	      sectors += sectors_of(entry);
+	    volumes.push_back(VolumeCheck{selector, vol, sectors, 0, 0, {}});
+	  }
+	file_systems.push_back(std::move(fs));
+      }
+
+    std::vector<unsigned long> costs;
+    for (const VolumeCheck& v : volumes)
+      costs.push_back(v.sectors + 1);
+    DFS::run_largest_first(costs, jobs,
+			   [&volumes](size_t i)
+			   {
+			     check_volume(&volumes[i]);
+			   });
+
+    unsigned long files = 0, sectors_read = 0;
+    for (const VolumeCheck& v : volumes)
+      {
+	problems.insert(problems.end(), v.problems.begin(), v.problems.end());
+	files += v.files;
+	sectors_read += v.sectors_read;
+      }
+    for (const std::string& p : problems)
+      ctx.out() << p << "\n";
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    const unsigned long bytes_read = sectors_read * DFS::SECTOR_BYTES;
+    ostream_flag_saver restore_cout_flags(ctx.out());
+    ctx.out() << std::dec << "verified " << drives << " drives, " << volumes.size()
+	      << " volumes and " << files << " files; " << sectors_read
+	      << " sectors (" << bytes_read << " bytes) read in "
+	      << std::fixed << std::setprecision(3) << elapsed.count() << " seconds";
+    if (elapsed.count() > 0)
+      ctx.out() << " (" << std::setprecision(1)
+		<< (bytes_read / 1024.0 / elapsed.count()) << " KiB/s)";
+    ctx.out() << "; " << problems.size() << " problems\n";
+    return problems.empty() && ctx.out().good();
+  }
+
+private:
+  template <class Where>
+  static std::string problem(const std::string& kind, const Where& where,
+			     const std::string& details)
+  {
+    std::ostringstream ss;
+    ss << kind << ' ' << where << ": " << details;
+    std::string result(ss.str());
+    // Some errors come with a trailing newline.
+    while (!result.empty() && result.back() == '\n')
+      result.pop_back();
+    return result;
+  }
+
+  static void check_crc(const DFS::StorageConfiguration& storage,
+			const DFS::SurfaceSelector& surface,
+			std::vector<std::string>* problems)
+  {
+    DFS::AbstractDrive* drive;
+    std::string error;
+    if (!storage.select_drive(surface, &drive, error))
+      return;
+    for (const DFS::TrackCrcErrors& t : drive->crc_errors())
+      {
+	std::ostringstream ss;
+	ss << "track " << t.track << " has " << t.records
+	   << " records with a bad CRC";
+	problems->push_back(problem("crc", surface, ss.str()));
+      }
+  }
+
+  static void check_volume(VolumeCheck* check)
+  {
+    const DFS::Catalog& catalog(check->volume->root());
+    std::string error;
+    if (!catalog.valid(error))
+      check->problems.push_back(problem("catalog", check->selector, error));
+
+    const unsigned long total_sectors = catalog.total_sectors();
+    std::vector<DFS::byte> buf(read_chunk_sectors * DFS::SECTOR_BYTES);
+    for (const DFS::CatalogEntry& entry : catalog.entries())
+      {
+	++check->files;
+	const std::string where(file_location(check->selector, entry));
+	const unsigned long begin = entry.start_sector();
+	unsigned long end = begin + sectors_of(entry);
+	if (end > total_sectors)
+	  {
+	    std::ostringstream ss;
+	    ss << "the file occupies sectors " << begin << "-" << (end - 1)
+	       << " but the volume has only " << total_sectors << " sectors";
+	    check->problems.push_back(problem("extent", where, ss.str()));
+	    end = std::max(begin, total_sectors);
+	  }
+	for (unsigned long sec = begin; sec < end; /* empty */)
+	  {
+	    const unsigned long want = std::min(end - sec, read_chunk_sectors);
+	    unsigned long got;
+	    try
+	      {
+		got = check->volume->data_region().read_blocks(sec, want, buf.data());
+	      }
+	    catch (DFS::BaseException& e)
+	      {
+		check->problems.push_back(problem("unreadable", where, e.what()));
+		break;
+	      }
+	    check->sectors_read += got;
+	    sec += got;
+	    if (got < want)
+	      {
+		std::ostringstream ss;
+		ss << "sector " << sec << " cannot be read";
+		check->problems.push_back(problem("unreadable", where, ss.str()));
+		++sec;
+	      }
+	  }
+      }
+  }
+};
+REGISTER_COMMAND(CommandVerify);
+
+} // namespace
@@ -15,39 +15,33 @@
 //
 #include "commands.h"
 
-#include <algorithm>        // for copy
+#include <stddef.h>         // for size_t
+#include <algorithm>        // for find, min, max
+#include <exception>        // for exception
 #include <iostream>         // for operator<<, basic_ostream, ostream, cerr
-#include <iterator>         // for back_insert_iterator, back_inserter
+#include <iterator>         // for next
+#include <memory>           // for unique_ptr
 #include <optional>         // for optional
 #include <string>           // for string, operator<<, char_traits
+#include <thread>           // for thread
+#include <utility>          // for make_pair, pair
 #include <vector>           // for vector, vector<>::const_iterator
 
 #include "dfs_catalog.h"    // for Catalog, CatalogEntry
+#include "dfs_filesystem.h" // for FileSystem
 #include "dfs_volume.h"     // for Volume
+#include "dfscontext.h"     // for DFSContext
 #include "dfstypes.h"       // for byte
 #include "driveselector.h"  // for operator<<
 #include "fsp.h"            // for ParsedFileName, parse_filename
 #include "storage.h"        // for VolumeMountResult, StorageConfiguration
 
 namespace DFS { class DataAccess; }
-namespace DFS { struct DFSContext; }
 
 namespace
 {
-  void read_file_body(const DFS::CatalogEntry& entry,
-		      DFS::DataAccess& media,
-		      std::vector<DFS::byte>* body)
-  {
-    entry.visit_file_body_piecewise(media,
-				    [body]
-				    (const DFS::byte* begin, const DFS::byte* end)
-				    {
-				      std::copy(begin, end,
-						std::back_inserter(*body));
-				      return true;
-				    });
-  }
-
+  // body_command() reads files this many sectors at a time.
+  constexpr unsigned long body_chunk_sectors = 16;
 }  // namespace
 
 
@@ -57,6 +51,25 @@ namespace DFS
   {
   }
 
+  bool CommandInterface::supports_multiple_images() const
+  {
+    return false;
+  }
+
+  FileBodyConsumer::~FileBodyConsumer()
+  {
+  }
+
+  bool FileBodyConsumer::begin(const std::vector<std::string>&)
+  {
+    return true;
+  }
+
+  bool FileBodyConsumer::end()
+  {
+    return true;
+  }
+
   CommandInterface* CIReg::get_command(const std::string& name)
   {
     auto m = get_command_map();
@@ -89,45 +102,200 @@ namespace DFS
     return true;
   }
 
+std::optional<unsigned int> parse_job_count(const std::string& value)
+{
+  size_t end;
+  unsigned long n;
+  try
+    {
+      n = std::stoul(value, &end, 10);
+    }
+  catch (std::exception&)
+    {
+      return std::nullopt;
+    }
+  if (end != value.size() || n < 1 || n > 256 || value[0] == '-')
+    return std::nullopt;
+  return static_cast<unsigned int>(n);
+}
+
+unsigned int default_job_count()
+{
+  return std::min(256u, std::max(1u, std::thread::hardware_concurrency()));
+}
+
+std::optional<unsigned int> jobs_option(const std::string& command_name,
+					const std::string& opt, std::ostream& err)
+{
+  const std::string prefix("--jobs=");
+  if (opt.compare(0, prefix.size(), prefix) != 0)
+    return std::nullopt;
+  std::optional<unsigned int> n = parse_job_count(opt.substr(prefix.size()));
+  if (!n)
+    {
+      err << command_name << ": --jobs needs a number between 1 and 256\n";
+      return 0;
+    }
+  return n;
+}
+
+bool visit_all_volumes(const StorageConfiguration& storage, const DFSContext& ctx,
+		       std::vector<std::unique_ptr<FileSystem>>* file_systems,
+		       const std::function<void(const VolumeSelector&, Volume*)>& visit_volume,
+		       const std::function<void(const SurfaceSelector&, FileSystem*)>& visit_drive)
+{
+  bool ok = true;
+  for (const SurfaceSelector& surface : storage.get_all_occupied_drive_numbers())
+    {
+      std::string error;
+      if (!storage.drive_format(surface, error))
+	{
+	  if (!error.empty())
+	    {
+	      failed_to_mount_surface(ctx.err(), surface, error);
+	      ok = false;
+	    }
+	  continue;		// unformatted
+	}
+      std::unique_ptr<FileSystem> fs = storage.mount_fs(surface, error);
+      if (!fs)
+	{
+	  failed_to_mount_surface(ctx.err(), surface, error);
+	  ok = false;
+	  continue;
+	}
+      for (std::optional<char> sv : fs->subvolumes())
+	{
+	  const VolumeSelector selector = sv ? VolumeSelector(surface, *sv)
+	    : VolumeSelector(surface);
+	  Volume *vol = fs->mount(sv, error);
+	  if (!vol)
+	    {
+	      failed_to_mount_volume(ctx.err(), selector, error);
+	      ok = false;
+	      continue;
+	    }
+	  visit_volume(selector, vol);
+	}
+      if (visit_drive)
+	visit_drive(surface, fs.get());
+      file_systems->push_back(std::move(fs));
+    }
+  return ok;
+}
+
+bool run_command(const StorageConfiguration& storage,
+		 const DFSContext& ctx,
+		 const std::vector<std::string>& args)
+{
+  const std::string& cmd_name(args[0]);
+  auto instance = CIReg::get_command(cmd_name);
+  if (0 == instance)
+    {
+      ctx.err() << "unknown command " << cmd_name << "\n";
+      return false;
+    }
+  try
+    {
+      return instance->invoke(storage, ctx, args);
+    }
+  catch (std::exception& e)
+    {
+      ctx.err() << "error: " << e.what() << "\n";
+      return false;
+    }
+}
+
+std::pair<std::vector<std::string>, std::vector<std::string>>
+split_command_options(const std::vector<std::string>& args,
+		      const std::vector<std::string>& takes_value)
+{
+  std::vector<std::string> options, non_options;
+  bool could_be_option = true;
+  for (auto it = args.begin(); it != args.end(); ++it)
+    {
+      const std::string& arg(*it);
+      if (it == args.begin())
+	{
+	  non_options.push_back(arg); // argv[0] is never an option
+	}
+      else if (!could_be_option || arg.empty())
+	{
+	  could_be_option = false;
+	  non_options.push_back(arg);
+	}
+      else if (arg == "--")
+	{
+	  could_be_option = false;
+	}
+      else if (arg[0] == '-' && arg != "-")
+	{
+	  if (std::next(it) != args.end()
+	      && std::find(takes_value.begin(), takes_value.end(), arg) != takes_value.end())
+	    {
+	      ++it;
+	      options.push_back(arg + "=" + *it);
+	    }
+	  else
+	    {
+	      options.push_back(arg);
+	    }
+	}
+      else
+	{
+	  could_be_option = false;
+	  non_options.push_back(arg);
+	}
+    }
+  return std::make_pair(options, non_options);
+}
+
 bool body_command(const StorageConfiguration& storage, const DFSContext& ctx,
 		  const std::vector<std::string>& args,
-		  file_body_logic logic)
+		  FileBodyConsumer& consumer)
 {
   if (args.size() < 2)
     {
-      std::cerr << "please give a file name.\n";
+      ctx.err() << "please give a file name.\n";
       return false;
     }
   if (args.size() > 2)
     {
       // The Beeb ignores subsequent arguments.
-      std::cerr << "warning: ignoring additional arguments.\n";
+      ctx.err() << "warning: ignoring additional arguments.\n";
     }
   ParsedFileName name;
   std::string error;
   if (!parse_filename(ctx, args[1], &name, error))
     {
-      std::cerr << args[1] << " is not a valid file name: " << error << "\n";
+      ctx.err() << args[1] << " is not a valid file name: " << error << "\n";
       return false;
     }
   auto mounted = storage.mount(name.vol, error);
   if (!mounted)
     {
-      failed_to_mount_volume(std::cerr, name.vol, error);
+      failed_to_mount_volume(ctx.err(), name.vol, error);
       return false;
     }
   const auto& root(mounted->volume()->root());
   const std::optional<CatalogEntry> entry = root.find_catalog_entry_for_name(name);
   if (!entry)
     {
-      std::cerr << args[1] << ": not found\n";
+      ctx.err() << args[1] << ": not found\n";
       return false;
     }
-  std::vector<DFS::byte> body;
   DataAccess& vol_access(mounted->volume()->data_region());
-  read_file_body(*entry, vol_access, &body);
   const std::vector<std::string> tail(args.begin() + 1, args.end());
-  return logic(body.data(), body.data() + body.size(), tail);
+  if (!consumer.begin(tail))
+    return false;
+  if (!entry->visit_file_body_spans(vol_access,
+				    [&consumer](const DFS::byte* begin, const DFS::byte* end)
+				    {
+				      return consumer.chunk(begin, end);
+				    },
+				    body_chunk_sectors))
+    return false;
+  return consumer.end();
 }
 
 }  // namespace DFS
@@ -18,16 +18,22 @@
 
 #include <cassert>      // for assert
 #include <functional>   // for function
+#include <iosfwd>       // for ostream
 #include <map>          // for map
 #include <memory>       // for unique_ptr, operator!=
+#include <optional>     // for optional
 #include <string>       // for basic_string, string
 #include <type_traits>  // for remove_reference<>::type
 #include <utility>      // for pair, make_pair, move
 #include <vector>       // for vector
 
+#include "driveselector.h"  // for SurfaceSelector, VolumeSelector
+
 namespace DFS
 {
+  class FileSystem;
   class StorageConfiguration;
+  class Volume;
   struct DFSContext;
 
   class CommandInterface
@@ -40,6 +46,11 @@ namespace DFS
     virtual bool invoke(const StorageConfiguration&,
 			const DFSContext&,
 			const std::vector<std::string>& args) = 0;
+    // Returns true if the command can be run separately on each of a
+    // list of images (see --files-from and --images).  Such commands
+    // must only read the images, and must not keep state between
+    // invocations, since they are run by several threads at once.
+    virtual bool supports_multiple_images() const;
   };
 
   class CIReg
@@ -73,13 +84,73 @@ namespace DFS
 typedef std::function<bool(const StorageConfiguration&,
 			   const DFSContext& ctx,
 			   const std::vector<std::string>& extra_args)> Command;
-typedef std::function<bool(const unsigned char* body_start,
-			   const unsigned char* body_end,
-			   const std::vector<std::string>& args_tail)> file_body_logic;
+// Split the arguments of a command into options (which begin with
+// "-") and non-options.  "-" by itself, which conventionally means
+// the standard input or output, is a non-option.  args[0] is the
+// command name, and is always a non-option.  Options end at "--" or
+// at the first non-option.  An option listed in takes_value which is
+// given as "--name value" consumes the following argument; it is
+// returned in the form "--name=value".
+std::pair<std::vector<std::string>, std::vector<std::string>>
+split_command_options(const std::vector<std::string>& args,
+		      const std::vector<std::string>& takes_value = {});
+
+// Convert the value of a --jobs option (a number of threads, between
+// 1 and 256).
+std::optional<unsigned int> parse_job_count(const std::string& value);
+
+// The number of threads used by a command having a --jobs option,
+// if the option is not given: the number of processors.
+unsigned int default_job_count();
+
+// If opt (one of the options returned by split_command_options) is
+// --jobs=N, return N.  If N is not valid, the problem is reported on
+// err and 0 is returned.  If opt is some other option, return
+// nullopt.
+std::optional<unsigned int> jobs_option(const std::string& command_name,
+					const std::string& opt, std::ostream& err);
+
+// Mount every volume of every formatted drive, calling visit_volume
+// for each volume and then visit_drive (if it is set) for the drive
+// as a whole.  Unformatted drives are skipped.  A drive or volume
+// which cannot be mounted is reported on ctx.err() (see
+// failed_to_mount_surface) and the others are still visited.  The
+// file systems are appended to *file_systems, so that the volumes
+// stay mounted after this returns.  Returns false if something could
+// not be mounted.
+bool visit_all_volumes(const StorageConfiguration& storage, const DFSContext& ctx,
+		       std::vector<std::unique_ptr<FileSystem>>* file_systems,
+		       const std::function<void(const VolumeSelector&, Volume*)>& visit_volume,
+		       const std::function<void(const SurfaceSelector&, FileSystem*)>& visit_drive
+		       = nullptr);
+
+// Look up the command named by args[0] and invoke it.  Unknown
+// commands and exceptions thrown by the command are reported on
+// ctx.err().  Returns true if the command succeeded.
+bool run_command(const StorageConfiguration& storage,
+		 const DFSContext& ctx,
+		 const std::vector<std::string>& args);
+
+// Commands which operate on the body of a single file (for example
+// type) implement FileBodyConsumer.  body_command() passes the file
+// body to it a chunk at a time, so the whole file is never held in
+// memory and output can start before the file has been fully read.
+class FileBodyConsumer
+{
+ public:
+  virtual ~FileBodyConsumer();
+  // Called once, before the first chunk.
+  virtual bool begin(const std::vector<std::string>& args_tail);
+  // Called for each successive (non-empty) piece of the body.
+  virtual bool chunk(const unsigned char* chunk_start,
+		     const unsigned char* chunk_end) = 0;
+  // Called once, after the last chunk has been accepted.
+  virtual bool end();
+};
 
 bool body_command(const StorageConfiguration& config, const DFSContext& ctx,
 		  const std::vector<std::string>& args,
-		  file_body_logic logic);
+		  FileBodyConsumer& consumer);
 
 extern std::map<std::string, Command> commands;
 
@@ -65,6 +65,18 @@ namespace DFS
     TapeCRC();
   };
 
+  // The CRC-32 used by zip files (and many others), with the
+  // reflected polynomial 0xEDB88320.  The work is done by zlib.
+  class CRC32
+  {
+  public:
+    CRC32();
+    void update(const uint8_t* start, const uint8_t *end);
+    unsigned long get() const;
+  private:
+    uint32_t crc_;
+  };
+
 }  // namespace DFS
 
 
@@ -0,0 +1,49 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "crc.h"
+
+#include <stddef.h>		// for size_t
+#include <stdint.h>		// for uint8_t, uint32_t
+#include <algorithm>		// for min
+#include <limits>		// for numeric_limits
+
+#include <zlib.h>		// for crc32, uInt, Z_NULL
+
+namespace DFS
+{
+  CRC32::CRC32()
+    : crc_(static_cast<uint32_t>(::crc32(0uL, Z_NULL, 0))) {}
+
+  void CRC32::update(const uint8_t* start, const uint8_t *end)
+  {
+    // zlib takes the length as a uInt, so feed it big buffers in
+    // pieces.
+    const size_t most = std::numeric_limits<uInt>::max();
+    uLong c = crc_;
+    while (start < end)
+      {
+	const size_t n = std::min(static_cast<size_t>(end - start), most);
+	c = ::crc32(c, start, static_cast<uInt>(n));
+	start += n;
+      }
+    crc_ = static_cast<uint32_t>(c);
+  }
+
+  unsigned long CRC32::get() const
+  {
+    return crc_;
+  }
+}  // namespace DFS
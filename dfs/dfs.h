@@ -16,17 +16,30 @@
 #ifndef INC_DFS_H
 #define INC_DFS_H 1
 
+#include <atomic>
 #include <stdexcept>
 #include <exception>
 #include <limits>
 #include <map>
+#include <ostream>
 #include <stdexcept>
 #include <string>
 
 #include "dfstypes.h"
 
 namespace DFS {
-  extern bool verbose;
+  extern std::atomic<bool> verbose;
+  // The library code writes warnings, and (when verbose is set) notes
+  // about what it is doing, to diagnostics().  This output is
+  // discarded unless a stream has been passed to
+  // set_diagnostic_stream() (the dfs program uses std::cerr).
+  std::ostream& diagnostics();
+  // Set the stream returned by diagnostics(); NULL discards the output.
+  void set_diagnostic_stream(std::ostream* os);
+  // Set the stream returned by diagnostics() in the calling thread
+  // only, overriding set_diagnostic_stream(); NULL removes the
+  // override.  Returns the previous override.
+  std::ostream* set_thread_diagnostic_stream(std::ostream* os);
   unsigned long sign_extend(unsigned long address);
   unsigned long compute_crc(const byte* start, const byte *end);
   const std::map<std::string, std::string>& get_option_help();
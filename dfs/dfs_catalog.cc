@@ -16,22 +16,24 @@
 #include "dfs_catalog.h"
 
 #include <assert.h>         // for assert
-#include <ctype.h>          // for isgraph
+#include <ctype.h>          // for isgraph, tolower
 #include <stdlib.h>         // for ldiv_t, ldiv
 #include <algorithm>        // for copy, all_of, find_if
 #include <iomanip>          // for operator<<, setw, setfill
 #include <iterator>         // for back_insert_iterator, back_inserter
 #include <limits>           // for numeric_limits
 #include <memory>           // for allocator_traits<>::value_type
+#include <mutex>            // for call_once
 #include <sstream>          // for operator<<, basic_ostream, ostringstream
 #include <string>           // for basic_string<>::iterator, string, operator<<
+#include <unordered_map>    // for unordered_map
 #include <vector>           // for vector, vector<>::const_iterator, ...
 
 #include "abstractio.h"     // for SectorBuffer, DataAccess, SECTOR_BYTES
 #include "dfs.h"            // for sign_extend
 #include "dfs_unused.h"     // for SectorMap
 #include "driveselector.h"  // for VolumeSelector
-#include "exceptions.h"     // for BadFileSystem
+#include "exceptions.h"     // for BadFileSystem, bad_file_system_message
 #include "fsp.h"            // for ParsedFileName
 #include "stringutil.h"     // for byte_to_ascii7, rtrim, ...
 
@@ -176,20 +178,18 @@ namespace DFS
   (DataAccess& media,
    std::function<bool(const byte* begin, const byte* end)> visitor) const
   {
-    const sector_count_type start = start_sector(), end=last_sector();
-    unsigned long len = file_length();
-    for (sector_count_type sec = start; sec <= end; ++sec)
-      {
-	assert(sec <= end);
-	auto buf = media.read_block(sec);
-	if (!buf)
-	  throw BadFileSystem("end of media or unreadable sector in body of file");
-	unsigned long visit_len = len > SECTOR_BYTES ? SECTOR_BYTES : len;
-	if (!visitor(buf->begin(), buf->begin() + visit_len))
-	  return false;
-	len -= visit_len;
-      }
-    return true;
+    return visit_file_body_piecewise<std::function<bool(const byte*, const byte*)>&>
+      (media, visitor);
+  }
+
+  std::string CatalogEntry::unreadable_body_error()
+  {
+    return bad_file_system_message("end of media or unreadable sector in body of file");
+  }
+
+  void CatalogEntry::unreadable_body()
+  {
+    throw BadFileSystem::from_error(unreadable_body_error());
   }
 
 
@@ -245,20 +245,7 @@ CatalogFragment::CatalogFragment(DFS::Format format,
     return entries_[offset / 8 - 1];
   }
 
-  std::optional<CatalogEntry> CatalogFragment::find_catalog_entry_for_name(const ParsedFileName& name) const
-  {
-    auto it = std::find_if(entries_.cbegin(), entries_.cend(),
-			   [&name](const CatalogEntry& entry) -> bool
-			   {
-			     return entry.has_name(name);
-			   });
-    if (it == entries_.cend())
-      return std::nullopt;
-    else
-      return *it;
-  }
-
-  std::vector<CatalogEntry> CatalogFragment::entries() const
+  const std::vector<CatalogEntry>& CatalogFragment::entries() const
   {
     return entries_;
   }
@@ -362,15 +349,16 @@ CatalogFragment::CatalogFragment(DFS::Format format,
     return true;
   }
 
-  Catalog::Catalog(DFS::Format format,
-		   DFS::sector_count_type catalog_location,
-		   DataAccess& media)
-    : disc_format_(format)
+  bool Catalog::read_fragments(DFS::Format format,
+			       DFS::sector_count_type catalog_location,
+			       DataAccess& media,
+			       std::vector<CatalogFragment>* fragments,
+			       std::string& error)
   {
     // All DFS formats have two sectors of catalog data, at sectors
     // 0 and 1.  WDFS also at 2 and 3.
-    const unsigned int frag_count = disc_format_ == Format::WDFS ? 2u : 1u;
-    fragments_.reserve(frag_count);
+    const unsigned int frag_count = format == Format::WDFS ? 2u : 1u;
+    fragments->reserve(frag_count);
     for (DFS::sector_count_type base = 0 ; base < frag_count*2u ; /* empty */)
       {
 	std::optional<DFS::SectorBuffer> names = media.read_block(catalog_location + base++);
@@ -378,15 +366,119 @@ CatalogFragment::CatalogFragment(DFS::Format format,
 	if (!names || !metadata)
 	  {
 	    std::ostringstream os;
-	    os << "to contain a valid " << format_name(disc_format_)
+	    os << "to contain a valid " << format_name(format)
 	       << " catalog, we must be able to read the first "
 	       << "two sectors of the file system";
-	    throw new BadFileSystem(os.str());
+	    error = bad_file_system_message(os.str());
+	    return false;
 	  }
-	fragments_.push_back(CatalogFragment(format, *names, *metadata));
+	fragments->push_back(CatalogFragment(format, *names, *metadata));
+      }
+    return true;
+  }
+
+  std::vector<CatalogFragment> Catalog::read_fragments_or_throw(DFS::Format format,
+								DFS::sector_count_type catalog_location,
+								DataAccess& media)
+  {
+    std::vector<CatalogFragment> fragments;
+    std::string error;
+    if (!read_fragments(format, catalog_location, media, &fragments, error))
+      throw BadFileSystem::from_error(error);
+    return fragments;
+  }
+
+  Catalog::Catalog(DFS::Format format,
+		   DFS::sector_count_type catalog_location,
+		   DataAccess& media)
+    : Catalog(format, read_fragments_or_throw(format, catalog_location, media))
+  {
+  }
+
+  Catalog::Catalog(DFS::Format format, std::vector<CatalogFragment>&& fragments)
+    : disc_format_(format), fragments_(std::move(fragments))
+  {
+    for (const auto& frag : fragments_)
+      {
+	const std::vector<CatalogEntry>& frag_entries = frag.entries();
+	std::copy(frag_entries.begin(), frag_entries.end(),
+		  std::back_inserter(entries_));
       }
   }
 
+  std::unique_ptr<Catalog> Catalog::read(DFS::Format format,
+					 DFS::sector_count_type catalog_location,
+					 DataAccess& media,
+					 std::string& error)
+  {
+    std::vector<CatalogFragment> fragments;
+    if (!read_fragments(format, catalog_location, media, &fragments, error))
+      return nullptr;
+    return std::unique_ptr<Catalog>(new Catalog(format, std::move(fragments)));
+  }
+
+  Catalog::~Catalog()
+  {
+  }
+
+  // NameIndex maps a file name (directory and name, both folded to
+  // lower case) to the positions of the catalog entries having that
+  // name.  Since the same name can occur in more than one fragment of
+  // a Watford DFS catalog, there may be more than one position.
+  class Catalog::NameIndex
+  {
+  public:
+    explicit NameIndex(const std::vector<CatalogEntry>& entries)
+    {
+      index_.reserve(entries.size());
+      for (position_type pos = 0; pos < entries.size(); ++pos)
+	{
+	  const CatalogEntry& entry(entries[pos]);
+	  index_[key(entry.directory(), entry.name())].push_back(pos);
+	}
+    }
+
+    const std::vector<position_type>& find(char dir, const std::string& name) const
+    {
+      auto it = index_.find(key(dir, name));
+      if (it == index_.end())
+	return none_;
+      return it->second;
+    }
+
+  private:
+    static std::string key(char dir, const std::string& name)
+    {
+      std::string result;
+      result.reserve(name.size() + 1);
+      result.push_back(fold(dir));
+      for (char ch : name)
+	result.push_back(fold(ch));
+      return result;
+    }
+
+    static char fold(char ch)
+    {
+      return static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+    }
+
+    std::unordered_map<std::string, std::vector<position_type>> index_;
+    std::vector<position_type> none_;
+  };
+
+  const Catalog::NameIndex& Catalog::name_index() const
+  {
+    std::call_once(name_index_once_,
+		   [this]() { name_index_ = std::make_unique<NameIndex>(entries_); });
+    return *name_index_;
+  }
+
+  const std::vector<Catalog::position_type>&
+  Catalog::positions_of(char dir, const std::string& name) const
+  {
+    return name_index().find(dir, name);
+  }
+
   bool Catalog::valid(std::string& error) const
   {
     for (const CatalogFragment& f : fragments_)
@@ -434,25 +526,19 @@ CatalogFragment::CatalogFragment(DFS::Format format,
 
   std::optional<CatalogEntry> Catalog::find_catalog_entry_for_name(const ParsedFileName& name) const
   {
-    for (const auto& frag : fragments_)
+    // The index ignores case in the directory too, so the candidates
+    // still need to be checked with has_name().
+    for (position_type pos : positions_of(name.dir, name.name))
       {
-	auto result = frag.find_catalog_entry_for_name(name);
-	if (result)
-	  return result;
+	if (entries_[pos].has_name(name))
+	  return entries_[pos];
       }
     return std::nullopt;
   }
 
-  std::vector<CatalogEntry> Catalog::entries() const
+  const std::vector<CatalogEntry>& Catalog::entries() const
   {
-    std::vector<CatalogEntry> result;
-    for (const auto& frag : fragments_)
-      {
-	std::vector<CatalogEntry> frag_entries = frag.entries();
-	std::copy(frag_entries.begin(), frag_entries.end(),
-		  std::back_inserter(result));
-      }
-    return result;
+    return entries_;
   }
 
   std::vector<std::vector<CatalogEntry>>
@@ -494,7 +580,7 @@ CatalogFragment::CatalogFragment(DFS::Format format,
 	file_name.name = entry.name();
 	out->add_file_sectors(DFS::sector_count(data_origin_lba + entry.start_sector()),
 			      DFS::sector_count(data_origin_lba + entry.last_sector() + 1),
-			      file_name);
+			      file_name, entry.file_length() == 0);
       }
   }
 
@@ -553,7 +639,7 @@ namespace std
     if (s)
       {
 	std::ostringstream os;
-	auto entries = f.entries();
+	const auto& entries = f.entries();
 	os << "Title " << f.title() << "\n"
 	   << "Boot setting " << f.boot_setting() << "\n"
 	   << "Total sectors " << f.total_sectors() << "\n"
@@ -16,12 +16,16 @@
 #ifndef INC_DFS_CATALOG_H
 #define INC_DFS_CATALOG_H
 
+#include <algorithm>     // for min
 #include <array>         // for array
 #include <functional>    // for function
 #include <iosfwd>        // for ostream
+#include <limits>        // for numeric_limits
+#include <memory>        // for unique_ptr
+#include <mutex>         // for once_flag
 #include <optional>      // for optional
 #include <string>        // for string
-#include <utility>       // for pair
+#include <utility>       // for pair, forward
 #include <vector>        // for vector
 
 #include "abstractio.h"  // for SectorBuffer
@@ -117,11 +121,93 @@ public:
   sector_count_type last_sector() const;
 
   std::pair<const byte*, const byte*> file_body(int slot) const;
+
+  // Call visitor(begin, end) for each sector of the file body in
+  // turn (the last call covers only the part of the final sector
+  // within the file).  Stops early, returning false, if the visitor
+  // returns false.  Throws BadFileSystem if a sector cannot be read.
   bool visit_file_body_piecewise(DataAccess& media,
 				 std::function<bool(const byte* begin,
 						    const byte *end)> visitor) const;
+  // As above, but the visitor can be inlined.
+  template <class Visitor>
+  bool visit_file_body_piecewise(DataAccess& media, Visitor&& visitor) const
+  {
+    std::string error;
+    const bool result = visit_file_body_piecewise(media, std::forward<Visitor>(visitor), error);
+    if (!error.empty())
+      unreadable_body();
+    return result;
+  }
+  // As above, but for scanning damaged images: if a sector cannot be
+  // read, this sets error and returns false instead of throwing.
+  template <class Visitor>
+  bool visit_file_body_piecewise(DataAccess& media, Visitor&& visitor, std::string& error) const
+  {
+    const sector_count_type start = start_sector();
+    unsigned long len = file_length();
+    for (sector_count_type sec = start; len > 0; ++sec)
+      {
+	auto buf = media.read_block(sec);
+	if (!buf)
+	  {
+	    error = unreadable_body_error();
+	    return false;
+	  }
+	unsigned long visit_len = len > SECTOR_BYTES ? SECTOR_BYTES : len;
+	if (!visitor(buf->data(), buf->data() + visit_len))
+	  return false;
+	len -= visit_len;
+      }
+    return true;
+  }
+
+  // Like visit_file_body_piecewise, but the visitor is called with
+  // the largest contiguous spans of the file body which the media
+  // can deliver, up to max_span_sectors sectors each (by default,
+  // the whole body in a single call).
+  template <class Visitor>
+  bool visit_file_body_spans(DataAccess& media, Visitor&& visitor,
+			     unsigned long max_span_sectors = std::numeric_limits<unsigned long>::max()) const
+  {
+    std::string error;
+    const bool result = visit_file_body_spans(media, std::forward<Visitor>(visitor), error,
+					      max_span_sectors);
+    if (!error.empty())
+      unreadable_body();
+    return result;
+  }
+  // As above, but sets error and returns false instead of throwing.
+  // The spans before an unreadable sector are still visited.
+  template <class Visitor>
+  bool visit_file_body_spans(DataAccess& media, Visitor&& visitor, std::string& error,
+			     unsigned long max_span_sectors = std::numeric_limits<unsigned long>::max()) const
+  {
+    unsigned long len = file_length();
+    const unsigned long sectors = (len + SECTOR_BYTES - 1) / SECTOR_BYTES;
+    std::vector<byte> buf(std::min(sectors, max_span_sectors) * SECTOR_BYTES);
+    for (unsigned long done = 0; done < sectors; /* empty */)
+      {
+	const unsigned long want = std::min(sectors - done, max_span_sectors);
+	const unsigned long got = media.read_blocks(start_sector() + done, want, buf.data());
+	const unsigned long visit_len = std::min(len, got * SECTOR_BYTES);
+	if (visit_len && !visitor(buf.data(), buf.data() + visit_len))
+	  return false;
+	if (got < want)
+	  {
+	    error = unreadable_body_error();
+	    return false;
+	  }
+	len -= visit_len;
+	done += got;
+      }
+    return true;
+  }
 
 private:
+  static std::string unreadable_body_error();
+  [[noreturn]] static void unreadable_body();
+
   std::array<byte, 8> raw_name_;
   std::array<byte, 8> raw_metadata_;
 };
@@ -152,9 +238,8 @@ public:
     return sequence_number_;
   }
 
-  std::vector<CatalogEntry> entries() const;
+  const std::vector<CatalogEntry>& entries() const;
 
-  std::optional<CatalogEntry> find_catalog_entry_for_name(const ParsedFileName& name) const;
   BootSetting boot_setting() const { return boot_; }
   sector_count_type total_sectors() const { return total_sectors_; };
   void read_sector(DataAccess&, sector_count_type n,
@@ -183,7 +268,15 @@ public:
 class Catalog
 {
  public:
+  using position_type = std::vector<CatalogEntry>::size_type;
+
+  // Throws BadFileSystem if the catalog cannot be read.
   explicit Catalog(DFS::Format format, DFS::sector_count_type loc, DataAccess&);
+  ~Catalog();
+  // As the constructor, but for scanning many (possibly damaged)
+  // images: returns null and sets error instead of throwing.
+  static std::unique_ptr<Catalog> read(DFS::Format format, DFS::sector_count_type loc,
+				       DataAccess&, std::string& error);
 
   const CatalogFragment& primary() const
   {
@@ -200,10 +293,16 @@ class Catalog
 
   std::optional<CatalogEntry> find_catalog_entry_for_name(const ParsedFileName& name) const;
 
+  // Return the positions (within entries()) of the entries whose
+  // directory and name are the same as dir and name, ignoring case.
+  // The positions are in catalog order.  This uses an index which is
+  // built the first time it is needed.
+  const std::vector<position_type>& positions_of(char dir, const std::string& name) const;
+
   // Return all the catalog entries.  This is normally the best way to
   // iterate over entries.  The entries are returned in the same order
-  // as "*INFO".
-  std::vector<CatalogEntry> entries() const;
+  // as "*INFO".  No copy is made; the entries belong to the Catalog.
+  const std::vector<CatalogEntry>& entries() const;
 
   // Return catalog entries in on-disc order.  The outermost vector is
   // the order in which the datalog is stored.  In the case of a
@@ -226,11 +325,25 @@ class Catalog
 		   SectorMap* out) const;
 
 private:
+  class NameIndex;
+  Catalog(DFS::Format format, std::vector<CatalogFragment>&& fragments);
+  static bool read_fragments(DFS::Format format, DFS::sector_count_type loc, DataAccess&,
+			     std::vector<CatalogFragment>* fragments, std::string& error);
+  static std::vector<CatalogFragment> read_fragments_or_throw(DFS::Format format,
+							      DFS::sector_count_type loc,
+							      DataAccess&);
+  const NameIndex& name_index() const;
+
   DFS::Format disc_format_;
   // class invariant: drive_ is non-null.
   // class invariant: fragments_ is non-empty.
   // class invariant: for all items f in fragments_, f.drive_ == drive.
   std::vector<CatalogFragment> fragments_;
+  // The entries of all the fragments, in catalog order.
+  std::vector<CatalogEntry> entries_;
+  // The index is built on first use, perhaps by several threads at once.
+  mutable std::once_flag name_index_once_;
+  mutable std::unique_ptr<NameIndex> name_index_;
 };
 
 }  // namespace DFS
@@ -21,7 +21,10 @@
 #include <array>            // for array
 #include <iterator>         // for back_inserter
 #include <map>              // for map, _Rb_tree_const_iterator
+#include <memory>           // for unique_ptr
+#include <optional>         // for optional
 #include <sstream>	    // for ostringstream
+#include <string>           // for string
 #include <ostream>          // for operator<<, ostream, basic_ostream, ...
 #include <utility>          // for pair
 #include <vector>           // for vector
@@ -58,11 +61,54 @@ namespace DFS
   FileSystem::FileSystem(DataAccess& media,
 			 DFS::Format fmt,
 			 DFS::Geometry geom)
-    : format_(fmt), geometry_(geom), media_(media),
-      volumes_(DFS::internal::init_volumes(media, fmt, geom))
+    : FileSystem(media, fmt, geom, volumes_or_throw(media, fmt, geom))
   {
-    const DFS::byte byte106 = get_byte(1, 0x06);
+    const std::optional<byte> byte106 = get_byte(1, 0x06);
+    if (!byte106)
+      throw eof_in_catalog();
+    check_recognition_id(*byte106);
+  }
+
+  FileSystem::FileSystem(DataAccess& media,
+			 DFS::Format fmt,
+			 DFS::Geometry geom,
+			 VolumeMap&& volumes)
+    : format_(fmt), geometry_(geom), media_(media), volumes_(std::move(volumes))
+  {
+  }
+
+  FileSystem::VolumeMap FileSystem::volumes_or_throw(DataAccess& media,
+						     DFS::Format fmt,
+						     const DFS::Geometry& geom)
+  {
+    VolumeMap volumes;
+    std::string error;
+    if (!DFS::internal::init_volumes(media, fmt, geom, &volumes, error))
+      throw BadFileSystem::from_error(error);
+    return volumes;
+  }
 
+  std::unique_ptr<FileSystem> FileSystem::load(DataAccess& media,
+					       DFS::Format fmt,
+					       DFS::Geometry geom,
+					       std::string& error)
+  {
+    VolumeMap volumes;
+    if (!DFS::internal::init_volumes(media, fmt, geom, &volumes, error))
+      return nullptr;
+    std::unique_ptr<FileSystem> result(new FileSystem(media, fmt, geom, std::move(volumes)));
+    const std::optional<byte> byte106 = result->get_byte(1, 0x06);
+    if (!byte106)
+      {
+	error = eof_in_catalog().what();
+	return nullptr;
+      }
+    result->check_recognition_id(*byte106);
+    return result;
+  }
+
+  void FileSystem::check_recognition_id(byte byte106) const
+  {
     // s1[6] is where all the interesting stuff alternate-format-wise is.  Bits:
     // b0: bit 8 of total sector count (Acorn => all)
     // b1: bit 9 of total sector count (Acorn => all)
@@ -146,12 +192,12 @@ namespace DFS
     return format_;
   }
 
-  byte FileSystem::get_byte(sector_count_type sector, unsigned offset) const
+  std::optional<byte> FileSystem::get_byte(sector_count_type sector, unsigned offset) const
   {
     assert(offset < DFS::SECTOR_BYTES);
     auto got = media_.read_block(sector);
     if (!got)
-      throw eof_in_catalog();
+      return std::nullopt;
     return (*got)[offset];
   }
 
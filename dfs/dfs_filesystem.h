@@ -40,7 +40,12 @@ class FileSystem
 {
 public:
   static constexpr char DEFAULT_VOLUME = 'A';
+  // Throws BadFileSystem if the catalogs cannot be read.
   explicit FileSystem(DataAccess&, DFS::Format fmt, DFS::Geometry geom);
+  // As the constructor, but for scanning many (possibly damaged)
+  // images: returns null and sets error instead of throwing.
+  static std::unique_ptr<FileSystem> load(DataAccess&, DFS::Format fmt, DFS::Geometry geom,
+					  std::string& error);
   Volume* mount(std::optional<char> vol, std::string& error) const;
   std::vector<std::optional<char>> subvolumes() const;
   // Determine what UI styling to use for the current file system.
@@ -55,12 +60,16 @@ public:
   DataAccess& whole_device() const;
 
 private:
-  byte get_byte(sector_count_type sector, unsigned offset) const;
+  using VolumeMap = std::map<std::optional<char>, std::unique_ptr<Volume>>;
+  FileSystem(DataAccess&, DFS::Format fmt, DFS::Geometry geom, VolumeMap&& volumes);
+  static VolumeMap volumes_or_throw(DataAccess&, DFS::Format fmt, const DFS::Geometry& geom);
+  void check_recognition_id(byte byte106) const;
+  std::optional<byte> get_byte(sector_count_type sector, unsigned offset) const;
 
   Format format_;
   Geometry geometry_;
   DataAccess& media_;
-  std::map<std::optional<char>, std::unique_ptr<Volume>> volumes_;
+  VolumeMap volumes_;
 };
 
 }  // namespace DFS
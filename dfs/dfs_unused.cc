@@ -15,8 +15,9 @@
 //
 #include "dfs_unused.h"
 
+#include <algorithm>        // for upper_bound
+#include <iterator>         // for next, prev
 #include <sstream>          // for operator<<, basic_ostream, ostringstream
-#include <utility>          // for pair, make_pair
 
 #include "driveselector.h"  // for operator<<, VolumeSelector
 #include "fsp.h"            // for ParsedFileName
@@ -52,15 +53,126 @@ namespace DFS
   std::optional<std::string> SectorMap::at(DFS::sector_count_type sec) const
   {
     std::optional<std::string> result;
-    auto it = used_by_.find(sec);
-    if (it != used_by_.end())
-      result = it->second;
+    // Find the last extent starting at or before sec.
+    auto it = std::upper_bound(extents_.begin(), extents_.end(), sec,
+			       [](DFS::sector_count_type s, const Extent& e)
+			       {
+				 return s < e.begin;
+			       });
+    if (it != extents_.begin())
+      {
+	--it;
+	if (sec < it->end)
+	  result = labels_[it->label];
+      }
+    return result;
+  }
+
+  std::vector<SectorMap::Run> SectorMap::runs(DFS::sector_count_type limit) const
+  {
+    std::vector<Run> result;
+    result.reserve(extents_.size() * 2 + 1);
+    DFS::sector_count_type pos = 0;
+    for (const Extent& e : extents_)
+      {
+	if (pos >= limit)
+	  break;
+	if (pos < e.begin)
+	  result.push_back(Run{pos, std::min(e.begin, limit), nullptr});
+	if (e.begin < limit)
+	  result.push_back(Run{e.begin, std::min(e.end, limit), &labels_[e.label]});
+	pos = e.end;
+      }
+    if (pos < limit)
+      result.push_back(Run{pos, limit, nullptr});
+    return result;
+  }
+
+  std::vector<SectorMap::Run> SectorMap::free_runs(DFS::sector_count_type limit) const
+  {
+    std::vector<Run> result;
+    for (const Run& r : runs(limit))
+      {
+	if (!r.label)
+	  result.push_back(r);
+      }
     return result;
   }
 
+  std::vector<std::string>::size_type SectorMap::intern(const std::string& label)
+  {
+    auto it = label_ids_.find(label);
+    if (it != label_ids_.end())
+      return it->second;
+    labels_.push_back(label);
+    zero_length_.push_back(false);
+    label_ids_[label] = labels_.size() - 1;
+    return labels_.size() - 1;
+  }
+
+  void SectorMap::assign(DFS::sector_count_type begin, DFS::sector_count_type end,
+			 std::vector<std::string>::size_type label)
+  {
+    if (begin >= end)
+      return;
+    // first is the first extent which ends after begin, and last is the
+    // first extent which starts at or after end.  The extents in
+    // [first, last) overlap the new one.
+    auto first = std::upper_bound(extents_.begin(), extents_.end(), begin,
+				  [](DFS::sector_count_type s, const Extent& e)
+				  {
+				    return s < e.end;
+				  });
+    auto last = first;
+    while (last != extents_.end() && last->begin < end)
+      ++last;
+
+    std::vector<Extent> replacement;
+    replacement.reserve(3);
+    if (first != last && first->begin < begin)
+      replacement.push_back(Extent{first->begin, begin, first->label});
+    replacement.push_back(Extent{begin, end, label});
+    if (first != last && end < std::prev(last)->end)
+      replacement.push_back(Extent{end, std::prev(last)->end, std::prev(last)->label});
+
+    // Merge extents carrying the same label, to keep the extents list
+    // short.
+    for (auto it = replacement.begin(); std::next(it) != replacement.end(); )
+      {
+	if (it->label == std::next(it)->label)
+	  {
+	    it->end = std::next(it)->end;
+	    replacement.erase(std::next(it));
+	  }
+	else
+	  {
+	    ++it;
+	  }
+      }
+    if (first != extents_.begin())
+      {
+	auto before = std::prev(first);
+	if (before->end == replacement.front().begin
+	    && before->label == replacement.front().label)
+	  {
+	    replacement.front().begin = before->begin;
+	    first = before;
+	  }
+      }
+    if (last != extents_.end()
+	&& last->begin == replacement.back().end
+	&& last->label == replacement.back().label)
+      {
+	replacement.back().end = last->end;
+	++last;
+      }
+    auto pos = extents_.erase(first, last);
+    extents_.insert(pos, replacement.begin(), replacement.end());
+  }
+
   void SectorMap::add_other(DFS::sector_count_type where, const std::string& label)
   {
-    used_by_[where] = label;
+    assign(where, where + 1, intern(label));
   }
 
   void SectorMap::add_catalog_sector(DFS::sector_count_type where, const VolumeSelector& vol)
@@ -69,25 +181,39 @@ namespace DFS
       {
 	std::ostringstream ss;
 	ss << "*CAT:" << vol;
-	used_by_[where] = ss.str();
+	add_other(where, ss.str());
       }
     else
       {
 	// There is no need for a distinguishing suffix to identify
 	// which catalog, so use a more descriptive label.
-	used_by_[where] = "catalog";
+	add_other(where, "catalog");
       }
   }
 
   void SectorMap::add_file_sectors(DFS::sector_count_type begin,
 				   DFS::sector_count_type end, // not included
-				   const ParsedFileName& name)
+				   const ParsedFileName& name,
+				   bool zero_length)
   {
-    std::string label = file_label(name, multiple_catalogs_);
-    auto hint = used_by_.begin();
-    for (auto sec = begin; sec < end; ++sec)
+    if (begin >= end)
+      return;
+    const auto label = intern(file_label(name, multiple_catalogs_));
+    if (zero_length)
+      zero_length_[label] = true;
+    // Only the gaps between existing extents are assigned.
+    std::vector<Run> gaps;
+    for (const Run& r : runs(end))
       {
-	used_by_.insert(hint, std::make_pair(sec, label));
+	if (r.end <= begin)
+	  continue;
+	if (!r.label)
+	  gaps.push_back(Run{std::max(r.begin, begin), r.end, nullptr});
+	else if (!zero_length && !zero_length_[label_ids_[*r.label]])
+	  overlaps_.push_back(Overlap{std::max(r.begin, begin), r.end,
+				      *r.label, labels_[label]});
       }
+    for (const Run& gap : gaps)
+      assign(gap.begin, gap.end, label);
   }
 }  // DFS
@@ -19,6 +19,7 @@
 #include <map>         // for map
 #include <optional>    // for optional
 #include <string>      // for string
+#include <vector>      // for vector
 
 #include "dfstypes.h"  // for sector_count_type
 
@@ -27,21 +28,83 @@ namespace DFS
   class VolumeSelector;
   struct ParsedFileName;
 
+  // SectorMap records what each sector of a disc is used for.  It
+  // stores a sorted list of non-overlapping runs of sectors, each run
+  // sharing a single label, so its size depends on the number of
+  // files rather than the number of sectors.
   class SectorMap
   {
   public:
+    // Run describes a span of consecutive sectors having the same
+    // owner.  label is null for sectors which are not in use; otherwise
+    // it points into the SectorMap (so it is invalidated if the map is
+    // modified or destroyed).
+    struct Run
+    {
+      DFS::sector_count_type begin;
+      DFS::sector_count_type end; // not included
+      const std::string* label;
+    };
+
+    // Overlap records that a file was given sectors which were
+    // already in use.
+    struct Overlap
+    {
+      DFS::sector_count_type begin;
+      DFS::sector_count_type end; // not included
+      std::string owner;	  // the label the sectors already had
+      std::string claimant;	  // the label of the later file
+    };
+
     explicit SectorMap(bool multiple_catalogs);
     std::optional<std::string> at(DFS::sector_count_type sec) const;
 
+    // Return all the runs (used or free) which together cover sectors
+    // 0 to limit-1, in order.
+    std::vector<Run> runs(DFS::sector_count_type limit) const;
+    // Return the runs of unused sectors below limit, in order.
+    std::vector<Run> free_runs(DFS::sector_count_type limit) const;
+
+    // Sectors which are already in use are not changed, but the
+    // conflict is recorded in overlaps().  A zero-length file is
+    // shown at its start sector, but since it does not really use
+    // it, no conflict over that sector is recorded.
     void add_file_sectors(DFS::sector_count_type begin,
 			  DFS::sector_count_type end, // not included
-			  const ParsedFileName& fn);
+			  const ParsedFileName& fn,
+			  bool zero_length = false);
+    // These replace any existing label for the sector.
     void add_catalog_sector(DFS::sector_count_type where, const VolumeSelector& vol);
     void add_other(DFS::sector_count_type where, const std::string& label);
 
+    // The sectors claimed by more than one file (or by a file and
+    // the catalog), in the order they were found.
+    const std::vector<Overlap>& overlaps() const
+    {
+      return overlaps_;
+    }
+
   private:
+    struct Extent
+    {
+      DFS::sector_count_type begin;
+      DFS::sector_count_type end; // not included
+      std::vector<std::string>::size_type label;
+    };
+
+    std::vector<std::string>::size_type intern(const std::string& label);
+    void assign(DFS::sector_count_type begin, DFS::sector_count_type end,
+		std::vector<std::string>::size_type label);
+
     bool multiple_catalogs_;
-    std::map<int, std::string> used_by_;
+    // class invariant: extents_ is sorted, and the extents do not
+    // overlap.  Adjacent extents have different labels.
+    std::vector<Extent> extents_;
+    std::vector<Overlap> overlaps_;
+    std::vector<std::string> labels_;
+    // zero_length_[i] is true if labels_[i] names a zero-length file.
+    std::vector<bool> zero_length_;
+    std::map<std::string, std::vector<std::string>::size_type> label_ids_;
   };
 
 }  // DFS
@@ -14,9 +14,11 @@
 //   limitations under the License.
 //
 #include "dfs_volume.h"
+#include <algorithm>      // for min
 #include <map>            // for map
 #include <memory>         // for unique_ptr, make_unique, allocator
 #include <optional>       // for optional, nullopt_t, nullopt
+#include <string>         // for string
 #include <type_traits>    // for remove_reference<>::type
 #include <utility>        // for pair, make_pair, move
 #include <vector>         // for vector
@@ -24,9 +26,10 @@
 #include "abstractio.h"   // for DataAccess
 #include "dfs_catalog.h"  // for Catalog
 #include "dfs_format.h"   // for Format, Format::OpusDDOS
-#include "exceptions.h"   // for BadFileSystem
+#include "exceptions.h"   // for bad_file_system_message
 #include "geometry.h"     // for Geometry
 #include "opus_cat.h"     // for OpusDiscCatalogue::VolumeLocation, ...
+#include "resolver.h"     // for SectorResolver, make_sector_resolver
 
 namespace DFS
 {
@@ -35,46 +38,123 @@ namespace DFS
 
   namespace internal
   {
-    std::map<std::optional<char>, std::unique_ptr<DFS::Volume>>
-    init_volumes(DFS::DataAccess& media, DFS::Format fmt, const DFS::Geometry& geom)
+    bool init_volumes(DFS::DataAccess& media, DFS::Format fmt, const DFS::Geometry& geom,
+		      std::map<std::optional<char>, std::unique_ptr<DFS::Volume>>* volumes,
+		      std::string& error)
     {
-      std::map<std::optional<char>, std::unique_ptr<DFS::Volume>> result;
       if (fmt == DFS::Format::OpusDDOS)
 	{
 	  auto got = media.read_block(16);
 	  if (!got)
-	    throw DFS::BadFileSystem("file system detected as Opus DDOS but the sector which should contain the disc catalogue is unreadable");
-	  auto dc = OpusDiscCatalogue(*got, geom);
-	  for (const auto& vol_loc : dc.get_volume_locations())
 	    {
-	      auto vol = std::make_unique<DFS::Volume>(fmt,
-						       vol_loc.catalog_location(),
-						       vol_loc.start_sector(),
-						       vol_loc.len(),
-						       media);
-	      result.insert(std::make_pair(vol_loc.volume(), std::move(vol)));
+	      error = DFS::bad_file_system_message("file system detected as Opus DDOS but the sector which should contain the disc catalogue is unreadable");
+	      return false;
+	    }
+	  std::optional<OpusDiscCatalogue> dc = OpusDiscCatalogue::parse(*got, geom, error);
+	  if (!dc)
+	    return false;
+	  for (const auto& vol_loc : dc->get_volume_locations())
+	    {
+	      auto vol = DFS::Volume::load(fmt,
+					   vol_loc.catalog_location(),
+					   vol_loc.start_sector(),
+					   vol_loc.len(),
+					   media, error);
+	      if (!vol)
+		return false;
+	      volumes->insert(std::make_pair(vol_loc.volume(), std::move(vol)));
 	    }
 	}
       else
 	{
-	  auto vol = std::make_unique<DFS::Volume>(fmt, 0, 0, geom.total_sectors(), media);
-	  result.insert(std::make_pair(std::nullopt, std::move(vol)));
+	  auto vol = DFS::Volume::load(fmt, 0, 0, geom.total_sectors(), media, error);
+	  if (!vol)
+	    return false;
+	  volumes->insert(std::make_pair(std::nullopt, std::move(vol)));
 	}
-      return result;
+      return true;
     }
 
   }  // namespace internal
 
+  Volume::Access::Access(unsigned long first_sector, unsigned long sectors,
+			 DataAccess& underlying)
+    : origin_(first_sector), len_(sectors), underlying_(underlying)
+  {
+    // The layout is worked out once, when the volume is mounted.
+    if (std::optional<SectorLayout> layout = sector_layout())
+      resolver_ = make_sector_resolver(*layout);
+  }
+
+  std::optional<SectorBuffer> Volume::Access::read_block(unsigned long lba)
+  {
+    if (lba > len_)
+      return std::nullopt;
+    if (!resolver_)
+      return underlying_.read_block(origin_ + lba);
+    SectorBuffer buf;
+    if (resolver_->read_blocks(lba, 1, buf.data()) != 1)
+      return std::nullopt;
+    return buf;
+  }
+
+  unsigned long Volume::Access::read_blocks(unsigned long lba, unsigned long count, byte* out)
+  {
+    if (lba > len_)
+      return 0;
+    // read_block() accepts lba == len_, so we do too.
+    if (count > len_ - lba + 1)
+      count = len_ - lba + 1;
+    if (resolver_)
+      return resolver_->read_blocks(lba, count, out);
+    return underlying_.read_blocks(origin_ + lba, count, out);
+  }
+
+  std::optional<SectorLayout> Volume::Access::sector_layout()
+  {
+    std::optional<SectorLayout> layout = underlying_.sector_layout();
+    if (!layout || layout->limit <= origin_)
+      return std::nullopt;
+    layout->origin += origin_;
+    // read_block() accepts lba == len_, so the layout does too.
+    layout->limit = std::min(layout->limit - origin_, len_ + 1);
+    return layout;
+  }
+
   Volume::Volume(DFS::Format format,
 		 DFS::sector_count_type catalog_location,
 		 unsigned long first_sector,
 		 unsigned long total_sectors,
 		 DataAccess& media)
+    : Volume(catalog_location, first_sector, total_sectors, media,
+	     std::make_unique<Catalog>(format, catalog_location, media))
+  {
+  }
+
+  Volume::Volume(DFS::sector_count_type catalog_location,
+		 unsigned long first_sector,
+		 unsigned long total_sectors,
+		 DataAccess& media,
+		 std::unique_ptr<Catalog> root)
     : catalog_location_(catalog_location),
       total_sectors_(DFS::sector_count(total_sectors)),
       volume_tracks_(first_sector, total_sectors, media),
-      root_(std::make_unique<Catalog>(format, catalog_location, media))
+      root_(std::move(root))
+  {
+  }
+
+  std::unique_ptr<Volume> Volume::load(DFS::Format format,
+				       DFS::sector_count_type catalog_location,
+				       unsigned long first_sector,
+				       unsigned long total_sectors,
+				       DataAccess& media,
+				       std::string& error)
   {
+    std::unique_ptr<Catalog> root = Catalog::read(format, catalog_location, media, error);
+    if (!root)
+      return nullptr;
+    return std::unique_ptr<Volume>(new Volume(catalog_location, first_sector, total_sectors,
+					      media, std::move(root)));
   }
 
   const Catalog& Volume::root() const
@@ -19,11 +19,13 @@
 #include <map>            // for map
 #include <memory>         // for unique_ptr
 #include <optional>       // for optional, nullopt
+#include <string>         // for string
 
 #include "abstractio.h"   // for DataAccess, SectorBuffer
 #include "dfs_catalog.h"  // for Catalog
 #include "dfs_format.h"   // for Format
 #include "dfstypes.h"     // for sector_count_type
+#include "resolver.h"     // for SectorResolver
 
 namespace DFS
 {
@@ -39,10 +41,17 @@ struct Geometry;
 class Volume
 {
  public:
+  // Throws BadFileSystem if the catalog cannot be read.
   explicit Volume(DFS::Format format,
 		  DFS::sector_count_type catalog_location,
 		  unsigned long first_sector, unsigned long total_sectors,
 		  DataAccess&);
+  // As the constructor, but returns null and sets error instead of
+  // throwing.
+  static std::unique_ptr<Volume> load(DFS::Format format,
+				      DFS::sector_count_type catalog_location,
+				      unsigned long first_sector, unsigned long total_sectors,
+				      DataAccess&, std::string& error);
   const Catalog& root() const;
   DataAccess& data_region();
   void map_sectors(const DFS::VolumeSelector& vol, DFS::SectorMap*) const;
@@ -55,22 +64,30 @@ class Volume
 
 
  private:
+  Volume(DFS::sector_count_type catalog_location,
+	 unsigned long first_sector, unsigned long total_sectors,
+	 DataAccess&, std::unique_ptr<Catalog> root);
+
   class Access : public DataAccess
    {
    public:
    Access(unsigned long first_sector, unsigned long sectors,
-	  DataAccess& underlying)
-     : origin_(first_sector), len_(sectors), underlying_(underlying)
-       {
-       }
+	  DataAccess& underlying);
 
-     std::optional<SectorBuffer> read_block(unsigned long lba) override
+     std::optional<SectorBuffer> read_block(unsigned long lba) override;
+     unsigned long read_blocks(unsigned long lba, unsigned long count, byte* out) override;
+
+     std::optional<HostExtent> host_extent(unsigned long lba, unsigned long count) override
        {
 	 if (lba > len_)
 	   return std::nullopt;
-	 return underlying_.read_block(origin_ + lba);
+	 if (count > len_ - lba + 1)
+	   count = len_ - lba + 1;
+	 return underlying_.host_extent(origin_ + lba, count);
        }
 
+     std::optional<SectorLayout> sector_layout() override;
+
      unsigned long origin() const
      {
        return origin_;
@@ -80,6 +97,9 @@ class Volume
      unsigned long origin_;
      unsigned long len_;
      DataAccess& underlying_;
+     // If the volume is stored at regular positions in a file, reads
+     // go straight to the file through resolver_.
+     std::unique_ptr<SectorResolver> resolver_;
    };
  sector_count_type catalog_location_;
  sector_count_type total_sectors_;
@@ -89,8 +109,10 @@ class Volume
 
  namespace internal
  {
-    std::map<std::optional<char>, std::unique_ptr<DFS::Volume>>
-      init_volumes(DFS::DataAccess& media, DFS::Format fmt, const DFS::Geometry&);
+    // Returns false and sets error if the volumes cannot be read.
+    bool init_volumes(DFS::DataAccess& media, DFS::Format fmt, const DFS::Geometry&,
+		      std::map<std::optional<char>, std::unique_ptr<DFS::Volume>>* volumes,
+		      std::string& error);
  }  // namespace internal
 
 }  // namespace DFS
@@ -16,6 +16,7 @@
 #if !defined(INC_DFSCONTEXT_H)
 #define INC_DFSCONTEXT_H 1
 
+#include <iostream>
 #include <string>
 #include <optional>
 
@@ -71,7 +72,28 @@ public:
   char current_directory;
   DFS::VolumeSelector current_volume;
 
+  // Commands write their output and diagnostics to these streams
+  // (normally the standard output and standard error streams) so
+  // that it can be captured, for example by the serve command.
+  std::ostream& out() const
+  {
+    return *out_;
+  }
+
+  std::ostream& err() const
+  {
+    return *err_;
+  }
+
+  void redirect_output(std::ostream* out, std::ostream* err)
+  {
+    out_ = out;
+    err_ = err;
+  }
+
 private:
+  std::ostream* out_ = &std::cout;
+  std::ostream* err_ = &std::cerr;
   friend class FileSystem;
   // ui is accessed via FileSystem so that it can also take into
   // account the type of image we are working with.
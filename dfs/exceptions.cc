@@ -47,9 +47,24 @@ std::string Unrecognized::make_msg(const std::string& cause)
 }
 
 
+std::string bad_file_system_message(const std::string& msg)
+{
+  return std::string("bad disk image: ") + msg;
+}
+
 BadFileSystem::BadFileSystem(const std::string& msg)
-  : BaseException(std::string("bad disk image: ") + msg)
+  : BaseException(bad_file_system_message(msg))
+{
+}
+
+BadFileSystem::BadFileSystem(FromError, const std::string& error)
+  : BaseException(error)
+{
+}
+
+BadFileSystem BadFileSystem::from_error(const std::string& error)
 {
+  return BadFileSystem(FromError(), error);
 }
 
 DFS::BadFileSystem eof_in_catalog()
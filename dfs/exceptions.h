@@ -80,10 +80,22 @@ public:
   }
 };
 
+// The message of a BadFileSystem exception whose cause is msg.  The
+// functions which report bad data without throwing (for scanning
+// many images) give the same messages.
+std::string bad_file_system_message(const std::string& msg);
+
 class BadFileSystem : public BaseException
 {
  public:
   BadFileSystem(const std::string& msg);
+  // The exception for an error already reported without throwing
+  // (whose message came from bad_file_system_message).
+  static BadFileSystem from_error(const std::string& error);
+
+ private:
+  struct FromError {};
+  BadFileSystem(FromError, const std::string& error);
 };
 
 BadFileSystem eof_in_catalog();
@@ -0,0 +1,177 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "extraction.h"
+
+#include <errno.h>          // for errno
+#include <fcntl.h>          // for open, O_WRONLY, O_CREAT, O_TRUNC, O_CLOEXEC
+#include <string.h>         // for strerror
+#include <unistd.h>         // for close
+#include <fstream>          // for ofstream
+#include <iomanip>          // for operator<<, setw, setfill, hex, uppercase
+#include <sstream>          // for ostringstream
+
+#include "crc.h"            // for TapeCRC
+#include "dfs.h"            // for sign_extend
+#include "hostcopy.h"       // for copy_host_range, crc_host_range
+#include "stringutil.h"     // for rtrim
+
+namespace
+{
+  using DFS::CatalogEntry;
+  using DFS::Extraction;
+  using DFS::TapeCRC;
+  using DFS::copy_host_range;
+  using DFS::crc_host_range;
+  using DFS::inf_line;
+
+  bool create_inf_file(const std::string& name,
+		       unsigned long crc,
+		       const CatalogEntry& entry,
+		       std::string* error)
+  {
+    std::ofstream inf_file(name, std::ofstream::out);
+    if (!inf_file.good())
+      {
+	*error = "unable to create file " + name + ": " + strerror(errno);
+	return false;
+      }
+    inf_file << inf_line(crc, entry);
+    inf_file.close();
+    if (!inf_file.good())
+      {
+	*error = name + ": " + strerror(errno);
+	return false;
+      }
+    return true;
+  }
+
+  // Copy the body of a file directly from the image file.
+  bool copy_extent(const Extraction& job, unsigned long* crc, std::string* error)
+  {
+    const int out = open(job.body_file.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0666);
+    if (out < 0)
+      {
+	*error = "unable to create file " + job.body_file + ": " + strerror(errno);
+	return false;
+      }
+    const unsigned long len = job.entry.file_length();
+    std::string why;
+    TapeCRC tape_crc;
+    bool ok = copy_host_range(job.extent->fd, job.extent->offset, len, out, &why)
+      && crc_host_range(job.extent->fd, job.extent->offset, len, &tape_crc, &why);
+    if (close(out) != 0 && ok)
+      {
+	why = strerror(errno);
+	ok = false;
+      }
+    if (!ok)
+      {
+	*error = job.body_file + ": " + why;
+	return false;
+      }
+    *crc = tape_crc.get();
+    return true;
+  }
+}  // namespace
+
+namespace DFS
+{
+  std::string extracted_file_name(const CatalogEntry& entry, char current_directory)
+  {
+    using DFS::stringutil::rtrim;
+    if (entry.directory() == current_directory)
+      return rtrim(entry.name());
+    return std::string(1, entry.directory()) + "." + rtrim(entry.name());
+  }
+
+  std::string inf_line(unsigned long crc, const CatalogEntry& entry)
+  {
+    unsigned long load_addr = sign_extend(entry.load_address());
+    unsigned long exec_addr = sign_extend(entry.exec_address());
+    std::ostringstream ss;
+    ss << std::hex << std::uppercase;
+    // The NEXT field is missing because our source is not tape.
+    using std::setw;
+    using std::setfill;
+    ss << entry.directory() << '.' << entry.name() << ' '
+       << setw(6) << setfill('0') << load_addr << " "
+       << setw(6) << setfill('0') << exec_addr << " "
+       << setw(6) << setfill('0') << entry.file_length() << " " // no sign-extend
+       << (entry.is_locked() ? "Locked " : "")
+       << "CRC=" << setw(4) << crc
+       << "\n";
+    return ss.str();
+  }
+
+  std::optional<Extraction> read_extraction(DataAccess& media, size_t index,
+					    const CatalogEntry& entry,
+					    const std::string& body_file,
+					    std::string& error)
+  {
+    Extraction job{index, entry, body_file, std::nullopt, {}};
+    const unsigned long len = entry.file_length();
+    const unsigned long sectors = (len + SECTOR_BYTES - 1) / SECTOR_BYTES;
+    if (sectors)
+      {
+	// When the whole body is a byte range of the image file, it
+	// can be copied from there when it is written.
+	std::optional<HostExtent> extent = media.host_extent(entry.start_sector(), sectors);
+	if (extent && extent->sectors == sectors)
+	  {
+	    job.extent = extent;
+	    return job;
+	  }
+      }
+    job.body.reserve(len);
+    if (!entry.visit_file_body_spans(media,
+				     [&job](const byte* begin, const byte* end)
+				     {
+				       job.body.insert(job.body.end(), begin, end);
+				       return true;
+				     },
+				     error))
+      return std::nullopt;
+    return job;
+  }
+
+  void write_extraction(const Extraction& job, ExtractionResult* result)
+  {
+    result->done = true;
+    if (job.extent)
+      {
+	unsigned long crc;
+	if (copy_extent(job, &crc, &result->error))
+	  create_inf_file(job.body_file + ".inf", crc, job.entry, &result->error);
+	return;
+      }
+    std::ofstream outfile(job.body_file, std::ofstream::out);
+    if (!outfile.good())
+      {
+	result->error = "unable to create file " + job.body_file + ": " + strerror(errno);
+	return;
+      }
+    TapeCRC crc;
+    crc.update(job.body.data(), job.body.data() + job.body.size());
+    outfile.write(reinterpret_cast<const char*>(job.body.data()), job.body.size());
+    outfile.close();
+    if (!outfile)
+      {
+	result->error = job.body_file + ": " + strerror(errno);
+	return;
+      }
+    create_inf_file(job.body_file + ".inf", crc.get(), job.entry, &result->error);
+  }
+}  // namespace DFS
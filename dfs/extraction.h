@@ -0,0 +1,75 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Extracting files (each with a .inf file) into a host directory.
+// This is shared by extract-files and extract-all.
+#ifndef INC_EXTRACTION_H
+#define INC_EXTRACTION_H 1
+
+#include <stddef.h>         // for size_t
+#include <optional>         // for optional
+#include <string>           // for string
+#include <vector>           // for vector
+
+#include "abstractio.h"     // for DataAccess, HostExtent
+#include "dfs_catalog.h"    // for CatalogEntry
+#include "dfstypes.h"       // for byte
+
+namespace DFS
+{
+  // One file to be written.
+  struct Extraction
+  {
+    size_t index;		// position in the catalog
+    CatalogEntry entry;
+    std::string body_file;
+    // Either the file body is stored in a host file and so can be
+    // copied directly from there (see copy_host_range), or we have
+    // read it into body.
+    std::optional<HostExtent> extent;
+    std::vector<byte> body;
+  };
+
+  // The outcome of writing one Extraction.  error is empty on success.
+  struct ExtractionResult
+  {
+    bool done = false;
+    std::string error;
+  };
+
+  // The name (within the destination directory) of the file into
+  // which entry is extracted.  Files in current_directory have no
+  // directory prefix.
+  std::string extracted_file_name(const CatalogEntry& entry, char current_directory);
+
+  // The contents of the .inf file for entry, whose body has the
+  // (tape) CRC crc.
+  std::string inf_line(unsigned long crc, const CatalogEntry& entry);
+
+  // Prepare to write entry (at position index in the catalog) to
+  // body_file.  This reads the file body from media unless it can
+  // later be copied directly from the image file.  Returns nullopt
+  // and sets error if the body cannot be read.
+  std::optional<Extraction> read_extraction(DataAccess& media, size_t index,
+					    const CatalogEntry& entry,
+					    const std::string& body_file,
+					    std::string& error);
+
+  // Write the body of a file and its .inf file.  This does not touch
+  // the disc image, so it is safe to call from a worker thread.
+  void write_extraction(const Extraction& job, ExtractionResult* result);
+}  // namespace DFS
+
+#endif
@@ -15,11 +15,54 @@
 //
 #include "hexdump.h"
 
-#include <iomanip>
-#include <cctype>
+#include <algorithm>		// for min
+#include <string>		// for string
 
-#include "cleanup.h"
+namespace
+{
+  // Lookup tables for formatting a byte: its two (upper case) hex
+  // digits, and the character shown for it in the right-hand column.
+  // Spaces and the characters for which isgraph() is true in the C
+  // locale are shown as themselves; everything else as '.'.
+  struct ByteTables
+  {
+    constexpr ByteTables()
+      : hex(), shown()
+    {
+      const char digits[] = "0123456789ABCDEF";
+      for (int b = 0; b < 256; ++b)
+	{
+	  hex[b][0] = digits[b >> 4];
+	  hex[b][1] = digits[b & 0x0F];
+	  shown[b] = (b >= 0x20 && b < 0x7F) ? static_cast<char>(b) : '.';
+	}
+    }
+
+    char hex[256][2];
+    char shown[256];
+  };
 
+  constexpr ByteTables tables;
+
+  // Output is assembled in a buffer and written out when it grows
+  // beyond this size.
+  constexpr size_t flush_threshold = 64 * 1024;
+
+  // Append pos in decimal, padded with zeroes to at least 6 digits.
+  void append_position(std::string* buf, size_t pos)
+  {
+    char digits[24];
+    char *p = digits + sizeof(digits);
+    do
+      {
+	*--p = static_cast<char>('0' + pos % 10);
+	pos /= 10;
+      } while (pos);
+    for (size_t width = digits + sizeof(digits) - p; width < 6; ++width)
+      buf->push_back('0');
+    buf->append(p, digits + sizeof(digits));
+  }
+}  // namespace
 
 namespace DFS
 {
@@ -27,51 +70,52 @@ namespace DFS
 bool hexdump_bytes(std::ostream& os, size_t pos, size_t stride,
 		   const DFS::byte* begin, const DFS::byte* end)
 {
-  ostream_flag_saver saver(os);
-  const DFS::byte *p;
   size_t len = end - begin;
+  // Each line is the position, then " XX" (or " **" after the end
+  // of the data) for each byte, then a space, the characters, and a
+  // newline.
+  const size_t body_len = 3 * stride + 1 + stride + 1;
+  std::string buf;
+  buf.reserve(std::min(flush_threshold, (len / stride + 1) * (body_len + 8)) + body_len + 24);
   while (len)
     {
-      os << std::setw(6) << std::setfill('0') << std::dec << pos << std::hex;
-      p = begin;
-      for (size_t i = 0; i < stride; ++i)
+      const size_t n = std::min(len, stride);
+      append_position(&buf, pos);
+      const size_t line_start = buf.size();
+      buf.resize(line_start + body_len);
+      char *out = &buf[line_start];
+      for (size_t i = 0; i < n; ++i)
 	{
-	  if (i < len)
-	    os << ' ' << std::setw(2) << std::setfill('0') << std::uppercase
-	       << unsigned(p[i]);
-	  else
-	    os << " **";
+	  const char* h = tables.hex[begin[i]];
+	  *out++ = ' ';
+	  *out++ = h[0];
+	  *out++ = h[1];
 	}
-      os << ' ';
-      p = begin;
-      for (size_t i = 0; i < stride; ++i)
+      for (size_t i = n; i < stride; ++i)
 	{
-	  char ch = '.';
-	  if (i < len)
-	    {
-	      ch = p[i];
-	    }
-	  // TODO: generate a test file which verifies that all the
-	  // members of the character set are correctly characterised as
-	  // being printed directly or as '.'.
-	  if (ch == ' ' || isgraph(ch))
-	    os << ch;
-	  else
-	    os << '.';
+	  *out++ = ' ';
+	  *out++ = '*';
+	  *out++ = '*';
 	}
-      os << '\n';
-      if (len >= stride)
+      *out++ = ' ';
+      for (size_t i = 0; i < n; ++i)
+	*out++ = tables.shown[begin[i]];
+      for (size_t i = n; i < stride; ++i)
+	*out++ = '.';
+      *out++ = '\n';
+      if (buf.size() >= flush_threshold)
 	{
-	  len -= stride;
-	  pos += stride;
-	  begin += stride;
-	}
-      else
-	{
-	  break;
+	  os.write(buf.data(), buf.size());
+	  buf.clear();
 	}
+      if (len < stride)
+	break;
+      len -= stride;
+      pos += stride;
+      begin += stride;
     }
-
+  if (!buf.empty())
+    os.write(buf.data(), buf.size());
   return true;
 }
 
@@ -0,0 +1,229 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "hostcopy.h"
+
+#include <errno.h>        // for errno, EINTR, EXDEV, ENOSYS, EINVAL, ...
+#include <string.h>       // for strerror
+#include <sys/mman.h>     // for mmap, munmap
+#include <sys/stat.h>     // for fstat, stat
+#include <sys/types.h>    // for off_t, ssize_t
+#include <unistd.h>       // for pread, write, sysconf
+#if defined(HAVE_SENDFILE)
+#include <sys/sendfile.h> // for sendfile
+#endif
+#include <algorithm>      // for min
+#include <vector>         // for vector
+
+#include "crc.h"          // for CRC16Base
+
+namespace
+{
+  // The size of the buffer used when the kernel can't do the copy
+  // for us.
+  constexpr unsigned long copy_buffer_size = 64 * 1024;
+
+  // Returns true if err indicates that a copy primitive isn't usable
+  // for this pair of files (as opposed to an I/O error), so that we
+  // should try the next method.
+  bool unsupported(int err)
+  {
+    return err == ENOSYS || err == EXDEV || err == EINVAL
+      || err == EOPNOTSUPP || err == EBADF;
+  }
+
+  bool write_all(int fd, const unsigned char* p, unsigned long len, std::string* error)
+  {
+    while (len)
+      {
+	const ssize_t n = write(fd, p, len);
+	if (n < 0)
+	  {
+	    if (errno == EINTR)
+	      continue;
+	    *error = strerror(errno);
+	    return false;
+	  }
+	p += n;
+	len -= static_cast<unsigned long>(n);
+      }
+    return true;
+  }
+
+  // Read exactly len bytes at offset.  Returns false and sets *error
+  // on error or premature EOF.
+  bool pread_all(int fd, unsigned char* p, unsigned long len, unsigned long offset,
+		 std::string* error)
+  {
+    while (len)
+      {
+	const ssize_t n = pread(fd, p, len, static_cast<off_t>(offset));
+	if (n < 0)
+	  {
+	    if (errno == EINTR)
+	      continue;
+	    *error = strerror(errno);
+	    return false;
+	  }
+	if (n == 0)
+	  {
+	    *error = "unexpected end of file";
+	    return false;
+	  }
+	p += n;
+	offset += static_cast<unsigned long>(n);
+	len -= static_cast<unsigned long>(n);
+      }
+    return true;
+  }
+}  // namespace
+
+namespace DFS
+{
+  bool copy_host_range(int in_fd, unsigned long offset, unsigned long len,
+		       int out_fd, std::string* error)
+  {
+#if defined(HAVE_COPY_FILE_RANGE)
+    while (len)
+      {
+	loff_t in_pos = static_cast<loff_t>(offset);
+	const ssize_t n = copy_file_range(in_fd, &in_pos, out_fd, NULL, len, 0);
+	if (n < 0)
+	  {
+	    if (errno == EINTR)
+	      continue;
+	    if (unsupported(errno))
+	      break;
+	    *error = strerror(errno);
+	    return false;
+	  }
+	if (n == 0)
+	  {
+	    *error = "unexpected end of file";
+	    return false;
+	  }
+	offset += static_cast<unsigned long>(n);
+	len -= static_cast<unsigned long>(n);
+      }
+#endif
+#if defined(HAVE_SENDFILE)
+    while (len)
+      {
+	off_t in_pos = static_cast<off_t>(offset);
+	const ssize_t n = sendfile(out_fd, in_fd, &in_pos, len);
+	if (n < 0)
+	  {
+	    if (errno == EINTR)
+	      continue;
+	    if (unsupported(errno))
+	      break;
+	    *error = strerror(errno);
+	    return false;
+	  }
+	if (n == 0)
+	  {
+	    *error = "unexpected end of file";
+	    return false;
+	  }
+	offset += static_cast<unsigned long>(n);
+	len -= static_cast<unsigned long>(n);
+      }
+#endif
+    if (len)
+      {
+	std::vector<unsigned char> buf(std::min(len, copy_buffer_size));
+	while (len)
+	  {
+	    const unsigned long chunk = std::min(len, copy_buffer_size);
+	    if (!pread_all(in_fd, buf.data(), chunk, offset, error))
+	      return false;
+	    if (!write_all(out_fd, buf.data(), chunk, error))
+	      return false;
+	    offset += chunk;
+	    len -= chunk;
+	  }
+      }
+    return true;
+  }
+
+  bool crc_host_range(int fd, unsigned long offset, unsigned long len,
+		      CRC16Base* crc, std::string* error)
+  {
+    if (0 == len)
+      return true;
+    // Touching a mapped page beyond the end of the file raises
+    // SIGBUS, so only map the range if the file is long enough to
+    // hold all of it.  Otherwise pread_all() below reports the short
+    // file.
+    struct stat st;
+    const bool whole_range_in_file = fstat(fd, &st) == 0 && st.st_size >= 0
+      && offset + len <= static_cast<unsigned long>(st.st_size);
+    // mmap needs a page-aligned file offset.
+    const long page_size = sysconf(_SC_PAGESIZE);
+    const unsigned long skip = page_size > 0 ? offset % static_cast<unsigned long>(page_size) : 0;
+    void *mapped = whole_range_in_file
+      ? mmap(NULL, len + skip, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset - skip))
+      : MAP_FAILED;
+    if (mapped != MAP_FAILED)
+      {
+	const unsigned char* p = static_cast<const unsigned char*>(mapped) + skip;
+	crc->update(p, p + len);
+	munmap(mapped, len + skip);
+	return true;
+      }
+    std::vector<unsigned char> buf(std::min(len, copy_buffer_size));
+    while (len)
+      {
+	const unsigned long chunk = std::min(len, copy_buffer_size);
+	if (!pread_all(fd, buf.data(), chunk, offset, error))
+	  return false;
+	crc->update(buf.data(), buf.data() + chunk);
+	offset += chunk;
+	len -= chunk;
+      }
+    return true;
+  }
+
+  bool copy_sectors(DataAccess& media, unsigned long begin, unsigned long end,
+		    int out_fd, unsigned long* copied, std::string* error)
+  {
+    *copied = 0;
+    std::vector<unsigned char> buf;
+    for (unsigned long sec = begin; sec < end; /* empty */)
+      {
+	if (std::optional<HostExtent> extent = media.host_extent(sec, end - sec))
+	  {
+	    if (!copy_host_range(extent->fd, extent->offset,
+				 extent->sectors * SECTOR_BYTES, out_fd, error))
+	      return false;
+	    sec += extent->sectors;
+	    *copied += extent->sectors;
+	    continue;
+	  }
+	// No host extent for this sector, so read it (and any
+	// following sectors which also lack one) the slow way.
+	if (buf.empty())
+	  buf.resize(SECTOR_BYTES);
+	const unsigned long got = media.read_blocks(sec, 1, buf.data());
+	if (got == 0)
+	  return true;		// unreadable sector.
+	if (!write_all(out_fd, buf.data(), SECTOR_BYTES, error))
+	  return false;
+	++sec;
+	++*copied;
+      }
+    return true;
+  }
+}  // namespace DFS
@@ -0,0 +1,53 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Copying data directly between host files, for when the data we want
+// to extract from a disc image is a plain byte range of the image file.
+#ifndef INC_HOSTCOPY_H
+#define INC_HOSTCOPY_H 1
+
+#include <string>        // for string
+
+#include "abstractio.h"  // for DataAccess
+
+namespace DFS
+{
+  class CRC16Base;
+
+  // Copy len bytes, starting at byte offset in in_fd, to the current
+  // position of out_fd.  The kernel is asked to do the copy (using
+  // copy_file_range or sendfile) where possible, so that the data
+  // doesn't pass through our buffers; otherwise it is copied with
+  // read and write.  Both descriptors must refer to regular files.  On
+  // failure, returns false and sets *error.
+  bool copy_host_range(int in_fd, unsigned long offset, unsigned long len,
+		       int out_fd, std::string* error);
+
+  // Feed len bytes, starting at byte offset in fd, to crc.  The data
+  // is examined through a memory mapping where possible.  On failure,
+  // returns false and sets *error.
+  bool crc_host_range(int fd, unsigned long offset, unsigned long len,
+		      CRC16Base* crc, std::string* error);
+
+  // Copy sectors [begin, end) of media to out_fd, using host extents
+  // where media can provide them and read_blocks() otherwise.  The
+  // number of sectors copied is stored in *copied; this is less than
+  // end-begin if a sector could not be read.  On a write failure,
+  // returns false and sets *error.
+  bool copy_sectors(DataAccess& media, unsigned long begin, unsigned long end,
+		    int out_fd, unsigned long* copied, std::string* error);
+}  // namespace DFS
+
+#endif
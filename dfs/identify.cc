@@ -31,11 +31,10 @@
 
 #include "abstractio.h"      // for SectorBuffer, DataAccess
 #include "cleanup.h"         // for ostream_flag_saver
-#include "dfs.h"             // for verbose
+#include "dfs.h"             // for verbose, diagnostics
 #include "dfs_catalog.h"     // for operator<<, CatalogFragment, Catalog
 #include "dfs_format.h"      // for Format, Format::OpusDDOS, Format::DFS
 #include "dfs_volume.h"      // for Volume
-#include "exceptions.h"      // for BadFileSystem, FailedToGuessFormat
 #include "fsp.h"	     // for ParsedFileName
 #include "opus_cat.h"        // for OpusDiscCatalogue::VolumeLocation, ...
 #include "stringutil.h"      // for ends_with
@@ -46,7 +45,7 @@ namespace
   {
     if (!DFS::verbose)
       return;
-    std::cerr << "Eliminated geometry " << g.description()
+    DFS::diagnostics() << "Eliminated geometry " << g.description()
 	      << " because " << reason << "\n";
   }
 
@@ -54,7 +53,7 @@ namespace
   {
     if (!DFS::verbose)
       return;
-    std::cerr << "Eliminated file format " << ff.description()
+    DFS::diagnostics() << "Eliminated file format " << ff.description()
 	      << " because " << reason << "\n";
   }
 
@@ -62,7 +61,7 @@ namespace
   {
     if (!DFS::verbose)
       return;
-    std::cerr << "Eliminated file system format " << format_name(df)
+    DFS::diagnostics() << "Eliminated file system format " << format_name(df)
 	      << " because " << reason << "\n";
   }
 
@@ -80,12 +79,12 @@ namespace
     if (!DFS::verbose)
       return;
     int i = 1;
-    ostream_flag_saver restore_cerr_flags(std::cerr);
-    std::cerr << intro << " (total number of possibilities is "
+    ostream_flag_saver restore_diagnostic_flags(DFS::diagnostics());
+    DFS::diagnostics() << intro << " (total number of possibilities is "
 	      << candidates.size() << ")\n";
     for (const auto& cand : candidates)
       {
-	std::cerr << std::setfill(' ') << std::setw(2) << std::dec << std::right
+	DFS::diagnostics() << std::setfill(' ') << std::setw(2) << std::dec << std::right
 		  << i++ << ". " << cand.description() << "\n";
       }
   }
@@ -123,7 +122,7 @@ namespace
       {
 	if (DFS::verbose)
 	  {
-	    std::cerr << "catalog fragment is valid: " << f << "\n";
+	    DFS::diagnostics() << "catalog fragment is valid: " << f << "\n";
 	  }
       }
     return valid;
@@ -228,23 +227,22 @@ namespace DFS
     // additional catalogs in track 0.  If any appear (from sector 16)
     // to be present but are not in fact valid then this is not a
     // valid Opus DDOS image.
-    std::vector<DFS::internal::OpusDiscCatalogue::VolumeLocation> locations;
-    try
-      {
-	// The OpusDiscCatalogue constructor validates track numbers
-	// against the optional geompetry argument which we are not
-	// passing.  However, sector 16 also records the total sectors
-	// and the sectors per track, so we can cross check the data
-	// in the volume catalog for self-consistency even without
-	// knowing the geometry.
-	DFS::internal::OpusDiscCatalogue opus_disc_cat(sector16, std::nullopt);
-	locations = opus_disc_cat.get_volume_locations();
-      }
-    catch (BadFileSystem& e)
-      {
-	eliminated_format(DFS::Format::OpusDDOS, e.what());
+    // The OpusDiscCatalogue constructor validates track numbers
+    // against the optional geompetry argument which we are not
+    // passing.  However, sector 16 also records the total sectors
+    // and the sectors per track, so we can cross check the data in
+    // the volume catalog for self-consistency even without knowing
+    // the geometry.
+    std::string error;
+    std::optional<DFS::internal::OpusDiscCatalogue> opus_disc_cat =
+      DFS::internal::OpusDiscCatalogue::parse(sector16, std::nullopt, error);
+    if (!opus_disc_cat)
+      {
+	eliminated_format(DFS::Format::OpusDDOS, error);
 	return false;
       }
+    const std::vector<DFS::internal::OpusDiscCatalogue::VolumeLocation> locations =
+      opus_disc_cat->get_volume_locations();
 
     if (locations.empty())
       {
@@ -254,7 +252,7 @@ namespace DFS
       }
     if (DFS::verbose)
       {
-	std::cerr << "verifying " << locations.size() << " possible Opus subvolumes...\n";
+	DFS::diagnostics() << "verifying " << locations.size() << " possible Opus subvolumes...\n";
       }
     for (const auto& loc : locations)
       {
@@ -262,7 +260,7 @@ namespace DFS
 	// are not listed as present (start track > 0) in the catalog.
 	assert(loc.start_sector() > 17);
 	if (DFS::verbose)
-	  std::cerr << "subvolume " << loc.volume()
+	  DFS::diagnostics() << "subvolume " << loc.volume()
 		    << " starts at sector " << loc.start_sector() << "\n";
 
 	DFS::Volume vol(DFS::Format::OpusDDOS, loc.catalog_location(),
@@ -278,7 +276,7 @@ namespace DFS
 	  }
 	if (DFS::verbose)
 	  {
-	    std::cerr << "Opus volume " << loc.volume() << " is valid.\n";
+	    DFS::diagnostics() << "Opus volume " << loc.volume() << " is valid.\n";
 	  }
       }
 
@@ -363,10 +361,11 @@ namespace DFS
   }
 
 
-  DFS::ImageFileFormat
+  std::optional<DFS::ImageFileFormat>
   probe_geometry(DFS::DataAccess& media,
 		 DFS::Format fmt, DFS::sector_count_type total_sectors,
-		 const std::vector<DFS::ImageFileFormat>& candidates)
+		 const std::vector<DFS::ImageFileFormat>& candidates,
+		 std::string& error)
   {
     show_possible("probe_geometry initial possibilities", candidates);
     auto large_enough =
@@ -395,8 +394,8 @@ namespace DFS
 	  {
 	    if (DFS::verbose)
 	      {
-		ostream_flag_saver restore_cerr_flags(std::cerr);
-		std::cerr << std::dec
+		ostream_flag_saver restore_diagnostic_flags(DFS::diagnostics());
+		DFS::diagnostics() << std::dec
 			  << "Candidate format " << ff.description()
 			  << " has " << available_sectors << " available sectors "
 			  << "for a " << sides_desc << " filesystem and so "
@@ -481,11 +480,12 @@ namespace DFS
     auto it = std::min_element(possible.cbegin(), possible.cend(), compare_formats);
     if (it == possible.cend())
       {
-	throw DFS::FailedToGuessFormat("all known formats have been eliminated");
+	error = "all known formats have been eliminated";
+	return std::nullopt;
       }
     if (DFS::verbose)
       {
-	std::cerr << "Selected the "
+	DFS::diagnostics() << "Selected the "
 		  << (possible.size() == 1 ? "only" : "smallest")
 		  << " remaining format: "
 		  << it->description() << "\n";
@@ -547,23 +547,20 @@ namespace DFS
     std::tie(fmt, total_sectors) = *fmt_probe_result;
     if (DFS::verbose)
       {
-	ostream_flag_saver restore_cerr_flags(std::cerr);
-	std::cerr << "File system format appears to be " << format_name(fmt)
+	ostream_flag_saver restore_diagnostic_flags(DFS::diagnostics());
+	DFS::diagnostics() << "File system format appears to be " << format_name(fmt)
 		  << " occupying " << std::dec << total_sectors
 		  << " sectors.\n";
       }
-    try
-      {
-	DFS::ImageFileFormat ff = probe_geometry(access, fmt, total_sectors, candidates);
-	return std::make_pair(fmt, ff);
-      }
-    catch (std::exception& e)
+    std::string geometry_error;
+    std::optional<DFS::ImageFileFormat> ff =
+      probe_geometry(access, fmt, total_sectors, candidates, geometry_error);
+    if (!ff)
       {
-	std::ostringstream ss;
-	ss << "failed to guess geometry of disc in image file: " << e.what();
-	error = ss.str();
+	error = "failed to guess geometry of disc in image file: " + geometry_error;
 	return std::nullopt;
       }
+    return std::make_pair(fmt, *ff);
   }
 
   std::vector<DFS::sector_count_type> sectors_per_track_options(DFS::Encoding e)
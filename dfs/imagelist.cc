@@ -0,0 +1,270 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "imagelist.h"
+
+#include <dirent.h>         // for opendir, readdir, closedir, dirent
+#include <errno.h>          // for errno
+#include <glob.h>           // for glob, globfree, GLOB_NOMATCH
+#include <stddef.h>         // for size_t
+#include <string.h>         // for strerror
+#include <sys/stat.h>       // for stat, lstat, S_ISDIR
+#include <algorithm>        // for sort
+#include <exception>        // for exception
+#include <fstream>          // for ifstream
+#include <iostream>         // for cin, operator<<, basic_ostream
+#include <memory>           // for unique_ptr
+#include <mutex>            // for mutex, lock_guard
+#include <sstream>          // for ostringstream, istringstream
+
+#include "cleanup.h"        // for cleanup
+#include "commands.h"       // for run_command
+#include "dfs.h"            // for set_thread_diagnostic_stream
+#include "dfscontext.h"     // for DFSContext
+#include "media.h"          // for AbstractImageFile, make_image_file, is_image_file_name
+#include "stringutil.h"     // for ends_with
+#include "workqueue.h"      // for run_largest_first
+
+namespace
+{
+  bool list_directory(const std::string& dir, std::vector<std::string>* names,
+		      std::string* error)
+  {
+    DIR* d = opendir(dir.c_str());
+    if (d == NULL)
+      {
+	*error = dir + ": " + strerror(errno);
+	return false;
+      }
+    cleanup close_dir([d]() { closedir(d); });
+    std::vector<std::string> entries;
+    while (struct dirent* e = readdir(d))
+      {
+	const std::string name(e->d_name);
+	if (name != "." && name != "..")
+	  entries.push_back(name);
+      }
+    std::sort(entries.begin(), entries.end());
+    const std::string prefix(dir.back() == '/' ? dir : dir + "/");
+    for (const std::string& entry : entries)
+      {
+	const std::string path(prefix + entry);
+	struct stat st;
+	// We don't follow symbolic links to directories, to avoid loops.
+	if (lstat(path.c_str(), &st) != 0)
+	  {
+	    *error = path + ": " + strerror(errno);
+	    return false;
+	  }
+	if (S_ISDIR(st.st_mode))
+	  {
+	    if (!list_directory(path, names, error))
+	      return false;
+	  }
+	else if (DFS::is_image_file_name(path))
+	  {
+	    names->push_back(path);
+	  }
+      }
+    return true;
+  }
+
+  std::string without_trailing_newline(std::string s)
+  {
+    while (!s.empty() && s.back() == '\n')
+      s.pop_back();
+    return s;
+  }
+
+  bool run_on_image(const std::string& name, DFS::DriveAllocation how,
+		    const DFS::DFSContext& ctx, const std::vector<std::string>& args)
+  {
+    std::unique_ptr<DFS::AbstractImageFile> file;
+    DFS::StorageConfiguration storage; // must be declared after file.
+    try
+      {
+	std::string error;
+	file = DFS::make_image_file(name, error);
+	if (!file || !file->connect_drives(&storage, how, error))
+	  {
+	    ctx.err() << without_trailing_newline(error) << "\n";
+	    return false;
+	  }
+      }
+    catch (std::exception& e)
+      {
+	ctx.err() << "cannot use image file: " << e.what() << "\n";
+	return false;
+      }
+    return DFS::run_command(storage, ctx, args);
+  }
+
+  struct ImageResult
+  {
+    bool done = false;
+    bool ok = false;
+    std::string out;
+    std::string err;
+  };
+}  // namespace
+
+namespace DFS
+{
+  bool expand_image_spec(const std::string& spec, std::vector<std::string>* names,
+			 std::string* error)
+  {
+    struct stat st;
+    if (stat(spec.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+      {
+	const size_t before = names->size();
+	if (!list_directory(spec, names, error))
+	  return false;
+	if (names->size() == before)
+	  {
+	    *error = "there are no disc images in " + spec;
+	    return false;
+	  }
+	return true;
+      }
+    glob_t matches;
+    const int result = glob(spec.c_str(), 0, NULL, &matches);
+    cleanup free_matches([&matches]() { globfree(&matches); });
+    if (result == GLOB_NOMATCH)
+      {
+	*error = "no files match " + spec;
+	return false;
+      }
+    if (result != 0)
+      {
+	*error = "failed to expand " + spec;
+	return false;
+      }
+    for (size_t i = 0; i < matches.gl_pathc; ++i)
+      names->push_back(matches.gl_pathv[i]);
+    return true;
+  }
+
+  bool read_image_list(const std::string& list_file, std::vector<std::string>* names,
+		       std::string* error)
+  {
+    std::ifstream f;
+    if (list_file != "-")
+      {
+	f.open(list_file);
+	if (!f)
+	  {
+	    *error = list_file + ": " + strerror(errno);
+	    return false;
+	  }
+      }
+    std::istream& in(list_file == "-" ? std::cin : f);
+    const size_t before = names->size();
+    std::string line;
+    while (std::getline(in, line))
+      {
+	if (!line.empty())
+	  names->push_back(line);
+      }
+    if (in.bad())
+      {
+	*error = list_file + ": " + strerror(errno);
+	return false;
+      }
+    if (names->size() == before)
+      {
+	// As for a --images pattern which matches nothing.
+	*error = (list_file == "-" ? std::string("standard input") : list_file)
+	  + ": no image files are listed";
+	return false;
+      }
+    return true;
+  }
+
+  unsigned long image_cost(const std::string& name)
+  {
+    struct stat st;
+    unsigned long cost = 1;
+    if (stat(name.c_str(), &st) == 0)
+      cost += static_cast<unsigned long>(st.st_size);
+    // These factors are rough.  Decompressing an image takes several
+    // times longer than reading it, and decoding the bit stream of an
+    // HFE or MFM file several times longer again.
+    std::string base(name);
+    if (stringutil::ends_with(base, ".gz"))
+      {
+	cost *= 4;
+	base.resize(base.size() - 3);
+      }
+    if (stringutil::ends_with(base, ".hfe") || stringutil::ends_with(base, ".mfm"))
+      cost *= 8;
+    return cost;
+  }
+
+  bool run_for_each_image(const std::vector<std::string>& images, DriveAllocation how,
+			  const DFSContext& ctx, const std::vector<std::string>& args,
+			  unsigned int jobs)
+  {
+    std::vector<unsigned long> costs;
+    costs.reserve(images.size());
+    for (const std::string& name : images)
+      costs.push_back(image_cost(name));
+
+    // Results are printed in the order of images, as soon as all
+    // the earlier ones have been printed.
+    std::vector<ImageResult> results(images.size());
+    std::mutex results_mu;
+    size_t next_to_print = 0;
+    bool all_ok = true;
+    auto print_ready = [&]()
+		       {
+			 for (; next_to_print < results.size() && results[next_to_print].done;
+			      ++next_to_print)
+			   {
+			     ImageResult& r(results[next_to_print]);
+			     const std::string& name(images[next_to_print]);
+			     if (next_to_print)
+			       ctx.out() << "\n";
+			     ctx.out() << "==> " << name << " <==\n" << r.out;
+			     ctx.out().flush();
+			     std::istringstream errors(r.err);
+			     std::string line;
+			     while (std::getline(errors, line))
+			       ctx.err() << name << ": " << line << "\n";
+			     if (!r.ok)
+			       all_ok = false;
+			     // Release the memory, since there may be many images.
+			     std::string().swap(r.out);
+			     std::string().swap(r.err);
+			   }
+		       };
+    run_largest_first(costs, jobs,
+		      [&](size_t i)
+		      {
+			std::ostringstream out, err;
+			DFSContext image_ctx(ctx);
+			image_ctx.redirect_output(&out, &err);
+			// Diagnostics about this image are reported with its
+			// errors, rather than interleaved with those of the
+			// images being read by other threads.
+			std::ostream* saved = set_thread_diagnostic_stream(&err);
+			cleanup restore([saved]() { set_thread_diagnostic_stream(saved); });
+			const bool ok = run_on_image(images[i], how, image_ctx, args);
+			std::lock_guard<std::mutex> lock(results_mu);
+			results[i] = ImageResult{true, ok, out.str(), err.str()};
+			print_ready();
+		      });
+    return all_ok;
+  }
+}  // namespace DFS
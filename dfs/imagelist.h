@@ -0,0 +1,61 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Running a command once for each of a list of disc images (the
+// --files-from and --images options).
+#ifndef INC_IMAGELIST_H
+#define INC_IMAGELIST_H 1
+
+#include <string>           // for string
+#include <vector>           // for vector
+
+#include "storage.h"        // for DriveAllocation
+
+namespace DFS
+{
+  struct DFSContext;
+
+  // Append to *names the image files named by spec.  If spec is a
+  // directory, these are the files within it (or within its
+  // subdirectories) whose names have the extension of a disc image,
+  // in sorted order.  Otherwise spec is a glob pattern (which may
+  // simply be the name of a file).  On failure, or if nothing
+  // matches, returns false and sets *error.
+  bool expand_image_spec(const std::string& spec, std::vector<std::string>* names,
+			 std::string* error);
+
+  // Append to *names the image file names listed (one per line) in
+  // list_file, or in the standard input if list_file is "-".  Blank
+  // lines are ignored.  On failure (including when no names are
+  // listed), returns false and sets *error.
+  bool read_image_list(const std::string& list_file, std::vector<std::string>* names,
+		       std::string* error);
+
+  // An estimate of the relative cost of reading the image file
+  // name, based on its size and type.
+  unsigned long image_cost(const std::string& name);
+
+  // Run the command args once for each of images, on its own (as if
+  // it were the only --file option), using up to jobs threads.  The
+  // output for each image is written to ctx.out() after a line
+  // "==> NAME <==", in the order of images.  Error messages are
+  // written to ctx.err(), each prefixed by the image name.  Returns
+  // true if the command succeeded for every image.
+  bool run_for_each_image(const std::vector<std::string>& images, DriveAllocation how,
+			  const DFSContext& ctx, const std::vector<std::string>& args,
+			  unsigned int jobs);
+}  // namespace DFS
+
+#endif
@@ -15,8 +15,11 @@
 //
 #include "img_fileio.h"
 
-#include <errno.h>       // for errno
-#include <iostream>      // for cerr
+#include <errno.h>       // for errno, EINTR
+#include <fcntl.h>       // for open, O_RDONLY, O_CLOEXEC
+#include <sys/stat.h>    // for fstat, S_ISREG
+#include <unistd.h>      // for pread, close
+#include <algorithm>     // for copy, min
 #include "dfs.h"         // for safe_unsigned_multiply
 #include "exceptions.h"  // for FileIOError
 
@@ -26,10 +29,45 @@ namespace DFS
   {
   }
 
+  unsigned long DataAccess::read_blocks(unsigned long lba, unsigned long count, byte* out)
+  {
+    unsigned long done;
+    for (done = 0; done < count; ++done)
+      {
+	std::optional<SectorBuffer> buf = read_block(lba + done);
+	if (!buf)
+	  break;
+	std::copy(buf->begin(), buf->end(), out + done * SECTOR_BYTES);
+      }
+    return done;
+  }
+
+  std::optional<HostExtent> DataAccess::host_extent(unsigned long, unsigned long)
+  {
+    return std::nullopt;
+  }
+
+  std::optional<SectorLayout> DataAccess::sector_layout()
+  {
+    return std::nullopt;
+  }
+
   FileAccess::~FileAccess()
   {
   }
 
+  unsigned long FileAccess::read_into(unsigned long offset, unsigned long len, byte* out)
+  {
+    const std::vector<byte> got = read(offset, len);
+    std::copy(got.begin(), got.end(), out);
+    return got.size();
+  }
+
+  std::optional<std::pair<int, unsigned long>> FileAccess::host_file() const
+  {
+    return std::nullopt;
+  }
+
   namespace internal
   {
     class NoIo : public DFS::DataAccess
@@ -52,59 +90,59 @@ namespace DFS
     NoIo no_io;
 
     OsFile::OsFile(const std::string& name)
-      : file_name_(name), f_(name, std::ifstream::binary)
+      : file_name_(name), fd_(open(name.c_str(), O_RDONLY|O_CLOEXEC))
     {
-      if (f_.fail())
-	{
-	  // failbit is set if f_ could not be opened.
-	  throw DFS::FileIOError(name, errno);
-	}
-      f_.exceptions(std::ifstream::badbit);
+      if (fd_ < 0)
+	throw DFS::FileIOError(name, errno);
+    }
+
+    OsFile::~OsFile()
+    {
+      close(fd_);
     }
 
     std::vector<byte> OsFile::read(unsigned long pos, unsigned long len)
     {
-      if (!f_)
-	{
-	  std::cerr << "OsFile::read: BUG? called on failed/bad file "
-		    << file_name_ << "\n";
-	}
-      errno = 0;
-      std::vector<byte> buf;
-      if (!f_.seekg(pos, f_.beg))
-	{
-	  int saved_errno = errno;
-	  std::cerr << "OsFile::read: failed to seek to position "
-		    << pos << " in file " << file_name_ << "; errno="
-		    << saved_errno << "\n";
-	  f_.clear();
-	  if (saved_errno)
-	    throw DFS::FileIOError(file_name_, errno);
-	  else
-	    return buf;
-	}
-      buf.resize(len);
-      f_.read(reinterpret_cast<char*>(buf.data()), len);
-      buf.resize(f_.gcount());
-      if (!f_.good())
+      std::vector<byte> buf(len);
+      buf.resize(read_into(pos, len, buf.data()));
+      return buf;
+    }
+
+    unsigned long OsFile::read_into(unsigned long pos, unsigned long len, byte* out)
+    {
+      // We use pread() so that there is no shared file position, and
+      // so reads from different threads cannot interfere.
+      unsigned long done = 0;
+      while (done < len)
 	{
-	  const int saved_errno = errno;
-	  // POSIX permits a seek beyond end-of-file (at least for
-	  // read/write files), so if pos was larger than the file
-	  // size, we may come to here rather than fail the seekg()
-	  // call.  However, it's also not a failure to read beyond
-	  // EOF, so reading from beyond EOF just returns zero bytes.
-	  f_.clear();
-	  if (errno)
-	    throw DFS::FileIOError(file_name_, saved_errno); // a real error
-	  else
-	    return buf;		// short read
+	  const ssize_t n = pread(fd_, out + done, len - done,
+				  static_cast<off_t>(pos + done));
+	  if (n < 0)
+	    {
+	      if (errno == EINTR)
+		continue;
+	      throw DFS::FileIOError(file_name_, errno);
+	    }
+	  if (n == 0)
+	    break;		// EOF; reading beyond it is not an error.
+	  done += static_cast<unsigned long>(n);
 	}
-      return buf;
+      return done;
+    }
+
+    std::optional<std::pair<int, unsigned long>> OsFile::host_file() const
+    {
+      struct stat st;
+      if (fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode))
+	return std::nullopt;
+      return std::make_pair(fd_, static_cast<unsigned long>(st.st_size));
+    }
+
+    ViewDescriber::~ViewDescriber()
+    {
     }
 
     FileView::FileView(DataAccess& media,
-		       const std::string& file_name,
 		       // The geometry parameter describes this device, not all
 		       // the devices in the file.  For example if an image
 		       // contains two sides each having a seprate file system,
@@ -115,7 +153,7 @@ namespace DFS
 		       sector_count_type take,
 		       sector_count_type leave,
 		       sector_count_type total)
-      : media_(media), file_name_(file_name), description_(description),
+      : media_(media), describer_(nullptr), index_(0), description_(description),
 	geometry_(geometry),
 	initial_skip_(initial_skip), take_(take), leave_(leave), total_(total)
     {
@@ -123,6 +161,20 @@ namespace DFS
       // Hence that is valid.
     }
 
+    FileView::FileView(DataAccess& media,
+		       const ViewDescriber& describer,
+		       unsigned int index,
+		       const DFS::Geometry& geometry,
+		       unsigned long initial_skip,
+		       sector_count_type take,
+		       sector_count_type leave,
+		       sector_count_type total)
+      : media_(media), describer_(&describer), index_(index),
+	geometry_(geometry),
+	initial_skip_(initial_skip), take_(take), leave_(leave), total_(total)
+    {
+    }
+
     FileView::~FileView()
     {
     }
@@ -134,6 +186,8 @@ namespace DFS
 
     std::string FileView::description() const
     {
+      if (describer_)
+	return describer_->describe_view(index_);
       return description_;
     }
 
@@ -201,17 +255,77 @@ namespace DFS
     }
 
 
+    unsigned long FileView::read_blocks(unsigned long sector, unsigned long count, byte* out)
+    {
+      if (0 == take_)
+	return 0;		// Device is unformatted.
+      unsigned long done = 0;
+      while (done < count && sector + done < total_)
+	{
+	  // Within a group of take_ sectors, the sectors are contiguous
+	  // in the underlying media, so we can read the rest of the
+	  // group in one go.  See read_block() for the layout.
+	  const unsigned long x = sector + done;
+	  const unsigned long pos =
+	    initial_skip_ +
+	    safe_unsigned_multiply(x / take_, static_cast<unsigned long>(take_) + leave_) +
+	    x % take_;
+	  const unsigned long run = std::min({count - done,
+					      take_ - x % take_,
+					      total_ - x});
+	  const unsigned long got = media_.read_blocks(pos, run, out + done * SECTOR_BYTES);
+	  done += got;
+	  if (got < run)
+	    break;
+	}
+      return done;
+    }
+
+    std::optional<HostExtent> FileView::host_extent(unsigned long sector, unsigned long count)
+    {
+      if (0 == take_ || sector >= total_ || 0 == count)
+	return std::nullopt;
+      // Only sectors in the same group of take_ sectors are contiguous.
+      const unsigned long pos =
+	initial_skip_ +
+	safe_unsigned_multiply(sector / take_, static_cast<unsigned long>(take_) + leave_) +
+	sector % take_;
+      const unsigned long run = std::min({count,
+					  take_ - sector % take_,
+					  total_ - sector});
+      return media_.host_extent(pos, run);
+    }
+
+    std::optional<SectorLayout> FileView::sector_layout()
+    {
+      if (0 == take_)
+	return std::nullopt;	// Device is unformatted.
+      // We can only describe the layout if the underlying media maps
+      // sectors straight onto the file.
+      std::optional<SectorLayout> media = media_.sector_layout();
+      if (!media || media->origin != 0 || media->skip != 0 || media->leave != 0)
+	return std::nullopt;
+      return SectorLayout{media->file, 0, std::min<unsigned long>(total_, media->limit),
+			  initial_skip_, take_, leave_};
+    }
+
     bool FileView::is_formatted() const
     {
       return take_ != 0;
     }
 
-    FileView FileView::unformatted_device(const std::string& file_name,
-					  const std::string& description,
+    FileView FileView::unformatted_device(const std::string& description,
 					  const DFS::Geometry& geometry)
     {
       // setting take=0 signals that I/O to the device is impossible.
-      return FileView(no_io, file_name, description, geometry, 0, 0, 1, 1);
+      return FileView(no_io, description, geometry, 0, 0, 1, 1);
+    }
+
+    FileView FileView::unformatted_device(const ViewDescriber& describer,
+					  unsigned int index,
+					  const DFS::Geometry& geometry)
+    {
+      return FileView(no_io, describer, index, geometry, 0, 0, 1, 1);
     }
 
 
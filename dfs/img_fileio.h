@@ -16,12 +16,12 @@
 #ifndef INC_FILEIO_H
 #define INC_FILEIO_H 1
 
-#include <fstream>       // for ifstream
 #include <optional>      // for optional
 #include <string>        // for string
+#include <utility>       // for pair
 #include <vector>        // for vector
 
-#include "abstractio.h"  // for FileAccess, SectorBuffer
+#include "abstractio.h"  // for FileAccess, SectorBuffer, HostExtent, SectorLayout
 #include "dfstypes.h"    // for sector_count_type, byte
 #include "geometry.h"    // for Geometry
 #include "storage.h"     // for AbstractDrive
@@ -34,18 +34,33 @@ namespace DFS
     {
     public:
       OsFile(const std::string& name);
+      ~OsFile() override;
       std::vector<byte> read(unsigned long offset, unsigned long len) override;
+      unsigned long read_into(unsigned long offset, unsigned long len, byte* out) override;
+      std::optional<std::pair<int, unsigned long>> host_file() const override;
+
+      OsFile(const OsFile&) = delete;
+      OsFile& operator=(const OsFile&) = delete;
 
     private:
       std::string file_name_;
-      std::ifstream f_;
+      int fd_;
+    };
+
+    // An image file holding many views (such as an MMB file) can
+    // describe them on demand, so that each view need not hold a copy
+    // of its description.
+    class ViewDescriber
+    {
+    public:
+      virtual ~ViewDescriber();
+      virtual std::string describe_view(unsigned int index) const = 0;
     };
 
     class FileView : public DFS::AbstractDrive
     {
     public:
       FileView(DataAccess& media,
-	       const std::string& file_name,
 	       // The geometry parameter describes this device, not all
 	       // the devices in the file.  For example if an image
 	       // contains two sides each having a seprate file system,
@@ -56,8 +71,20 @@ namespace DFS
 	       sector_count_type take,
 	       sector_count_type leave,
 	       sector_count_type total);
-      static FileView unformatted_device(const std::string& file_name,
-					 const std::string& description,
+      // As above, but the description is the one describer gives for
+      // view number index, which is only worked out when needed.
+      FileView(DataAccess& media,
+	       const ViewDescriber& describer,
+	       unsigned int index,
+	       const DFS::Geometry& geometry,
+	       unsigned long initial_skip,
+	       sector_count_type take,
+	       sector_count_type leave,
+	       sector_count_type total);
+      static FileView unformatted_device(const std::string& description,
+					 const DFS::Geometry& geometry);
+      static FileView unformatted_device(const ViewDescriber& describer,
+					 unsigned int index,
 					 const DFS::Geometry& geometry);
       bool is_formatted() const;
 
@@ -68,10 +95,15 @@ namespace DFS
       DFS::Geometry geometry() const override;
       std::string description() const override;
       std::optional<DFS::SectorBuffer> read_block(unsigned long sector) override;
+      unsigned long read_blocks(unsigned long sector, unsigned long count, byte* out) override;
+      std::optional<HostExtent> host_extent(unsigned long sector, unsigned long count) override;
+      std::optional<SectorLayout> sector_layout() override;
 
     private:
       DataAccess& media_;
-      std::string file_name_;
+      // If describer_ is null, description_ is the description.
+      const ViewDescriber* describer_;
+      unsigned int index_;
       std::string description_;
       DFS::Geometry geometry_;
       // initial_skip_ is wider than sector_count_type because MMB files
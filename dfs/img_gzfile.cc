@@ -16,10 +16,12 @@
 #include "media.h"           // for make_decompressed_file
 
 #include <exception>         // for exception
-#include <errno.h>           // for errno
-#include <stdio.h>           // for fread, FILE, fclose, ferror, fopen, fseek
+#include <errno.h>           // for errno, EINTR
+#include <stdio.h>           // for fread, FILE, fclose, ferror, fopen, fileno
 #include <stdlib.h>          // for free
 #include <string.h>          // for memset, strdup
+#include <sys/types.h>       // for off_t, ssize_t
+#include <unistd.h>          // for pread
 #include <zconf.h>           // for MAX_WBITS
 #include <zlib.h>            // for z_stream, Z_NULL, Z_STREAM_END, gz_header
 #include <functional>        // for function
@@ -273,6 +275,7 @@ namespace
     explicit DecompressedFile(const std::string& name);
     virtual ~DecompressedFile();
     std::vector<DFS::byte> read(unsigned long pos, unsigned long len) override;
+    unsigned long read_into(unsigned long pos, unsigned long len, DFS::byte* out) override;
 
   private:
     FILE *f_;
@@ -284,35 +287,60 @@ namespace
       name_(std::string("decompressed version of " + name))
   {
     if (0 == f_)
-      throw new NonFileOsError(errno);
-    write_decompressed_data(name, f_);
+      throw NonFileOsError(errno);
+    try
+      {
+	write_decompressed_data(name, f_);
+	// Reads use pread() on the underlying descriptor, so the data
+	// must have left the stdio buffer.
+	errno = 0;
+	if (EOF == fflush(f_))
+	  throw FileIOError(name_, errno);
+      }
+    catch (...)
+      {
+	fclose(f_);
+	throw;
+      }
   }
 
   DecompressedFile::~DecompressedFile()
   {
+    fclose(f_);
   }
 
   std::vector<DFS::byte> DecompressedFile::read(unsigned long pos, unsigned long len)
   {
-    auto fail = [this]() -> std::vector<DFS::byte>
-      {
-       if (errno)
-	 throw FileIOError(name_, errno);
-       else
-	 return std::vector<DFS::byte>();
-      };
-    errno = 0;
-    if (0 != fseek(f_, pos, SEEK_SET))
-      return fail();
-    std::vector<DFS::byte> buf;
-    buf.resize(len);
-    const size_t bytes_read = fread(buf.data(), 1, buf.size(), f_);
-    if (bytes_read == 0)
-      return fail();
-    buf.resize(bytes_read);
+    std::vector<DFS::byte> buf(len);
+    buf.resize(read_into(pos, len, buf.data()));
     return buf;
   }
 
+  unsigned long DecompressedFile::read_into(unsigned long pos, unsigned long len,
+					    DFS::byte* out)
+  {
+    // We use pread() rather than fseek() and fread() so that there is
+    // no shared file position, and so reads from different threads
+    // cannot interfere.
+    const int fd = fileno(f_);
+    unsigned long done = 0;
+    while (done < len)
+      {
+	const ssize_t n = pread(fd, out + done, len - done,
+				static_cast<off_t>(pos + done));
+	if (n < 0)
+	  {
+	    if (errno == EINTR)
+	      continue;
+	    throw FileIOError(name_, errno);
+	  }
+	if (n == 0)
+	  break;		// EOF; reading beyond it is not an error.
+	done += static_cast<unsigned long>(n);
+      }
+    return done;
+  }
+
 }  // namespace
 
 
@@ -44,7 +44,7 @@
 #include <vector>            // for vector, vector<>::iterator, ...
 
 #include "abstractio.h"      // for SectorBuffer, FileAccess, SECTOR_BYTES
-#include "dfs.h"             // for verbose
+#include "dfs.h"             // for verbose, diagnostics
 #include "dfs_format.h"      // for Format
 #include "exceptions.h"      // for FileIOError
 #include "geometry.h"        // for Geometry, Encoding, Encoding::FM, ...
@@ -65,40 +65,6 @@ using Track::decode_mfm_track;
 using Track::SectorAddress;
 using Track::byte;
 
-class InvalidHfeFile : public std::exception
-{
-public:
-  InvalidHfeFile(const std::string& msg)
-    : msg_(msg)
-  {
-  }
-
-  const char *what() const noexcept override
-  {
-    return msg_.c_str();
-  }
-
-private:
-  std::string msg_;
-};
-
-class UnsupportedHfeFile : public std::exception
-{
-public:
-  UnsupportedHfeFile(const std::string& msg)
-    : msg_(msg)
-  {
-  }
-
-  const char *what() const noexcept override
-  {
-    return msg_.c_str();
-  }
-
-private:
-  std::string msg_;
-};
-
 #define IBMPC_DD_FLOPPYMODE                  0x00
 #define IBMPC_HD_FLOPPYMODE		     0x01
 #define ATARIST_DD_FLOPPYMODE		     0x02
@@ -295,10 +261,9 @@ public:
   unsigned short track_len_;
 };
 
-std::vector<PicTrack>
-read_track_offset_lut(DFS::FileAccess* f, unsigned int tracks)
+bool read_track_offset_lut(DFS::FileAccess* f, unsigned int tracks,
+			   std::vector<PicTrack>* result, std::string& error)
 {
-  std::vector<PicTrack> result;
   std::vector<unsigned char> buf = f->read(512, tracks * 4u);
   if (buf.size() != tracks * 4u)
     {
@@ -306,15 +271,16 @@ read_track_offset_lut(DFS::FileAccess* f, unsigned int tracks)
       ss << "file is too short to contain a LUT for "
 	 << tracks << " tracks, but that's the number of tracks "
 	 << "indicated in the HFE file header";
-      throw InvalidHfeFile(ss.str());
+      error = ss.str();
+      return false;
     }
   const unsigned char *pos = buf.data();
   for (unsigned  i = 0; i < tracks; ++i)
     {
-      result.push_back(PicTrack(pos));
+      result->push_back(PicTrack(pos));
       pos += 4u;
     }
-  return result;
+  return true;
 }
 
 
@@ -322,6 +288,10 @@ class HfeFile : public DFS::AbstractImageFile
 {
 public:
   explicit HfeFile(const std::string& name, bool compressed, std::unique_ptr<DFS::FileAccess>&& file);
+  // Read the header and decode all the tracks.  Problems with the
+  // contents of the file are reported by returning false and setting
+  // error.
+  bool load(std::string& error);
 
   class DataAccessAdapter : public DFS::AbstractDrive
   {
@@ -329,11 +299,13 @@ public:
     DataAccessAdapter(HfeFile* f,
 		      DFS::Geometry geom,
 		      unsigned int side,
-		      const std::vector<Sector> sectors)
+		      const std::vector<Sector> sectors,
+		      const std::vector<DFS::TrackCrcErrors>& crc_errors)
       : f_(f),
 	geom_(geom),
 	side_(side),
-	sectors_(sectors)
+	sectors_(sectors),
+	crc_errors_(crc_errors)
     {
     }
 
@@ -372,6 +344,11 @@ public:
       return geom_;
     }
 
+    std::vector<DFS::TrackCrcErrors> crc_errors() const override
+    {
+      return crc_errors_;
+    }
+
     std::vector<Sector>::const_iterator find_sector(const SectorAddress& want) const
     {
       std::vector<Sector>::const_iterator it = sectors_.cbegin();
@@ -391,6 +368,7 @@ public:
     DFS::Geometry geom_;  // geom_ has just one side.
     unsigned int side_;
     std::vector<Sector> sectors_;
+    std::vector<DFS::TrackCrcErrors> crc_errors_;
   };
 
   std::string description() const;
@@ -401,8 +379,11 @@ private:
   unsigned char encoding_of_track(int side, int track) const;
   SectorAddress lba_to_address(unsigned long lba);
   int encoding_of_track(int track) const;
-  std::vector<Sector> read_all_sectors(const std::vector<PicTrack>& lut,
-				       unsigned int side);
+  bool read_all_sectors(const std::vector<PicTrack>& lut,
+			unsigned int side,
+			std::vector<Sector>* result,
+			std::vector<DFS::TrackCrcErrors>* crc_errors,
+			std::string& error);
   std::string name_;
   std::unique_ptr<DFS::FileAccess> file_;
   const bool compressed_;
@@ -417,19 +398,24 @@ HfeFile::HfeFile(const std::string& name, bool compressed, std::unique_ptr<DFS::
     file_(std::move(file)),
     compressed_(compressed),
     hfe_version_(0)
+{
+}
+
+bool HfeFile::load(std::string& error)
 {
   try
     {
       std::vector<byte> header_data = file_->read(0, 512);
       if (header_data.size() < 512)
 	{
-	  throw InvalidHfeFile("file is too short to contain the HFE file header");
+	  error = "file is too short to contain the HFE file header";
+	  return false;
 	}
       header_ = decode_header(header_data);
 
       if (DFS::verbose)
 	{
-	  std::cerr << name << ":\n" << header_ << "\n";
+	  DFS::diagnostics() << name_ << ":\n" << header_ << "\n";
 	}
       if (0 == memcmp(header_.HEADERSIGNATURE, "HXCPICFE", 8))
 	{
@@ -449,24 +435,31 @@ HfeFile::HfeFile(const std::string& name, bool compressed, std::unique_ptr<DFS::
 			     static_cast<const unsigned char*>(&header_.HEADERSIGNATURE[0]),
 			     static_cast<const unsigned char*>(&header_.HEADERSIGNATURE[sizeof(header_.HEADERSIGNATURE)]));
 
-	  throw InvalidHfeFile(ss.str());
+	  error = ss.str();
+	  return false;
 	}
 
-      std::vector<PicTrack> track_lut = read_track_offset_lut(file_.get(), header_.number_of_track);
+      std::vector<PicTrack> track_lut;
+      if (!read_track_offset_lut(file_.get(), header_.number_of_track, &track_lut, error))
+	return false;
 
       for (unsigned int side = 0; side < header_.number_of_side; ++side)
 	{
-	  std::vector<Sector> sectors = read_all_sectors(track_lut, side);
+	  std::vector<DFS::TrackCrcErrors> crc_errors;
+	  std::vector<Sector> sectors;
+	  if (!read_all_sectors(track_lut, side, &sectors, &crc_errors, error))
+	    return false;
 	  DFS::Geometry geom = geom_;
 	  geom.heads = 1;
-	  acc_.emplace_back(this, geom, side, sectors);
+	  acc_.emplace_back(this, geom, side, sectors, crc_errors);
 	}
     }
   catch (std::ifstream::failure& e)
     {
       // TODO: I don't think we can get a real errno value here.
-      throw DFS::FileIOError(name, EIO);
+      throw DFS::FileIOError(name_, EIO);
     }
+  return true;
 }
 
 unsigned char HfeFile::encoding_of_track(int side, int track) const
@@ -516,14 +509,15 @@ std::string opcode_name(byte op)
 
 void premature_stream_end(DFS::byte opcode)
 {
-  std::cerr << "warning: track data stream ends in the middle of an HFEv3 0x"
+  DFS::diagnostics() << "warning: track data stream ends in the middle of an HFEv3 0x"
 	    << std::hex << static_cast<unsigned>(opcode)
 	    << " (" << opcode_name(opcode)
 	    << ") instruction\n";
 }
 
-void copy_hfe(bool hfe3, const byte* begin, const byte* end,
-	      std::back_insert_iterator<std::vector<byte>> dest)
+bool copy_hfe(bool hfe3, const byte* begin, const byte* end,
+	      std::back_insert_iterator<std::vector<byte>> dest,
+	      std::string& error)
 {
   int got_bits = 0;
   byte out = 0;
@@ -539,7 +533,7 @@ void copy_hfe(bool hfe3, const byte* begin, const byte* end,
 	    {
 	    case NOP_OPCODE:
 	    case SETINDEX_OPCODE:
-	      std::cerr << "HFEv3: unexpected this_op value "
+	      DFS::diagnostics() << "HFEv3: unexpected this_op value "
 			<< std::hex << std::setw(2) << std::setfill('0')
 			<< static_cast<unsigned int>(this_op) << "\n";
 	      this_op = 0;
@@ -551,7 +545,7 @@ void copy_hfe(bool hfe3, const byte* begin, const byte* end,
 	      this_op = 0;
 	      if (DFS::verbose)
 		{
-		  std::cerr << "HFEv3: setbitrate: ignoring value 0x"
+		  DFS::diagnostics() << "HFEv3: setbitrate: ignoring value 0x"
 			    << std::setfill('0') << std::hex << skipbits << "\n";
 		}
 	      continue;
@@ -562,11 +556,11 @@ void copy_hfe(bool hfe3, const byte* begin, const byte* end,
 		this_op = 0;
 		if (DFS::verbose)
 		  {
-		  std::cerr << "HFEv3: skipbits: " << skipbits << " bits to skip\n";
+		  DFS::diagnostics() << "HFEv3: skipbits: " << skipbits << " bits to skip\n";
 		  }
 		if (in >= 8)
 		  {
-		    std::cerr << "HFEv3: unexpected SKIPBITS argument " << in << "\n";
+		    DFS::diagnostics() << "HFEv3: unexpected SKIPBITS argument " << in << "\n";
 		    continue;
 		  }
 	      }
@@ -609,7 +603,8 @@ void copy_hfe(bool hfe3, const byte* begin, const byte* end,
 		std::ostringstream ss;
 		ss << "track contains an invalid HFE3 opcode 0x"
 		   << std::hex << unsigned(in);
-		throw InvalidHfeFile(ss.str());
+		error = ss.str();
+		return false;
 	      }
 	    }
 	  this_op = 0;
@@ -618,7 +613,7 @@ void copy_hfe(bool hfe3, const byte* begin, const byte* end,
 	{
 	  if (DFS::verbose)
 	    {
-	      std::cerr << "HFEv3: processing opcode "
+	      DFS::diagnostics() << "HFEv3: processing opcode "
 			<< std::hex << unsigned(in) << " ("
 			<< opcode_name(in) << ")\n";
 	    }
@@ -666,7 +661,7 @@ void copy_hfe(bool hfe3, const byte* begin, const byte* end,
 	      --skipbits;
 	      if (DFS::verbose)
 		{
-		  std::cerr << "HFEv3: skipping a bit ("
+		  DFS::diagnostics() << "HFEv3: skipping a bit ("
 			    << std::dec << skipbits << " more to skip)\n";
 		}
 	      continue;
@@ -689,6 +684,7 @@ void copy_hfe(bool hfe3, const byte* begin, const byte* end,
     {
       premature_stream_end(this_op);
     }
+  return true;
 }
 
 // Sort the sectors by address.
@@ -705,14 +701,16 @@ sorted_sectors(std::vector<Sector>&& track_sectors)
   return result;
 }
 
-std::vector<Sector>
+bool
 HfeFile::read_all_sectors(const std::vector<PicTrack>& lut,
-			  unsigned int side)
+			  unsigned int side,
+			  std::vector<Sector>* result,
+			  std::vector<DFS::TrackCrcErrors>* crc_errors,
+			  std::string& error)
 {
   assert(side == 0 || side == 1);
    // offset_unit_size is the unit size of lut[i].offset_in_blocks.
   constexpr unsigned int offset_unit_size = 512;
-  std::vector<Sector> result;
   std::optional<unsigned int> sectors_per_track;
   for (unsigned int track = 0 ; track < header_.number_of_track; ++track)
     {
@@ -722,7 +720,8 @@ HfeFile::read_all_sectors(const std::vector<PicTrack>& lut,
 	  std::ostringstream ss;
 	  ss << "track " << track << " has unsupported track encoding value "
 	     << unsigned(encoding) << " (" << encoding_name(encoding) << ")";
-	  throw UnsupportedHfeFile(ss.str());
+	  error = ss.str();
+	  return false;
 	}
 
       unsigned int offset_in_blocks = lut[track].offset();
@@ -738,7 +737,7 @@ HfeFile::read_all_sectors(const std::vector<PicTrack>& lut,
       auto track_bytes_read = raw_data.size();
       if (DFS::verbose)
 	{
-	  std::cerr << "Track " << std::dec << track << " has " << track_len_in_bytes
+	  DFS::diagnostics() << "Track " << std::dec << track << " has " << track_len_in_bytes
 		    << " bytes of data; we read " << track_bytes_read
 		    << "\n";
 	}
@@ -763,12 +762,12 @@ HfeFile::read_all_sectors(const std::vector<PicTrack>& lut,
 	  if (DFS::verbose)
 	    {
 #if ULTRA_VERBOSE
-	      std::cerr << "Track " << track << ": copying "
+	      DFS::diagnostics() << "Track " << track << ": copying "
 			<< (end_offset - begin_offset) << " bytes starting at "
 			<< "offset " << begin_offset << " to position "
 			<< track_stream.size() << " in the track stream\n";
-	      std::cerr << "Input:\n";
-	      DFS::hexdump_bytes(std::cerr, begin_offset, 16,
+	      DFS::diagnostics() << "Input:\n";
+	      DFS::hexdump_bytes(DFS::diagnostics(), begin_offset, 16,
 				 raw_data.data() + begin_offset,
 				 raw_data.data() + end_offset);
 #endif
@@ -776,15 +775,17 @@ HfeFile::read_all_sectors(const std::vector<PicTrack>& lut,
 #if ULTRA_VERBOSE
 	  auto oldsize = track_stream.size();
 #endif
-	  copy_hfe(3 == hfe_version_,
-		   raw_data.data() + begin_offset,
-		   raw_data.data() + end_offset,
-		   std::back_inserter(track_stream));
+	  if (!copy_hfe(3 == hfe_version_,
+			raw_data.data() + begin_offset,
+			raw_data.data() + end_offset,
+			std::back_inserter(track_stream),
+			error))
+	    return false;
 	  if (DFS::verbose)
 	    {
 #if ULTRA_VERBOSE
-	      std::cerr << "Output:\n";
-	      DFS::hexdump_bytes(std::cerr, oldsize, 16,
+	      DFS::diagnostics() << "Output:\n";
+	      DFS::hexdump_bytes(DFS::diagnostics(), oldsize, 16,
 				 track_stream.data() + oldsize,
 				 track_stream.data() + track_stream.size());
 #endif
@@ -794,7 +795,7 @@ HfeFile::read_all_sectors(const std::vector<PicTrack>& lut,
 #if ULTRA_VERBOSE
       if (DFS::verbose)
 	{
-	  std::cerr << std::dec << std::setfill(' ')
+	  DFS::diagnostics() << std::dec << std::setfill(' ')
 		    << "Track " << std::setw(2) << track << ": " << track_len_in_bytes
 		    << " bytes at position "
 		    << (offset_unit_size * offset_in_blocks)
@@ -810,11 +811,15 @@ HfeFile::read_all_sectors(const std::vector<PicTrack>& lut,
       const size_t stride = is_fm ? 2 : 1;
       Track::BitStream bits(track_stream, first_bit, stride);
       auto decoder = (is_fm ? decode_fm_track : decode_mfm_track);
-      const std::vector<Sector> track_sectors = sorted_sectors(decoder(bits, DFS::verbose));
+      unsigned int bad_records = 0;
+      const std::vector<Sector> track_sectors =
+	sorted_sectors(decoder(bits, DFS::verbose, &bad_records));
+      if (bad_records)
+	crc_errors->push_back(DFS::TrackCrcErrors{track, bad_records});
 
       if (DFS::verbose)
 	{
-	  std::cerr << "Found " << track_sectors.size() << " sectors on track "
+	  DFS::diagnostics() << "Found " << track_sectors.size() << " sectors on track "
 		    << track << "\n";
 	}
       if (!sectors_per_track)
@@ -826,17 +831,18 @@ HfeFile::read_all_sectors(const std::vector<PicTrack>& lut,
 	  std::ostringstream ss;
 	  ss << "track " << track << " has " << track_sectors.size()
 	     << " sectors but other tracks have " << *sectors_per_track
-	     << " sectors; this is not supported";
-	  throw UnsupportedHfeFile(ss.str());
+	     << " sectors";
+	  if (bad_records)
+	    ss << " (" << bad_records << " records had a bad CRC)";
+	  ss << "; this is not supported";
+	  error = ss.str();
+	  return false;
 	}
 
-      std::string error;
       if (!DFS::check_track_is_supported(track_sectors, track, side, DFS::SECTOR_BYTES, DFS::verbose, error))
-	{
-	  throw UnsupportedHfeFile(error);
-	}
+	return false;
       std::copy(track_sectors.begin(), track_sectors.end(),
-		std::back_inserter(result));
+		std::back_inserter(*result));
     }
 
   assert(header_.number_of_track > 0);
@@ -857,7 +863,8 @@ HfeFile::read_all_sectors(const std::vector<PicTrack>& lut,
 	std::ostringstream ss;
 	ss << "disc has unsupported encoding "
 	   << encoding_name(header_.track_encoding);
-	throw UnsupportedHfeFile(ss.str());
+	error = ss.str();
+	return false;
       }
     }
 
@@ -865,7 +872,7 @@ HfeFile::read_all_sectors(const std::vector<PicTrack>& lut,
 			header_.number_of_side,
 			*sectors_per_track,
 			enc);
-  return result;
+  return true;
 }
 
 bool HfeFile::connect_drives(DFS::StorageConfiguration* storage,
@@ -898,6 +905,8 @@ namespace DFS
     try
       {
 	std::unique_ptr<HfeFile> result = std::make_unique<HfeFile>(name, compressed, std::move(file));
+	if (!result->load(error))
+	  return 0;
 	return result;
       }
     catch (std::exception& e)
@@ -22,7 +22,7 @@
 #include <string>		// for string
 #include <vector>		// for vector<>
 
-#include "dfs.h"		// for verbose
+#include "dfs.h"		// for verbose, diagnostics
 #include "hexdump.h"		// for DFS::hexdump_bytes
 #include "identify.h"		// for identify_file_system
 #include "media.h"		// for AbstractImageFile
@@ -228,7 +228,7 @@ std::optional<Header> read_and_verify_header(DFS::FileAccess *f, std::string& er
 
   if (DFS::verbose)
     {
-      std::cerr << result;
+      DFS::diagnostics() << result;
     }
   return result;
 }
@@ -245,7 +245,8 @@ public:
 private:
   std::map<TrackDataKey, TrackData> get_track_metadata();
   std::vector<Track::Sector> read_all_sectors(unsigned int side,
-					      const std::map<TrackDataKey, TrackData>&);
+					      const std::map<TrackDataKey, TrackData>&,
+					      std::vector<DFS::TrackCrcErrors>* crc_errors);
 
   class DataAccessAdapter : public DFS::AbstractDrive
   {
@@ -253,11 +254,13 @@ private:
     DataAccessAdapter(HxcMfmFile* f,
 		      DFS::Geometry geom,
 		      unsigned int side,
-		      const std::vector<Track::Sector> sectors)
+		      const std::vector<Track::Sector> sectors,
+		      const std::vector<DFS::TrackCrcErrors>& crc_errors)
       : f_(f),
 	geom_(geom),
 	side_(side),
-	sectors_(sectors)
+	sectors_(sectors),
+	crc_errors_(crc_errors)
     {
     }
 
@@ -283,12 +286,18 @@ private:
       return geom_;
     }
 
+    std::vector<DFS::TrackCrcErrors> crc_errors() const override
+    {
+      return crc_errors_;
+    }
+
     HxcMfmFile *f_;
     std::string name_;
     std::unique_ptr<DFS::FileAccess> file_;
     DFS::Geometry geom_;	// geom_ has just one side.
     unsigned int side_;
     std::vector<Track::Sector> sectors_;
+    std::vector<DFS::TrackCrcErrors> crc_errors_;
   };
 
   Header header_;
@@ -329,9 +338,10 @@ HxcMfmFile::HxcMfmFile(const std::string& name, bool compressed, std::unique_ptr
   const std::map<TrackDataKey, TrackData> track_metadata = get_track_metadata();
   for (unsigned int side = 0; side < header_.sides; ++side)
     {
-      std::vector<Sector> sectors = read_all_sectors(side, track_metadata);
+      std::vector<DFS::TrackCrcErrors> crc_errors;
+      std::vector<Sector> sectors = read_all_sectors(side, track_metadata, &crc_errors);
       DFS::Geometry g = compute_geometry(1, sectors);
-      acc_.emplace_back(this, g, side, sectors);
+      acc_.emplace_back(this, g, side, sectors, crc_errors);
     }
 }
 
@@ -379,7 +389,7 @@ std::map<TrackDataKey, TrackData> HxcMfmFile::get_track_metadata()
       const TrackData td(le_quad(raw+3), le_quad(raw+7));
       if (DFS::verbose)
 	{
-	  std::cerr << "HxcMfmFile::get_track_metadata: data for "
+	  DFS::diagnostics() << "HxcMfmFile::get_track_metadata: data for "
 		    << std::setw(6) << key << " is at " << td << "\n";
 	}
 
@@ -389,7 +399,7 @@ std::map<TrackDataKey, TrackData> HxcMfmFile::get_track_metadata()
     }
   if (DFS::verbose)
     {
-      std::cerr << "HxcMfmFile::get_track_metadata: collected data for "
+      DFS::diagnostics() << "HxcMfmFile::get_track_metadata: collected data for "
 		<< result.size() << " tracks\n";
     }
   return result;
@@ -399,7 +409,8 @@ std::map<TrackDataKey, TrackData> HxcMfmFile::get_track_metadata()
 
 std::vector<Sector>
 HxcMfmFile::read_all_sectors(unsigned int side,
-			     const std::map<TrackDataKey, TrackData>& track_metadata)
+			     const std::map<TrackDataKey, TrackData>& track_metadata,
+			     std::vector<DFS::TrackCrcErrors>* crc_errors)
 {
   std::vector<Sector> result;
   for (auto [key, td] : track_metadata)
@@ -423,7 +434,10 @@ HxcMfmFile::read_all_sectors(unsigned int side,
 		     Track::reverse_bit_order);
 
       Track::BitStream bits(track, 0u, 1u);
-      std::vector<Sector> track_sectors = decode_mfm_track(bits, DFS::verbose);
+      unsigned int bad_records = 0;
+      std::vector<Sector> track_sectors = decode_mfm_track(bits, DFS::verbose, &bad_records);
+      if (bad_records)
+	crc_errors->push_back(DFS::TrackCrcErrors{key.track_number, bad_records});
       std::sort(track_sectors.begin(), track_sectors.end(),
 		[](const Sector& a, const Sector& b)
 		{
@@ -48,6 +48,66 @@ namespace
     return parts;
   }
 
+  using ImageMaker = std::unique_ptr<DFS::AbstractImageFile>
+    (*)(const std::string& name, bool compressed,
+	std::unique_ptr<DFS::FileAccess>&& fa, std::string& error);
+
+  // The kinds of image file we can read, keyed by extension.
+  struct ImageKind
+  {
+    const char* extension;
+    ImageMaker make;
+  };
+
+  const ImageKind image_kinds[] =
+    {
+     {"hfe", [](const std::string& name, bool compressed,
+		std::unique_ptr<DFS::FileAccess>&& fa, std::string& error)
+	     {
+	       return DFS::make_hfe_file(name, compressed, std::move(fa), error);
+	     }},
+     {"mfm", [](const std::string& name, bool compressed,
+		std::unique_ptr<DFS::FileAccess>&& fa, std::string& error)
+	     {
+	       return DFS::make_hxcmfm_file(name, compressed, std::move(fa), error);
+	     }},
+     {"ssd", [](const std::string& name, bool compressed,
+		std::unique_ptr<DFS::FileAccess>&& fa, std::string&)
+	     {
+	       return DFS::make_noninterleaved_file(name, compressed, std::move(fa));
+	     }},
+     {"sdd", [](const std::string& name, bool compressed,
+		std::unique_ptr<DFS::FileAccess>&& fa, std::string&)
+	     {
+	       return DFS::make_noninterleaved_file(name, compressed, std::move(fa));
+	     }},
+     {"dsd", [](const std::string& name, bool compressed,
+		std::unique_ptr<DFS::FileAccess>&& fa, std::string&)
+	     {
+	       return DFS::make_interleaved_file(name, compressed, std::move(fa));
+	     }},
+     {"ddd", [](const std::string& name, bool compressed,
+		std::unique_ptr<DFS::FileAccess>&& fa, std::string&)
+	     {
+	       return DFS::make_interleaved_file(name, compressed, std::move(fa));
+	     }},
+     {"mmb", [](const std::string& name, bool compressed,
+		std::unique_ptr<DFS::FileAccess>&& fa, std::string&)
+	     {
+	       return DFS::make_mmb_file(name, compressed, std::move(fa));
+	     }},
+    };
+
+  const ImageKind* find_image_kind(const std::string& ext)
+  {
+    for (const ImageKind& kind : image_kinds)
+      {
+	if (ext == kind.extension)
+	  return &kind;
+      }
+    return nullptr;
+  }
+
 }  // namespace
 
 namespace DFS
@@ -56,6 +116,16 @@ namespace DFS
     {
     }
 
+  bool is_image_file_name(const std::string& name)
+  {
+    std::deque<std::string> extensions = split_extensions(name);
+    if (!extensions.empty() && extensions.back() == "gz")
+      extensions.pop_back();
+    if (extensions.empty())
+      return false;
+    return find_image_kind(extensions.back()) != nullptr;
+  }
+
   std::unique_ptr<AbstractImageFile> make_image_file(const std::string& name, std::string& error)
   {
     std::deque<std::string> extensions = split_extensions(name);
@@ -93,25 +163,9 @@ namespace DFS
     const std::string ext(extensions.back());
     try
       {
-	if (extensions.back() == "hfe")
-	  {
-	    return make_hfe_file(name, compressed, std::move(fa), error);
-	  }
-	if (extensions.back() == "mfm")
-	  {
-	    return make_hxcmfm_file(name, compressed, std::move(fa), error);
-	  }
-	if (ext == "ssd" || ext == "sdd")
-	  {
-	    return make_noninterleaved_file(name, compressed, std::move(fa));
-	  }
-	if (ext == "dsd" || ext == "ddd")
-	  {
-	    return make_interleaved_file(name, compressed, std::move(fa));
-	  }
-	if (ext == "mmb")
+	if (const ImageKind* kind = find_image_kind(ext))
 	  {
-	    return make_mmb_file(name, compressed, std::move(fa));
+	    return kind->make(name, compressed, std::move(fa), error);
 	  }
 	std::ostringstream ss;
 	ss << "Image file " << name << " does not seem to be of a supported type; "
@@ -19,110 +19,254 @@
 #include <iomanip>       // for operator<<, setw, setbase, setfill, uppercase
 #include <iostream>      // for operator<<, basic_ostream, basic_ostream::op...
 #include <memory>        // for unique_ptr, allocator, make_unique
+#include <mutex>         // for call_once, once_flag
 #include <optional>      // for optional
+#include <sstream>       // for ostringstream
 #include <string>        // for string, char_traits, operator<<
 #include <utility>       // for move
+#include <vector>        // for vector
 #include "abstractio.h"  // for DataAccess, SECTOR_BYTES
 #include "dfstypes.h"    // for sector_count
+#include "dfs.h"         // for diagnostics
 #include "exceptions.h"  // for BadFileSystem
 #include "geometry.h"    // for Encoding, Geometry, Encoding::FM
 #include "img_fileio.h"  // for FileView
 #include "media.h"       // for AbstractImageFile
+#include "storage.h"     // for AbstractDrive, DriveConfig, StorageConfiguration
 
 namespace
 {
   using DFS::ViewFile;
   using DFS::internal::FileView;
 
-  class MmbFile : public ViewFile
+  class MmbFile;
+
+  // One disc of an MMB file.  A large MMB file holds thousands of
+  // discs, so this just refers back to the file; the view of the
+  // file is made when the disc is read.
+  class MmbDrive : public DFS::AbstractDrive
+  {
+  public:
+    MmbDrive(MmbFile* file, unsigned int disc)
+      : file_(file), disc_(disc)
+    {
+    }
+
+    DFS::Geometry geometry() const override;
+    std::string description() const override;
+    std::optional<DFS::SectorBuffer> read_block(unsigned long sector) override;
+    unsigned long read_blocks(unsigned long sector, unsigned long count, DFS::byte* out) override;
+    std::optional<DFS::HostExtent> host_extent(unsigned long sector, unsigned long count) override;
+    std::optional<DFS::SectorLayout> sector_layout() override;
+
+  private:
+    FileView view() const;
+
+    MmbFile* file_;
+    unsigned int disc_;
+  };
+
+  // An MMB file is made of one or more banks.  Each bank is a table
+  // of 511 slots followed by the 511 disc images which they describe.
+  // Except for the first, the table of a bank is only read when one
+  // of its discs is used, so that opening a large file costs no more
+  // than opening a small one.
+  class MmbFile : public ViewFile, private DFS::internal::ViewDescriber
   {
   public:
     static constexpr unsigned long MMB_ENTRY_BYTES = 16;
+    static constexpr unsigned long MMB_SECTORS = 32;
+    static constexpr unsigned int SLOTS = MMB_SECTORS * DFS::SECTOR_BYTES / MMB_ENTRY_BYTES - 1;
+    static constexpr unsigned long DISC_SECTORS = 80 * 10;
+    static constexpr unsigned long BANK_SECTORS = MMB_SECTORS + SLOTS * DISC_SECTORS;
 
     explicit MmbFile(const std::string& name, bool compressed,
 		     std::unique_ptr<DFS::FileAccess>&& file)
-      : ViewFile(name, std::move(file))
+      : ViewFile(name, std::move(file)), media_(block_access()), compressed_(compressed)
+    {
+      // The first entry of the table is the header; it specifies
+      // which drives are loaded at boot time, which we don't need to
+      // know.  But in an extended MMB file, byte 8 of the header of
+      // the first bank gives the number of banks.
+      std::optional<DFS::SectorBuffer> first = media_.read_block(0);
+      if (!first)
+	throw DFS::BadFileSystem("MMB file is too short");
+      const DFS::byte banks_byte = (*first)[8];
+      banks_ = (banks_byte & 0xF0) == 0xA0 ? (banks_byte & 0x0F) + 1u : 1u;
+      // The tables need not be read yet, but we want to diagnose a
+      // truncated file now.
+      if (!media_.read_block(bank_origin(banks_ - 1) + MMB_SECTORS - 1))
+	throw DFS::BadFileSystem("MMB file is too short");
+      tables_ = std::make_unique<SlotTable[]>(banks_);
+      drives_.reserve(banks_ * SLOTS);
+      for (unsigned int disc = 0; disc < banks_ * SLOTS; ++disc)
+	drives_.emplace_back(this, disc);
+      // The first bank is almost always used, and reading its table
+      // now means that problems with it are reported when the file is
+      // opened.
+      slot_status(0);
+    }
+
+    bool connect_drives(DFS::StorageConfiguration* storage,
+			DFS::DriveAllocation how,
+			std::string&) override
+    {
+      // Identifying the file system of a disc means reading it, so
+      // that is also put off until the disc is used.
+      std::vector<std::optional<DFS::DriveConfig>> drives;
+      drives.reserve(drives_.size());
+      for (MmbDrive& drive : drives_)
+	drives.emplace_back(DFS::DriveConfig::identify_later(&drive));
+      return storage->connect_drives(drives, how);
+    }
+
+    static DFS::Geometry disc_geometry()
     {
-      const DFS::Geometry disc_image_geom = DFS::Geometry(80, 1, 10, DFS::Encoding::FM);
-      const auto disc_image_sectors = disc_image_geom.total_sectors();
-      const unsigned long mmb_sectors = 32;
-      const unsigned entries_per_sector = DFS::SECTOR_BYTES/MMB_ENTRY_BYTES;
-      for (unsigned sec = 0; sec < mmb_sectors; ++sec)
+      return DFS::Geometry(80, 1, 10, DFS::Encoding::FM);
+    }
+
+    FileView view(unsigned int disc) const
+    {
+      const DFS::byte status = slot_status(disc);
+      if (status == 0x00 || status == 0x0F) // read-only or read-write
 	{
-	  auto got = block_access().read_block(sec);
-	  if (!got)
-	    throw DFS::BadFileSystem("MMB file is too short");
-	  for (unsigned i = 0; i < entries_per_sector; ++i)
+	  return FileView(media_, *this, disc, disc_geometry(),
+			  bank_origin(disc / SLOTS) + MMB_SECTORS + (disc % SLOTS) * DISC_SECTORS,
+			  DFS::sector_count(DISC_SECTORS),
+			  DFS::sector_count(0),
+			  DFS::sector_count(DISC_SECTORS));
+	}
+      return FileView::unformatted_device(*this, disc, disc_geometry());
+    }
+
+  private:
+    struct SlotTable
+    {
+      std::once_flag loaded;
+      // The status byte of each slot.
+      std::array<DFS::byte, SLOTS> status;
+    };
+
+    static unsigned long bank_origin(unsigned int bank)
+    {
+      return bank * BANK_SECTORS;
+    }
+
+    // Several threads may ask for the status of discs at once.
+    DFS::byte slot_status(unsigned int disc) const
+    {
+      const unsigned int bank = disc / SLOTS;
+      SlotTable& table = tables_[bank];
+      std::call_once(table.loaded, [this, bank, &table]() { load_table(bank, &table); });
+      return table.status[disc % SLOTS];
+    }
+
+    void load_table(unsigned int bank, SlotTable* table) const
+    {
+      std::array<DFS::byte, MMB_SECTORS * DFS::SECTOR_BYTES> data;
+      if (media_.read_blocks(bank_origin(bank), MMB_SECTORS, data.data()) < MMB_SECTORS)
+	{
+	  // We checked that the file was long enough when we opened it,
+	  // so this should not happen.
+	  DFS::diagnostics() << "The table of MMB bank " << bank << " cannot be read\n";
+	  table->status.fill(0xFF);
+	  return;
+	}
+      for (unsigned int slot = 0; slot < SLOTS; ++slot)
+	{
+	  const DFS::byte status = data[(slot + 1) * MMB_ENTRY_BYTES + 0x0F];
+	  table->status[slot] = status;
+	  if (status != 0x00 && status != 0x0F && status != 0xF0 && status != 0xFF)
 	    {
-	      if (sec == 0 && i == 0)
-		{
-		  // We don't actually care about the header; it specifies
-		  // which drives are loaded at boot time, but we don't
-		  // need to know that.
-		  continue;
-		}
-	      const int slot = (sec * entries_per_sector) + i - 1;
-	      const unsigned char *entry = got->data() + (i * MMB_ENTRY_BYTES);
-	      const auto slot_status = entry[0x0F];
-	      std::string slot_status_desc;
-	      bool present = false;
-	      int fill = 0;
-	      switch (slot_status)
-		{
-		case 0x00:		// read-only
-		  slot_status_desc = "read-only";
-		  present = true;
-		  fill = 2;
-		  break;
-		case 0x0F:		// read-write
-		  slot_status_desc = "read-write";
-		  present = true;
-		  fill = 1;
-		  break;
-		case 0xF0:		// unformatted
-		  slot_status_desc = "unformatted";
-		  present = false;
-		  fill = 0;
-		  break;
-		case 0xFF:		// invalid, perhaps missing
-		  slot_status_desc = "missing";
-		  present = false;
-		  fill = 4;
-		  break;
-		default:
-		  slot_status_desc = "unknown";
-		  present = false;
-		  fill = 5;
-		  // TODO: provide infrastructure for issuing warnings
-		  std::cerr << "MMB entry " << i << " has unexpected type 0x"
-			    << std::setw(2) << std::uppercase << std::setbase(16)
-			    << entry[0x0F] << "\n";
-		  break;
-		}
-	      std::ostringstream ss;
-	      ss << std::setfill(' ') << std::setw(fill) << "" << slot_status_desc
-		 << " slot " << std::setw(3) << slot << " of "
-		 << (compressed ? "compressed " : "")
-		 << "MMB file " << name;
-	      const std::string disc_name = ss.str();
-	      if (present)
-		{
-		  auto initial_skip_sectors = mmb_sectors + (slot * disc_image_sectors);
-		  add_view(FileView(block_access(), name, disc_name,
-				    disc_image_geom,
-				    initial_skip_sectors,
-				    disc_image_sectors,
-				    DFS::sector_count(0),
-				    disc_image_sectors));
-		}
-	      else
-		{
-		  add_view(FileView::unformatted_device(name, disc_name, disc_image_geom));
-		}
+	      std::ostringstream hex;
+	      hex << std::setw(2) << std::setfill('0') << std::uppercase
+		  << std::setbase(16) << static_cast<unsigned int>(status);
+	      DFS::diagnostics() << "MMB entry " << (slot + 1);
+	      if (banks_ > 1)
+		DFS::diagnostics() << " of bank " << bank;
+	      DFS::diagnostics() << " has unexpected type 0x" << hex.str() << "\n";
 	    }
 	}
     }
+
+    // The description of each disc is only formatted when it is
+    // needed, which (for a large MMB file) is rarely.
+    std::string describe_view(unsigned int disc) const override
+    {
+      std::string slot_status_desc;
+      int fill;
+      switch (slot_status(disc))
+	{
+	case 0x00:
+	  slot_status_desc = "read-only";
+	  fill = 2;
+	  break;
+	case 0x0F:
+	  slot_status_desc = "read-write";
+	  fill = 1;
+	  break;
+	case 0xF0:
+	  slot_status_desc = "unformatted";
+	  fill = 0;
+	  break;
+	case 0xFF:		// invalid, perhaps missing
+	  slot_status_desc = "missing";
+	  fill = 4;
+	  break;
+	default:
+	  slot_status_desc = "unknown";
+	  fill = 5;
+	  break;
+	}
+      std::ostringstream ss;
+      ss << std::setfill(' ') << std::setw(fill) << "" << slot_status_desc
+	 << " slot " << std::setw(3) << disc << " of "
+	 << (compressed_ ? "compressed " : "")
+	 << "MMB file " << name();
+      return ss.str();
+    }
+
+    DFS::DataAccess& media_;
+    bool compressed_;
+    unsigned int banks_;
+    std::unique_ptr<SlotTable[]> tables_;
+    std::vector<MmbDrive> drives_;
   };
+
+  FileView MmbDrive::view() const
+  {
+    return file_->view(disc_);
+  }
+
+  DFS::Geometry MmbDrive::geometry() const
+  {
+    return MmbFile::disc_geometry();
+  }
+
+  std::string MmbDrive::description() const
+  {
+    return view().description();
+  }
+
+  std::optional<DFS::SectorBuffer> MmbDrive::read_block(unsigned long sector)
+  {
+    return view().read_block(sector);
+  }
+
+  unsigned long MmbDrive::read_blocks(unsigned long sector, unsigned long count, DFS::byte* out)
+  {
+    return view().read_blocks(sector, count, out);
+  }
+
+  std::optional<DFS::HostExtent> MmbDrive::host_extent(unsigned long sector, unsigned long count)
+  {
+    return view().host_extent(sector, count);
+  }
+
+  std::optional<DFS::SectorLayout> MmbDrive::sector_layout()
+  {
+    return view().sector_layout();
+  }
 }  // namespace
 
 namespace DFS
@@ -16,8 +16,9 @@
 #include "img_sdf.h"
 
 #include <assert.h>      // for assert
-#include <algorithm>     // for copy
+#include <algorithm>     // for copy, min
 #include <array>         // for array<>::iterator
+#include <limits>        // for numeric_limits
 #include <ostream>       // for operator<<, basic_ostream, ostringstream
 #include <sstream>       // for ostringstream
 #include <utility>       // for move
@@ -65,7 +66,7 @@ namespace
 	      os << " side " << surface_num;
 	    }
 	  std::string desc = os.str();
-	  FileView v(block_access(), name, desc, single_side_geom,
+	  FileView v(block_access(), desc, single_side_geom,
 		     skip, side_len, 0, side_len);
 	  skip = DFS::sector_count(skip + side_len);
 	  add_view(v);
@@ -101,14 +102,14 @@ namespace
 							   geometry.sectors,
 							   geometry.encoding);
       const DFS::sector_count_type track_len = single_side_geom.sectors;
-      FileView side0(block_access(), name, make_desc(0),
+      FileView side0(block_access(), make_desc(0),
 		     single_side_geom,
 		     0,		/* side 0 begins immediately */
 		     track_len, /* read the whole of the track */
 		     track_len, /* ignore track data for side 1 */
 		     single_side_geom.total_sectors());
       add_view(side0);
-      FileView side1(block_access(), name, make_desc(1),
+      FileView side1(block_access(), make_desc(1),
 		     single_side_geom,
 		     track_len, /* side 1 begins after the first track of side 0 */
 		     track_len, /* read the whole of the track */
@@ -139,6 +140,35 @@ namespace DFS
     return buf;
   }
 
+  unsigned long FilePresentedBlockwise::read_blocks(unsigned long lba, unsigned long count,
+						    byte* out)
+  {
+    const unsigned long pos = lba * DFS::SECTOR_BYTES;
+    const unsigned long got = f_.read_into(pos, count * DFS::SECTOR_BYTES, out);
+    assert(got <= count * DFS::SECTOR_BYTES);
+    // A partial sector at the end of the file is not counted.
+    return got / DFS::SECTOR_BYTES;
+  }
+
+  std::optional<SectorLayout> FilePresentedBlockwise::sector_layout()
+  {
+    return SectorLayout{&f_, 0, std::numeric_limits<unsigned long>::max(), 0, 1, 0};
+  }
+
+  std::optional<HostExtent> FilePresentedBlockwise::host_extent(unsigned long lba,
+								unsigned long count)
+  {
+    const auto host = f_.host_file();
+    if (!host)
+      return std::nullopt;
+    // Image files are often shorter than the disc they represent, and
+    // we only describe sectors that are entirely present.
+    const unsigned long available = host->second / DFS::SECTOR_BYTES;
+    if (lba >= available)
+      return std::nullopt;
+    return HostExtent{host->first, lba * DFS::SECTOR_BYTES, std::min(count, available - lba)};
+  }
+
   ViewFile::ViewFile(const std::string& name, std::unique_ptr<DFS::FileAccess>&& file)
     : name_(name), data_(std::move(file)), blocks_(*data_)
   {
@@ -153,6 +183,11 @@ namespace DFS
     views_.push_back(v);
   }
 
+  const std::string& ViewFile::name() const
+  {
+    return name_;
+  }
+
   DFS::DataAccess& ViewFile::block_access()
   {
     return blocks_;
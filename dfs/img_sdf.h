@@ -35,6 +35,9 @@ namespace DFS
   public:
     explicit FilePresentedBlockwise(FileAccess& f);
     std::optional<SectorBuffer> read_block(unsigned long lba) override;
+    unsigned long read_blocks(unsigned long lba, unsigned long count, byte* out) override;
+    std::optional<HostExtent> host_extent(unsigned long lba, unsigned long count) override;
+    std::optional<SectorLayout> sector_layout() override;
 
   private:
     FileAccess& f_;
@@ -54,6 +57,7 @@ namespace DFS
     ~ViewFile() override;
     bool connect_drives(StorageConfiguration* storage, DriveAllocation how, std::string& error) override;
     void add_view(const DFS::internal::FileView& v);
+    const std::string& name() const;
     DFS::DataAccess& block_access();
 
   private:
@@ -16,9 +16,11 @@
 #include <exception>           // for exception
 #include <unistd.h>	       // for optarg, optind
 #include <ctype.h>             // for isupper
+#include <errno.h>             // for errno
 #include <getopt.h>            // for option, getopt_long
 #include <limits.h>            // for SCHAR_MIN
-#include <string.h>            // for NULL, strlen, size_t
+#include <string.h>            // for NULL, strlen, size_t, strerror
+#include <fstream>             // for ifstream
 #include <iostream>            // for operator<<, basic_ostream, cerr, ostream
 #include <map>                 // for map
 #include <memory>              // for unique_ptr, make_unique
@@ -30,12 +32,14 @@
 #include <utility>             // for pair, make_pair, move
 #include <vector>              // for vector
 
-#include "commands.h"          // for CommandHelp, CIReg, CommandInterface
-#include "dfs.h"               // for get_option_help, verbose
+#include "commands.h"          // for CommandHelp, CIReg, CommandInterface, default_job_count
+#include "dfs.h"               // for get_option_help, verbose, set_diagnost...
 #include "dfscontext.h"        // for UiStyle, DFSContext, UiStyle::Acorn
 #include "driveselector.h"     // for VolumeSelector
+#include "imagelist.h"         // for expand_image_spec, read_image_list, run_f...
 #include "media.h"             // for AbstractImageFile, make_image_file
 #include "storage.h"           // for DriveAllocation, DriveAllocation::PHYS...
+#include "stringutil.h"        // for split_words
 
 namespace
 {
@@ -86,6 +90,10 @@ namespace
      OPT_UI_STYLE,
      OPT_VERBOSE,
      OPT_HELP,
+     OPT_BATCH,
+     OPT_IMAGES,
+     OPT_FILES_FROM,
+     OPT_JOBS,
     };
 
   // struct option fields: name, has_arg, *flag, val
@@ -110,6 +118,13 @@ namespace
      { "help", 0, NULL, OPT_HELP },
      { "ui", 1, NULL, OPT_UI_STYLE },
      { "verbose", 0, NULL, OPT_VERBOSE },
+     // --batch reads commands from a file instead of the command line.
+     { "batch", 1, NULL, OPT_BATCH },
+     // --images and --files-from run the command separately on each
+     // of many image files; --jobs says how many at once.
+     { "images", 1, NULL, OPT_IMAGES },
+     { "files-from", 1, NULL, OPT_FILES_FROM },
+     { "jobs", 1, NULL, OPT_JOBS },
      { 0, 0, 0, 0 },
     };
 
@@ -170,6 +185,73 @@ namespace
     return std::make_pair(ok, v);
   }
 
+  // Run each of the commands in the batch file named batch_file_name
+  // ("-" meaning the standard input).  Each line holds one command
+  // and its arguments (quoted as for the shell), and blank lines and
+  // lines starting with # are ignored.  A command which fails is
+  // reported (with its line number) but does not stop the batch.
+  // Returns false if any command failed.
+  bool run_batch(const DFS::StorageConfiguration& storage,
+		 const DFS::DFSContext& ctx,
+		 const std::string& batch_file_name)
+  {
+    std::ifstream batch_file;
+    if (batch_file_name != "-")
+      {
+	batch_file.open(batch_file_name);
+	if (!batch_file)
+	  {
+	    std::cerr << batch_file_name << ": " << strerror(errno) << "\n";
+	    return false;
+	  }
+      }
+    std::istream& in(batch_file_name == "-" ? std::cin : batch_file);
+    const std::string where(batch_file_name == "-" ? "standard input" : batch_file_name);
+    unsigned long line_number = 0, commands_run = 0, failures = 0;
+    std::string line;
+    while (std::getline(in, line))
+      {
+	++line_number;
+	std::vector<std::string> args;
+	std::string error;
+	bool ok;
+	if (!DFS::stringutil::split_words(line, &args, &error))
+	  {
+	    ++commands_run;
+	    std::cerr << where << ":" << line_number << ": " << error << "\n";
+	    ok = false;
+	  }
+	else if (args.empty())
+	  {
+	    continue;
+	  }
+	else
+	  {
+	    ++commands_run;
+	    ok = DFS::run_command(storage, ctx, args);
+	    // Keep the output of each command ahead of any diagnostic
+	    // about it.
+	    std::cout.flush();
+	    if (!ok)
+	      std::cerr << where << ":" << line_number << ": "
+			<< args[0] << " failed\n";
+	  }
+	if (!ok)
+	  ++failures;
+      }
+    if (in.bad())
+      {
+	std::cerr << where << ": " << strerror(errno) << "\n";
+	return false;
+      }
+    if (failures)
+      {
+	std::cerr << failures << " of " << commands_run << " commands in "
+		  << where << " failed\n";
+      }
+    return failures == 0;
+  }
+
 std::unique_ptr<std::map<std::string, std::string>> option_help;
 
 std::unique_ptr<std::map<std::string, std::string>> make_option_help()
@@ -186,7 +268,14 @@ std::unique_ptr<std::map<std::string, std::string>> make_option_help()
 	"performing the operation"},
        {"ui", "follow the user-interface of this type of DFS ROM"},
        {"help", "print a brief explanation of how to use the program"},
-       {"verbose", "print (on stderr) messages about the operation of the program"}
+       {"verbose", "print (on stderr) messages about the operation of the program"},
+       {"batch", "read commands, one per line, from the named file (or - for the standard "
+	"input) instead of the command line"},
+       {"images", "run the command separately on each disc image in the named directory, "
+	"or matching the named glob pattern"},
+       {"files-from", "run the command separately on each disc image named (one per line) "
+	"in the named file (or - for the standard input)"},
+       {"jobs", "the number of images given by --images or --files-from to work on at once"},
       });
   return std::make_unique<std::map<std::string, std::string>>(m);
 }
@@ -209,6 +298,7 @@ int main (int argc, char *argv[])
 {
   if (!check_consistency())
     return 2;
+  DFS::set_diagnostic_stream(&std::cerr);
   DFS::DFSContext ctx('$', DFS::VolumeSelector(0));
   int longindex;
   std::vector<std::string> extra_args;
@@ -217,6 +307,12 @@ int main (int argc, char *argv[])
   std::vector<std::unique_ptr<DFS::AbstractImageFile>> files;
   DFS::StorageConfiguration storage; // must be declared after files.
   bool show_config = false;
+  std::optional<std::string> batch_file_name;
+  // The images given by --images and --files-from.
+  std::vector<std::string> image_names;
+  bool multi_image = false;
+  unsigned int jobs = DFS::default_job_count();
+  bool jobs_given = false;
   DFS::DriveAllocation how_to_allocate_drives(DFS::DriveAllocation::PHYSICAL);
   int opt;
   while ((opt=getopt_long(argc, argv, "+", global_opts, &longindex)) != -1)
@@ -301,6 +397,39 @@ int main (int argc, char *argv[])
 	  DFS::verbose = true;
 	  break;
 
+	case OPT_BATCH:
+	  batch_file_name = optarg;
+	  break;
+
+	case OPT_IMAGES:
+	case OPT_FILES_FROM:
+	  {
+	    std::string error;
+	    const bool ok = (opt == OPT_IMAGES)
+	      ? DFS::expand_image_spec(optarg, &image_names, &error)
+	      : DFS::read_image_list(optarg, &image_names, &error);
+	    if (!ok)
+	      {
+		std::cerr << error << "\n";
+		return 1;
+	      }
+	    multi_image = true;
+	    break;
+	  }
+
+	case OPT_JOBS:
+	  {
+	    std::optional<unsigned int> n = DFS::parse_job_count(optarg);
+	    if (!n)
+	      {
+		std::cerr << "--jobs needs a number between 1 and 256\n";
+		return 1;
+	      }
+	    jobs = *n;
+	    jobs_given = true;
+	    break;
+	  }
+
 	case OPT_HELP:
 	  {
 	    DFS::CommandHelp help;
@@ -308,33 +437,60 @@ int main (int argc, char *argv[])
 	  }
 	}
     }
-  if (optind == argc)
+  if (batch_file_name)
+    {
+      if (optind < argc)
+	{
+	  std::cerr << "Please specify commands either with --batch or on the "
+		    << "command line, not both\n";
+	  return 1;
+	}
+    }
+  else if (optind == argc)
     {
       std::cerr << "Please specify a command (try \"help\")\n";
       return 1;
     }
-  const std::string cmd_name = argv[optind];
-  if (optind < argc)
-    extra_args.assign(&argv[optind], &argv[argc]);
-
-  auto instance = DFS::CIReg::get_command(cmd_name);
-  if (0 == instance)
+  else
     {
-      std::cerr << "unknown command " << cmd_name << "\n";
-      return 1;
+      extra_args.assign(&argv[optind], &argv[argc]);
     }
 
-  try
+  if (multi_image)
     {
-      if (show_config)
+      if (!files.empty() || batch_file_name || show_config)
+	{
+	  std::cerr << "--images and --files-from cannot be used with "
+		    << "--file, --batch or --show-config\n";
+	  return 1;
+	}
+      const DFS::CommandInterface* cmd = DFS::CIReg::get_command(extra_args[0]);
+      if (cmd == 0)
 	{
-	  storage.show_drive_configuration(std::cerr);
+	  std::cerr << "unknown command " << extra_args[0] << "\n";
+	  return 1;
+	}
+      if (!cmd->supports_multiple_images())
+	{
+	  std::cerr << "The " << extra_args[0] << " command cannot be used with "
+		    << "--images or --files-from\n";
+	  return 1;
 	}
-      return instance->invoke(storage, ctx, extra_args) ? 0 : 1;
+      return DFS::run_for_each_image(image_names, how_to_allocate_drives, ctx,
+				     extra_args, jobs) ? 0 : 1;
     }
-  catch (std::exception& e)
+  if (jobs_given)
     {
-      std::cerr << "error: " << e.what() << "\n";
+      // Commands which work in parallel have their own --jobs option.
+      std::cerr << "--jobs can only be used with --images or --files-from\n";
       return 1;
     }
+
+  if (show_config)
+    {
+      storage.show_drive_configuration(std::cerr);
+    }
+  if (batch_file_name)
+    return run_batch(storage, ctx, *batch_file_name) ? 0 : 1;
+  return DFS::run_command(storage, ctx, extra_args) ? 0 : 1;
 }
@@ -39,6 +39,10 @@ namespace DFS
 
   std::unique_ptr<AbstractImageFile> make_image_file(const std::string& file_name, std::string& error);
 
+  // Returns true if make_image_file() would recognise the extension
+  // of file_name (for example, "foo.ssd" or "foo.hfe.gz").
+  bool is_image_file_name(const std::string& file_name);
+
 #if USE_ZLIB
   std::unique_ptr<FileAccess> make_decompressed_file(const std::string& name);
 #endif
@@ -0,0 +1,285 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "minhash.h"
+
+#include <stdlib.h>		// for strtoul
+#include <algorithm>		// for min, max
+#include <limits>		// for numeric_limits
+#include <map>			// for map
+#include <utility>		// for move
+#include <unordered_map>	// for unordered_map
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>		// for _mm256_mullo_epi32, _mm256_min_epu32 etc.
+#else
+#define HAVE_X86_SIMD 0
+#endif
+
+namespace
+{
+  // The bands used for locality-sensitive hashing.  With bands of
+  // two values, a pair of sketches with similarity s becomes a
+  // candidate with probability 1-(1-s^2)^32, which is over 99.9% for
+  // s = 0.5.
+  constexpr size_t band_rows = 2;
+  constexpr size_t bands = DFS::MinHashSketch::size / band_rows;
+
+  constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+  constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+
+  inline uint64_t rotl64(uint64_t x, int n)
+  {
+    return (x << n) | (x >> (64 - n));
+  }
+
+  inline uint64_t load_le64(const DFS::byte* p)
+  {
+    uint64_t result = 0;
+    for (int i = 7; i >= 0; --i)
+      result = (result << 8) | p[i];
+    return result;
+  }
+
+  inline uint64_t finish64(uint64_t h)
+  {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  inline uint32_t finish32(uint32_t h)
+  {
+    h ^= h >> 16;
+    h *= 0x85EBCA6BU;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35U;
+    h ^= h >> 16;
+    return h;
+  }
+
+  // The i'th hash function is finish32(x ^ seeds[i]), where x is the
+  // feature folded to 32 bits.
+  struct Seeds
+  {
+    Seeds()
+    {
+      uint64_t state = 0x5EED5EED5EED5EEDULL;
+      for (uint32_t& s : values)
+	{
+	  state += prime1;
+	  s = static_cast<uint32_t>(finish64(state) >> 32);
+	}
+    }
+
+    alignas(32) std::array<uint32_t, DFS::MinHashSketch::size> values;
+  };
+
+  const Seeds& seeds()
+  {
+    static const Seeds s;
+    return s;
+  }
+
+  void add_portable(uint32_t* mins, uint32_t x)
+  {
+    const uint32_t* s = seeds().values.data();
+    for (size_t i = 0; i < DFS::MinHashSketch::size; ++i)
+      mins[i] = std::min(mins[i], finish32(x ^ s[i]));
+  }
+
+#if HAVE_X86_SIMD
+  // Eight of the hash functions are computed at once.
+  __attribute__((target("avx2")))
+  void add_avx2(uint32_t* mins, uint32_t x)
+  {
+    const uint32_t* s = seeds().values.data();
+    const __m256i feature = _mm256_set1_epi32(static_cast<int>(x));
+    const __m256i c1 = _mm256_set1_epi32(static_cast<int>(0x85EBCA6BU));
+    const __m256i c2 = _mm256_set1_epi32(static_cast<int>(0xC2B2AE35U));
+    for (size_t i = 0; i < DFS::MinHashSketch::size; i += 8)
+      {
+	__m256i h = _mm256_xor_si256(feature,
+				     _mm256_load_si256(reinterpret_cast<const __m256i*>(s + i)));
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+	h = _mm256_mullo_epi32(h, c1);
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+	h = _mm256_mullo_epi32(h, c2);
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+	__m256i* m = reinterpret_cast<__m256i*>(mins + i);
+	_mm256_store_si256(m, _mm256_min_epu32(_mm256_load_si256(m), h));
+      }
+  }
+#endif
+}  // namespace
+
+namespace DFS
+{
+  uint64_t block_hash(const byte* begin, const byte* end)
+  {
+    // Four independent lanes, each consuming one 8-byte word of
+    // every 32 bytes.
+    const size_t len = end - begin;
+    uint64_t lane[4] = {prime1 + prime2, prime2, 0, 0 - prime1};
+    const byte* p = begin;
+    for (; end - p >= 32; p += 32)
+      {
+	for (int k = 0; k < 4; ++k)
+	  lane[k] = rotl64(lane[k] + load_le64(p + 8 * k) * prime2, 31) * prime1;
+      }
+    uint64_t h = rotl64(lane[0], 1) + rotl64(lane[1], 7) + rotl64(lane[2], 12)
+      + rotl64(lane[3], 18);
+    for (; p != end; ++p)
+      h = rotl64(h ^ (*p * prime1), 11) * prime2;
+    return finish64(h ^ len);
+  }
+
+  MinHashSketch::MinHashSketch()
+    : features_(0)
+  {
+    mins_.fill(std::numeric_limits<uint32_t>::max());
+  }
+
+  void MinHashSketch::add(uint64_t feature, SimdLevel level)
+  {
+    ++features_;
+    const uint32_t x = static_cast<uint32_t>(feature ^ (feature >> 32));
+#if HAVE_X86_SIMD
+    if (level > best_simd_level())
+      level = best_simd_level();
+    if (level == SimdLevel::AVX2)
+      {
+	add_avx2(mins_.data(), x);
+	return;
+      }
+#else
+    (void)level;
+#endif
+    add_portable(mins_.data(), x);
+  }
+
+  double MinHashSketch::similarity(const MinHashSketch& other) const
+  {
+    size_t same = 0;
+    for (size_t i = 0; i < size; ++i)
+      {
+	if (mins_[i] == other.mins_[i])
+	  ++same;
+      }
+    return static_cast<double>(same) / size;
+  }
+
+  std::string MinHashSketch::encode() const
+  {
+    static const char digits[] = "0123456789abcdef";
+    std::string result(std::to_string(features_));
+    result.push_back(' ');
+    for (uint32_t v : mins_)
+      {
+	for (int shift = 28; shift >= 0; shift -= 4)
+	  result.push_back(digits[(v >> shift) & 0x0F]);
+      }
+    return result;
+  }
+
+  std::optional<MinHashSketch> MinHashSketch::decode(const std::string& s)
+  {
+    const size_t space = s.find(' ');
+    if (space == 0 || space == std::string::npos || s.size() - space - 1 != size * 8)
+      return std::nullopt;
+    MinHashSketch result;
+    const std::string count(s.substr(0, space));
+    if (count.find_first_not_of("0123456789") != std::string::npos)
+      return std::nullopt;
+    result.features_ = strtoul(count.c_str(), NULL, 10);
+    const char* p = s.c_str() + space + 1;
+    for (size_t i = 0; i < size; ++i)
+      {
+	uint32_t v = 0;
+	for (int k = 0; k < 8; ++k, ++p)
+	  {
+	    const char ch = *p;
+	    int digit;
+	    if (ch >= '0' && ch <= '9')
+	      digit = ch - '0';
+	    else if (ch >= 'a' && ch <= 'f')
+	      digit = ch - 'a' + 10;
+	    else
+	      return std::nullopt;
+	    v = (v << 4) | static_cast<uint32_t>(digit);
+	  }
+	result.mins_[i] = v;
+      }
+    return result;
+  }
+
+  std::vector<std::vector<size_t>> find_similar_groups(const std::vector<MinHashSketch>& sketches,
+						       double threshold)
+  {
+    // Union-find over the indexes of the sketches.  The root of each
+    // group is its first member.
+    std::vector<size_t> parent(sketches.size());
+    for (size_t i = 0; i < parent.size(); ++i)
+      parent[i] = i;
+    auto find_root = [&parent](size_t i)
+		     {
+		       while (parent[i] != i)
+			 {
+			   parent[i] = parent[parent[i]];
+			   i = parent[i];
+			 }
+		       return i;
+		     };
+
+    for (size_t band = 0; band < bands; ++band)
+      {
+	// Group the sketches by the values in this band.  Each bucket
+	// is represented by its first member, and the others are
+	// compared only with that one, so that a bucket of k identical
+	// sketches costs k comparisons rather than k^2.
+	std::unordered_map<uint64_t, size_t> representative;
+	for (size_t i = 0; i < sketches.size(); ++i)
+	  {
+	    if (!sketches[i].features())
+	      continue;
+	    uint64_t key = band;
+	    for (size_t r = 0; r < band_rows; ++r)
+	      key = (key << 32) ^ sketches[i].value(band * band_rows + r);
+	    auto inserted = representative.emplace(finish64(key), i);
+	    if (inserted.second)
+	      continue;
+	    const size_t rep = inserted.first->second;
+	    const size_t a = find_root(rep), b = find_root(i);
+	    if (a != b && sketches[rep].similarity(sketches[i]) >= threshold)
+	      parent[std::max(a, b)] = std::min(a, b);
+	  }
+      }
+
+    std::map<size_t, std::vector<size_t>> by_root;
+    for (size_t i = 0; i < sketches.size(); ++i)
+      by_root[find_root(i)].push_back(i);
+    std::vector<std::vector<size_t>> result;
+    for (auto& g : by_root)
+      {
+	if (g.second.size() > 1)
+	  result.push_back(std::move(g.second));
+      }
+    return result;
+  }
+}  // namespace DFS
@@ -0,0 +1,95 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// MinHash sketches, for estimating how similar two discs are.  Each
+// disc is described by a set of features (here, hashes of its
+// sectors and of the pieces of its files), and the sketch keeps the
+// smallest value of each of several hash functions over the set.  The
+// proportion of those values which two sketches share estimates the
+// Jaccard similarity of the two sets.
+#ifndef INC_MINHASH_H
+#define INC_MINHASH_H 1
+
+#include <stddef.h>		// for size_t
+#include <stdint.h>		// for uint32_t, uint64_t
+#include <array>		// for array
+#include <optional>		// for optional
+#include <string>		// for string
+#include <vector>		// for vector
+
+#include "dfstypes.h"		// for byte
+#include "textconv.h"		// for SimdLevel, best_simd_level
+
+namespace DFS
+{
+  // A 64-bit hash of a block of bytes (such as a sector).  This is
+  // not a cryptographic hash, and the result is the same on every
+  // platform.
+  uint64_t block_hash(const byte* begin, const byte* end);
+
+  class MinHashSketch
+  {
+  public:
+    static constexpr size_t size = 64;
+
+    MinHashSketch();
+    // Add a feature to the set summarised by the sketch.  The level
+    // argument is for testing; a level better than best_simd_level()
+    // is reduced to it.
+    void add(uint64_t feature, SimdLevel level = best_simd_level());
+    // The number of calls to add().
+    unsigned long features() const
+    {
+      return features_;
+    }
+    // The estimated Jaccard similarity (between 0 and 1) of the sets
+    // summarised by this sketch and other.
+    double similarity(const MinHashSketch& other) const;
+    // The minimum value of the i'th hash function.
+    uint32_t value(size_t i) const
+    {
+      return mins_[i];
+    }
+    bool operator==(const MinHashSketch& other) const
+    {
+      return mins_ == other.mins_ && features_ == other.features_;
+    }
+
+    // A textual form of the sketch (which includes the number of
+    // features), and its inverse.
+    std::string encode() const;
+    static std::optional<MinHashSketch> decode(const std::string& s);
+
+  private:
+    alignas(32) std::array<uint32_t, size> mins_;
+    unsigned long features_;
+  };
+
+  // Return the groups of sketches which are similar to each other,
+  // as indexes into sketches.  Sketches are joined into a group when
+  // their estimated similarity is at least threshold.  Instead of
+  // comparing every pair, locality-sensitive hashing is used: the
+  // sketches which agree on every value in a band of the sketch are
+  // compared with one of their number.  So comparing many sketches
+  // is quick, even where thousands of them are the same, but a pair
+  // which is only a little above the threshold may occasionally be
+  // missed.  Each group has at least two members, in ascending order,
+  // and the groups are ordered by their first members.  Sketches
+  // having no features are not compared.
+  std::vector<std::vector<size_t>> find_similar_groups(const std::vector<MinHashSketch>& sketches,
+						       double threshold);
+}  // namespace DFS
+
+#endif
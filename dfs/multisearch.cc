@@ -0,0 +1,110 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "multisearch.h"
+
+#include <algorithm>		// for stable_sort
+#include <deque>		// for deque
+#include <stdexcept>		// for invalid_argument
+
+namespace DFS
+{
+  MultiPatternMatcher::MultiPatternMatcher(const std::vector<Pattern>& patterns)
+  {
+    // First build the trie of the patterns, in which a missing
+    // transition is marked as none.
+    constexpr uint32_t none = ~uint32_t(0);
+    std::vector<uint32_t> trie(256, none);
+    std::vector<std::vector<uint32_t>> ends(1);
+    for (size_t i = 0; i < patterns.size(); ++i)
+      {
+	const Pattern& pattern(patterns[i]);
+	if (pattern.empty())
+	  throw std::invalid_argument("search patterns must not be empty");
+	lengths_.push_back(pattern.size());
+	uint32_t node = 0;
+	for (byte b : pattern)
+	  {
+	    uint32_t next = trie[node * 256u + b];
+	    if (next == none)
+	      {
+		next = static_cast<uint32_t>(ends.size());
+		trie[node * 256u + b] = next;
+		ends.emplace_back();
+		trie.resize(trie.size() + 256, none);
+	      }
+	    node = next;
+	  }
+	ends[node].push_back(static_cast<uint32_t>(i));
+      }
+
+    // Then visit the nodes in breadth-first order, so that the
+    // failure node (the node for the longest proper suffix which is
+    // also in the trie) of each node is complete before it is needed.
+    // Missing transitions are replaced by those of the failure node,
+    // turning the trie into a DFA.
+    const size_t nodes = ends.size();
+    std::vector<uint32_t> failure(nodes, 0);
+    std::deque<uint32_t> queue;
+    for (unsigned int b = 0; b < 256; ++b)
+      {
+	uint32_t& next = trie[b];
+	if (next == none)
+	  next = 0;
+	else
+	  queue.push_back(next);
+      }
+    while (!queue.empty())
+      {
+	const uint32_t node = queue.front();
+	queue.pop_front();
+	// A node's failure node is closer to the root, so its outputs
+	// are already complete.
+	const std::vector<uint32_t>& inherited(ends[failure[node]]);
+	ends[node].insert(ends[node].end(), inherited.begin(), inherited.end());
+	for (unsigned int b = 0; b < 256; ++b)
+	  {
+	    uint32_t& next = trie[node * 256u + b];
+	    const uint32_t fallback = trie[failure[node] * 256u + b];
+	    if (next == none)
+	      {
+		next = fallback;
+	      }
+	    else
+	      {
+		failure[next] = fallback;
+		queue.push_back(next);
+	      }
+	  }
+      }
+    delta_ = std::move(trie);
+
+    accepting_.resize(nodes);
+    output_start_.reserve(nodes + 1);
+    for (size_t node = 0; node < nodes; ++node)
+      {
+	std::vector<uint32_t>& out(ends[node]);
+	std::stable_sort(out.begin(), out.end(),
+			 [this](uint32_t a, uint32_t b)
+			 {
+			   return lengths_[a] > lengths_[b];
+			 });
+	accepting_[node] = !out.empty();
+	output_start_.push_back(static_cast<uint32_t>(outputs_.size()));
+	outputs_.insert(outputs_.end(), out.begin(), out.end());
+      }
+    output_start_.push_back(static_cast<uint32_t>(outputs_.size()));
+  }
+}  // namespace DFS
@@ -0,0 +1,104 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Searching for many patterns at once, using the Aho-Corasick
+// algorithm.  The patterns are compiled into a deterministic
+// automaton, so each byte searched costs one table lookup however
+// many patterns there are.
+#ifndef INC_MULTISEARCH_H
+#define INC_MULTISEARCH_H 1
+
+#include <stddef.h>		// for size_t
+#include <stdint.h>		// for uint32_t
+#include <vector>		// for vector
+
+#include "dfstypes.h"		// for byte
+
+namespace DFS
+{
+  class MultiPatternMatcher
+  {
+  public:
+    using Pattern = std::vector<byte>;
+
+    // Throws std::invalid_argument if a pattern is empty.
+    explicit MultiPatternMatcher(const std::vector<Pattern>& patterns);
+
+    // The progress of a scan through a stream of data which is
+    // presented in several blocks; matches which span the boundary
+    // between blocks are found.
+    class State
+    {
+    public:
+      unsigned long position() const
+      {
+	return pos_;
+      }
+
+    private:
+      friend class MultiPatternMatcher;
+      uint32_t node_ = 0;
+      unsigned long pos_ = 0;	// stream offset of the next byte
+    };
+
+    size_t pattern_length(size_t pattern) const
+    {
+      return lengths_[pattern];
+    }
+
+    // Scan the next block of the stream, calling on_match(pattern,
+    // offset) for each occurrence of a pattern which ends within the
+    // block.  pattern is the index of the pattern in the vector given
+    // to the constructor, and offset is the position of its first byte
+    // within the stream.  Matches are reported in order of their end
+    // positions; where several patterns end at the same place, the
+    // longest is reported first.
+    template <class OnMatch>
+    void scan(State* state, const byte* begin, const byte* end, OnMatch&& on_match) const
+    {
+      const uint32_t* delta = delta_.data();
+      const unsigned char* accepting = accepting_.data();
+      uint32_t node = state->node_;
+      for (const byte* p = begin; p != end; ++p)
+	{
+	  node = delta[node * 256u + *p];
+	  if (accepting[node])
+	    {
+	      const unsigned long match_end = state->pos_ + (p - begin) + 1;
+	      for (uint32_t i = output_start_[node]; i < output_start_[node + 1]; ++i)
+		{
+		  const uint32_t pattern = outputs_[i];
+		  on_match(static_cast<size_t>(pattern), match_end - lengths_[pattern]);
+		}
+	    }
+	}
+      state->node_ = node;
+      state->pos_ += end - begin;
+    }
+
+  private:
+    // delta_[node * 256 + b] is the node reached from node on byte b.
+    std::vector<uint32_t> delta_;
+    // accepting_[node] is nonzero if some pattern ends at node.
+    std::vector<unsigned char> accepting_;
+    // The patterns ending at node are
+    // outputs_[output_start_[node]...output_start_[node+1]-1].
+    std::vector<uint32_t> output_start_;
+    std::vector<uint32_t> outputs_;
+    std::vector<size_t> lengths_;
+  };
+}  // namespace DFS
+
+#endif
@@ -22,7 +22,7 @@
 #include "abstractio.h"  // for SectorBuffer, DataAccess
 #include "dfs.h"         // for safe_unsigned_multiply
 #include "dfs_unused.h"  // for SectorMap
-#include "exceptions.h"  // for BadFileSystem
+#include "exceptions.h"  // for BadFileSystem, bad_file_system_message
 #include "geometry.h"    // for Geometry
 
 namespace DFS
@@ -38,10 +38,35 @@ namespace DFS
       return OpusDiscCatalogue(*got, geom);
     }
 
-    OpusDiscCatalogue::OpusDiscCatalogue(const DFS::SectorBuffer& sector16,
-					 std::optional<const DFS::Geometry> geom)
+    OpusDiscCatalogue::OpusDiscCatalogue(const DFS::SectorBuffer& sector16)
       : total_disc_sectors_((sector16[1] << 8) | sector16[2]),
 	sectors_per_track_(sector16[3])
+    {
+    }
+
+    OpusDiscCatalogue::OpusDiscCatalogue(const DFS::SectorBuffer& sector16,
+					 std::optional<const DFS::Geometry> geom)
+      : OpusDiscCatalogue(sector16)
+    {
+      std::string error;
+      if (!find_volumes(sector16, geom, error))
+	throw DFS::BadFileSystem::from_error(error);
+    }
+
+    std::optional<OpusDiscCatalogue>
+    OpusDiscCatalogue::parse(const DFS::SectorBuffer& sector16,
+			     std::optional<const DFS::Geometry> geom,
+			     std::string& error)
+    {
+      OpusDiscCatalogue result(sector16);
+      if (!result.find_volumes(sector16, geom, error))
+	return std::nullopt;
+      return result;
+    }
+
+    bool OpusDiscCatalogue::find_volumes(const DFS::SectorBuffer& sector16,
+					 std::optional<const DFS::Geometry> geom,
+					 std::string& error)
     {
       if (geom)
 	{
@@ -52,11 +77,13 @@ namespace DFS
 		 << total_disc_sectors_ << " from sector 16, "
 		 << geom->total_sectors() << " from the disc image geometry) "
 		 << "in Opus DDOS disc catalogue";
-	      throw DFS::BadFileSystem(os.str());
+	      error = DFS::bad_file_system_message(os.str());
+	      return false;
 	    }
 	  if (sectors_per_track_ != geom->sectors)
 	    {
-	      throw DFS::BadFileSystem("inconsistent sectors-per-ttrack in Opus DDOS disc catalogue");
+	      error = DFS::bad_file_system_message("inconsistent sectors-per-ttrack in Opus DDOS disc catalogue");
+	      return false;
 	    }
 	}
 
@@ -77,7 +104,8 @@ namespace DFS
 		  os << "Opus DDOS volume " << label << " has starting track "
 		     << std::dec << std::setw(0) << track << " but the disc itself "
 		     << "only has " << geom->cylinders << " tracks";
-		  throw DFS::BadFileSystem(os.str());
+		  error = DFS::bad_file_system_message(os.str());
+		  return false;
 		}
 	    }
 	  auto start = DFS::safe_unsigned_multiply(track, sectors_per_track_);
@@ -97,11 +125,13 @@ namespace DFS
 		 << std::dec << std::setw(0) << it->start_sector()
 		 << " but the disc itself "
 		 << "only has " << total_disc_sectors_ << " sectors";
-	      throw DFS::BadFileSystem(os.str());
+	      error = DFS::bad_file_system_message(os.str());
+	      return false;
 	    }
 	  it->set_next_sector(next_sector);
 	  next_sector = it->start_sector();
 	}
+      return true;
     }
 
     const std::vector<OpusDiscCatalogue::VolumeLocation>
@@ -19,6 +19,7 @@
 #include <assert.h>      // for assert
 #include <limits>        // for numeric_limits
 #include <optional>      // for optional
+#include <string>        // for string
 #include <vector>        // for vector
 #include "abstractio.h"  // for SectorBuffer
 #include "dfstypes.h"    // for sector_count_type
@@ -90,12 +91,24 @@ namespace DFS
       // this while probing the image file in order to guess what's in
       // it.  This means we don't always have an accurate idea yet of
       // what's in the image file (e.g. the sectors per track).
+      //
+      // Throws BadFileSystem if the catalogue is inconsistent.
       explicit OpusDiscCatalogue(const DFS::SectorBuffer& sector16,
 				 std::optional<const DFS::Geometry> geom);
+      // As the constructor, but returns nullopt and sets error
+      // instead of throwing.
+      static std::optional<OpusDiscCatalogue> parse(const DFS::SectorBuffer& sector16,
+						    std::optional<const DFS::Geometry> geom,
+						    std::string& error);
       const std::vector<VolumeLocation> get_volume_locations() const;
       void map_sectors(DFS::SectorMap*) const;
 
     private:
+      explicit OpusDiscCatalogue(const DFS::SectorBuffer& sector16);
+      bool find_volumes(const DFS::SectorBuffer& sector16,
+			std::optional<const DFS::Geometry> geom,
+			std::string& error);
+
       DFS::sector_count_type total_disc_sectors_;
       unsigned int sectors_per_track_;
       // we don't store the total track count because we see it set to 0 anyway.
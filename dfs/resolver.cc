@@ -0,0 +1,179 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "resolver.h"
+
+#include <algorithm>     // for min
+#include <limits>        // for numeric_limits
+#include <memory>        // for make_unique, unique_ptr
+#include <stdexcept>     // for range_error
+#include <utility>       // for make_pair, pair
+
+#include "dfs.h"         // for safe_unsigned_multiply
+
+namespace
+{
+  using DFS::SectorLayout;
+
+  constexpr unsigned long unlimited = std::numeric_limits<unsigned long>::max();
+
+  enum class Striding
+    {
+     Identity,			// leave == 0
+     Interleave2,		// leave == take
+     General
+    };
+
+  // Stride<S>::position(y) is the position of device sector y relative
+  // to the start of the device's data in the file, and run(y) is the
+  // number of sectors stored contiguously from y.
+  template <Striding S> struct Stride;
+
+  template <> struct Stride<Striding::Identity>
+  {
+    static unsigned long position(unsigned long y, unsigned long, unsigned long)
+    {
+      return y;
+    }
+
+    static unsigned long run(unsigned long, unsigned long)
+    {
+      return unlimited;
+    }
+  };
+
+  template <> struct Stride<Striding::Interleave2>
+  {
+    static unsigned long position(unsigned long y, unsigned long take, unsigned long)
+    {
+      // Each group of take sectors is followed by take sectors of the
+      // other side.
+      return y + (y / take) * take;
+    }
+
+    static unsigned long run(unsigned long y, unsigned long take)
+    {
+      return take - y % take;
+    }
+  };
+
+  template <> struct Stride<Striding::General>
+  {
+    static unsigned long position(unsigned long y, unsigned long take, unsigned long leave)
+    {
+      return y + (y / take) * leave;
+    }
+
+    static unsigned long run(unsigned long y, unsigned long take)
+    {
+      return take - y % take;
+    }
+  };
+
+  template <Striding S>
+  class Resolver : public DFS::SectorResolver
+  {
+  public:
+    explicit Resolver(const SectorLayout& layout)
+      : file_(*layout.file), origin_(layout.origin), limit_(layout.limit),
+	skip_(layout.skip), take_(layout.take), leave_(layout.leave)
+    {
+    }
+
+    std::optional<std::pair<unsigned long, unsigned long>>
+    locate(unsigned long lba, unsigned long count) const override
+    {
+      if (lba >= limit_)
+	return std::nullopt;
+      const unsigned long y = origin_ + lba;
+      const unsigned long pos = skip_ + Stride<S>::position(y, take_, leave_);
+      const unsigned long run = std::min({count, limit_ - lba, Stride<S>::run(y, take_)});
+      return std::make_pair(pos * DFS::SECTOR_BYTES, run);
+    }
+
+    unsigned long read_blocks(unsigned long lba, unsigned long count,
+			      DFS::byte* out) const override
+    {
+      unsigned long done = 0;
+      while (done < count)
+	{
+	  const auto where = locate(lba + done, count - done);
+	  if (!where)
+	    break;
+	  const unsigned long want = where->second * DFS::SECTOR_BYTES;
+	  const unsigned long got = file_.read_into(where->first, want,
+						    out + done * DFS::SECTOR_BYTES);
+	  // A partial sector at the end of the file is not counted.
+	  done += got / DFS::SECTOR_BYTES;
+	  if (got < want)
+	    break;
+	}
+      return done;
+    }
+
+  private:
+    DFS::FileAccess& file_;
+    const unsigned long origin_;
+    const unsigned long limit_;
+    const unsigned long skip_;
+    const unsigned long take_;
+    const unsigned long leave_;
+  };
+
+  unsigned long checked_add(unsigned long a, unsigned long b)
+  {
+    if (unlimited - a < b)
+      throw std::range_error("overflow in checked_add");
+    return a + b;
+  }
+
+  // Returns false if the byte offset of some sector of the layout
+  // would not fit in an unsigned long.
+  bool fits(const SectorLayout& l)
+  {
+    try
+      {
+	const unsigned long y = checked_add(l.origin, l.limit - 1);
+	const unsigned long stride = checked_add(l.take, l.leave);
+	const unsigned long pos =
+	  checked_add(checked_add(l.skip, DFS::safe_unsigned_multiply(y / l.take, stride)),
+		      y % l.take);
+	DFS::safe_unsigned_multiply(checked_add(pos, 1), static_cast<unsigned long>(DFS::SECTOR_BYTES));
+	return true;
+      }
+    catch (std::range_error&)
+      {
+	return false;
+      }
+  }
+}  // namespace
+
+namespace DFS
+{
+  SectorResolver::~SectorResolver()
+  {
+  }
+
+  std::unique_ptr<SectorResolver> make_sector_resolver(const SectorLayout& layout)
+  {
+    if (layout.file == nullptr || layout.take == 0 || layout.limit == 0 || !fits(layout))
+      return nullptr;
+    if (layout.leave == 0)
+      return std::make_unique<Resolver<Striding::Identity>>(layout);
+    if (layout.leave == layout.take)
+      return std::make_unique<Resolver<Striding::Interleave2>>(layout);
+    return std::make_unique<Resolver<Striding::General>>(layout);
+  }
+}  // namespace DFS
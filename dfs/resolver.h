@@ -0,0 +1,56 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// SectorResolver reads the sectors of a device directly from the file
+// holding them, given a SectorLayout saying where they are, instead
+// of passing each read down through the chain of DataAccess objects
+// (volume, cache, view, file) which present the device.
+#ifndef INC_RESOLVER_H
+#define INC_RESOLVER_H 1
+
+#include <memory>        // for unique_ptr
+#include <optional>      // for optional
+#include <utility>       // for pair
+
+#include "abstractio.h"  // for SectorLayout
+#include "dfstypes.h"    // for byte
+
+namespace DFS
+{
+  class SectorResolver
+  {
+  public:
+    virtual ~SectorResolver();
+
+    // Return the byte offset in the file of sector lba, and the number
+    // of sectors (at most count, which must be non-zero) stored
+    // contiguously from there.  Returns an empty optional if lba is
+    // outside the device.
+    virtual std::optional<std::pair<unsigned long, unsigned long>>
+    locate(unsigned long lba, unsigned long count) const = 0;
+
+    // As DataAccess::read_blocks().
+    virtual unsigned long read_blocks(unsigned long lba, unsigned long count, byte* out) const = 0;
+  };
+
+  // The mapping is computed once, here, and specialised for the
+  // common layouts: SSD and MMB images (no gaps) and DSD and DDD
+  // images (the two sides alternate track by track).  Returns null if
+  // the layout cannot be resolved directly, for example because some
+  // positions would not fit in an unsigned long.
+  std::unique_ptr<SectorResolver> make_sector_resolver(const SectorLayout& layout);
+}  // namespace DFS
+
+#endif
@@ -0,0 +1,258 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "sha256.h"
+
+#include <string.h>		// for memcpy
+#include <algorithm>		// for min
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_SHA_EXTENSIONS 1
+#include <cpuid.h>		// for __get_cpuid, __get_cpuid_count, bit_SHA
+#include <immintrin.h>		// for _mm_sha256rnds2_epu32 etc.
+#else
+#define HAVE_SHA_EXTENSIONS 0
+#endif
+
+namespace
+{
+  alignas(16) const uint32_t K[64] =
+    {
+     0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+     0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+     0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+     0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+     0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+     0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+     0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+     0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+  inline uint32_t rotr(uint32_t x, int n)
+  {
+    return (x >> n) | (x << (32 - n));
+  }
+
+  void compress_portable(uint32_t* state, const uint8_t* data, size_t blocks)
+  {
+    for (; blocks; --blocks, data += 64)
+      {
+	uint32_t w[64];
+	for (int i = 0; i < 16; ++i)
+	  {
+	    w[i] = (uint32_t(data[4 * i]) << 24) | (uint32_t(data[4 * i + 1]) << 16)
+	      | (uint32_t(data[4 * i + 2]) << 8) | uint32_t(data[4 * i + 3]);
+	  }
+	for (int i = 16; i < 64; ++i)
+	  {
+	    const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+	    const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+	    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	  }
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+	for (int i = 0; i < 64; ++i)
+	  {
+	    const uint32_t S1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+	    const uint32_t ch = (e & f) ^ (~e & g);
+	    const uint32_t t1 = h + S1 + ch + K[i] + w[i];
+	    const uint32_t S0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+	    const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+	    const uint32_t t2 = S0 + maj;
+	    h = g;
+	    g = f;
+	    f = e;
+	    e = d + t1;
+	    d = c;
+	    c = b;
+	    b = a;
+	    a = t1 + t2;
+	  }
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+      }
+  }
+
+#if HAVE_SHA_EXTENSIONS
+  bool cpu_has_sha_extensions()
+  {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+      return false;
+    if (!(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1))
+      return false;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+      return false;
+    return ebx & bit_SHA;
+  }
+
+  // The SHA extensions work on the state in the order ABEF and CDGH,
+  // four rounds (two calls to sha256rnds2) at a time.
+  __attribute__((target("sha,sse4.1")))
+  void compress_sha_extensions(uint32_t* state, const uint8_t* data, size_t blocks)
+  {
+    const __m128i byteswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);			// CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);		// EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);	// ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);	// CDGH
+
+    for (; blocks; --blocks, data += 64)
+      {
+	const __m128i abef_save = state0;
+	const __m128i cdgh_save = state1;
+	__m128i msg[4];
+	for (int i = 0; i < 16; ++i)
+	  {
+	    __m128i w;
+	    if (i < 4)
+	      {
+		w = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)),
+				     byteswap);
+	      }
+	    else
+	      {
+		// W[t-16] + sigma0(W[t-15]) + W[t-7] + sigma1(W[t-2]),
+		// for four values of t.
+		w = _mm_sha256msg1_epu32(msg[i & 3], msg[(i - 3) & 3]);
+		w = _mm_add_epi32(w, _mm_alignr_epi8(msg[(i - 1) & 3], msg[(i - 2) & 3], 4));
+		w = _mm_sha256msg2_epu32(w, msg[(i - 1) & 3]);
+	      }
+	    msg[i & 3] = w;
+	    __m128i wk = _mm_add_epi32(w, _mm_load_si128(reinterpret_cast<const __m128i*>(&K[4 * i])));
+	    state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+	    wk = _mm_shuffle_epi32(wk, 0x0E);
+	    state0 = _mm_sha256rnds2_epu32(state0, state1, wk);
+	  }
+	state0 = _mm_add_epi32(state0, abef_save);
+	state1 = _mm_add_epi32(state1, cdgh_save);
+      }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);		// FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);		// DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);	// DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);		// ABEF
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+  }
+#endif
+}  // namespace
+
+namespace DFS
+{
+  SHA256::SHA256(bool allow_hardware)
+    : state_({0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}),
+      buf_len_(0),
+      total_len_(0),
+      use_hardware_(allow_hardware && hardware_available())
+  {
+  }
+
+  bool SHA256::hardware_available()
+  {
+#if HAVE_SHA_EXTENSIONS
+    static const bool available = cpu_has_sha_extensions();
+    return available;
+#else
+    return false;
+#endif
+  }
+
+  void SHA256::compress(const uint8_t* blocks, size_t count)
+  {
+#if HAVE_SHA_EXTENSIONS
+    if (use_hardware_)
+      {
+	compress_sha_extensions(state_.data(), blocks, count);
+	return;
+      }
+#endif
+    compress_portable(state_.data(), blocks, count);
+  }
+
+  void SHA256::update(const uint8_t* start, const uint8_t *end)
+  {
+    size_t len = end - start;
+    total_len_ += len;
+    if (buf_len_)
+      {
+	const size_t n = std::min(len, buf_.size() - buf_len_);
+	memcpy(buf_.data() + buf_len_, start, n);
+	buf_len_ += n;
+	start += n;
+	len -= n;
+	if (buf_len_ < buf_.size())
+	  return;
+	compress(buf_.data(), 1);
+	buf_len_ = 0;
+      }
+    // Whole blocks are hashed where they are, without copying.
+    const size_t blocks = len / 64;
+    if (blocks)
+      compress(start, blocks);
+    start += blocks * 64;
+    len -= blocks * 64;
+    memcpy(buf_.data(), start, len);
+    buf_len_ = len;
+  }
+
+  SHA256::Digest SHA256::finish()
+  {
+    const uint64_t bits = total_len_ * 8;
+    buf_[buf_len_++] = 0x80;
+    if (buf_len_ > 56)
+      {
+	memset(buf_.data() + buf_len_, 0, buf_.size() - buf_len_);
+	compress(buf_.data(), 1);
+	buf_len_ = 0;
+      }
+    memset(buf_.data() + buf_len_, 0, 56 - buf_len_);
+    for (int i = 0; i < 8; ++i)
+      buf_[56 + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    compress(buf_.data(), 1);
+
+    Digest result;
+    for (int i = 0; i < 8; ++i)
+      {
+	result[4 * i] = static_cast<uint8_t>(state_[i] >> 24);
+	result[4 * i + 1] = static_cast<uint8_t>(state_[i] >> 16);
+	result[4 * i + 2] = static_cast<uint8_t>(state_[i] >> 8);
+	result[4 * i + 3] = static_cast<uint8_t>(state_[i]);
+      }
+    return result;
+  }
+
+  std::string SHA256::hex(const Digest& d)
+  {
+    static const char digits[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(2 * d.size());
+    for (uint8_t b : d)
+      {
+	result.push_back(digits[b >> 4]);
+	result.push_back(digits[b & 0x0F]);
+      }
+    return result;
+  }
+}  // namespace DFS
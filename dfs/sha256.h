@@ -0,0 +1,59 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// SHA-256, as specified in FIPS 180-4.  On x86 processors having the
+// SHA extensions, these are used; otherwise a portable
+// implementation is used.
+#ifndef INC_SHA256_H
+#define INC_SHA256_H 1
+
+#include <stddef.h>		// for size_t
+#include <stdint.h>		// for uint8_t, uint32_t, uint64_t
+#include <array>		// for array
+#include <string>		// for string
+
+namespace DFS
+{
+  class SHA256
+  {
+  public:
+    using Digest = std::array<uint8_t, 32>;
+
+    // If allow_hardware is false, the portable implementation is
+    // used even if the processor has the SHA extensions (this is for
+    // testing).
+    explicit SHA256(bool allow_hardware = true);
+    void update(const uint8_t* start, const uint8_t *end);
+    // Return the digest.  After this, the object must not be used
+    // again.
+    Digest finish();
+
+    // Returns true if this processor has the SHA extensions and we
+    // can use them.
+    static bool hardware_available();
+    static std::string hex(const Digest& d);
+
+  private:
+    void compress(const uint8_t* blocks, size_t count);
+
+    std::array<uint32_t, 8> state_;
+    std::array<uint8_t, 64> buf_;
+    size_t buf_len_;
+    uint64_t total_len_;
+    bool use_hardware_;
+  };
+}  // namespace DFS
+
+#endif
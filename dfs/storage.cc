@@ -23,12 +23,17 @@
 #include <functional>          // for function
 #include <iomanip>             // for operator<<, setw
 #include <iterator>            // for reverse_iterator
+#include <memory>              // for make_unique, unique_ptr
+#include <mutex>               // for unique_lock, call_once, once_flag
 #include <optional>            // for optional, nullopt
+#include <shared_mutex>        // for shared_mutex, shared_lock
 #include <string>              // for string, operator<<, char_traits, basic...
 #include <vector>              // for vector, vector<>::size_type
 #include "dfs_filesystem.h"    // for FileSystem
 #include "dfstypes.h"          // for sector_count_type, byte
 #include "driveselector.h"     // for drive_number, operator<<, SurfaceSelector
+#include "exceptions.h"        // for BaseException
+#include "identify.h"          // for identify_file_system
 
 using std::vector;
 
@@ -36,22 +41,36 @@ using DFS::byte;
 
 namespace
 {
+  // SectorCache may be used by several threads at once.  Since
+  // sectors are only ever added, most accesses are lookups, which
+  // share the lock.  Nothing is allocated until a sector is cached,
+  // since most of the drives of an MMB file are never read.
   class SectorCache
   {
   public:
-    explicit SectorCache(DFS::sector_count_type initial_sectors)
+    // The catalog of every format we support is in the first few
+    // sectors, and these are the ones read most often.
+    static constexpr unsigned long CACHED_SECTORS = 4;
+
+    unsigned long size() const
     {
-      cache_.resize(initial_sectors);
+      return CACHED_SECTORS;
     }
 
     bool has(unsigned long sec) const
     {
-      return sec < cache_.size() && cache_[sec].get() != 0;
+      if (sec >= CACHED_SECTORS)
+	return false;
+      std::shared_lock<std::shared_mutex> lock(mu_);
+      return cache_[sec].get() != 0;
     }
 
     bool get(unsigned long sec, DFS::SectorBuffer *buf) const
     {
-      if (!has(sec))
+      if (sec >= CACHED_SECTORS)
+	return false;
+      std::shared_lock<std::shared_mutex> lock(mu_);
+      if (!cache_[sec])
 	return false;
       *buf = *(cache_[sec].get());
       return true;
@@ -59,58 +78,17 @@ namespace
 
     void put(unsigned long sec, const DFS::SectorBuffer *buf)
     {
-      if (sec >= cache_.size())
+      if (sec >= CACHED_SECTORS)
 	return;
-      cache_[sec] = std::make_unique<DFS::SectorBuffer>();
-      std::copy(buf->begin(), buf->end(), cache_[sec]->begin());
+      auto copy = std::make_unique<DFS::SectorBuffer>(*buf);
+      std::unique_lock<std::shared_mutex> lock(mu_);
+      if (!cache_[sec])
+	cache_[sec] = std::move(copy);
     }
 
   private:
-    std::vector<std::unique_ptr<DFS::SectorBuffer>> cache_;
-  };
-
-  class CachedDevice : public DFS::AbstractDrive
-  {
-  public:
-    CachedDevice(AbstractDrive* underlying,
-		 DFS::sector_count_type cached_sectors)
-      : underlying_(underlying),
-	cache_(cached_sectors)
-    {
-    }
-
-    ~CachedDevice() override
-    {
-    }
-
-    virtual std::optional<DFS::SectorBuffer> read_block(unsigned long sector) override
-    {
-      DFS::SectorBuffer buf;
-      if (cache_.get(sector, &buf))
-	{
-	  return buf;
-	}
-      std::optional<DFS::SectorBuffer> b = underlying_->read_block(sector);
-      if (b)
-	{
-	  cache_.put(sector, &*b);
-	}
-      return b;
-    }
-
-    std::string description() const override
-    {
-      return underlying_->description();
-    }
-
-    DFS::Geometry geometry() const override
-    {
-      return underlying_->geometry();
-    }
-
-  private:
-    DFS::AbstractDrive* underlying_;
-    mutable SectorCache cache_;
+    mutable std::shared_mutex mu_;
+    std::array<std::unique_ptr<DFS::SectorBuffer>, CACHED_SECTORS> cache_;
   };
 
   template <typename SELECTOR>
@@ -128,9 +106,132 @@ namespace
 
 namespace DFS
 {
+  namespace internal
+  {
+    // CachedDevice keeps copies of the first few sectors of a drive.
+    // The caches are allocated in blocks (see connect_drives), so they
+    // are default-constructed and then attached to their drive.
+    class CachedDevice : public DFS::AbstractDrive
+    {
+    public:
+      CachedDevice()
+	: underlying_(nullptr)
+      {
+      }
+
+      void attach(AbstractDrive* underlying)
+      {
+	underlying_ = underlying;
+      }
+
+      ~CachedDevice() override
+      {
+      }
+
+      virtual std::optional<DFS::SectorBuffer> read_block(unsigned long sector) override
+      {
+	DFS::SectorBuffer buf;
+	if (cache_.get(sector, &buf))
+	  {
+	    return buf;
+	  }
+	std::optional<DFS::SectorBuffer> b = underlying_->read_block(sector);
+	if (b)
+	  {
+	    cache_.put(sector, &*b);
+	  }
+	return b;
+      }
+
+      unsigned long read_blocks(unsigned long sector, unsigned long count, DFS::byte* out) override
+      {
+	const unsigned long got = underlying_->read_blocks(sector, count, out);
+	for (unsigned long i = 0; i < got && sector + i < cache_.size(); ++i)
+	  {
+	    if (cache_.has(sector + i))
+	      continue;
+	    DFS::SectorBuffer buf;
+	    std::copy(out + i * DFS::SECTOR_BYTES, out + (i + 1) * DFS::SECTOR_BYTES, buf.begin());
+	    cache_.put(sector + i, &buf);
+	  }
+	return got;
+      }
+
+      std::optional<DFS::HostExtent> host_extent(unsigned long sector, unsigned long count) override
+      {
+	return underlying_->host_extent(sector, count);
+      }
+
+      // Reads made through the layout bypass the cache, but since the
+      // cache only holds copies of the same data, that is harmless.
+      std::optional<DFS::SectorLayout> sector_layout() override
+      {
+	return underlying_->sector_layout();
+      }
+
+      std::string description() const override
+      {
+	return underlying_->description();
+      }
+
+      DFS::Geometry geometry() const override
+      {
+	return underlying_->geometry();
+      }
+
+      std::vector<DFS::TrackCrcErrors> crc_errors() const override
+      {
+	return underlying_->crc_errors();
+      }
+
+      // Identifies the file system on the drive the first time it is
+      // called; see DriveConfig::identify_later().  Several threads
+      // may call this at once.
+      std::optional<DFS::Format> identified_format(std::string& error)
+      {
+	std::call_once(identified_,
+		       [this]()
+		       {
+			 std::string cause;
+			 try
+			   {
+			     format_ = DFS::identify_file_system(*this, geometry(), false, cause);
+			   }
+			 catch (DFS::BaseException& e)
+			   {
+			     identify_error_ = e.what();
+			   }
+		       });
+	if (!format_)
+	  error = identify_error_;
+	return format_;
+      }
+
+    private:
+      DFS::AbstractDrive* underlying_;
+      mutable SectorCache cache_;
+      std::once_flag identified_;
+      std::optional<DFS::Format> format_;
+      std::string identify_error_;
+    };
+
+  }  // namespace internal
+
   DriveConfig::DriveConfig(std::optional<DFS::Format> fmt, AbstractDrive* p)
-    : fmt_(fmt), drive_(p)
+    : fmt_(fmt), drive_(p), identified_(true)
+  {
+  }
+
+  DriveConfig DriveConfig::identify_later(AbstractDrive* p)
   {
+    DriveConfig result(std::nullopt, p);
+    result.identified_ = false;
+    return result;
+  }
+
+  bool DriveConfig::identified() const
+  {
+    return identified_;
   }
 
   std::optional<Format> DriveConfig::format() const
@@ -147,6 +248,11 @@ namespace DFS
   {
   }
 
+  std::vector<TrackCrcErrors> AbstractDrive::crc_errors() const
+  {
+    return {};
+  }
+
   VolumeMountResult::VolumeMountResult(std::unique_ptr<DFS::FileSystem> fs, DFS::Volume* vol)
     : fs_(std::move(fs)), vol_(vol)
   {
@@ -166,9 +272,17 @@ namespace DFS
   }
 
   StorageConfiguration::StorageConfiguration()
+    : connected_(0)
   {
   }
 
+  StorageConfiguration::~StorageConfiguration()
+  {
+  }
+
+  StorageConfiguration::StorageConfiguration(StorageConfiguration&&) noexcept = default;
+  StorageConfiguration& StorageConfiguration::operator=(StorageConfiguration&&) noexcept = default;
+
   bool check_sequence_fits(DFS::drive_number i,
 			   const std::vector<DriveConfig>::size_type to_do,
 			   std::function<bool(DFS::drive_number)> occupied)
@@ -191,25 +305,31 @@ namespace DFS
     return done == to_do;
   }
 
-  void StorageConfiguration::connect_internal(const DFS::SurfaceSelector& n, const std::optional<DriveConfig>& cfg)
+  void StorageConfiguration::connect_internal(const DFS::SurfaceSelector& n,
+					      const std::optional<DriveConfig>& cfg,
+					      internal::CachedDevice* cache)
   {
-    const sector_count_type cached_sectors = 4;
     assert(!is_drive_connected(n));
-    drives_.emplace(n, cfg);
+    if (n.surface() >= slots_.size())
+      slots_.resize(n.surface() + 1, DriveSlot{false, std::nullopt, nullptr});
+    DriveSlot& slot(slots_[n.surface()]);
+    slot.connected = true;
+    slot.config = cfg;
     if (cfg)
       {
-	caches_[n] = std::make_unique<CachedDevice>(cfg->drive(), cached_sectors);
-      }
-    else
-      {
-	caches_[n] = 0;
+	cache->attach(cfg->drive());
+	slot.cache = cache;
       }
+    ++connected_;
   }
 
   bool StorageConfiguration::connect_drives(const std::vector<std::optional<DriveConfig>>& drives,
 					    DriveAllocation how)
   {
     const auto limit = std::numeric_limits<drive_number>::max();
+    // One allocation holds the caches for all the drives.
+    caches_.push_back(std::make_unique<internal::CachedDevice[]>(drives.size()));
+    internal::CachedDevice* cache = caches_.back().get();
     if (how == DriveAllocation::PHYSICAL)
       {
 	auto occ = [this](DFS::drive_number i) -> bool
@@ -222,9 +342,9 @@ namespace DFS
 	  {
 	    if (check_sequence_fits(n, drives.size(), occ))
 	      {
-		for (auto d : drives)
+		for (const auto& d : drives)
 		  {
-		    connect_internal(n, d);
+		    connect_internal(n, d, cache++);
 		    n = n.next().next();
 		  }
 		return true;
@@ -235,13 +355,13 @@ namespace DFS
     else
       {
 	DFS::drive_number n(0);
-	for (auto d : drives)
+	for (const auto& d : drives)
 	  {
 	    for (; n < limit; n = n.next())
 	      {
 		if (!is_drive_connected(n))
 		  {
-		    connect_internal(n, d);
+		    connect_internal(n, d, cache++);
 		    break;
 		  }
 	      }
@@ -253,38 +373,40 @@ namespace DFS
   std::optional<Format> StorageConfiguration::drive_format(drive_number drive,
 							   std::string& error) const
   {
-    auto it = drives_.find(drive);
-    if (it == drives_.end())
+    const DriveSlot* slot = find_slot(drive);
+    if (!slot)
       {
 	std::ostringstream ss;
 	ss << "there is no disc in drive " << drive << "\n";
 	error = ss.str();
 	return std::nullopt;
       }
-    if (!it->second)
+    if (!slot->config)
       return std::nullopt;	// unformatted
-    return it->second->format();
+    if (!slot->config->identified())
+      return slot->cache->identified_format(error);
+    return slot->config->format();
   }
 
   bool StorageConfiguration::select_drive(const DFS::SurfaceSelector& drive, AbstractDrive **pp,
 					  std::string& error) const
   {
-    auto it = caches_.find(drive);
-    if (it == caches_.end())
+    const DriveSlot* slot = find_slot(drive);
+    if (!slot)
       {
 	std::ostringstream ss;
 	ss << "there is no disc in drive " << drive << "\n";
 	error = ss.str();
 	return false;
       }
-    if (!it->second)
+    if (!slot->cache)
       {
 	std::ostringstream ss;
 	ss << "the disc in drive " << drive << " is unformatted\n";
 	error = ss.str();
 	return false;
       }
-    *pp = it->second.get();
+    *pp = slot->cache;
     return true;
   }
 
@@ -311,32 +433,36 @@ namespace DFS
   std::vector<drive_number> StorageConfiguration::get_all_occupied_drive_numbers() const
   {
     std::vector<drive_number> result;
-    result.reserve(drives_.size());
-    for (const auto& number_and_device : drives_)
-      result.push_back(number_and_device.first);
+    result.reserve(connected_);
+    for (size_t i = 0; i < slots_.size(); ++i)
+      {
+	if (slots_[i].connected)
+	  result.push_back(drive_number(static_cast<drive_number::repr_type>(i)));
+      }
     return result;
   }
 
   void StorageConfiguration::show_drive_configuration(std::ostream& os) const
   {
-    const auto max_drive = drives_.empty() ? DFS::SurfaceSelector(0) : drives_.rbegin()->first;
+    // The last slot is always connected.
+    const auto max_drive = slots_.empty() ? DFS::SurfaceSelector(0)
+      : drive_number(static_cast<drive_number::repr_type>(slots_.size() - 1));
     std::ostringstream ss;
     ss << max_drive;
     const int max_drive_num_len = static_cast<int>(ss.str().size());
 
     auto show = [this, &os, max_drive_num_len](drive_number d)
 		{
-		  auto it = drives_.find(d);
+		  const DriveSlot* slot = find_slot(d);
 		  os << "Drive " << std::setw(max_drive_num_len) << d << ": "
-		     << (it != drives_.end() ? "occupied" : "empty");
-		  if (it != drives_.end())
+		     << (slot ? "occupied" : "empty");
+		  if (slot)
 		    {
-		      assert(is_drive_connected(d));
-		      if (it->second)
+		      if (slot->config)
 			{
-			  os << ", " << it->second->drive()->geometry().description();
+			  os << ", " << slot->config->drive()->geometry().description();
 			  // TODO: consider printing the format description too, here.
-			  os << ", " << it->second->drive()->description();
+			  os << ", " << slot->config->drive()->description();
 			}
 		      else
 			{
@@ -347,9 +473,9 @@ namespace DFS
 		};
 
     drive_number loop_limit = DFS::SurfaceSelector::acorn_default_last_surface();
-    if (!drives_.empty())
+    if (!slots_.empty())
       {
-	loop_limit = std::max(drives_.rbegin()->first, loop_limit);
+	loop_limit = std::max(max_drive, loop_limit);
       }
     drive_number i(0);
     do
@@ -369,7 +495,7 @@ namespace DFS
     std::optional<Format> fmt = drive_format(drive, error);
     if (!fmt)
       return 0;
-    return std::make_unique<FileSystem>(*p, *fmt, p->geometry());
+    return FileSystem::load(*p, *fmt, p->geometry(), error);
   }
 
   std::optional<VolumeMountResult> StorageConfiguration::mount(const DFS::VolumeSelector& vol,
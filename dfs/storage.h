@@ -17,8 +17,8 @@
 #define INC_STORAGE_H 1
 
 #include <assert.h>         // for assert
+#include <stddef.h>         // for size_t
 #include <fstream>          // for ostream
-#include <map>              // for map, _Rb_tree_const_iterator
 #include <memory>           // for unique_ptr
 #include <optional>         // for optional
 #include <string>           // for string
@@ -49,12 +49,24 @@ namespace DFS
      PHYSICAL = 2, // behave as if image files were physical discs
     };
 
+  // TrackCrcErrors records that some records on a track could not be
+  // used because their CRC was wrong.
+  struct TrackCrcErrors
+  {
+    unsigned int track;
+    unsigned int records;
+  };
+
   class AbstractDrive : public DataAccess
   {
   public:
     virtual ~AbstractDrive();
     virtual Geometry geometry() const = 0;
     virtual std::string description() const = 0;
+    // Images which hold the encoded track data (such as HFE files)
+    // return the tracks on which records had a bad CRC.  The default
+    // implementation returns an empty vector.
+    virtual std::vector<TrackCrcErrors> crc_errors() const;
   };
 
   class DriveConfig
@@ -63,8 +75,15 @@ namespace DFS
     //DriveConfig(const DriveConfig&) = default;
     std::optional<Format> format() const;
     DriveConfig(std::optional<Format> fmt, AbstractDrive* p);
+    // The file system on the drive is identified when it is first
+    // needed, rather than when the drive is connected.  Image files
+    // holding thousands of discs (MMB files) use this so that opening
+    // them does not read every disc.
+    static DriveConfig identify_later(AbstractDrive* p);
     ~DriveConfig() {}
     AbstractDrive* drive() const;
+    // Returns false if format() is not yet known.
+    bool identified() const;
 
     DriveConfig& operator=(const DriveConfig&) = default;
     bool operator==(const DriveConfig&);
@@ -72,6 +91,7 @@ namespace DFS
   private:
     std::optional<Format> fmt_;
     AbstractDrive* drive_;	// not owned
+    bool identified_;
   };
 
   class VolumeMountResult
@@ -86,40 +106,65 @@ namespace DFS
     DFS::Volume* vol_;
   };
 
+  namespace internal
+  {
+    class CachedDevice;
+  }
+
+  // Once the drives are connected, the const member functions of
+  // StorageConfiguration (and the drives, file systems and volumes
+  // they return) may be used by several threads at once.
   class StorageConfiguration
   {
   public:
     StorageConfiguration();
+    ~StorageConfiguration();
+    StorageConfiguration(StorageConfiguration&&) noexcept;
+    StorageConfiguration& operator=(StorageConfiguration&&) noexcept;
     bool connect_drives(const std::vector<std::optional<DriveConfig>>& sides,
 			DriveAllocation how);
 
     bool is_drive_connected(drive_number drive) const
     {
-      auto it = drives_.find(drive);
-      if (it == drives_.end())
-	return false;
-      if (!it->second)
-	{
-	  // connected but unformatted
-	  return true;
-	}
-      assert(it->second->drive() != 0);
-      return true;
+      return find_slot(drive) != nullptr;
     }
 
     static bool decode_drive_number(const std::string& s, DFS::VolumeSelector *result,
 				    std::string& error);
     std::vector<drive_number> get_all_occupied_drive_numbers() const;
     void show_drive_configuration(std::ostream& os) const;
-    void connect_internal(const DFS::SurfaceSelector& d, const std::optional<DriveConfig>& drive);
     std::optional<Format> drive_format(drive_number drive, std::string& error) const;
     bool select_drive(const DFS::SurfaceSelector&, AbstractDrive **pp, std::string& error) const;
+    // mount_fs and mount report a damaged catalog by setting error,
+    // rather than by throwing.
     std::unique_ptr<DFS::FileSystem> mount_fs(const DFS::SurfaceSelector&, std::string& error) const;
     std::optional<VolumeMountResult> mount(const DFS::VolumeSelector& vol, std::string& error) const;
 
   private:
-    std::map<drive_number, std::optional<DriveConfig>> drives_;
-    std::map<drive_number, std::unique_ptr<AbstractDrive>> caches_;
+    // What is connected to one drive number.
+    struct DriveSlot
+    {
+      bool connected;
+      std::optional<DriveConfig> config; // empty if unformatted
+      internal::CachedDevice* cache;	 // null if unformatted
+    };
+
+    const DriveSlot* find_slot(drive_number drive) const
+    {
+      if (drive.surface() >= slots_.size() || !slots_[drive.surface()].connected)
+	return nullptr;
+      return &slots_[drive.surface()];
+    }
+    void connect_internal(const DFS::SurfaceSelector& d, const std::optional<DriveConfig>& drive,
+			  internal::CachedDevice* cache);
+
+    // Indexed by drive number.  An MMB file fills hundreds of these,
+    // so they are kept small and contiguous.
+    std::vector<DriveSlot> slots_;
+    size_t connected_;
+    // The caches in front of the drives, allocated together for each
+    // call to connect_drives().
+    std::vector<std::unique_ptr<internal::CachedDevice[]>> caches_;
   };
 
   void failed_to_mount_surface(std::ostream&, const SurfaceSelector&, const std::string&);
@@ -15,10 +15,12 @@
 //
 #include "stringutil.h"
 
-#include <ctype.h>    // for tolower
+#include <ctype.h>    // for tolower, isspace
 #include <algorithm>  // for equal, find, mismatch
+#include <iterator>   // for next
 #include <string>     // for string, basic_string, basic_string<>::const_ite...
 #include <utility>    // for pair
+#include <vector>     // for vector
 
 namespace DFS
 {
@@ -107,6 +109,60 @@ std::deque<string> split(const std::string& s, char delim)
   return result;
 }
 
+bool split_words(const std::string& line, std::vector<std::string>* words,
+		 std::string* error)
+{
+  words->clear();
+  std::string word;
+  bool in_word = false;
+  for (auto it = line.begin(); it != line.end(); ++it)
+    {
+      const char c = *it;
+      if (isspace(static_cast<unsigned char>(c)))
+	{
+	  if (in_word)
+	    words->push_back(word);
+	  word.clear();
+	  in_word = false;
+	  continue;
+	}
+      if (c == '#' && !in_word && words->empty())
+	break;			// the whole line is a comment.
+      in_word = true;
+      if (c == '\\')
+	{
+	  if (++it == line.end())
+	    {
+	      *error = "backslash at end of line";
+	      return false;
+	    }
+	  word.push_back(*it);
+	}
+      else if (c == '\'' || c == '"')
+	{
+	  for (++it; it != line.end() && *it != c; ++it)
+	    {
+	      if (c == '"' && *it == '\\' && std::next(it) != line.end()
+		  && (*std::next(it) == '"' || *std::next(it) == '\\'))
+		++it;
+	      word.push_back(*it);
+	    }
+	  if (it == line.end())
+	    {
+	      *error = std::string("unmatched ") + c;
+	      return false;
+	    }
+	}
+      else
+	{
+	  word.push_back(c);
+	}
+    }
+  if (in_word)
+    words->push_back(word);
+  return true;
+}
+
 }  // namespace stringutil
 
 }  // namespace DFS
@@ -18,6 +18,7 @@
 
 #include <deque>       // for deque
 #include <string>      // for string
+#include <vector>      // for vector
 
 #include "dfstypes.h"  // for byte
 
@@ -33,6 +34,17 @@ bool ends_with(const std::string& s, const std::string& suffix);
 bool remove_suffix(std::string* s, const std::string& suffix);
 std::deque<std::string> split(const std::string& s, char delim);
 
+// Split a command line into words, roughly as the shell does.  Words
+// are separated by white space, which can be quoted with '...' or
+// "..." or escaped with a backslash (within "...", backslash only
+// escapes " and \).  A line whose first non-blank character is # is
+// a comment and yields no words; elsewhere # is an ordinary character
+// (it is the DFS single-character wildcard).  On a syntax error (an
+// unclosed quote or a trailing backslash) returns false and sets
+// *error.
+bool split_words(const std::string& line, std::vector<std::string>* words,
+		 std::string* error);
+
 inline char byte_to_ascii7(DFS::byte b)
 {
   return char(b & 0x7F);
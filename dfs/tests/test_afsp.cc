@@ -421,6 +421,22 @@ namespace
 			   {{0, 'P', "Trice"}, {0, 'p', "Trice"}, {0, '$', "Trice"}},
 			   {{0, 'P', "Trice"}, {0, 'p', "Trice"}}));
 
+    // Tests for stars which are not at the end of the pattern; these
+    // require the matcher to backtrack.
+    record_test(match_test(ctx, "*E",
+			   {{0, '$', "E"}, {0, '$', "TREE"}, {0, '$', "TREES"}},
+			   {{0, '$', "E"}, {0, '$', "TREE"}}));
+    record_test(match_test(ctx, "A*B*C",
+			   {{0, '$', "ABC"}, {0, '$', "AXBXC"}, {0, '$', "ABCBC"},
+			    {0, '$', "ABCB"}, {0, '$', "ACB"}},
+			   {{0, '$', "ABC"}, {0, '$', "AXBXC"}, {0, '$', "ABCBC"}}));
+    record_test(match_test(ctx, "#*#",
+			   {{0, '$', "A"}, {0, '$', "AB"}, {0, '$', "ABCDEFG"}},
+			   {{0, '$', "AB"}, {0, '$', "ABCDEFG"}}));
+    record_test(match_test(ctx, "**X",
+			   {{0, '$', "X"}, {0, '$', "XX"}, {0, '$', "XY"}},
+			   {{0, '$', "X"}, {0, '$', "XX"}}));
+
     return std::find(results.cbegin(), results.cend(), false) == results.cend();
   }
 }
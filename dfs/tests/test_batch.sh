@@ -0,0 +1,120 @@
+#! /bin/sh
+#
+#   Copyright 2020 James Youngman
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+# Tags: positive negative
+# Args:
+# ${DFS}" "${TEST_DATA_DIR}"
+DFS="$1"
+shift
+TEST_DATA_DIR="$1"
+shift
+
+# Ensure TMPDIR is set.
+: ${TMPDIR:?}
+
+if ! d="$(mktemp --tmpdir=${TMPDIR:?} -d)"; then
+    echo "failed to create temporary directory" >&1
+    exit 1
+fi
+
+image="${TEST_DATA_DIR}/watford-sd-62-with-62-files.ssd.gz"
+dfs() {
+    echo Running: "${DFS}" --file "${image}" "$@" >&2
+    "${DFS}" --file "${image}" "$@"
+}
+
+(
+    # The output of a batch should be the same as the output of the
+    # separate commands.
+    cat > "${d}/batch" <<'EOF_BATCH'
+# Comments and blank lines are ignored.
+cat
+
+info '$.FILE1*'
+  # An indented comment.
+free
+info #.*
+space
+EOF_BATCH
+    if ! dfs --batch "${d}/batch" > "${d}/got"
+    then
+	echo "FAIL: --batch returned nonzero" >&2
+	exit 1
+    fi
+    # '#' only starts a comment at the start of a line; elsewhere it
+    # is the DFS wildcard.
+    {
+	dfs cat &&
+	    dfs info '$.FILE1*' &&
+	    dfs free &&
+	    dfs info '#.*' &&
+	    dfs space
+    } > "${d}/expected" || exit 1
+    if ! diff "${d}/expected" "${d}/got" >&2
+    then
+	echo "FAIL: --batch output differs from separate commands" >&2
+	exit 1
+    fi
+
+    # Commands can also come from the standard input.
+    if ! echo free | dfs --batch - > "${d}/got"
+    then
+	echo "FAIL: --batch - returned nonzero" >&2
+	exit 1
+    fi
+    if ! dfs free | diff - "${d}/got" >&2
+    then
+	echo "FAIL: --batch - output differs from the free command" >&2
+	exit 1
+    fi
+
+    # A failing command (or a syntax error) makes the batch fail,
+    # but the following commands still run.
+    printf 'no-such-command\ntype "unclosed\nfree\n' > "${d}/batch"
+    if dfs --batch "${d}/batch" > "${d}/got" 2> "${d}/errors"
+    then
+	echo "FAIL: --batch returned zero despite failing commands" >&2
+	exit 1
+    fi
+    if ! grep -q 'Bytes Free' "${d}/got"
+    then
+	echo "FAIL: --batch did not continue after a failing command" >&2
+	exit 1
+    fi
+    if ! grep -q ':1: no-such-command failed' "${d}/errors" ||
+	    ! grep -q ':2: unmatched' "${d}/errors"
+    then
+	echo "FAIL: --batch did not report which lines failed:" >&2
+	cat "${d}/errors" >&2
+	exit 1
+    fi
+
+    # Invalid: a command as well as --batch.
+    if ! fails dfs --batch "${d}/batch" free
+    then
+	echo "FAIL: --batch accepts a command on the command line too" >&2
+	exit 1
+    fi
+    # Invalid: missing batch file.
+    if ! fails dfs --batch "${d}/does-not-exist"
+    then
+	echo "FAIL: --batch accepts a missing file" >&2
+	exit 1
+    fi
+)
+rv=$?
+rm -rf "${d}"
+exit $rv
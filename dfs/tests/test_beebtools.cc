@@ -0,0 +1,172 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Tests for the public interface of the beebtools library.  This
+// test is linked only against the library, and includes only its
+// public header.
+#include <exception>     // for exception
+#include <iostream>      // for operator<<, basic_ostream, cerr, cout
+#include <sstream>       // for ostringstream
+#include <string>        // for string, operator+
+#include <vector>        // for vector
+
+#include "beebtools.h"   // for Images, FileInfo, Error
+
+namespace
+{
+  std::string image_dir;
+
+  bool expect(bool condition, const std::string& what)
+  {
+    if (!condition)
+      std::cerr << "FAIL: " << what << "\n";
+    return condition;
+  }
+
+  template <class F> bool expect_error(F f, const std::string& what)
+  {
+    try
+      {
+	f();
+      }
+    catch (beebtools::Error& e)
+      {
+	return expect(e.what()[0] != '\0', what + ": the error has no message");
+      }
+    return expect(false, what + ": expected beebtools::Error");
+  }
+
+  beebtools::Images double_sided_image()
+  {
+    beebtools::Images images;
+    images.add_image(image_dir + "/dfs-80t-double-sided.dsd");
+    return images;
+  }
+
+  bool test_volumes()
+  {
+    beebtools::Images images(double_sided_image());
+    const std::vector<std::string> volumes = images.volumes();
+    return expect(volumes == std::vector<std::string>{"0", "2"}, "volumes should be 0 and 2")
+      && expect(images.title("0") == "DRIVE0", "title of drive 0")
+      && expect(images.title("2") == "DRIVE2", "title of drive 2");
+  }
+
+  bool test_files()
+  {
+    beebtools::Images images(double_sided_image());
+    const std::vector<beebtools::FileInfo> files = images.files("2");
+    if (!expect(files.size() == 1, "drive 2 should have one file"))
+      return false;
+    const beebtools::FileInfo& f(files[0]);
+    return expect(f.directory == '$', "directory of THISIS2")
+      && expect(f.name == "THISIS2", "name of THISIS2")
+      && expect(f.length == 0x28, "length of THISIS2")
+      && expect(f.start_sector == 2, "start sector of THISIS2")
+      && expect(!f.locked, "THISIS2 should not be locked");
+  }
+
+  bool test_read_file()
+  {
+    beebtools::Images images(double_sided_image());
+    bool ok = true;
+    std::vector<unsigned char> buf(256, 0xFF);
+    const unsigned long len = images.read_file(":2.$.THISIS2", buf.data(), buf.size());
+    ok = expect(len == 0x28, "read_file should return the file length") && ok;
+    const std::string body(buf.begin(), buf.begin() + len);
+    ok = expect(body.find("THIS PROGRAM IS ON SIDE 2") != std::string::npos,
+		"read_file should return the file body") && ok;
+    ok = expect(buf[len] == 0xFF, "read_file should not write beyond the file") && ok;
+
+    // A short buffer gets the start of the file.
+    images.read_file("THISIS0", buf.data(), buf.size());
+    std::vector<unsigned char> small(4, 0);
+    ok = expect(images.read_file("THISIS0", small.data(), small.size()) == 0x29,
+		"read_file with a small buffer should return the file length") && ok;
+    ok = expect(std::vector<unsigned char>(buf.begin(), buf.begin() + 4) == small,
+		"read_file with a small buffer should copy the start of the file") && ok;
+    return ok;
+  }
+
+  bool test_errors()
+  {
+    beebtools::Images images(double_sided_image());
+    unsigned char buf[16];
+    bool ok = true;
+    ok = expect_error([&images]() { images.add_image(image_dir + "/does-not-exist.ssd"); },
+		      "add_image of a missing file") && ok;
+    ok = expect_error([&images, &buf]() { images.read_file("$.NOSUCH", buf, sizeof(buf)); },
+		      "read_file of a missing file") && ok;
+    ok = expect_error([&images, &buf]() { images.read_file("$.TOOLONGNAME", buf, sizeof(buf)); },
+		      "read_file with an invalid name") && ok;
+    ok = expect_error([&images]() { images.files("1"); }, "files of an empty drive") && ok;
+    ok = expect_error([&images]() { images.title("Q"); }, "title of an invalid volume") && ok;
+    return ok;
+  }
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+    {
+      std::cerr << "usage: " << argv[0] << " test-data-directory\n";
+      return 1;
+    }
+  image_dir = argv[1];
+
+  // The library must not write to the console, so capture anything
+  // it does write.
+  std::ostringstream captured_out, captured_err;
+  std::streambuf* saved_out = std::cout.rdbuf(captured_out.rdbuf());
+  std::streambuf* saved_err = std::cerr.rdbuf(captured_err.rdbuf());
+  std::ostringstream failures;
+  bool ok = true;
+  try
+    {
+      ok = test_volumes() && ok;
+      ok = test_files() && ok;
+      ok = test_read_file() && ok;
+      ok = test_errors() && ok;
+    }
+  catch (std::exception& e)
+    {
+      failures << "unexpected exception: " << e.what() << "\n";
+      ok = false;
+    }
+  std::cout.rdbuf(saved_out);
+  std::cerr.rdbuf(saved_err);
+
+  // Our own failure messages went to std::cerr too; the library's
+  // output (if any) is mixed in with them.
+  const std::string err = captured_err.str();
+  std::cerr << failures.str() << err;
+  if (!captured_out.str().empty())
+    {
+      std::cerr << "FAIL: the library wrote to the standard output:\n"
+		<< captured_out.str();
+      ok = false;
+    }
+  if (ok && !err.empty())
+    {
+      std::cerr << "FAIL: the library wrote to the standard error\n";
+      ok = false;
+    }
+  if (!ok)
+    {
+      std::cerr << "TEST FAILURE\n";
+      return 1;
+    }
+  return 0;
+}
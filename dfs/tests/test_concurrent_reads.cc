@@ -0,0 +1,210 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Tests that several threads can read the same disc images at once,
+// and get the same results as a single thread does.
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "abstractio.h"
+#include "dfs.h"
+#include "dfs_catalog.h"
+#include "dfs_filesystem.h"
+#include "dfs_volume.h"
+#include "driveselector.h"
+#include "media.h"
+#include "storage.h"
+
+using std::cerr;
+
+namespace
+{
+  constexpr int thread_count = 8;
+  constexpr int rounds = 20;
+
+  // Maps the location of each file to its body.
+  using Contents = std::map<std::string, std::string>;
+
+  // Mount every volume of every drive and read all the files, as the
+  // bulk commands do.  Returns false (setting error) on failure.
+  bool read_everything(const DFS::StorageConfiguration& storage, Contents* contents,
+		       std::string& error)
+  {
+    for (const DFS::SurfaceSelector& surface : storage.get_all_occupied_drive_numbers())
+      {
+	if (!storage.drive_format(surface, error))
+	  {
+	    if (!error.empty())
+	      return false;
+	    continue;
+	  }
+	std::unique_ptr<DFS::FileSystem> fs = storage.mount_fs(surface, error);
+	if (!fs)
+	  return false;
+	for (std::optional<char> sv : fs->subvolumes())
+	  {
+	    DFS::Volume* vol = fs->mount(sv, error);
+	    if (!vol)
+	      return false;
+	    for (const DFS::CatalogEntry& entry : vol->root().entries())
+	      {
+		// Looking the name up builds the catalog's name index.
+		if (vol->root().positions_of(entry.directory(), entry.name()).empty())
+		  {
+		    error = "cannot find " + entry.name() + " in the name index";
+		    return false;
+		  }
+		std::ostringstream where;
+		where << surface << (sv ? std::string(1, *sv) : std::string())
+		      << '.' << entry.directory() << '.' << entry.name();
+		std::string body;
+		auto append = [&body](const DFS::byte* begin, const DFS::byte* end)
+			      {
+				body.append(begin, end);
+				return true;
+			      };
+		if (!entry.visit_file_body_spans(vol->data_region(), append, error))
+		  return false;
+		(*contents)[where.str()] = body;
+	      }
+	  }
+      }
+    return true;
+  }
+
+  bool test_concurrent_reads(const std::string& image_dir)
+  {
+    const std::vector<std::string> images =
+      {
+       "acorn-dfs-ss-80t-textfiles.ssd.gz", // decompressed into a temporary file
+       "dfs-80t-double-sided.dsd",	    // interleaved sides
+       "acorn-dfs-ss-80t-manyfiles.ssd",
+      };
+    DFS::StorageConfiguration storage;
+    std::vector<std::unique_ptr<DFS::AbstractImageFile>> files;
+    std::string error;
+    for (const std::string& name : images)
+      {
+	std::unique_ptr<DFS::AbstractImageFile> f =
+	  DFS::make_image_file(image_dir + "/" + name, error);
+	if (!f || !f->connect_drives(&storage, DFS::DriveAllocation::FIRST, error))
+	  {
+	    cerr << name << ": " << error << "\n";
+	    return false;
+	  }
+	files.push_back(std::move(f));
+      }
+
+    Contents expected;
+    if (!read_everything(storage, &expected, error))
+      {
+	cerr << "single-threaded read failed: " << error << "\n";
+	return false;
+      }
+    if (expected.empty())
+      {
+	cerr << "the test images contain no files\n";
+	return false;
+      }
+
+    std::vector<std::string> failures(thread_count);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t)
+      {
+	threads.emplace_back([&storage, &expected, &failures, t]()
+			     {
+			       try
+				 {
+				   for (int r = 0; r < rounds; ++r)
+				     {
+				       Contents got;
+				       std::string err;
+				       if (!read_everything(storage, &got, err))
+					 failures[t] = err;
+				       else if (got != expected)
+					 failures[t] = "the file contents differ";
+				       if (!failures[t].empty())
+					 return;
+				     }
+				 }
+			       catch (std::exception& e)
+				 {
+				   failures[t] = e.what();
+				 }
+			     });
+      }
+    for (std::thread& th : threads)
+      th.join();
+    bool ok = true;
+    for (int t = 0; t < thread_count; ++t)
+      {
+	if (!failures[t].empty())
+	  {
+	    cerr << "thread " << t << ": " << failures[t] << "\n";
+	    ok = false;
+	  }
+      }
+    return ok;
+  }
+
+  bool test_thread_diagnostics()
+  {
+    std::ostringstream shared, mine, other;
+    DFS::set_diagnostic_stream(&shared);
+    std::ostream* previous = DFS::set_thread_diagnostic_stream(&mine);
+    DFS::diagnostics() << "mine";
+    std::thread([&other]()
+		{
+		  DFS::diagnostics() << "shared";
+		  DFS::set_thread_diagnostic_stream(&other);
+		  DFS::diagnostics() << "other";
+		}).join();
+    DFS::set_thread_diagnostic_stream(previous);
+    DFS::diagnostics() << ".";
+    DFS::set_diagnostic_stream(nullptr);
+    bool ok = true;
+    if (previous != nullptr)
+      {
+	cerr << "a thread diagnostic stream was already set\n";
+	ok = false;
+      }
+    if (mine.str() != "mine" || other.str() != "other" || shared.str() != "shared.")
+      {
+	cerr << "diagnostics went to the wrong streams: mine=\"" << mine.str()
+	     << "\", other=\"" << other.str() << "\", shared=\"" << shared.str() << "\"\n";
+	ok = false;
+      }
+    return ok;
+  }
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+    {
+      cerr << "usage: " << argv[0] << " test-data-directory\n";
+      return 1;
+    }
+  bool ok = test_concurrent_reads(argv[1]);
+  ok = test_thread_diagnostics() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Tests for the functions which report damaged images without
+// throwing, and for the exception-based wrappers around them.
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "abstractio.h"
+#include "dfs_catalog.h"
+#include "dfs_filesystem.h"
+#include "dfs_format.h"
+#include "dfs_volume.h"
+#include "exceptions.h"
+#include "geometry.h"
+#include "opus_cat.h"
+
+using DFS::SectorBuffer;
+using std::cerr;
+
+namespace
+{
+  // An image in which only some sectors can be read.
+  class PartialImage : public DFS::DataAccess
+  {
+  public:
+    explicit PartialImage(const std::map<unsigned long, SectorBuffer>& sectors)
+      : sectors_(sectors)
+    {
+    }
+
+    std::optional<SectorBuffer> read_block(unsigned long lba) override
+    {
+      auto it = sectors_.find(lba);
+      if (it == sectors_.end())
+	return std::nullopt;
+      return it->second;
+    }
+
+  private:
+    std::map<unsigned long, SectorBuffer> sectors_;
+  };
+
+  const DFS::Geometry geometry(80, 1, DFS::sector_count(10), DFS::Encoding::FM);
+
+  SectorBuffer filled(DFS::byte value)
+  {
+    SectorBuffer result;
+    result.fill(value);
+    return result;
+  }
+
+  // An 800-sector Acorn DFS disc holding $.FILE, which is 0x300
+  // bytes long and starts at sector 2.  Sector 4, the last sector of
+  // the file, is missing.
+  std::map<unsigned long, SectorBuffer> damaged_disc()
+  {
+    SectorBuffer s0 = filled(0), s1 = filled(0);
+    const std::string title("DAMAGED"), name("FILE   $");
+    std::copy(title.begin(), title.end(), s0.begin());
+    std::copy(name.begin(), name.end(), s0.begin() + 8);
+    s1[5] = 8;			// one catalog entry
+    s1[6] = 0x03;		// 800 sectors
+    s1[7] = 0x20;
+    s1[8 + 5] = 0x03;		// length 0x300
+    s1[8 + 7] = 2;		// start sector
+    return {{0, s0}, {1, s1}, {2, filled('A')}, {3, filled('B')}};
+  }
+
+  bool check_error(const std::string& label, const std::string& error)
+  {
+    const std::string prefix(DFS::bad_file_system_message(""));
+    if (error.compare(0, prefix.size(), prefix) != 0)
+      {
+	cerr << label << ": unexpected error message \"" << error << "\"\n";
+	return false;
+      }
+    return true;
+  }
+
+  bool test_unreadable_catalog()
+  {
+    std::map<unsigned long, SectorBuffer> sectors = damaged_disc();
+    sectors.erase(1);
+    PartialImage image(sectors);
+    std::string error;
+    if (DFS::Catalog::read(DFS::Format::DFS, 0, image, error))
+      {
+	cerr << "Catalog::read accepted a catalog whose second sector is unreadable\n";
+	return false;
+      }
+    bool ok = check_error("Catalog::read", error);
+
+    std::string fs_error;
+    if (DFS::FileSystem::load(image, DFS::Format::DFS, geometry, fs_error))
+      {
+	cerr << "FileSystem::load accepted a catalog whose second sector is unreadable\n";
+	return false;
+      }
+    if (fs_error != error)
+      {
+	cerr << "FileSystem::load gave error \"" << fs_error << "\", expected \""
+	     << error << "\"\n";
+	ok = false;
+      }
+
+    // The wrapper throws the same error.
+    try
+      {
+	DFS::FileSystem fs(image, DFS::Format::DFS, geometry);
+	cerr << "the FileSystem constructor did not throw\n";
+	ok = false;
+      }
+    catch (DFS::BadFileSystem& e)
+      {
+	if (e.what() != error)
+	  {
+	    cerr << "the FileSystem constructor threw \"" << e.what() << "\", expected \""
+		 << error << "\"\n";
+	    ok = false;
+	  }
+      }
+    return ok;
+  }
+
+  bool test_unreadable_file_body()
+  {
+    PartialImage image(damaged_disc());
+    std::string error;
+    std::unique_ptr<DFS::FileSystem> fs =
+      DFS::FileSystem::load(image, DFS::Format::DFS, geometry, error);
+    if (!fs)
+      {
+	cerr << "FileSystem::load failed: " << error << "\n";
+	return false;
+      }
+    DFS::Volume* vol = fs->mount(std::nullopt, error);
+    if (!vol || vol->root().entries().size() != 1)
+      {
+	cerr << "failed to mount the volume: " << error << "\n";
+	return false;
+      }
+    const DFS::CatalogEntry& entry(vol->root().entries().front());
+
+    // The readable part of the file is still visited.
+    bool ok = true;
+    for (unsigned long span : {1ul, 2ul, 3ul})
+      {
+	std::string body;
+	auto collect = [&body](const DFS::byte* begin, const DFS::byte* end)
+		       {
+			 body.append(begin, end);
+			 return true;
+		       };
+	error.clear();
+	const bool result = entry.visit_file_body_spans(vol->data_region(), collect, error, span);
+	const std::string expected(std::string(256, 'A') + std::string(256, 'B'));
+	if (result || !check_error("visit_file_body_spans", error) || body != expected)
+	  {
+	    cerr << "visit_file_body_spans with spans of " << span << " sectors returned "
+		 << result << " with " << body.size() << " bytes of the body\n";
+	    ok = false;
+	  }
+      }
+
+    error.clear();
+    unsigned long visited = 0;
+    if (entry.visit_file_body_piecewise(vol->data_region(),
+					[&visited](const DFS::byte* begin, const DFS::byte* end)
+					{
+					  visited += end - begin;
+					  return true;
+					},
+					error)
+	|| !check_error("visit_file_body_piecewise", error) || visited != 512)
+      {
+	cerr << "visit_file_body_piecewise did not report the unreadable sector\n";
+	ok = false;
+      }
+
+    // When the visitor stops early, there is no error.
+    error.clear();
+    if (entry.visit_file_body_spans(vol->data_region(),
+				    [](const DFS::byte*, const DFS::byte*) { return false; },
+				    error)
+	|| !error.empty())
+      {
+	cerr << "visit_file_body_spans reported an error when the visitor stopped\n";
+	ok = false;
+      }
+
+    try
+      {
+	entry.visit_file_body_spans(vol->data_region(),
+				    [](const DFS::byte*, const DFS::byte*) { return true; });
+	cerr << "visit_file_body_spans did not throw\n";
+	ok = false;
+      }
+    catch (DFS::BadFileSystem&)
+      {
+      }
+    return ok;
+  }
+
+  bool test_inconsistent_opus_catalogue()
+  {
+    SectorBuffer sector16 = filled(0);
+    sector16[1] = 0x05;		// 1440 sectors
+    sector16[2] = 0xA0;
+    sector16[3] = 18;
+    sector16[8] = 1;		// volume A starts on track 1
+    const DFS::Geometry opus(80, 1, DFS::sector_count(18), DFS::Encoding::MFM);
+    const DFS::Geometry other(40, 1, DFS::sector_count(18), DFS::Encoding::MFM);
+    std::string error;
+    std::optional<DFS::internal::OpusDiscCatalogue> cat =
+      DFS::internal::OpusDiscCatalogue::parse(sector16, opus, error);
+    if (!cat || cat->get_volume_locations().size() != 1)
+      {
+	cerr << "OpusDiscCatalogue::parse rejected a valid catalogue: " << error << "\n";
+	return false;
+      }
+    if (DFS::internal::OpusDiscCatalogue::parse(sector16, other, error))
+      {
+	cerr << "OpusDiscCatalogue::parse accepted a catalogue which disagrees with the geometry\n";
+	return false;
+      }
+    bool ok = check_error("OpusDiscCatalogue::parse", error);
+    try
+      {
+	DFS::internal::OpusDiscCatalogue thrown(sector16, other);
+	cerr << "the OpusDiscCatalogue constructor did not throw\n";
+	ok = false;
+      }
+    catch (DFS::BadFileSystem& e)
+      {
+	if (e.what() != error)
+	  {
+	    cerr << "the OpusDiscCatalogue constructor threw \"" << e.what() << "\"\n";
+	    ok = false;
+	  }
+      }
+    return ok;
+  }
+
+}  // namespace
+
+int main()
+{
+  bool ok = test_unreadable_catalog();
+  ok = test_unreadable_file_body() && ok;
+  ok = test_inconsistent_opus_catalogue() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#! /bin/sh
+#
+#   Copyright 2020 James Youngman
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+# Tags: positive negative
+# Args:
+# ${DFS}" "${TEST_DATA_DIR}"
+DFS="$1"
+shift
+TEST_DATA_DIR="$1"
+shift
+
+# Ensure TMPDIR is set.
+: ${TMPDIR:?}
+
+if ! d="$(mktemp --tmpdir=${TMPDIR:?} -d)"; then
+    echo "failed to create temporary directory" >&1
+    exit 1
+fi
+
+dfs() {
+    echo Running: "${DFS}" "$@" >&2
+    "${DFS}" "$@"
+}
+
+(
+    image="${TEST_DATA_DIR}/acorn-dfs-ss-80t-manyfiles.ssd"
+    if ! dfs --file "${image}" --file "${image}" diff 0 1 > "${d}/got"
+    then
+	echo "FAIL: diff found differences between identical images:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+    if [ "$(cat "${d}/got")" != "drives 0 and 1 are the same" ]
+    then
+	echo "FAIL: diff gave unexpected output for identical images:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+
+    # Change the load address of $.TINY (the first catalog entry)
+    # and the first byte of its body.
+    cp "${image}" "${d}/changed.ssd" || exit 1
+    printf '\001' | dd of="${d}/changed.ssd" bs=1 seek=264 conv=notrunc 2>/dev/null || exit 1
+    printf 'Z' | dd of="${d}/changed.ssd" bs=1 seek=2816 conv=notrunc 2>/dev/null || exit 1
+    if dfs --file "${image}" --file "${d}/changed.ssd" diff 0 1 > "${d}/got"
+    then
+	echo "FAIL: diff returned zero for images which differ" >&2
+	exit 1
+    fi
+    cat > "${d}/expected" <<'EOF_EXPECTED'
+changed :0.$.TINY: load 008000 -> 008001
+sector 1 differs: catalog / catalog
+sector 11 differs: $.TINY / $.TINY
+drives 0 and 1 differ: 0 added, 0 removed, 1 changed; 2 sectors differ
+EOF_EXPECTED
+    if ! diff "${d}/expected" "${d}/got" >&2
+    then
+	echo "FAIL: diff reported the wrong differences" >&2
+	exit 1
+    fi
+
+    # Sectors missing from the end of an image compare as zeroes;
+    # they are not reported as unreadable.
+    head -c 102400 "${image}" > "${d}/short.ssd" || exit 1
+    if ! dfs --file "${image}" --file "${d}/short.ssd" diff 0 1 > "${d}/got"
+    then
+	echo "FAIL: diff found differences in the missing end of an image:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+
+    # Files which are only on one side.
+    dual="${TEST_DATA_DIR}/dfs-80t-double-sided.dsd"
+    dfs --file "${dual}" diff 0 2 > "${d}/got"
+    if ! grep -q '^removed :0\.\$\.THISIS0$' "${d}/got" ||
+	    ! grep -q '^added :2\.\$\.THISIS2$' "${d}/got"
+    then
+	echo "FAIL: diff did not report added and removed files:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+
+    # Invalid: the wrong number of drives.
+    if ! fails dfs --file "${image}" diff 0
+    then
+	echo "FAIL: diff accepts a single drive" >&2
+	exit 1
+    fi
+)
+rv=$?
+rm -rf "${d}"
+exit $rv
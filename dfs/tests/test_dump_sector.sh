@@ -0,0 +1,88 @@
+#! /bin/sh
+#
+#   Copyright 2020 James Youngman
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+# Tags: positive negative
+# Args:
+# ${DFS}" "${TEST_DATA_DIR}"
+DFS="$1"
+shift
+TEST_DATA_DIR="$1"
+shift
+
+# Ensure TMPDIR is set.
+: ${TMPDIR:?}
+
+if ! d="$(mktemp --tmpdir=${TMPDIR:?} -d)"; then
+    echo "failed to create temporary directory" >&1
+    exit 1
+fi
+
+dfs() {
+    echo Running: "${DFS}" --file "${TEST_DATA_DIR}/acorn-dfs-ss-80t-manyfiles.ssd" "$@" >&2
+    "${DFS}" --file "${TEST_DATA_DIR}/acorn-dfs-ss-80t-manyfiles.ssd" "$@"
+}
+
+(
+    # The first sector of the catalog holds the start of the title.
+    if ! dfs dump-sector 0 0 0 > "${d}/sector" ||
+	    ! grep -q '^000000 53 30 3A 41 42 43 44 45 S0:ABCDE$' "${d}/sector"
+    then
+	echo "FAIL: dump-sector gave unexpected output:" >&2
+	cat "${d}/sector" >&2
+	exit 1
+    fi
+
+    # Dumping whole tracks gives the same bytes as dumping each
+    # sector, but the positions are offsets within the surface.
+    for track in 1 2
+    do
+	for sector in 0 1 2 3 4 5 6 7 8 9
+	do
+	    dfs dump-sector 0 ${track} ${sector} || exit 1
+	done
+    done | cut -c7- > "${d}/expected"
+    if ! dfs dump-sector --tracks 0 1 2 > "${d}/tracks"
+    then
+	echo "FAIL: dump-sector --tracks failed" >&2
+	exit 1
+    fi
+    if ! cut -c7- "${d}/tracks" | diff "${d}/expected" - >&2
+    then
+	echo "FAIL: dump-sector --tracks differs from dumping each sector" >&2
+	exit 1
+    fi
+    if [ "$(head -n 1 "${d}/tracks" | cut -c1-6)" != "002560" ] ||
+	   [ "$(tail -n 1 "${d}/tracks" | cut -c1-6)" != "007672" ]
+    then
+	echo "FAIL: dump-sector --tracks gave the wrong positions" >&2
+	exit 1
+    fi
+
+    # Invalid: a range which is backwards or beyond the disc.
+    if ! fails dfs dump-sector --tracks 0 2 1
+    then
+	echo "FAIL: dump-sector --tracks accepts a backward range" >&2
+	exit 1
+    fi
+    if ! fails dfs dump-sector --tracks 0 0 80
+    then
+	echo "FAIL: dump-sector --tracks accepts a track beyond the disc" >&2
+	exit 1
+    fi
+)
+rv=$?
+rm -rf "${d}"
+exit $rv
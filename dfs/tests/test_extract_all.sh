@@ -0,0 +1,98 @@
+#! /bin/sh
+#
+#   Copyright 2020 James Youngman
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+# Tags: positive negative
+# Args:
+# ${DFS}" "${TEST_DATA_DIR}"
+DFS="$1"
+shift
+TEST_DATA_DIR="$1"
+shift
+
+# Ensure TMPDIR is set.
+: ${TMPDIR:?}
+
+# extract-all should give the same result as running extract-files
+# once for each drive and volume.
+check_extract_all() {
+    input="$1"
+    shift
+    expected_volumes="$*"
+
+    if ! d="$(mktemp --tmpdir=${TMPDIR:?} -d)"; then
+	echo "failed to create temporary directory" >&1
+	exit 1
+    fi
+
+    dfs() {
+	echo Running: "${DFS}" --file "${TEST_DATA_DIR}/${input}" "$@" >&2
+	"${DFS}" --file "${TEST_DATA_DIR}/${input}" "$@"
+    }
+
+    (
+	mkdir "${d}/all" "${d}/each" || exit 1
+	if ! dfs extract-all --jobs 3 "${d}/all"; then
+	    echo "extract-all command failed" >&2
+	    exit 1
+	fi
+	volumes="$(cd "${d}/all" && echo *)"
+	if [ "${volumes}" != "${expected_volumes}" ]
+	then
+	    echo "extract-all created ${volumes}, expected ${expected_volumes}" >&2
+	    exit 1
+	fi
+	for vol in ${volumes}
+	do
+	    mkdir "${d}/each/${vol}" || exit 1
+	    if ! dfs --drive "${vol}" extract-files "${d}/each/${vol}"; then
+		echo "extract-files command failed for drive ${vol}" >&2
+		exit 1
+	    fi
+	done
+	if ! diff -r "${d}/all" "${d}/each" >&2
+	then
+	    echo "extract-all gave different results from extract-files" >&2
+	    exit 1
+	fi
+
+	# Invalid: too many arguments
+	if ! fails dfs extract-all "${d}/all" extra-arg
+	then
+	    echo "extract-all command doesn't diagnose spurious arguments" >&2
+	    exit 1
+	fi
+	# Invalid: bad --jobs value
+	if ! fails dfs extract-all --jobs=0 "${d}/all"
+	then
+	    echo "extract-all command accepts --jobs=0" >&2
+	    exit 1
+	fi
+    )
+    rv=$?
+    rm -rf "${d}"
+    ( exit $rv )
+}
+
+check_extract_all opus-ddos-80t-ds-dd-vols-ABCDEFGH.sdd.gz 0A 0B 0C 0D 0E 0F 0G 0H || exit 1
+check_extract_all dfs-80t-double-sided.dsd 0 2 || exit 1
+check_extract_all watford-sd-62-with-62-files.ssd.gz 0 || exit 1
+
+# Invalid: no destination directory.
+if ! fails "${DFS}" --file "${TEST_DATA_DIR}/acorn-dfs-sd-40t.ssd.gz" extract-all
+then
+    echo "FAIL: extract-all command doesn't diagnose missing output directory" >&2
+    exit 1
+fi
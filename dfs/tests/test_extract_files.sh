@@ -35,9 +35,14 @@ then
     echo "Unable to create a temporary directory" >&2
     exit 1
 fi
+if ! archive_dir=$(mktemp  --tmpdir="${TMPDIR:?}" -d 'tmp_archive.XXXXXX' )
+then
+    echo "Unable to create a temporary directory" >&2
+    exit 1
+fi
 
 cleanup_dirs() {
-    for d in "${extract_dfs}" "${extract_zip}"
+    for d in "${extract_dfs}" "${extract_zip}" "${archive_dir}"
     do
 	if [ -d "${d}" ]
 	then
@@ -57,7 +62,7 @@ check_extract() {
 
     cleanup_just_files() {
 	echo "cleaning up extracted files..."
-	rm -f "${extract_dfs}"/* "${extract_zip}"/*
+	rm -f "${extract_dfs}"/* "${extract_zip}"/* "${archive_dir}"/*
     }
 
     dfs() {
@@ -160,6 +165,99 @@ check_extract() {
 		    exit 1
 	fi
 
+	# Extracting with several threads must give the same result.
+	cleanup_just_files
+	if ! ( cd "${extract_zip}" && unzip "${zipfile}" )
+	then
+	    echo "FAILED: could not extract ${zipfile}" >&2
+	    exit 1
+	fi
+	if ! dfs extract-files --jobs 4 "${extract_dfs}"
+	then
+	    echo "FAILED: extract-files --jobs 4 returned nonzero" >&2
+	    exit 1
+	fi
+	if ! diff -r "${extract_dfs}" "${extract_zip}" >&2
+	then
+		    echo "FAILED: files extracted with --jobs 4 differ" >&2
+		    exit 1
+	fi
+
+	# Files which cannot be read (here, because the image is
+	# truncated) are reported, and the others are still written,
+	# however many jobs are used.
+	cleanup_just_files
+	short="${archive_dir}/short.ssd"
+	gunzip -c "${TEST_DATA_DIR}/${input}.gz" | head -c 10240 > "${short}"
+	for jobs in 1 4
+	do
+	    rm -f "${extract_dfs}"/*
+	    if "${DFS}" --file "${short}" extract-files --jobs ${jobs} "${extract_dfs}" \
+		   > "${archive_dir}/out.${jobs}" 2> "${archive_dir}/err.${jobs}"
+	    then
+		echo "FAILED: extract-files --jobs ${jobs} succeeds on a truncated image" >&2
+		exit 1
+	    fi
+	    ls "${extract_dfs}" > "${archive_dir}/files.${jobs}"
+	    sed -i -e 's/ in [0-9.]* seconds.*//' "${archive_dir}/out.${jobs}"
+	done
+	for what in out err files
+	do
+	    if ! diff "${archive_dir}/${what}.1" "${archive_dir}/${what}.4" >&2
+	    then
+		echo "FAILED: extract-files --jobs changes the result (${what}) on a truncated image" >&2
+		exit 1
+	    fi
+	done
+	if ! [ -s "${archive_dir}/err.1" ] || ! [ -s "${archive_dir}/files.1" ]
+	then
+	    echo "FAILED: extract-files on a truncated image should write some files and report the others" >&2
+	    exit 1
+	fi
+	rm -f "${extract_dfs}"/*
+
+	# Writing a zip archive (here, to the standard output) should
+	# give the same files, including the .inf files.
+	cleanup_just_files
+	if ! ( cd "${extract_zip}" && unzip "${zipfile}" )
+	then
+	    echo "FAILED: could not extract ${zipfile}" >&2
+	    exit 1
+	fi
+	if ! dfs extract-files --archive=zip - > "${archive_dir}/out.zip"
+	then
+	    echo "FAILED: extract-files --archive=zip returned nonzero" >&2
+	    exit 1
+	fi
+	if ! ( cd "${extract_dfs}" && unzip "${archive_dir}/out.zip" )
+	then
+	    echo "FAILED: could not extract the zip file written by extract-files" >&2
+	    exit 1
+	fi
+	if ! diff -r "${extract_dfs}" "${extract_zip}" >&2
+	then
+		    echo "FAILED: files extracted with --archive=zip differ" >&2
+		    exit 1
+	fi
+
+	# Likewise for a tar archive.
+	rm -f "${extract_dfs}"/*
+	if ! dfs extract-files --archive tar "${archive_dir}/out.tar"
+	then
+	    echo "FAILED: extract-files --archive tar returned nonzero" >&2
+	    exit 1
+	fi
+	if ! ( cd "${extract_dfs}" && tar xf "${archive_dir}/out.tar" )
+	then
+	    echo "FAILED: could not extract the tar file written by extract-files" >&2
+	    exit 1
+	fi
+	if ! diff -r "${extract_dfs}" "${extract_zip}" >&2
+	then
+		    echo "FAILED: files extracted with --archive=tar differ" >&2
+		    exit 1
+	fi
+
 	# Now test a small number of usage errors.
 	if ! fails dfs extract-files # no output directory
 	then
@@ -176,6 +274,26 @@ check_extract() {
 	    echo "FAILED: extract-files succeeds with spurious extra arguments" >&2
 	    exit 1
 	fi
+	if ! fails dfs extract-files --jobs=0 "${extract_dfs}"
+	then
+	    echo "FAILED: extract-files accepts --jobs=0" >&2
+	    exit 1
+	fi
+	if ! fails dfs extract-files --jobs=many "${extract_dfs}"
+	then
+	    echo "FAILED: extract-files accepts a non-numeric --jobs value" >&2
+	    exit 1
+	fi
+	if ! fails dfs extract-files --archive=rar "${archive_dir}/out.rar"
+	then
+	    echo "FAILED: extract-files accepts an unsupported archive format" >&2
+	    exit 1
+	fi
+	if ! fails dfs extract-files --archive=zip --jobs=2 "${archive_dir}/out.zip"
+	then
+	    echo "FAILED: extract-files accepts --jobs with --archive" >&2
+	    exit 1
+	fi
 	if ! fails dfs extract-files --drive=1   # no media in that drive
 	then
 	    echo "FAILED: extract-files --drive=1 succeeds even with no media in drive 1" >&2
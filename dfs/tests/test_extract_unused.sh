@@ -52,6 +52,28 @@ check_extract_unused() {
 	    exit 1
 	fi
 
+	# Writing the same spans into an archive.
+	if ! dfs extract-unused --archive=tar - > "${d}/unused.tar"
+	then
+	    echo "extract-unused --archive=tar command failed" >&2
+	    exit 1
+	fi
+	listed="$(tar tf "${d}/unused.tar" | sort)"
+	written="$(cd "${d}" && ls unused_*.bin | sort)"
+	if [ "${listed}" != "${written}" ]
+	then
+	    echo "extract-unused --archive=tar wrote ${listed}, expected ${written}" >&2
+	    exit 1
+	fi
+	for f in ${listed}
+	do
+	    if ! tar xOf "${d}/unused.tar" "${f}" | cmp - "${d}/${f}"
+	    then
+		echo "extract-unused --archive=tar gave the wrong content for ${f}" >&2
+		exit 1
+	    fi
+	done
+
 	# Negative case: unwritable output directory.
 	if [ $(id -u) -eq 0 ]
 	then
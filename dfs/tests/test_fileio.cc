@@ -14,7 +14,7 @@
 //   limitations under the License.
 //
 #include <assert.h>      // for assert
-#include <stdio.h>       // for perror, remove, fclose, fopen, fputc, EOF, FILE
+#include <stdio.h>       // for perror, remove, fclose, fopen, fputc, EOF, FILE, tmpfile
 #include <stdlib.h>      // for mkstemp, NULL
 #include <unistd.h>      // for close
 #include <algorithm>     // for all_of, max
@@ -29,6 +29,7 @@
 #include "cleanup.h"     // for cleanup
 #include "dfstypes.h"    // for byte, sector_count_type
 #include "geometry.h"    // for Encoding, Geometry, Encoding::FM
+#include "hostcopy.h"    // for copy_sectors
 #include "img_fileio.h"  // for FileView, OsFile
 #include "img_sdf.h"     // for FilePresentedBlockwise
 
@@ -144,8 +145,7 @@ namespace
     DFS::FilePresentedBlockwise block_io(underlying);
     const DFS::Geometry geom(3, 2, 2, DFS::Encoding::FM);
     assert(geom.total_sectors() <= maxblocks);
-    DFS::internal::FileView v(block_io, name,
-			      "test file", geom,
+    DFS::internal::FileView v(block_io, "test file", geom,
 			      1, // initial skip
 			      2, // take
 			      3, // leave
@@ -174,6 +174,117 @@ namespace
   }
 
 
+  bool test_fileview_read_blocks(const std::string& name)
+  {
+    DFS::internal::OsFile underlying(name);
+    DFS::FilePresentedBlockwise block_io(underlying);
+    const DFS::Geometry geom(3, 2, 2, DFS::Encoding::FM);
+    DFS::internal::FileView v(block_io, "test file", geom,
+			      1, // initial skip
+			      2, // take
+			      3, // leave
+			      geom.total_sectors());
+    // The run crosses groups of "take" sectors, and then reaches EOF
+    // (the sector after 11 would be at position 12).
+    std::vector<DFS::byte> buf(geom.total_sectors() * DFS::SECTOR_BYTES);
+    const unsigned long got = v.read_blocks(0, geom.total_sectors(), buf.data());
+    const std::vector<int> expected = {1, 2, 6, 7, 11};
+    if (got != expected.size())
+      {
+	std::cerr << "test_fileview_read_blocks: expected " << expected.size()
+		  << " sectors, got " << got << "\n";
+	return false;
+      }
+    for (unsigned long i = 0; i < got; ++i)
+      {
+	for (unsigned j = 0; j < DFS::SECTOR_BYTES; ++j)
+	  {
+	    if (buf[i * DFS::SECTOR_BYTES + j] != expected[i])
+	      {
+		std::cerr << "test_fileview_read_blocks: wrong data in sector " << i
+			  << "; expected " << expected[i] << ", got "
+			  << int(buf[i * DFS::SECTOR_BYTES + j]) << "\n";
+		return false;
+	      }
+	  }
+      }
+    std::cerr << "PASS: test_fileview_read_blocks\n";
+    return true;
+  }
+
+
+  bool test_fileview_host_extent(const std::string& name)
+  {
+    DFS::internal::OsFile underlying(name);
+    DFS::FilePresentedBlockwise block_io(underlying);
+    const DFS::Geometry geom(3, 2, 2, DFS::Encoding::FM);
+    DFS::internal::FileView v(block_io, "test file", geom,
+			      1, // initial skip
+			      2, // take
+			      3, // leave
+			      geom.total_sectors());
+    // An extent stops at the end of a group of "take" sectors.
+    std::optional<DFS::HostExtent> extent = v.host_extent(1, 4);
+    if (!extent || extent->offset != 2 * DFS::SECTOR_BYTES || extent->sectors != 1)
+      {
+	std::cerr << "test_fileview_host_extent: wrong extent for sector 1\n";
+	return false;
+      }
+    // The last sector present in the file is position 11.
+    extent = v.host_extent(4, 2);
+    if (!extent || extent->offset != 11 * DFS::SECTOR_BYTES || extent->sectors != 1)
+      {
+	std::cerr << "test_fileview_host_extent: wrong extent for sector 4\n";
+	return false;
+      }
+    if (v.host_extent(5, 1))
+      {
+	std::cerr << "test_fileview_host_extent: extent beyond EOF\n";
+	return false;
+      }
+
+    // copy_sectors should produce the same data as read_blocks.
+    FILE *out = tmpfile();
+    if (NULL == out)
+      {
+	perror("tmpfile");
+	return false;
+      }
+    cleanup close_out([out]() { fclose(out); });
+    unsigned long copied;
+    std::string error;
+    if (!DFS::copy_sectors(v, 0, geom.total_sectors(), fileno(out), &copied, &error))
+      {
+	std::cerr << "test_fileview_host_extent: copy_sectors failed: " << error << "\n";
+	return false;
+      }
+    const std::vector<int> expected = {1, 2, 6, 7, 11};
+    if (copied != expected.size())
+      {
+	std::cerr << "test_fileview_host_extent: expected " << expected.size()
+		  << " sectors to be copied, got " << copied << "\n";
+	return false;
+      }
+    rewind(out);
+    for (unsigned long i = 0; i < copied * DFS::SECTOR_BYTES; ++i)
+      {
+	const int ch = fgetc(out);
+	if (ch != expected[i / DFS::SECTOR_BYTES])
+	  {
+	    std::cerr << "test_fileview_host_extent: wrong data at offset " << i << "\n";
+	    return false;
+	  }
+      }
+    if (fgetc(out) != EOF)
+      {
+	std::cerr << "test_fileview_host_extent: too much data was copied\n";
+	return false;
+      }
+    std::cerr << "PASS: test_fileview_host_extent\n";
+    return true;
+  }
+
+
   bool self_test()
   {
     const std::string name_tmpl = "test_osfile_XXXXXXXXXX";
@@ -192,7 +303,9 @@ namespace
 
     return
       test_osfile(file_name, TEST_FILE_BLOCKS) &&
-      test_fileview(file_name, TEST_FILE_BLOCKS);
+      test_fileview(file_name, TEST_FILE_BLOCKS) &&
+      test_fileview_read_blocks(file_name) &&
+      test_fileview_host_extent(file_name);
   }
 }
 
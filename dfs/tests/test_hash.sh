@@ -0,0 +1,107 @@
+#! /bin/sh
+#
+#   Copyright 2020 James Youngman
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+# Tags: positive negative
+# Args:
+# ${DFS}" "${TEST_DATA_DIR}"
+DFS="$1"
+shift
+TEST_DATA_DIR="$1"
+shift
+
+# Ensure TMPDIR is set.
+: ${TMPDIR:?}
+
+if ! d="$(mktemp --tmpdir=${TMPDIR:?} -d)"; then
+    echo "failed to create temporary directory" >&1
+    exit 1
+fi
+
+dfs() {
+    echo Running: "${DFS}" "$@" >&2
+    "${DFS}" "$@"
+}
+
+(
+    image="${TEST_DATA_DIR}/acorn-dfs-ss-80t-manyfiles.ssd"
+    if ! dfs --file "${image}" hash --jobs 3 > "${d}/got"
+    then
+	echo "FAIL: hash command failed" >&2
+	exit 1
+    fi
+    # Metadata from the catalog follows the hash.
+    if ! grep -q '^[0-9a-f]\{64\} 000018 FF1900 FF8023 :0\.B\.S0B02$' "${d}/got"
+    then
+	echo "FAIL: hash gave unexpected output:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+
+    # Each hash should match the hash of the extracted file.
+    mkdir "${d}/files" || exit 1
+    dfs --file "${image}" extract-files "${d}/files" >/dev/null || exit 1
+    lines=0
+    while read -r hash length load exec name
+    do
+	lines=$((lines + 1))
+	case "${name}" in
+	    :0.\$.*) file="${name#:0.\$.}" ;;
+	    *) file="${name#:0.}" ;;
+	esac
+	set -- $(sha256sum < "${d}/files/${file}")
+	if [ "$1" != "${hash}" ]
+	then
+	    echo "FAIL: hash of ${name} is ${hash}, but sha256sum gives $1" >&2
+	    exit 1
+	fi
+    done < "${d}/got"
+    if [ "${lines}" -ne 11 ]
+    then
+	echo "FAIL: expected 11 files to be hashed, got ${lines}" >&2
+	exit 1
+    fi
+
+    # The same file in two images has the same hash.
+    cp "${image}" "${d}/copy.ssd" || exit 1
+    if ! dfs --images "${image}" --images "${d}/copy.ssd" hash > "${d}/both"
+    then
+	echo "FAIL: hash command failed for two images" >&2
+	exit 1
+    fi
+    dups="$(grep '^[0-9a-f]' "${d}/both" | cut -d' ' -f1 | sort | uniq -d | wc -l)"
+    uniq="$(cut -d' ' -f1 "${d}/got" | sort -u | wc -l)"
+    if [ "${dups}" -ne "${uniq}" ]
+    then
+	echo "FAIL: the files of two identical images did not have the same hashes:" >&2
+	cat "${d}/both" >&2
+	exit 1
+    fi
+
+    # Invalid: a bad job count, or an argument.
+    if ! fails dfs --file "${image}" hash --jobs 0
+    then
+	echo "FAIL: hash accepts --jobs 0" >&2
+	exit 1
+    fi
+    if ! fails dfs --file "${image}" hash 0
+    then
+	echo "FAIL: hash accepts an argument" >&2
+	exit 1
+    fi
+)
+rv=$?
+rm -rf "${d}"
+exit $rv
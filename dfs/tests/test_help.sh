@@ -32,7 +32,7 @@ if ! t="$(mktemp --tmpdir=${TMPDIR:?})"; then
 fi
 (
     rv=0
-    commands="cat dump dump-sector extract-files extract-unused free help info list sector-map show-titles space type"
+    commands="cat diff dump dump-sector extract-all extract-files extract-unused free hash help info list search sector-map serve show-titles similar space type verify"
 
     check() {
 	for c in $commands
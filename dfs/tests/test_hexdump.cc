@@ -0,0 +1,126 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "hexdump.h"
+
+#include <cctype>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::cerr;
+
+namespace
+{
+
+// A straightforward formatter using iostreams, against which the
+// output of hexdump_bytes() is compared.
+std::string reference_hexdump(size_t pos, size_t stride,
+			      const DFS::byte* begin, const DFS::byte* end)
+{
+  std::ostringstream os;
+  size_t len = end - begin;
+  while (len)
+    {
+      os << std::setw(6) << std::setfill('0') << std::dec << pos << std::hex;
+      for (size_t i = 0; i < stride; ++i)
+	{
+	  if (i < len)
+	    os << ' ' << std::setw(2) << std::setfill('0') << std::uppercase
+	       << unsigned(begin[i]);
+	  else
+	    os << " **";
+	}
+      os << ' ';
+      for (size_t i = 0; i < stride; ++i)
+	{
+	  char ch = i < len ? static_cast<char>(begin[i]) : '.';
+	  os << ((ch == ' ' || isgraph(static_cast<unsigned char>(ch))) ? ch : '.');
+	}
+      os << '\n';
+      if (len < stride)
+	break;
+      len -= stride;
+      pos += stride;
+      begin += stride;
+    }
+  return os.str();
+}
+
+bool check(size_t pos, size_t stride, const std::vector<DFS::byte>& data)
+{
+  std::ostringstream os;
+  DFS::hexdump_bytes(os, pos, stride, data.data(), data.data() + data.size());
+  const std::string expected = reference_hexdump(pos, stride, data.data(),
+						 data.data() + data.size());
+  if (os.str() != expected)
+    {
+      cerr << "hexdump of " << data.size() << " bytes at position " << pos
+	   << " with stride " << stride << " gave\n" << os.str()
+	   << "expected\n" << expected;
+      return false;
+    }
+  return true;
+}
+
+bool test_all_bytes()
+{
+  std::vector<DFS::byte> data;
+  for (int b = 0; b < 256; ++b)
+    data.push_back(static_cast<DFS::byte>(b));
+  bool ok = true;
+  for (size_t stride : {1, 8, 16, 32})
+    ok = check(0, stride, data) && ok;
+  return ok;
+}
+
+bool test_lengths()
+{
+  // Partial lines, and positions which need more than 6 digits.
+  std::vector<DFS::byte> data;
+  bool ok = true;
+  for (int len = 0; len < 40 && ok; ++len)
+    {
+      for (size_t pos : {0, 8, 999990})
+	ok = check(pos, 8, data) && check(pos, 16, data) && ok;
+      data.push_back(static_cast<DFS::byte>(len * 29 + 7));
+    }
+  return ok;
+}
+
+bool test_large()
+{
+  // Enough output to need more than one write.
+  std::vector<DFS::byte> data;
+  unsigned int x = 1;
+  for (int i = 0; i < 100003; ++i)
+    {
+      x = x * 1103515245u + 12345u;
+      data.push_back(static_cast<DFS::byte>(x >> 16));
+    }
+  return check(0, 8, data);
+}
+
+} // namespace
+
+int main()
+{
+  bool ok = test_all_bytes();
+  ok = test_lengths() && ok;
+  ok = test_large() && ok;
+  return ok ? 0 : 1;
+}
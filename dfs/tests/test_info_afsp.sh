@@ -84,3 +84,10 @@ options="--drive 0"
 check_info ':0.#.*' 'B.NOTHING     FF1900 FF8023 000064 003'
 options="--drive 1"
 check_info ':0.#.*' 'B.NOTHING     FF1900 FF8023 000064 003'
+
+# Patterns without wildcard characters are looked up by name, but
+# must still ignore case.
+options=""
+check_info ':0.B.NOTHING' 'B.NOTHING     FF1900 FF8023 000064 003' \
+	   ':0.b.nothing' 'B.NOTHING     FF1900 FF8023 000064 003' \
+	   'B.NoThInG' 'B.NOTHING     FF1900 FF8023 000064 003'
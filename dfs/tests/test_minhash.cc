@@ -0,0 +1,184 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "minhash.h"
+
+#include <math.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using DFS::MinHashSketch;
+using std::cerr;
+
+namespace
+{
+
+MinHashSketch sketch_of_range(uint64_t first, uint64_t last,
+			      DFS::SimdLevel level = DFS::best_simd_level())
+{
+  MinHashSketch result;
+  for (uint64_t i = first; i < last; ++i)
+    result.add(i * 0x9E3779B97F4A7C15ULL, level);
+  return result;
+}
+
+bool test_block_hash()
+{
+  std::vector<DFS::byte> a(256);
+  for (size_t i = 0; i < a.size(); ++i)
+    a[i] = static_cast<DFS::byte>(i * 7);
+  std::vector<DFS::byte> b(a);
+  const DFS::byte* pa = a.data();
+  if (DFS::block_hash(pa, pa + 256) != DFS::block_hash(b.data(), b.data() + 256))
+    {
+      cerr << "equal blocks have different hashes\n";
+      return false;
+    }
+  bool ok = true;
+  for (size_t pos : {0, 31, 32, 200, 255})
+    {
+      b = a;
+      b[pos] ^= 1;
+      if (DFS::block_hash(pa, pa + 256) == DFS::block_hash(b.data(), b.data() + 256))
+	{
+	  cerr << "changing byte " << pos << " did not change the hash\n";
+	  ok = false;
+	}
+    }
+  // A block is not the same as the same block with zeroes after it.
+  std::vector<DFS::byte> z(64, 0);
+  if (DFS::block_hash(z.data(), z.data() + 32) == DFS::block_hash(z.data(), z.data() + 64))
+    {
+      cerr << "the length of a block does not affect its hash\n";
+      ok = false;
+    }
+  return ok;
+}
+
+bool test_implementations_agree()
+{
+  const MinHashSketch portable = sketch_of_range(0, 1000, DFS::SimdLevel::None);
+  const MinHashSketch best = sketch_of_range(0, 1000);
+  if (!(portable == best))
+    {
+      cerr << "the portable and vector implementations give different sketches\n";
+      return false;
+    }
+  return true;
+}
+
+bool test_similarity()
+{
+  bool ok = true;
+  const MinHashSketch a = sketch_of_range(0, 2000);
+  if (a.similarity(a) != 1.0)
+    {
+      cerr << "a sketch is not the same as itself\n";
+      ok = false;
+    }
+  // The sets of these pairs have Jaccard similarity 0.9, 0.5 and 0.
+  const struct
+  {
+    uint64_t first, last;
+    double expected;
+  } cases[] = {{100, 2100, 1800.0 / 2200.0}, {0, 1000, 0.5}, {5000, 7000, 0.0}};
+  for (const auto& c : cases)
+    {
+      const double got = a.similarity(sketch_of_range(c.first, c.last));
+      // The standard error with 64 values is at most 1/16.
+      if (fabs(got - c.expected) > 0.2)
+	{
+	  cerr << "range " << c.first << "-" << c.last << ": estimated similarity is "
+	       << got << ", expected about " << c.expected << "\n";
+	  ok = false;
+	}
+    }
+  return ok;
+}
+
+bool test_encoding()
+{
+  bool ok = true;
+  const MinHashSketch a = sketch_of_range(0, 100);
+  const std::string encoded = a.encode();
+  std::optional<MinHashSketch> decoded = MinHashSketch::decode(encoded);
+  if (!decoded || !(*decoded == a) || decoded->features() != 100)
+    {
+      cerr << "sketch " << encoded << " did not survive encoding and decoding\n";
+      ok = false;
+    }
+  for (const std::string& bad : {std::string(""), std::string("100"), " " + encoded.substr(4),
+				 encoded.substr(0, encoded.size() - 1), encoded + "0",
+				 "x" + encoded, encoded.substr(0, 4) + "G" + encoded.substr(5)})
+    {
+      if (MinHashSketch::decode(bad))
+	{
+	  cerr << "invalid sketch \"" << bad << "\" was accepted\n";
+	  ok = false;
+	}
+    }
+  return ok;
+}
+
+bool test_find_similar_groups()
+{
+  const std::vector<MinHashSketch> sketches =
+    {
+     sketch_of_range(0, 1000),
+     sketch_of_range(10000, 11000),
+     MinHashSketch(),		// never similar to anything
+     sketch_of_range(0, 1010),
+     MinHashSketch(),
+    };
+  const std::vector<std::vector<size_t>> groups = DFS::find_similar_groups(sketches, 0.5);
+  if (groups.size() != 1 || groups[0] != std::vector<size_t>{0, 3})
+    {
+      cerr << "find_similar_groups found " << groups.size()
+	   << " groups, expected only {0, 3}\n";
+      return false;
+    }
+  return true;
+}
+
+bool test_many_identical()
+{
+  // Many identical sketches must form one group, without comparing
+  // every pair of them.
+  const size_t copies = 20000;
+  std::vector<MinHashSketch> sketches(copies, sketch_of_range(0, 1000));
+  sketches.push_back(sketch_of_range(50000, 51000));
+  const std::vector<std::vector<size_t>> groups = DFS::find_similar_groups(sketches, 0.5);
+  if (groups.size() != 1 || groups[0].size() != copies || groups[0].back() != copies - 1)
+    {
+      cerr << "find_similar_groups did not put " << copies
+	   << " identical sketches into one group\n";
+      return false;
+    }
+  return true;
+}
+
+} // namespace
+
+int main()
+{
+  bool ok = test_block_hash();
+  ok = test_implementations_agree() && ok;
+  ok = test_similarity() && ok;
+  ok = test_encoding() && ok;
+  ok = test_find_similar_groups() && ok;
+  ok = test_many_identical() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Tests for MMB files, including extended MMB files holding several
+// banks of discs.
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "abstractio.h"
+#include "dfs_catalog.h"
+#include "dfs_format.h"
+#include "dfs_volume.h"
+#include "driveselector.h"
+#include "exceptions.h"
+#include "img_sdf.h"
+#include "storage.h"
+
+using std::cerr;
+
+namespace
+{
+  constexpr unsigned long TABLE_BYTES = 32 * DFS::SECTOR_BYTES;
+  constexpr unsigned int SLOTS = 511;
+  constexpr unsigned long DISC_BYTES = 800 * DFS::SECTOR_BYTES;
+  constexpr unsigned long BANK_BYTES = TABLE_BYTES + SLOTS * DISC_BYTES;
+
+  // An MMB file which is made up as it is read, so that we don't need
+  // gigabytes of test data.  Each formatted disc holds the same image.
+  class FakeMmbFile : public DFS::FileAccess
+  {
+  public:
+    FakeMmbFile(unsigned int banks, DFS::byte banks_byte, const std::set<unsigned int>& formatted,
+		const std::vector<DFS::byte>& image)
+      : banks_byte_(banks_byte), formatted_(formatted), image_(image),
+	size_(banks * BANK_BYTES)
+    {
+    }
+
+    std::vector<DFS::byte> read(unsigned long offset, unsigned long len) override
+    {
+      std::vector<DFS::byte> result;
+      for (unsigned long pos = offset; pos < offset + len && pos < size_; ++pos)
+	result.push_back(byte_at(pos));
+      return result;
+    }
+
+    // The banks whose table has been loaded.
+    std::set<unsigned int> tables_read;
+
+  private:
+    DFS::byte byte_at(unsigned long pos)
+    {
+      const unsigned int bank = static_cast<unsigned int>(pos / BANK_BYTES);
+      const unsigned long within = pos % BANK_BYTES;
+      if (within < TABLE_BYTES)
+	{
+	  // Opening the file reads the last sector of the last table,
+	  // to check the file's length, but loading a table reads all
+	  // of it.
+	  if (within < DFS::SECTOR_BYTES)
+	    tables_read.insert(bank);
+	  const unsigned long entry = within / 16, field = within % 16;
+	  if (entry == 0)
+	    return (bank == 0 && field == 8) ? banks_byte_ : 0;
+	  if (field != 0x0F)
+	    return 0;
+	  return formatted_.count(bank * SLOTS + entry - 1) ? 0x0F : 0xF0;
+	}
+      const unsigned int disc = bank * SLOTS + static_cast<unsigned int>((within - TABLE_BYTES) / DISC_BYTES);
+      const unsigned long in_disc = (within - TABLE_BYTES) % DISC_BYTES;
+      if (!formatted_.count(disc) || in_disc >= image_.size())
+	return 0;
+      return image_[in_disc];
+    }
+
+    DFS::byte banks_byte_;
+    std::set<unsigned int> formatted_;
+    std::vector<DFS::byte> image_;
+    unsigned long size_;
+  };
+
+  std::vector<DFS::byte> load_image(const std::string& name)
+  {
+    std::ifstream f(name, std::ios::binary);
+    return std::vector<DFS::byte>(std::istreambuf_iterator<char>(f),
+				  std::istreambuf_iterator<char>());
+  }
+
+  bool expect_tables_read(const FakeMmbFile& f, const std::set<unsigned int>& expected,
+			  const std::string& when)
+  {
+    if (f.tables_read == expected)
+      return true;
+    cerr << when << ", the tables of banks";
+    for (unsigned int bank : f.tables_read)
+      cerr << ' ' << bank;
+    cerr << " had been read, but we expected only";
+    for (unsigned int bank : expected)
+      cerr << ' ' << bank;
+    cerr << "\n";
+    return false;
+  }
+
+  bool test_extended(const std::vector<DFS::byte>& image)
+  {
+    const unsigned int banks = 16;
+    const unsigned int last = banks * SLOTS - 1;
+    auto fake = std::make_unique<FakeMmbFile>(banks, 0xAF, std::set<unsigned int>{0, 7 * SLOTS + 3, last},
+					      image);
+    FakeMmbFile* f = fake.get();
+    std::unique_ptr<DFS::AbstractImageFile> mmb = DFS::make_mmb_file("fake.mmb", false, std::move(fake));
+    DFS::StorageConfiguration storage;
+    std::string error;
+    if (!mmb->connect_drives(&storage, DFS::DriveAllocation::FIRST, error))
+      {
+	cerr << "failed to connect the drives: " << error << "\n";
+	return false;
+      }
+    bool ok = expect_tables_read(*f, {0}, "after opening the file");
+    const auto occupied = storage.get_all_occupied_drive_numbers();
+    if (occupied.size() != banks * SLOTS)
+      {
+	cerr << "expected " << (banks * SLOTS) << " drives, got " << occupied.size() << "\n";
+	ok = false;
+      }
+
+    const DFS::drive_number in_bank_7(7 * SLOTS + 3);
+    std::optional<DFS::Format> fmt = storage.drive_format(in_bank_7, error);
+    if (!fmt || *fmt != DFS::Format::DFS)
+      {
+	cerr << "drive " << in_bank_7 << " should hold an Acorn DFS disc: " << error << "\n";
+	ok = false;
+      }
+    ok = expect_tables_read(*f, {0, 7}, "after identifying a disc in bank 7") && ok;
+    fmt = storage.drive_format(in_bank_7.next(), error);
+    if (fmt || !error.empty())
+      {
+	cerr << "drive " << in_bank_7.next() << " should be unformatted\n";
+	ok = false;
+      }
+
+    const DFS::drive_number last_drive(last);
+    std::optional<DFS::VolumeMountResult> mounted = storage.mount(DFS::VolumeSelector(last_drive), error);
+    if (!mounted)
+      {
+	cerr << "failed to mount drive " << last_drive << ": " << error << "\n";
+	return false;
+      }
+    if (mounted->volume()->root().entries().empty())
+      {
+	cerr << "the disc in drive " << last_drive << " has no files\n";
+	ok = false;
+      }
+    DFS::AbstractDrive* drive;
+    if (!storage.select_drive(last_drive, &drive, error))
+      {
+	cerr << "failed to select drive " << last_drive << ": " << error << "\n";
+	return false;
+      }
+    const std::string expected_desc = " read-write slot 8175 of MMB file fake.mmb";
+    if (drive->description() != expected_desc)
+      {
+	cerr << "drive " << last_drive << " has description \"" << drive->description()
+	     << "\", expected \"" << expected_desc << "\"\n";
+	ok = false;
+      }
+    return ok;
+  }
+
+  bool test_bank_count(DFS::byte banks_byte, unsigned int expected)
+  {
+    auto fake = std::make_unique<FakeMmbFile>(16, banks_byte, std::set<unsigned int>{},
+					      std::vector<DFS::byte>());
+    std::unique_ptr<DFS::AbstractImageFile> mmb = DFS::make_mmb_file("fake.mmb", false, std::move(fake));
+    DFS::StorageConfiguration storage;
+    std::string error;
+    if (!mmb->connect_drives(&storage, DFS::DriveAllocation::FIRST, error))
+      {
+	cerr << "failed to connect the drives: " << error << "\n";
+	return false;
+      }
+    const auto got = storage.get_all_occupied_drive_numbers().size();
+    if (got != expected * SLOTS)
+      {
+	cerr << "with byte 8 of the header set to " << static_cast<unsigned int>(banks_byte)
+	     << ", expected " << (expected * SLOTS) << " drives but got " << got << "\n";
+	return false;
+      }
+    return true;
+  }
+
+  bool test_truncated()
+  {
+    // The header says there are three banks, but there are two.
+    auto fake = std::make_unique<FakeMmbFile>(2, 0xA2, std::set<unsigned int>{},
+					      std::vector<DFS::byte>());
+    try
+      {
+	DFS::make_mmb_file("fake.mmb", false, std::move(fake));
+      }
+    catch (DFS::BadFileSystem&)
+      {
+	return true;
+      }
+    cerr << "a truncated extended MMB file was accepted\n";
+    return false;
+  }
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+    {
+      cerr << "usage: " << argv[0] << " test-data-directory\n";
+      return 1;
+    }
+  const std::vector<DFS::byte> image =
+    load_image(std::string(argv[1]) + "/acorn-dfs-ss-80t-manyfiles.ssd");
+  if (image.empty())
+    {
+      cerr << "failed to read the test disc image\n";
+      return 1;
+    }
+  bool ok = test_extended(image);
+  ok = test_bank_count(0x00, 1) && ok;
+  ok = test_bank_count(0x5F, 1) && ok;
+  ok = test_bank_count(0xA0, 1) && ok;
+  ok = test_bank_count(0xA3, 4) && ok;
+  ok = test_truncated() && ok;
+  return ok ? 0 : 1;
+}
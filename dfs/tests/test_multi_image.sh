@@ -0,0 +1,174 @@
+#! /bin/sh
+#
+#   Copyright 2020 James Youngman
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+# Tags: positive negative
+# Args:
+# ${DFS}" "${TEST_DATA_DIR}"
+DFS="$1"
+shift
+TEST_DATA_DIR="$1"
+shift
+
+# Ensure TMPDIR is set.
+: ${TMPDIR:?}
+
+if ! d="$(mktemp --tmpdir=${TMPDIR:?} -d)"; then
+    echo "failed to create temporary directory" >&1
+    exit 1
+fi
+
+dfs() {
+    echo Running: "${DFS}" "$@" >&2
+    "${DFS}" "$@"
+}
+
+# Print what running the command separately on each of the named
+# images would give with --images or --files-from.
+expected_output() {
+    cmd="$1"
+    shift
+    first=true
+    for image
+    do
+	${first} || echo
+	first=false
+	echo "==> ${image} <=="
+	"${DFS}" --file "${image}" ${cmd} || return 1
+    done
+}
+
+(
+    mkdir "${d}/images" "${d}/images/sub" &&
+	cp "${TEST_DATA_DIR}/dfs-80t-double-sided.dsd" \
+	   "${TEST_DATA_DIR}/acorn-dfs-ss-80t-manyfiles.hfe.gz" \
+	   "${TEST_DATA_DIR}/opus-ddos.sdd.gz" "${d}/images/" &&
+	cp "${TEST_DATA_DIR}/watford-sd-62-with-62-files.ssd.gz" \
+	   "${d}/images/sub/" &&
+	cp "${TEST_DATA_DIR}/lines-list.txt" "${d}/images/" || exit 1
+
+    # A directory is searched recursively, in sorted order, for files
+    # which look like disc images.
+    if ! dfs --images "${d}/images" --jobs 3 cat > "${d}/got"
+    then
+	echo "FAIL: --images with a directory returned nonzero" >&2
+	exit 1
+    fi
+    expected_output cat \
+	"${d}/images/acorn-dfs-ss-80t-manyfiles.hfe.gz" \
+	"${d}/images/dfs-80t-double-sided.dsd" \
+	"${d}/images/opus-ddos.sdd.gz" \
+	"${d}/images/sub/watford-sd-62-with-62-files.ssd.gz" > "${d}/expected" || exit 1
+    if ! diff "${d}/expected" "${d}/got" >&2
+    then
+	echo "FAIL: --images output differs from separate commands" >&2
+	exit 1
+    fi
+
+    # The output is the same with only one job.
+    if ! dfs --images "${d}/images" --jobs 1 cat | diff "${d}/expected" - >&2
+    then
+	echo "FAIL: --images output depends on --jobs" >&2
+	exit 1
+    fi
+
+    # A glob pattern, and a list of file names (which are processed
+    # in the order given).
+    if ! dfs --images "${d}/images/*.gz" free > "${d}/got"
+    then
+	echo "FAIL: --images with a glob pattern returned nonzero" >&2
+	exit 1
+    fi
+    expected_output free \
+	"${d}/images/acorn-dfs-ss-80t-manyfiles.hfe.gz" \
+	"${d}/images/opus-ddos.sdd.gz" > "${d}/expected" || exit 1
+    if ! diff "${d}/expected" "${d}/got" >&2
+    then
+	echo "FAIL: --images with a glob pattern gave the wrong output" >&2
+	exit 1
+    fi
+    printf '%s\n\n%s\n' "${d}/images/opus-ddos.sdd.gz" \
+	   "${d}/images/dfs-80t-double-sided.dsd" > "${d}/list"
+    if ! dfs --files-from "${d}/list" show-titles > "${d}/got"
+    then
+	echo "FAIL: --files-from returned nonzero" >&2
+	exit 1
+    fi
+    expected_output show-titles \
+	"${d}/images/opus-ddos.sdd.gz" \
+	"${d}/images/dfs-80t-double-sided.dsd" > "${d}/expected" || exit 1
+    if ! diff "${d}/expected" "${d}/got" >&2
+    then
+	echo "FAIL: --files-from gave the wrong output" >&2
+	exit 1
+    fi
+
+    # An image which cannot be read is reported (with its name) but
+    # the others are still processed.
+    printf '%s\n%s\n' "${d}/images/lines-list.txt" \
+	   "${d}/images/dfs-80t-double-sided.dsd" > "${d}/list"
+    if dfs --files-from "${d}/list" cat > "${d}/got" 2> "${d}/errors"
+    then
+	echo "FAIL: --files-from returned zero despite a bad image" >&2
+	exit 1
+    fi
+    if ! grep -q 'DRIVE0' "${d}/got" ||
+	    ! grep -q "^${d}/images/lines-list.txt: " "${d}/errors"
+    then
+	echo "FAIL: --files-from did not handle a bad image correctly:" >&2
+	cat "${d}/got" "${d}/errors" >&2
+	exit 1
+    fi
+
+    # Invalid: a command which changes state or needs several images.
+    if ! fails dfs --images "${d}/images" sector-map
+    then
+	echo "FAIL: --images accepts an unsupported command" >&2
+	exit 1
+    fi
+    # Invalid: a pattern which matches nothing.
+    if ! fails dfs --images "${d}/images/*.nosuch" cat
+    then
+	echo "FAIL: --images accepts a pattern matching nothing" >&2
+	exit 1
+    fi
+    # Invalid: an empty list of images.
+    if ! fails dfs --files-from /dev/null cat
+    then
+	echo "FAIL: --files-from accepts an empty list" >&2
+	exit 1
+    fi
+    # Invalid: --file as well as --images.
+    if ! fails dfs --file "${d}/images/opus-ddos.sdd.gz" --images "${d}/images" cat
+    then
+	echo "FAIL: --images can be combined with --file" >&2
+	exit 1
+    fi
+    # Invalid: a bad job count.
+    if ! fails dfs --jobs 0 --images "${d}/images" cat
+    then
+	echo "FAIL: --jobs accepts 0" >&2
+	exit 1
+    fi
+    # Invalid: --jobs without --images or --files-from.
+    if ! fails dfs --jobs 4 --file "${d}/images/opus-ddos.sdd.gz" cat
+    then
+	echo "FAIL: --jobs is accepted without --images or --files-from" >&2
+	exit 1
+    fi
+)
+rv=$?
+rm -rf "${d}"
+exit $rv
@@ -0,0 +1,163 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "multisearch.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using DFS::MultiPatternMatcher;
+using std::cerr;
+
+namespace
+{
+
+using Match = std::pair<unsigned long, size_t>; // offset, pattern
+
+MultiPatternMatcher::Pattern bytes(const std::string& s)
+{
+  return MultiPatternMatcher::Pattern(s.begin(), s.end());
+}
+
+std::vector<Match> naive_search(const std::vector<MultiPatternMatcher::Pattern>& patterns,
+				const std::vector<DFS::byte>& data)
+{
+  std::vector<Match> result;
+  for (size_t i = 0; i < patterns.size(); ++i)
+    {
+      const auto& p(patterns[i]);
+      for (size_t pos = 0; pos + p.size() <= data.size(); ++pos)
+	{
+	  if (std::equal(p.begin(), p.end(), data.begin() + pos))
+	    result.push_back(Match(pos, i));
+	}
+    }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// Search data presented in blocks of block_size bytes.
+std::vector<Match> search(const MultiPatternMatcher& m, const std::vector<DFS::byte>& data,
+			  size_t block_size)
+{
+  std::vector<Match> result;
+  MultiPatternMatcher::State state;
+  for (size_t pos = 0; pos < data.size(); pos += block_size)
+    {
+      const size_t len = std::min(block_size, data.size() - pos);
+      m.scan(&state, data.data() + pos, data.data() + pos + len,
+	     [&result](size_t pattern, unsigned long offset)
+	     {
+	       result.push_back(Match(offset, pattern));
+	     });
+    }
+  if (state.position() != data.size())
+    {
+      cerr << "state position is " << state.position() << ", expected " << data.size() << "\n";
+      result.clear();
+    }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+bool check(const std::string& label, const std::vector<MultiPatternMatcher::Pattern>& patterns,
+	   const std::vector<DFS::byte>& data)
+{
+  const MultiPatternMatcher m(patterns);
+  const std::vector<Match> expected = naive_search(patterns, data);
+  for (size_t block_size : {1, 2, 3, 7, 256, 100000})
+    {
+      if (search(m, data, block_size) != expected)
+	{
+	  cerr << label << ": wrong matches with blocks of " << block_size << " bytes\n";
+	  return false;
+	}
+    }
+  return true;
+}
+
+bool test_overlapping_patterns()
+{
+  // The classic example: patterns which are prefixes and suffixes
+  // of each other.
+  const std::string text("ushers she said his hershey");
+  return check("overlapping patterns",
+	       {bytes("he"), bytes("she"), bytes("his"), bytes("hers"), bytes("s"), bytes("he")},
+	       std::vector<DFS::byte>(text.begin(), text.end()));
+}
+
+bool test_binary()
+{
+  // Patterns over a small alphabet, so that they occur often and
+  // overlap in many ways.
+  std::vector<DFS::byte> data;
+  unsigned int x = 3;
+  for (int i = 0; i < 5000; ++i)
+    {
+      x = x * 1103515245u + 12345u;
+      data.push_back(static_cast<DFS::byte>((x >> 16) % 3 == 0 ? 0xFF : (x >> 20) & 1));
+    }
+  return check("binary",
+	       {{0x00}, {0x00, 0x01}, {0x01, 0x01, 0x01}, {0xFF, 0x00, 0xFF},
+		{0x00, 0x00, 0x00, 0x00, 0x00}, {0x01, 0xFF, 0x01, 0xFF, 0x01, 0xFF}},
+	       data);
+}
+
+bool test_order_of_report()
+{
+  // Patterns ending at the same place are reported longest first.
+  const MultiPatternMatcher m({bytes("c"), bytes("abc"), bytes("bc")});
+  const std::string text("abc");
+  std::vector<size_t> got;
+  MultiPatternMatcher::State state;
+  m.scan(&state, reinterpret_cast<const DFS::byte*>(text.data()),
+	 reinterpret_cast<const DFS::byte*>(text.data()) + text.size(),
+	 [&got](size_t pattern, unsigned long) { got.push_back(pattern); });
+  if (got != std::vector<size_t>{1, 2, 0})
+    {
+      cerr << "order of report: matches were reported in the wrong order\n";
+      return false;
+    }
+  return true;
+}
+
+bool test_empty_pattern()
+{
+  try
+    {
+      MultiPatternMatcher m({bytes("a"), bytes("")});
+    }
+  catch (std::invalid_argument&)
+    {
+      return true;
+    }
+  cerr << "empty pattern: no exception was thrown\n";
+  return false;
+}
+
+} // namespace
+
+int main()
+{
+  bool ok = test_overlapping_patterns();
+  ok = test_binary() && ok;
+  ok = test_order_of_report() && ok;
+  ok = test_empty_pattern() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Tests that SectorResolver finds the same data as reading through
+// the chain of DataAccess objects it replaces.
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "abstractio.h"
+#include "geometry.h"
+#include "img_fileio.h"
+#include "img_sdf.h"
+#include "resolver.h"
+
+using std::cerr;
+
+namespace
+{
+  // A file held in memory, in which each sector is filled with its
+  // own (truncated) sector number, and which may end part way
+  // through a sector.
+  class MemoryFile : public DFS::FileAccess
+  {
+  public:
+    explicit MemoryFile(unsigned long bytes)
+      : data_(bytes)
+    {
+      for (unsigned long i = 0; i < bytes; ++i)
+	data_[i] = static_cast<DFS::byte>((i / DFS::SECTOR_BYTES) ^ (i % 7));
+    }
+
+    std::vector<DFS::byte> read(unsigned long offset, unsigned long len) override
+    {
+      if (offset >= data_.size())
+	return {};
+      const unsigned long n = std::min(len, data_.size() - offset);
+      return std::vector<DFS::byte>(data_.begin() + offset, data_.begin() + offset + n);
+    }
+
+  private:
+    std::vector<DFS::byte> data_;
+  };
+
+  struct Case
+  {
+    const char* label;
+    unsigned long skip, take, leave, total;
+    unsigned long file_bytes;
+  };
+
+  bool check_case(const Case& c)
+  {
+    MemoryFile file(c.file_bytes);
+    DFS::FilePresentedBlockwise blocks(file);
+    const DFS::Geometry geom(80, 1, 10, DFS::Encoding::FM);
+    DFS::internal::FileView view(blocks, "test", geom, c.skip,
+				 DFS::sector_count(c.take), DFS::sector_count(c.leave),
+				 DFS::sector_count(c.total));
+    std::optional<DFS::SectorLayout> layout = view.sector_layout();
+    if (!layout)
+      {
+	cerr << c.label << ": the view has no layout\n";
+	return false;
+      }
+    std::unique_ptr<DFS::SectorResolver> resolver = DFS::make_sector_resolver(*layout);
+    if (!resolver)
+      {
+	cerr << c.label << ": no resolver for the layout\n";
+	return false;
+      }
+    bool ok = true;
+    // Every run of sectors (including some beyond the end) must read
+    // the same as it does through the view.
+    for (unsigned long lba = 0; lba < c.total + 3 && ok; ++lba)
+      {
+	for (unsigned long count : {1ul, 2ul, 7ul, c.take + 1, c.total})
+	  {
+	    std::vector<DFS::byte> expected(count * DFS::SECTOR_BYTES, 0);
+	    std::vector<DFS::byte> got(count * DFS::SECTOR_BYTES, 0);
+	    const unsigned long n_expected = view.read_blocks(lba, count, expected.data());
+	    const unsigned long n_got = resolver->read_blocks(lba, count, got.data());
+	    if (n_got != n_expected
+		|| !std::equal(got.begin(), got.begin() + n_got * DFS::SECTOR_BYTES,
+			       expected.begin()))
+	      {
+		cerr << c.label << ": reading " << count << " sectors from " << lba
+		     << " gave " << n_got << " sectors, expected " << n_expected
+		     << (n_got == n_expected ? " (but the data differs)" : "") << "\n";
+		ok = false;
+		break;
+	      }
+	    std::optional<std::pair<unsigned long, unsigned long>> where =
+	      resolver->locate(lba, count);
+	    if (lba < c.total && (!where || where->second == 0))
+	      {
+		cerr << c.label << ": cannot locate sector " << lba << "\n";
+		ok = false;
+		break;
+	      }
+	    if (lba >= c.total && where)
+	      {
+		cerr << c.label << ": located sector " << lba << " beyond the end\n";
+		ok = false;
+		break;
+	      }
+	  }
+      }
+
+    return ok;
+  }
+
+  bool test_layouts()
+  {
+    const unsigned long S = DFS::SECTOR_BYTES;
+    const std::vector<Case> cases =
+      {
+       // An SSD file, shorter than the disc (as they often are), and
+       // ending part way through a sector.
+       {"identity", 0, 10, 0, 200, 120 * S + 17},
+       // A slot of an MMB file.
+       {"identity with skip", 32, 800, 0, 800, 40 * 800 * S},
+       // Side 0 and side 1 of a DSD file.
+       {"interleave side 0", 0, 10, 10, 400, 800 * S},
+       {"interleave side 1", 10, 10, 10, 400, 795 * S + 100},
+       // Some other regular layout.
+       {"general", 1, 2, 3, 12, 12 * S},
+      };
+    bool ok = true;
+    for (const Case& c : cases)
+      ok = check_case(c) && ok;
+    return ok;
+  }
+
+  bool test_unresolvable()
+  {
+    MemoryFile file(DFS::SECTOR_BYTES);
+    bool ok = true;
+    // A layout whose positions overflow cannot be resolved.
+    const DFS::SectorLayout huge{&file, 0, ~0ul, 0, 1, 1};
+    if (DFS::make_sector_resolver(huge))
+      {
+	cerr << "a layout with positions which overflow was resolved\n";
+	ok = false;
+      }
+    const DFS::SectorLayout empty{&file, 0, 0, 0, 10, 0};
+    if (DFS::make_sector_resolver(empty))
+      {
+	cerr << "an empty layout was resolved\n";
+	ok = false;
+      }
+    return ok;
+  }
+}  // namespace
+
+int main()
+{
+  bool ok = test_layouts();
+  ok = test_unresolvable() && ok;
+  return ok ? 0 : 1;
+}
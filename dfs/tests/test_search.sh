@@ -0,0 +1,94 @@
+#! /bin/sh
+#
+#   Copyright 2020 James Youngman
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+# Tags: positive negative
+# Args:
+# ${DFS}" "${TEST_DATA_DIR}"
+DFS="$1"
+shift
+TEST_DATA_DIR="$1"
+shift
+
+# Ensure TMPDIR is set.
+: ${TMPDIR:?}
+
+if ! d="$(mktemp --tmpdir=${TMPDIR:?} -d)"; then
+    echo "failed to create temporary directory" >&1
+    exit 1
+fi
+
+dfs() {
+    echo Running: "${DFS}" "$@" >&2
+    "${DFS}" "$@"
+}
+
+(
+    # Literal and hex patterns; the blank line in the file is a pair
+    # of carriage returns.
+    if ! dfs --file "${TEST_DATA_DIR}/acorn-dfs-ss-80t-textfiles.ssd.gz" \
+	 search --jobs 2 --hex '0D 0D' the nowhere > "${d}/got"
+    then
+	echo "FAIL: search command failed" >&2
+	exit 1
+    fi
+    cat > "${d}/expected" <<'EOF_EXPECTED'
+:0.$.LINES 000057 0D 0D
+:0.$.LINES 00005F the
+:0.$.LINES 000075 the
+EOF_EXPECTED
+    if ! diff "${d}/expected" "${d}/got" >&2
+    then
+	echo "FAIL: search gave the wrong matches" >&2
+	exit 1
+    fi
+
+    # Text hidden in the unused sectors is found only with --unused.
+    # Its offset is from the start of the drive.
+    cp "${TEST_DATA_DIR}/acorn-dfs-ss-80t-manyfiles.ssd" "${d}/hidden.ssd" || exit 1
+    printf 'HIDDEN' |
+	dd of="${d}/hidden.ssd" bs=1 seek=8197 conv=notrunc 2>/dev/null || exit 1
+    if ! dfs --file "${d}/hidden.ssd" search HIDDEN > "${d}/got" || [ -s "${d}/got" ]
+    then
+	echo "FAIL: search found text in unused sectors without --unused:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+    if ! dfs --file "${d}/hidden.ssd" search --unused HIDDEN > "${d}/got" ||
+	    [ "$(cat "${d}/got")" != "0:unused 002005 HIDDEN" ]
+    then
+	echo "FAIL: search --unused gave the wrong matches:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+
+    # Invalid: no pattern, an empty pattern, or bad hex.
+    for args in "" "--hex 0" "--hex 0G"
+    do
+	if ! fails dfs --file "${d}/hidden.ssd" search ${args}
+	then
+	    echo "FAIL: search accepts arguments '${args}'" >&2
+	    exit 1
+	fi
+    done
+    if ! fails dfs --file "${d}/hidden.ssd" search ""
+    then
+	echo "FAIL: search accepts an empty pattern" >&2
+	exit 1
+    fi
+)
+rv=$?
+rm -rf "${d}"
+exit $rv
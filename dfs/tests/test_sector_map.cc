@@ -0,0 +1,141 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "dfs_unused.h"
+
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "driveselector.h"
+#include "fsp.h"
+
+using DFS::SectorMap;
+using std::cerr;
+
+namespace
+{
+
+DFS::ParsedFileName file(char dir, const std::string& name)
+{
+  DFS::ParsedFileName result;
+  result.vol = DFS::VolumeSelector(0u);
+  result.dir = dir;
+  result.name = name;
+  return result;
+}
+
+// Compare the label of each sector with expected, where each
+// character of expected is the first character of the label ('-' for
+// unused sectors).
+bool check_map(const std::string& label, const SectorMap& m, const std::string& expected)
+{
+  std::string actual;
+  for (DFS::sector_count_type sec = 0; sec < expected.size(); ++sec)
+    actual.push_back(m.at(sec).value_or("-")[0]);
+  std::string from_runs;
+  for (const SectorMap::Run& run : m.runs(DFS::sector_count(expected.size())))
+    from_runs.append(run.end - run.begin, run.label ? (*run.label)[0] : '-');
+  if (actual != expected)
+    {
+      cerr << label << ": at() gave " << actual << ", expected " << expected << "\n";
+      return false;
+    }
+  if (from_runs != expected)
+    {
+      cerr << label << ": runs() gave " << from_runs << ", expected " << expected << "\n";
+      return false;
+    }
+  return true;
+}
+
+bool test_sector_map()
+{
+  SectorMap m(false);
+  if (!check_map("empty", m, "-----"))
+    return false;
+
+  m.add_catalog_sector(0, DFS::VolumeSelector(0u));
+  m.add_catalog_sector(1, DFS::VolumeSelector(0u));
+  m.add_file_sectors(4, 7, file('A', "LPHA"));
+  if (!check_map("first file", m, "cc--AAA--"))
+    return false;
+
+  // File sectors don't displace existing owners.
+  m.add_file_sectors(1, 5, file('B', "ETA"));
+  if (!check_map("overlapping file", m, "ccBBAAA--"))
+    return false;
+
+  // Other labels do.
+  m.add_other(5, "reserved");
+  if (!check_map("add_other", m, "ccBBArA--"))
+    return false;
+
+  const std::vector<SectorMap::Run> free_runs = m.free_runs(10);
+  if (free_runs.size() != 1 || free_runs[0].begin != 7 || free_runs[0].end != 10)
+    {
+      cerr << "free_runs: unexpected result\n";
+      return false;
+    }
+  if (m.at(1) != std::optional<std::string>("catalog")
+      || m.at(2) != std::optional<std::string>("B.ETA"))
+    {
+      cerr << "at: unexpected label\n";
+      return false;
+    }
+  return true;
+}
+
+bool test_overlaps()
+{
+  SectorMap m(false);
+  m.add_catalog_sector(0, DFS::VolumeSelector(0u));
+  m.add_catalog_sector(1, DFS::VolumeSelector(0u));
+  m.add_file_sectors(2, 5, file('A', "LPHA"));
+  // A zero-length file "uses" its start sector, but only for display
+  // purposes, so it does not conflict with anything.
+  m.add_file_sectors(5, 6, file('E', "MPTY"), true);
+  m.add_file_sectors(5, 7, file('G', "AMMA"));
+  if (!m.overlaps().empty())
+    {
+      cerr << "overlaps: files which do not overlap were reported\n";
+      return false;
+    }
+  // This claims the second catalog sector and one sector of A.LPHA.
+  m.add_file_sectors(1, 4, file('B', "ETA"));
+  if (!check_map("overlaps", m, "ccAAAEG"))
+    return false;
+  const std::vector<SectorMap::Overlap>& got = m.overlaps();
+  if (got.size() != 2
+      || got[0].begin != 1 || got[0].end != 2
+      || got[0].owner != "catalog" || got[0].claimant != "B.ETA"
+      || got[1].begin != 2 || got[1].end != 4
+      || got[1].owner != "A.LPHA" || got[1].claimant != "B.ETA")
+    {
+      cerr << "overlaps: unexpected result\n";
+      return false;
+    }
+  return true;
+}
+
+} // namespace
+
+int main()
+{
+  bool ok = test_sector_map();
+  ok = test_overlaps() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#! /bin/sh
+#
+#   Copyright 2020 James Youngman
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+# Tags: positive negative
+# Args:
+# ${DFS}" "${TEST_DATA_DIR}"
+DFS="$1"
+shift
+TEST_DATA_DIR="$1"
+shift
+
+# Ensure TMPDIR is set.
+: ${TMPDIR:?}
+
+# We need a client which can talk to a Unix-domain socket.
+if ! command -v python3 >/dev/null 2>&1
+then
+    echo "python3 is not available, skipping this test" >&2
+    exit 0
+fi
+
+if ! d="$(mktemp --tmpdir=${TMPDIR:?} -d)"; then
+    echo "failed to create temporary directory" >&1
+    exit 1
+fi
+
+image="${TEST_DATA_DIR}/watford-sd-62-with-62-files.ssd.gz"
+dfs() {
+    echo Running: "${DFS}" --file "${image}" "$@" >&2
+    "${DFS}" --file "${image}" "$@"
+}
+
+# Send each argument as a request on a single connection.  The output
+# of each command goes to our standard output and its error messages
+# to our standard error.  The exit status is that of the last request.
+cat > "${d}/client.py" <<'EOF_CLIENT'
+import socket, sys, time
+sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+for attempt in range(100):
+    try:
+        sock.connect(sys.argv[1])
+        break
+    except OSError:
+        time.sleep(0.1)
+else:
+    sys.exit("cannot connect to " + sys.argv[1])
+f = sock.makefile("rwb")
+status = 0
+for request in sys.argv[2:]:
+    f.write(request.encode() + b"\n")
+    f.flush()
+    status, out_len, err_len = (int(n) for n in f.readline().split())
+    sys.stdout.buffer.write(f.read(out_len))
+    sys.stderr.buffer.write(f.read(err_len))
+sys.exit(status)
+EOF_CLIENT
+client() {
+    python3 "${d}/client.py" "${d}/socket" "$@"
+}
+
+# Run the server directly rather than with dfs(), so that $! is its
+# process ID.
+"${DFS}" --file "${image}" serve --jobs 2 --socket "${d}/socket" &
+server=$!
+
+(
+    # The responses should match the output of the separate commands.
+    if ! client cat "info '\$.FILE1*'" free > "${d}/got"
+    then
+	echo "FAIL: serve request failed" >&2
+	exit 1
+    fi
+    for cmd in cat "info \$.FILE1*" free
+    do
+	dfs ${cmd} || exit 1
+    done > "${d}/expected"
+    if ! diff "${d}/expected" "${d}/got" >&2
+    then
+	echo "FAIL: serve output differs from separate commands" >&2
+	exit 1
+    fi
+
+    # Several clients at once.
+    pids=""
+    for i in 1 2 3 4
+    do
+	client "type \$.FILE0${i}" > "${d}/got${i}" &
+	pids="${pids} $!"
+    done
+    wait_failed=false
+    for pid in ${pids}
+    do
+	wait ${pid} || wait_failed=true
+    done
+    for i in 1 2 3 4
+    do
+	if ! dfs type "\$.FILE0${i}" | diff - "${d}/got${i}" >&2
+	then
+	    echo "FAIL: concurrent serve output for FILE0${i} is wrong" >&2
+	    exit 1
+	fi
+    done
+    if ${wait_failed}
+    then
+	echo "FAIL: a concurrent serve request failed" >&2
+	exit 1
+    fi
+
+    # Failures are reported in the response.
+    if client no-such-command 2> "${d}/errors"
+    then
+	echo "FAIL: serve returned success for an unknown command" >&2
+	exit 1
+    fi
+    if ! grep -q 'unknown command no-such-command' "${d}/errors"
+    then
+	echo "FAIL: serve did not return the error message" >&2
+	exit 1
+    fi
+    if client 'type "unclosed' 2>/dev/null
+    then
+	echo "FAIL: serve accepted a request with an unclosed quote" >&2
+	exit 1
+    fi
+
+    # Invalid: the socket is already in use.
+    if ! fails dfs serve --socket "${d}/socket"
+    then
+	echo "FAIL: serve accepts a socket which is in use" >&2
+	exit 1
+    fi
+    # Invalid: no socket.
+    if ! fails dfs serve
+    then
+	echo "FAIL: serve does not diagnose a missing --socket option" >&2
+	exit 1
+    fi
+)
+rv=$?
+kill -TERM ${server}
+if ! wait ${server}
+then
+    echo "FAIL: serve did not exit cleanly" >&2
+    rv=1
+fi
+if [ -e "${d}/socket" ]
+then
+    echo "FAIL: serve did not remove its socket" >&2
+    rv=1
+fi
+rm -rf "${d}"
+exit $rv
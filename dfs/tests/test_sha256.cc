@@ -0,0 +1,113 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "sha256.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using DFS::SHA256;
+using std::cerr;
+
+namespace
+{
+
+std::string digest_of(const std::string& data, bool allow_hardware, size_t piece = 0)
+{
+  SHA256 h(allow_hardware);
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+  const uint8_t* end = p + data.size();
+  if (piece == 0)
+    piece = data.size();
+  while (p < end)
+    {
+      const uint8_t* next = (end - p) > static_cast<long>(piece) ? p + piece : end;
+      h.update(p, next);
+      p = next;
+    }
+  return SHA256::hex(h.finish());
+}
+
+bool check(const std::string& label, const std::string& data, const std::string& expected)
+{
+  bool ok = true;
+  std::vector<bool> modes{false};
+  if (SHA256::hardware_available())
+    modes.push_back(true);
+  for (bool hw : modes)
+    {
+      // Feeding the data in pieces of various sizes exercises the
+      // buffering of partial blocks.
+      for (size_t piece : {0, 1, 3, 63, 64, 65, 1000})
+	{
+	  const std::string got = digest_of(data, hw, piece);
+	  if (got != expected)
+	    {
+	      cerr << label << ": with " << (hw ? "hardware" : "portable")
+		   << " implementation and pieces of " << piece
+		   << " bytes, got " << got << ", expected " << expected << "\n";
+	      ok = false;
+	    }
+	}
+    }
+  return ok;
+}
+
+bool test_known_values()
+{
+  // These are the examples from NIST's "Cryptographic Standards and
+  // Guidelines" pages for SHA-256.
+  bool ok = check("empty", "",
+		  "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  ok = check("abc", "abc",
+	     "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad") && ok;
+  ok = check("two blocks", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	     "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1") && ok;
+  ok = check("a million", std::string(1000000, 'a'),
+	     "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0") && ok;
+  return ok;
+}
+
+bool test_lengths()
+{
+  // The portable and hardware implementations must agree for every
+  // length around the block boundaries, where the padding changes.
+  if (!SHA256::hardware_available())
+    return true;
+  std::string data;
+  for (int len = 0; len < 200; ++len)
+    {
+      const std::string portable = digest_of(data, false);
+      const std::string hardware = digest_of(data, true);
+      if (portable != hardware)
+	{
+	  cerr << "length " << len << ": portable implementation gave " << portable
+	       << " but hardware implementation gave " << hardware << "\n";
+	  return false;
+	}
+      data.push_back(static_cast<char>(len * 37));
+    }
+  return true;
+}
+
+} // namespace
+
+int main()
+{
+  bool ok = test_known_values();
+  ok = test_lengths() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+#! /bin/sh
+#
+#   Copyright 2020 James Youngman
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+# Tags: positive negative
+# Args:
+# ${DFS}" "${TEST_DATA_DIR}"
+DFS="$1"
+shift
+TEST_DATA_DIR="$1"
+shift
+
+# Ensure TMPDIR is set.
+: ${TMPDIR:?}
+
+if ! d="$(mktemp --tmpdir=${TMPDIR:?} -d)"; then
+    echo "failed to create temporary directory" >&1
+    exit 1
+fi
+
+dfs() {
+    echo Running: "${DFS}" "$@" >&2
+    "${DFS}" "$@"
+}
+
+(
+    image="${TEST_DATA_DIR}/acorn-dfs-ss-80t-manyfiles.ssd"
+    # A copy with a different title and a change to the body of
+    # $.TINY, and an unrelated disc.
+    cp "${image}" "${d}/a.ssd" || exit 1
+    cp "${image}" "${d}/b.ssd" || exit 1
+    printf 'NEWTITLE' | dd of="${d}/b.ssd" bs=1 seek=0 conv=notrunc 2>/dev/null || exit 1
+    printf 'Z' | dd of="${d}/b.ssd" bs=1 seek=2816 conv=notrunc 2>/dev/null || exit 1
+    gunzip -c "${TEST_DATA_DIR}/acorn-dfs-ss-80t-textfiles.ssd.gz" > "${d}/c.ssd" || exit 1
+
+    if ! dfs --images "${d}/a.ssd" --images "${d}/b.ssd" --images "${d}/c.ssd" \
+	 similar --sketch > "${d}/index"
+    then
+	echo "FAIL: similar --sketch returned nonzero" >&2
+	exit 1
+    fi
+    if [ "$(grep -c '^minhash [0-9]* [0-9a-f]* :0$' "${d}/index")" -ne 3 ]
+    then
+	echo "FAIL: similar --sketch did not print one sketch per image:" >&2
+	cat "${d}/index" >&2
+	exit 1
+    fi
+
+    if ! dfs similar --sketches "${d}/index" > "${d}/got"
+    then
+	echo "FAIL: similar --sketches returned nonzero" >&2
+	exit 1
+    fi
+    if [ "$(grep -c '^group ' "${d}/got")" -ne 1 ] ||
+	   ! grep -q "^  1\.000 ${d}/a\.ssd:0\$" "${d}/got" ||
+	   ! grep -q " ${d}/b\.ssd:0\$" "${d}/got" ||
+	   grep -q "c\.ssd" "${d}/got"
+    then
+	echo "FAIL: similar did not group the two copies of the disc (only):" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+
+    # The same result comes from comparing the drives directly.
+    if ! dfs --file "${d}/a.ssd" --file "${d}/b.ssd" similar > "${d}/got"
+    then
+	echo "FAIL: similar returned nonzero" >&2
+	exit 1
+    fi
+    if [ "$(grep -c '^  [01]\.[0-9]* :[01]$' "${d}/got")" -ne 2 ]
+    then
+	echo "FAIL: similar did not group drives 0 and 1:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+
+    # With a threshold of 1, only identical volumes are grouped.
+    if ! dfs --file "${d}/a.ssd" --file "${d}/b.ssd" similar --threshold 1 > "${d}/got"
+    then
+	echo "FAIL: similar --threshold 1 returned nonzero" >&2
+	exit 1
+    fi
+    if [ -s "${d}/got" ]
+    then
+	echo "FAIL: similar --threshold 1 grouped volumes which differ:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+
+    # Invalid: thresholds out of range, and files which are not
+    # sketches.
+    for args in "--threshold 0" "--threshold 1.5" "--threshold x" \
+		"--sketches ${d}/a.ssd" "--sketches ${d}/nonexistent"
+    do
+	if ! fails dfs similar ${args}
+	then
+	    echo "FAIL: similar accepts arguments '${args}'" >&2
+	    exit 1
+	fi
+    done
+    exit 0
+)
+rv=$?
+rm -rf "${d}"
+exit $rv
@@ -120,6 +120,55 @@ namespace
     return ok;
   }
 
+  bool test_split_words()
+  {
+    struct test_case
+    {
+      int id;
+      std::string input;
+      bool valid;
+      std::vector<std::string> expected;
+    };
+    const vector<test_case> cases =
+      {
+       {10, "", true, {}},
+       {20, "   ", true, {}},
+       {30, "cat", true, {"cat"}},
+       {40, "  info  *.* ", true, {"info", "*.*"}},
+       {50, "type 'A B'", true, {"type", "A B"}},
+       {60, "type \"A B\"C", true, {"type", "A BC"}},
+       {70, "a\\ b", true, {"a b"}},
+       {80, "\"x\\\"y\"", true, {"x\"y"}},
+       {90, "'x\\y'", true, {"x\\y"}},
+       {100, "''", true, {""}},
+       {110, "# a comment", true, {}},
+       {115, "  # an indented comment", true, {}},
+       {120, "free # not a comment", true, {"free", "#", "not", "a", "comment"}},
+       {125, "info #.*", true, {"info", "#.*"}},
+       {130, "info a#b", true, {"info", "a#b"}},
+       {140, "type 'A B", false, {}},
+       {150, "type A\\", false, {}},
+      };
+    bool ok = true;
+    for (const auto& testcase : cases)
+      {
+	std::vector<std::string> actual;
+	std::string error;
+	const bool valid = DFS::stringutil::split_words(testcase.input, &actual, &error);
+	if (valid != testcase.valid || (valid && actual != testcase.expected))
+	  {
+	    std::cerr << "split_words test case " << testcase.id << " failed: got ";
+	    if (valid)
+	      print(std::cerr, actual.begin(), actual.end());
+	    else
+	      std::cerr << "error " << error;
+	    std::cerr << "\n";
+	    ok = false;
+	  }
+      }
+    return ok;
+  }
+
   bool remove_suffix_test(const std::string& input,
 			  const std::string& suffix,
 			  bool expected_return,
@@ -346,6 +395,7 @@ int main()
 {
   int rv = 0;
   if (!test_split()) rv = 1;
+  if (!test_split_words()) rv = 1;
   if (!test_endswith()) rv = 1;
   if (!test_remove_suffix()) rv = 1;
   if (!test_rtrim()) rv = 1;
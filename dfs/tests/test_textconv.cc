@@ -0,0 +1,128 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "textconv.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using DFS::SimdLevel;
+using std::cerr;
+
+namespace
+{
+
+const char* level_name(SimdLevel level)
+{
+  switch (level)
+    {
+    case SimdLevel::None: return "portable";
+    case SimdLevel::SSE2: return "SSE2";
+    case SimdLevel::AVX2: return "AVX2";
+    }
+  return "unknown";
+}
+
+std::vector<SimdLevel> levels()
+{
+  std::vector<SimdLevel> result{SimdLevel::None};
+  if (DFS::best_simd_level() >= SimdLevel::SSE2)
+    result.push_back(SimdLevel::SSE2);
+  if (DFS::best_simd_level() >= SimdLevel::AVX2)
+    result.push_back(SimdLevel::AVX2);
+  return result;
+}
+
+// Check every start offset and length within data (so that each
+// kernel's main loop and tail are both exercised, at every alignment)
+// against the obvious byte-at-a-time implementation.
+bool check_all_spans(const std::string& label, const std::vector<DFS::byte>& data)
+{
+  for (SimdLevel level : levels())
+    {
+      for (size_t start = 0; start < data.size(); ++start)
+	{
+	  for (size_t len = 0; start + len <= data.size(); ++len)
+	    {
+	      const DFS::byte* b = data.data() + start;
+	      const DFS::byte* e = b + len;
+	      const DFS::byte* expected_cr = e;
+	      std::string expected_text;
+	      for (const DFS::byte* p = b; p != e; ++p)
+		{
+		  if (*p == 0x0D && expected_cr == e)
+		    expected_cr = p;
+		  expected_text.push_back(static_cast<char>(*p == 0x0D ? 0x0A : *p));
+		}
+	      const DFS::byte* got_cr = DFS::find_cr(b, e, level);
+	      if (got_cr != expected_cr)
+		{
+		  cerr << label << ": " << level_name(level) << " find_cr at offset "
+		       << start << " length " << len << " gave position " << (got_cr - b)
+		       << ", expected " << (expected_cr - b) << "\n";
+		  return false;
+		}
+	      std::string got_text(len, '?');
+	      DFS::cr_to_lf(b, e, &got_text[0], level);
+	      if (got_text != expected_text)
+		{
+		  cerr << label << ": " << level_name(level) << " cr_to_lf at offset "
+		       << start << " length " << len << " gave the wrong result\n";
+		  return false;
+		}
+	    }
+	}
+    }
+  return true;
+}
+
+bool test_no_cr()
+{
+  std::vector<DFS::byte> data;
+  for (int i = 0; i < 100; ++i)
+    data.push_back(static_cast<DFS::byte>(i == 0x0D ? 0x8D : i));
+  return check_all_spans("no carriage returns", data);
+}
+
+bool test_sparse_cr()
+{
+  // Lines of varying lengths, with the other bytes covering all
+  // values (including 0x0A and 0x8D, which are not carriage returns).
+  std::vector<DFS::byte> data;
+  unsigned int x = 7;
+  for (int i = 0; i < 100; ++i)
+    {
+      x = x * 1103515245u + 12345u;
+      const DFS::byte b = static_cast<DFS::byte>(x >> 16);
+      data.push_back((i % 37 == 36 || i % 11 == 5) ? 0x0D : b);
+    }
+  return check_all_spans("sparse carriage returns", data);
+}
+
+bool test_all_cr()
+{
+  return check_all_spans("only carriage returns", std::vector<DFS::byte>(70, 0x0D));
+}
+
+} // namespace
+
+int main()
+{
+  bool ok = test_no_cr();
+  ok = test_sparse_cr() && ok;
+  ok = test_all_cr() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+#! /bin/sh
+#
+#   Copyright 2020 James Youngman
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+# Tags: positive negative
+# Args:
+# ${DFS}" "${TEST_DATA_DIR}"
+DFS="$1"
+shift
+TEST_DATA_DIR="$1"
+shift
+
+# Ensure TMPDIR is set.
+: ${TMPDIR:?}
+
+if ! d="$(mktemp --tmpdir=${TMPDIR:?} -d)"; then
+    echo "failed to create temporary directory" >&1
+    exit 1
+fi
+
+dfs() {
+    echo Running: "${DFS}" "$@" >&2
+    "${DFS}" "$@"
+}
+
+(
+    # Every image in the test data is consistent.
+    if ! dfs --images "${TEST_DATA_DIR}" verify --jobs 2 > "${d}/got"
+    then
+	echo "FAIL: verify found problems in the test data:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+    if ! grep -q '^verified 2 drives, 2 volumes and 2 files; 2 sectors (512 bytes) read in .*; 0 problems$' "${d}/got"
+    then
+	echo "FAIL: verify gave an unexpected summary:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+
+    # An image which was truncated after the catalog was written has
+    # files which cannot be read.
+    head -c 2560 "${TEST_DATA_DIR}/acorn-dfs-ss-80t-manyfiles.ssd" > "${d}/short.ssd" || exit 1
+    if dfs --file "${d}/short.ssd" verify > "${d}/got"
+    then
+	echo "FAIL: verify returned zero for a truncated image" >&2
+	exit 1
+    fi
+    grep -v '^verified ' "${d}/got" > "${d}/problems"
+    cat > "${d}/expected" <<'EOF_EXPECTED'
+unreadable :0.$.TINY: sector 11 cannot be read
+unreadable :0.V.S0B01: sector 10 cannot be read
+EOF_EXPECTED
+    if ! diff "${d}/expected" "${d}/problems" >&2
+    then
+	echo "FAIL: verify reported the wrong problems for a truncated image" >&2
+	exit 1
+    fi
+    if ! grep -q '^verified 1 drives, 1 volumes and 11 files; 8 sectors .*; 2 problems$' "${d}/got"
+    then
+	echo "FAIL: verify gave an unexpected summary for a truncated image:" >&2
+	cat "${d}/got" >&2
+	exit 1
+    fi
+
+    # Invalid: a bad job count, or an argument.
+    if ! fails dfs --file "${d}/short.ssd" verify --jobs 0
+    then
+	echo "FAIL: verify accepts --jobs 0" >&2
+	exit 1
+    fi
+    if ! fails dfs --file "${d}/short.ssd" verify 0
+    then
+	echo "FAIL: verify accepts an argument" >&2
+	exit 1
+    fi
+)
+rv=$?
+rm -rf "${d}"
+exit $rv
@@ -0,0 +1,168 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+#include "textconv.h"
+
+#include <string.h>		// for memchr
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>		// for _mm_cmpeq_epi8, _mm256_cmpeq_epi8 etc.
+#else
+#define HAVE_X86_SIMD 0
+#endif
+
+namespace
+{
+  constexpr DFS::byte CR = 0x0D;
+  constexpr DFS::byte LF = 0x0A;
+
+  const DFS::byte* find_cr_portable(const DFS::byte* begin, const DFS::byte* end)
+  {
+    const void* found = memchr(begin, CR, end - begin);
+    return found ? static_cast<const DFS::byte*>(found) : end;
+  }
+
+  void cr_to_lf_portable(const DFS::byte* begin, const DFS::byte* end, char* out)
+  {
+    for (; begin != end; ++begin)
+      *out++ = static_cast<char>(*begin == CR ? LF : *begin);
+  }
+
+#if HAVE_X86_SIMD
+  // Each block of bytes is compared with CR all at once.  When
+  // translating, the bytes which matched are XORed with CR ^ LF,
+  // which turns them into LF and leaves the others alone.
+
+  __attribute__((target("sse2")))
+  const DFS::byte* find_cr_sse2(const DFS::byte* begin, const DFS::byte* end)
+  {
+    const __m128i cr = _mm_set1_epi8(CR);
+    for (; end - begin >= 16; begin += 16)
+      {
+	const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+	const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, cr));
+	if (mask)
+	  return begin + __builtin_ctz(mask);
+      }
+    return find_cr_portable(begin, end);
+  }
+
+  __attribute__((target("sse2")))
+  void cr_to_lf_sse2(const DFS::byte* begin, const DFS::byte* end, char* out)
+  {
+    const __m128i cr = _mm_set1_epi8(CR);
+    const __m128i flip = _mm_set1_epi8(CR ^ LF);
+    for (; end - begin >= 16; begin += 16, out += 16)
+      {
+	const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+	const __m128i is_cr = _mm_cmpeq_epi8(v, cr);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+			 _mm_xor_si128(v, _mm_and_si128(is_cr, flip)));
+      }
+    cr_to_lf_portable(begin, end, out);
+  }
+
+  __attribute__((target("avx2")))
+  const DFS::byte* find_cr_avx2(const DFS::byte* begin, const DFS::byte* end)
+  {
+    const __m256i cr = _mm256_set1_epi8(CR);
+    for (; end - begin >= 32; begin += 32)
+      {
+	const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+	const unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, cr));
+	if (mask)
+	  return begin + __builtin_ctz(mask);
+      }
+    return find_cr_sse2(begin, end);
+  }
+
+  __attribute__((target("avx2")))
+  void cr_to_lf_avx2(const DFS::byte* begin, const DFS::byte* end, char* out)
+  {
+    const __m256i cr = _mm256_set1_epi8(CR);
+    const __m256i flip = _mm256_set1_epi8(CR ^ LF);
+    for (; end - begin >= 32; begin += 32, out += 32)
+      {
+	const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+	const __m256i is_cr = _mm256_cmpeq_epi8(v, cr);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+			    _mm256_xor_si256(v, _mm256_and_si256(is_cr, flip)));
+      }
+    cr_to_lf_sse2(begin, end, out);
+  }
+
+  DFS::SimdLevel detect_simd_level()
+  {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      return DFS::SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+      return DFS::SimdLevel::SSE2;
+    return DFS::SimdLevel::None;
+  }
+#endif
+}  // namespace
+
+namespace DFS
+{
+  SimdLevel best_simd_level()
+  {
+#if HAVE_X86_SIMD
+    static const SimdLevel level = detect_simd_level();
+    return level;
+#else
+    return SimdLevel::None;
+#endif
+  }
+
+  const byte* find_cr(const byte* begin, const byte* end, SimdLevel level)
+  {
+    if (level > best_simd_level())
+      level = best_simd_level();
+#if HAVE_X86_SIMD
+    switch (level)
+      {
+      case SimdLevel::AVX2:
+	return find_cr_avx2(begin, end);
+      case SimdLevel::SSE2:
+	return find_cr_sse2(begin, end);
+      case SimdLevel::None:
+	break;
+      }
+#endif
+    return find_cr_portable(begin, end);
+  }
+
+  void cr_to_lf(const byte* begin, const byte* end, char* out, SimdLevel level)
+  {
+    if (level > best_simd_level())
+      level = best_simd_level();
+#if HAVE_X86_SIMD
+    switch (level)
+      {
+      case SimdLevel::AVX2:
+	cr_to_lf_avx2(begin, end, out);
+	return;
+      case SimdLevel::SSE2:
+	cr_to_lf_sse2(begin, end, out);
+	return;
+      case SimdLevel::None:
+	break;
+      }
+#endif
+    cr_to_lf_portable(begin, end, out);
+  }
+}  // namespace DFS
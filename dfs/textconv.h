@@ -0,0 +1,51 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Conversion of Acorn text files (in which lines end with a carriage
+// return) for display on the host.  These work on large blocks at
+// once, using SSE2 or AVX2 instructions where the processor has them.
+#ifndef INC_TEXTCONV_H
+#define INC_TEXTCONV_H 1
+
+#include <stddef.h>		// for size_t
+
+#include "dfstypes.h"		// for byte
+
+namespace DFS
+{
+  enum class SimdLevel
+    {
+     None,			// portable code only
+     SSE2,
+     AVX2,
+    };
+
+  // The best instruction set extension which this processor supports
+  // and this program was compiled to use.
+  SimdLevel best_simd_level();
+
+  // Return a pointer to the first carriage return (0x0D) in [begin,
+  // end), or end if there is none.  The level argument is for
+  // testing; a level better than best_simd_level() is reduced to it.
+  const byte* find_cr(const byte* begin, const byte* end,
+		      SimdLevel level = best_simd_level());
+
+  // Copy [begin, end) to out, replacing each carriage return with a
+  // line feed (0x0A).  out must have room for end - begin bytes.
+  void cr_to_lf(const byte* begin, const byte* end, char* out,
+		SimdLevel level = best_simd_level());
+}  // namespace DFS
+
+#endif
@@ -27,6 +27,7 @@
 #include <utility>              // for make_pair, pair
 
 #include "crc.h"                // for CCITT_CRC16
+#include "dfs.h"                // for diagnostics
 #include "hexdump.h"
 
 #undef ULTRA_VERBOSE
@@ -225,7 +226,7 @@ namespace DFS
 	      {
 		if (verbose)
 		  {
-		    std::cerr << "warning: the lowest-numbered sector of "
+		    DFS::diagnostics() << "warning: the lowest-numbered sector of "
 			      << "track " << track << " has address "
 			      << sect.address
 			      << " but it should have record number 0 "
@@ -17,7 +17,7 @@
 #define INC_TRACK_H 1
 
 #include <iosfwd>		// for ostream
-#include <iostream>		// for cerr
+#include <iostream>		// for ostream
 #include <optional>		// for optional
 #include <vector>		// for vector
 #include <sstream>		// for std::ostringstream
@@ -131,16 +131,21 @@ private:
 // is returned.  source must be initialized such that the first byte
 // it returns is after the index mark and before the sync field.
 //
-// Only data sectors are returned.
-std::vector<Sector> decode_fm_track(const BitStream& track, bool verbose);
+// Only data sectors are returned.  Records whose CRC is wrong are
+// dropped; if crc_errors is not null, their number is added to
+// *crc_errors.
+std::vector<Sector> decode_fm_track(const BitStream& track, bool verbose,
+				    unsigned int* crc_errors = nullptr);
 
 // decode_mfm_track() decodes an MFM data stream (as clock/data bit
 // pairs) into a sector. source must be initialized such that the
 // first byte it returns is after the index mark and before the sync
 // field.
 //
-// Only data sectors are returned.
-std::vector<Sector> decode_mfm_track(const BitStream& track, bool verbose);
+// Only data sectors are returned.  Records whose CRC is wrong are
+// dropped and counted as for decode_fm_track().
+std::vector<Sector> decode_mfm_track(const BitStream& track, bool verbose,
+				     unsigned int* crc_errors = nullptr);
 
 /* reverse the ordering of bits in a byte. */
 inline byte reverse_bit_order(Track::byte in)
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "crc.h"
+#include "dfs.h"
 #include "hexdump.h"
 
 namespace
@@ -70,11 +71,11 @@ bool copy_fm_bytes(const Track::BitStream& bits, size_t& thisbit,
 	{
 	  if (!clock_and_data)
 	    {
-	      std::cerr << "end-of-track while reading data bytes\n";
+	      DFS::diagnostics() << "end-of-track while reading data bytes\n";
 	    }
 	  else
 	    {
-	      std::cerr << "desynced while reading data bytes\n";
+	      DFS::diagnostics() << "desynced while reading data bytes\n";
 	    }
 	}
       return false;
@@ -89,7 +90,8 @@ namespace Track
 
 // Decode a train of FM clock/data bits into a sequence of zero or more
 // sectors.
-  std::vector<Sector> decode_fm_track(const BitStream& bits, bool verbose)
+  std::vector<Sector> decode_fm_track(const BitStream& bits, bool verbose,
+				      unsigned int* crc_errors)
 {
   self_test_crc();
 
@@ -185,7 +187,7 @@ namespace Track
 	  if (verbose)
 	    {
 #if ULTRA_VERBOSE
-	      std::cerr << "Found AM1, reading sector address\n";
+	      DFS::diagnostics() << "Found AM1, reading sector address\n";
 #endif
 	    }
 	  /* clock=0xC7, data=0xFE - this is the index address mark */
@@ -203,7 +205,7 @@ namespace Track
 	    {
 	      if (verbose)
 		{
-		  std::cerr << "Failed to read sector address\n";
+		  DFS::diagnostics() << "Failed to read sector address\n";
 		}
 	      state = DecodeState::LookingForAddress;
 	      continue;
@@ -211,9 +213,11 @@ namespace Track
 	  const auto addr_crc = get_crc(id);
 	  if (addr_crc)
 	    {
+	      if (crc_errors)
+		++*crc_errors;
 	      if (verbose)
 		{
-		  std::cerr << "Sector address CRC mismatch: 0x"
+		  DFS::diagnostics() << "Sector address CRC mismatch: 0x"
 			    << std::hex << addr_crc << " should be 0\n";
 		}
 	      state = DecodeState::LookingForAddress;
@@ -224,7 +228,7 @@ namespace Track
 	  if (!decode_sector_address_and_size(id.data(), &sec.address, &sec_size, error))
 	    {
 	      if (verbose)
-		std::cerr << error << "\n";
+		DFS::diagnostics() << error << "\n";
 	      state = DecodeState::LookingForAddress;
 	      continue;
 	    }
@@ -240,7 +244,7 @@ namespace Track
 	  const bool discard_record = *found == 0xF56A;
 	  if (verbose)
 	    {
-	      std::cerr << "This record has address " << sec.address
+	      DFS::diagnostics() << "This record has address " << sec.address
 			<< " and should contain "
 			<< std::dec << sec_size << " bytes.  It is a "
 			<< (discard_record ? "control" : "data")
@@ -260,7 +264,7 @@ namespace Track
 	    {
 	      if (verbose)
 		{
-		  std::cerr << "Lost sync in sector data\n";
+		  DFS::diagnostics() << "Lost sync in sector data\n";
 		}
 	      state = DecodeState::LookingForAddress;
 	      continue;
@@ -275,13 +279,15 @@ namespace Track
 	  auto data_crc = crc.get();
 	  if (data_crc != 0 && !discard_record)
 	    {
+	      if (crc_errors)
+		++*crc_errors;
 	      if (verbose)
 		{
-		  std::cerr << "Sector data CRC mismatch: 0x"
+		  DFS::diagnostics() << "Sector data CRC mismatch: 0x"
 			    << std::hex << data_crc << " should be 0; "
 			    << "dropping the sector\n";
-		  DFS::hexdump_bytes(std::cerr, 0, 1, data_mark, data_mark+1);
-		  DFS::hexdump_bytes(std::cerr, 1, 32, sec.data.data(), sec.data.data() + size_with_crc);
+		  DFS::hexdump_bytes(DFS::diagnostics(), 0, 1, data_mark, data_mark+1);
+		  DFS::hexdump_bytes(DFS::diagnostics(), 1, 32, sec.data.data(), sec.data.data() + size_with_crc);
 		}
 	      state = DecodeState::LookingForAddress;
 	      continue;
@@ -295,7 +301,7 @@ namespace Track
 	    {
 	      if (verbose)
 		{
-		  std::cerr << "Accepting record/sector with address "
+		  DFS::diagnostics() << "Accepting record/sector with address "
 			    << sec.address << "; " << "it has "
 			    << sec.data.size() << " bytes of data.\n";
 		}
@@ -303,7 +309,7 @@ namespace Track
 	    }
 	  else
 	    {
-	      std::cerr << "Dropping the control record\n";
+	      DFS::diagnostics() << "Dropping the control record\n";
 	    }
 	  state = DecodeState::LookingForAddress;
 	}
@@ -21,6 +21,7 @@
 #include <sstream>
 
 #include "crc.h"
+#include "dfs.h"
 #include "hexdump.h"
 
 namespace
@@ -113,7 +114,8 @@ bool copy_mfm_bytes(const Track::BitStream& bits, size_t& thisbit,
 
 namespace Track
 {
-std::vector<Sector> decode_mfm_track(const BitStream& bits, bool verbose)
+std::vector<Sector> decode_mfm_track(const BitStream& bits, bool verbose,
+				     unsigned int* crc_errors)
 {
   self_test_crc();
 
@@ -161,9 +163,9 @@ std::vector<Sector> decode_mfm_track(const BitStream& bits, bool verbose)
 	      {
 		if (verbose)
 		  {
-		    std::cerr << "read " << std::dec << header.size()
+		    DFS::diagnostics() << "read " << std::dec << header.size()
 			      << " bytes of data:\n";
-		    DFS::hexdump_bytes(std::cerr, 0, sizeof(header),
+		    DFS::hexdump_bytes(DFS::diagnostics(), 0, sizeof(header),
 				       header.data(), header.data() + header.size());
 		  }
 		if (check_crc_with_a1s(header, error))
@@ -175,10 +177,16 @@ std::vector<Sector> decode_mfm_track(const BitStream& bits, bool verbose)
 			continue;
 		      }
 		  }
+		else if (header[0] == id_address_mark && crc_errors)
+		  {
+		    // A damaged sector address, rather than some other
+		    // record turning up when we expected an address.
+		    ++*crc_errors;
+		  }
 	      }
 	    if (verbose)
 	      {
-		std::cerr << "Failed to read sector address: " << error << "\n";
+		DFS::diagnostics() << "Failed to read sector address: " << error << "\n";
 	      }
 	  }
 	  state = MfmDecodeState::LookingForSectorHeader;
@@ -198,9 +206,9 @@ std::vector<Sector> decode_mfm_track(const BitStream& bits, bool verbose)
 	      {
 		if (verbose)
 		  {
-		    std::cerr << "read " << std::dec << mark_and_data.size()
+		    DFS::diagnostics() << "read " << std::dec << mark_and_data.size()
 			      << " bytes of sector data:\n";
-		    DFS::hexdump_bytes(std::cerr, 0, 16,
+		    DFS::hexdump_bytes(DFS::diagnostics(), 0, 16,
 				       mark_and_data.data(),
 				       mark_and_data.data() + mark_and_data.size());
 		  }
@@ -217,7 +225,7 @@ std::vector<Sector> decode_mfm_track(const BitStream& bits, bool verbose)
 				  sec.data.begin());
 			if (verbose)
 			  {
-			    std::cerr << "Accepting record/sector with address "
+			    DFS::diagnostics() << "Accepting record/sector with address "
 				      << sec.address << "; " << "it has "
 				      << sec.data.size() << " bytes of data.\n";
 			  }
@@ -228,9 +236,11 @@ std::vector<Sector> decode_mfm_track(const BitStream& bits, bool verbose)
 		  }
 		else
 		  {
+		    if (crc_errors && mark_and_data[0] == data_address_mark)
+		      ++*crc_errors;
 		    if (verbose)
 		      {
-			std::cerr << "Failed to read sector " << sec.address
+			DFS::diagnostics() << "Failed to read sector " << sec.address
 				  << ": " << error << "\n";
 		      }
 		    state = MfmDecodeState::LookingForSectorHeader;
@@ -238,7 +248,7 @@ std::vector<Sector> decode_mfm_track(const BitStream& bits, bool verbose)
 		  }
 	      }
 	    if (verbose)
-	      std::cerr << "Failed to read sector data: " << error << "\n";
+	      DFS::diagnostics() << "Failed to read sector data: " << error << "\n";
 	  }
 	  state = MfmDecodeState::LookingForSectorHeader;
 	  continue;
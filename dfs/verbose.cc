@@ -15,7 +15,56 @@
 //
 #include "dfs.h"
 
+#include <atomic>     // for atomic
+#include <ostream>    // for ostream
+#include <streambuf>  // for streambuf
+
+namespace
+{
+  class DiscardBuffer : public std::streambuf
+  {
+  protected:
+    int_type overflow(int_type c) override
+    {
+      return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char_type*, std::streamsize n) override
+    {
+      return n;
+    }
+  };
+
+  std::atomic<std::ostream*> diagnostic_stream(nullptr);
+  thread_local std::ostream* thread_diagnostic_stream = nullptr;
+}  // namespace
+
 namespace DFS
 {
-    bool verbose = false;
+    std::atomic<bool> verbose(false);
+
+    std::ostream& diagnostics()
+    {
+      if (thread_diagnostic_stream)
+	return *thread_diagnostic_stream;
+      if (std::ostream* os = diagnostic_stream.load())
+	return *os;
+      // Each thread has its own, since writing to a stream changes
+      // its state (for example, its format flags).
+      static thread_local DiscardBuffer discard_buffer;
+      static thread_local std::ostream discard(&discard_buffer);
+      return discard;
+    }
+
+    void set_diagnostic_stream(std::ostream* os)
+    {
+      diagnostic_stream.store(os);
+    }
+
+    std::ostream* set_thread_diagnostic_stream(std::ostream* os)
+    {
+      std::ostream* previous = thread_diagnostic_stream;
+      thread_diagnostic_stream = os;
+      return previous;
+    }
 }  // namespace DFS
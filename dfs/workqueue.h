@@ -0,0 +1,293 @@
+//
+//   Copyright 2020 James Youngman
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+//
+// Machinery for handing work from one thread to a pool of others.
+#ifndef INC_WORKQUEUE_H
+#define INC_WORKQUEUE_H 1
+
+#include <stddef.h>            // for size_t
+#include <algorithm>           // for min, stable_sort
+#include <atomic>              // for atomic
+#include <condition_variable>  // for condition_variable
+#include <deque>               // for deque
+#include <exception>           // for exception_ptr, current_exception, rethrow_exception
+#include <functional>          // for function
+#include <mutex>               // for mutex, unique_lock, lock_guard
+#include <optional>            // for optional
+#include <thread>              // for thread
+#include <utility>             // for move
+#include <vector>              // for vector
+
+namespace DFS
+{
+  // A first-in, first-out queue holding at most capacity items.
+  // Producers block while it is full, so a fast producer cannot run
+  // arbitrarily far ahead of the consumers.
+  template <class T>
+  class BoundedQueue
+  {
+  public:
+    explicit BoundedQueue(size_t capacity)
+      : capacity_(capacity ? capacity : 1), closed_(false)
+    {
+    }
+
+    // Block until there is space, then add item.  Returns false
+    // (discarding item) if the queue has been closed.
+    bool push(T item)
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      not_full_.wait(lock, [this]() { return closed_ || items_.size() < capacity_; });
+      if (closed_)
+	return false;
+      items_.push_back(std::move(item));
+      not_empty_.notify_one();
+      return true;
+    }
+
+    // Block until an item is available and return it.  Once the queue
+    // has been closed and drained, returns an empty optional.
+    std::optional<T> pop()
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      not_empty_.wait(lock, [this]() { return closed_ || !items_.empty(); });
+      if (items_.empty())
+	return std::nullopt;
+      std::optional<T> result(std::move(items_.front()));
+      items_.pop_front();
+      not_full_.notify_one();
+      return result;
+    }
+
+    // No more items will be added.  Consumers still receive the items
+    // which are already queued.
+    void close()
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      closed_ = true;
+      not_empty_.notify_all();
+      not_full_.notify_all();
+    }
+
+  private:
+    std::mutex mu_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<T> items_;
+    size_t capacity_;
+    bool closed_;
+  };
+
+  // Run consume() on each item of a BoundedQueue using a fixed number
+  // of worker threads.  The destructor closes the queue and waits for
+  // the workers to finish, so the pool is safe to abandon when an
+  // exception is thrown in the producing thread.
+  template <class T>
+  class WorkerPool
+  {
+  public:
+    WorkerPool(unsigned int workers, size_t queue_capacity,
+	       std::function<void(T&)> consume)
+      : queue_(queue_capacity), consume_(std::move(consume))
+    {
+      threads_.reserve(workers);
+      for (unsigned int i = 0; i < workers; ++i)
+	threads_.emplace_back([this]()
+			      {
+				while (std::optional<T> item = queue_.pop())
+				  consume_(*item);
+			      });
+    }
+
+    ~WorkerPool()
+    {
+      finish();
+    }
+
+    bool submit(T item)
+    {
+      return queue_.push(std::move(item));
+    }
+
+    // Wait for all submitted items to be consumed.
+    void finish()
+    {
+      queue_.close();
+      for (std::thread& t : threads_)
+	{
+	  if (t.joinable())
+	    t.join();
+	}
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+  private:
+    BoundedQueue<T> queue_;
+    std::function<void(T&)> consume_;
+    std::vector<std::thread> threads_;
+  };
+
+  namespace internal
+  {
+    // The queue of task numbers belonging to one worker of
+    // run_work_stealing().
+    class TaskDeque
+    {
+    public:
+      void push_back(size_t n)
+      {
+	std::lock_guard<std::mutex> lock(mu_);
+	items_.push_back(n);
+      }
+
+      // The owner takes work from the front...
+      std::optional<size_t> take_front()
+      {
+	std::lock_guard<std::mutex> lock(mu_);
+	if (items_.empty())
+	  return std::nullopt;
+	size_t n = items_.front();
+	items_.pop_front();
+	return n;
+      }
+
+      // ...and other workers steal from the back.
+      std::optional<size_t> steal_back()
+      {
+	std::lock_guard<std::mutex> lock(mu_);
+	if (items_.empty())
+	  return std::nullopt;
+	size_t n = items_.back();
+	items_.pop_back();
+	return n;
+      }
+
+    private:
+      std::mutex mu_;
+      std::deque<size_t> items_;
+    };
+
+    // Start n_workers threads.  Each repeatedly calls take(me), where
+    // me is its own number, to get the index of a task and then
+    // run(index); a worker stops when take() returns nullopt.  If
+    // run() throws, tasks not yet started are abandoned and the first
+    // exception is rethrown here once every worker has stopped.
+    inline void run_workers(size_t n_workers,
+			    const std::function<std::optional<size_t>(size_t)>& take,
+			    const std::function<void(size_t)>& run)
+    {
+      std::atomic<bool> abandon(false);
+      std::mutex failure_mu;
+      std::exception_ptr failure;
+      auto work = [&](size_t me)
+		  {
+		    while (!abandon)
+		      {
+			std::optional<size_t> next = take(me);
+			if (!next)
+			  return;
+			try
+			  {
+			    run(*next);
+			  }
+			catch (...)
+			  {
+			    std::lock_guard<std::mutex> lock(failure_mu);
+			    if (!failure)
+			      failure = std::current_exception();
+			    abandon = true;
+			  }
+		      }
+		  };
+      std::vector<std::thread> threads;
+      threads.reserve(n_workers);
+      for (size_t i = 0; i < n_workers; ++i)
+	threads.emplace_back(work, i);
+      for (std::thread& t : threads)
+	t.join();
+      if (failure)
+	std::rethrow_exception(failure);
+    }
+  }  // namespace internal
+
+  // Run consume() on each of tasks using (at most) the given number
+  // of worker threads, returning when all are done.  The tasks are
+  // dealt out to the workers in turn, so callers should put the
+  // biggest tasks first.  Each worker takes tasks from the front of
+  // its own queue and, once that is empty, steals from the back of
+  // the others' queues; this keeps every worker busy even when the
+  // sizes of the tasks vary a lot.  If consume() throws, tasks not
+  // yet started are abandoned and the first exception is rethrown
+  // here.
+  template <class T>
+  void run_work_stealing(std::vector<T>& tasks, unsigned int workers,
+			 const std::function<void(T&)>& consume)
+  {
+    if (tasks.empty())
+      return;
+    const size_t n_workers = std::min<size_t>(workers ? workers : 1, tasks.size());
+    std::vector<internal::TaskDeque> queues(n_workers);
+    for (size_t i = 0; i < tasks.size(); ++i)
+      queues[i % n_workers].push_back(i);
+
+    // Tasks are never added, so once every queue is empty there is
+    // nothing more to do.
+    internal::run_workers(n_workers,
+			  [&queues, n_workers](size_t me)
+			  {
+			    std::optional<size_t> next = queues[me].take_front();
+			    for (size_t k = 1; !next && k < n_workers; ++k)
+			      next = queues[(me + k) % n_workers].steal_back();
+			    return next;
+			  },
+			  [&tasks, &consume](size_t i) { consume(tasks[i]); });
+  }
+
+  // Call consume(i) for each i in [0, costs.size()) using (at most)
+  // the given number of worker threads, returning when all are done.
+  // costs[i] is an estimate of how long task i will take.  The tasks
+  // are started most expensive first, each by whichever worker is
+  // next free (the "longest processing time first" rule), so that a
+  // few expensive tasks are not left to run on their own at the end.
+  // Exceptions are handled as for run_work_stealing().
+  inline void run_largest_first(const std::vector<unsigned long>& costs, unsigned int workers,
+				const std::function<void(size_t)>& consume)
+  {
+    if (costs.empty())
+      return;
+    std::vector<size_t> order(costs.size());
+    for (size_t i = 0; i < order.size(); ++i)
+      order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+		     [&costs](size_t a, size_t b) { return costs[a] > costs[b]; });
+
+    const size_t n_workers = std::min<size_t>(workers ? workers : 1, costs.size());
+    std::atomic<size_t> next(0);
+    internal::run_workers(n_workers,
+			  [&next, &order](size_t) -> std::optional<size_t>
+			  {
+			    const size_t n = next++;
+			    if (n >= order.size())
+			      return std::nullopt;
+			    return order[n];
+			  },
+			  consume);
+  }
+
+}  // namespace DFS
+
+#endif